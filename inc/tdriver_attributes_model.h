@@ -0,0 +1,81 @@
+/***************************************************************************
+**
+** Copyright (C) 2010 Nokia Corporation and/or its subsidiary(-ies).
+** All rights reserved.
+** Contact: Nokia Corporation (testabilitydriver@nokia.com)
+**
+** This file is part of Testability Driver.
+**
+** If you have questions regarding the use of this file, please contact
+** Nokia at testabilitydriver@nokia.com .
+**
+** This library is free software; you can redistribute it and/or
+** modify it under the terms of the GNU Lesser General Public
+** License version 2.1 as published by the Free Software Foundation
+** and appearing in the file LICENSE.LGPL included in the packaging
+** of this file.
+**
+****************************************************************************/
+
+
+#ifndef TDRIVERATTRIBUTESMODEL_H
+#define TDRIVERATTRIBUTESMODEL_H
+
+#include <QAbstractTableModel>
+#include <QFont>
+#include <QHash>
+#include <QMap>
+#include <QVector>
+
+#include "tdriver_main_types.h"
+
+class QFontMetrics;
+
+// Attributes of selected test object for the properties dock. Rows are read from the
+// attribute map of MainWindow, which is shared instead of copied into widget items.
+// When the same object gets new values from a refresh, only changed rows are updated.
+class TDriverAttributesModel : public QAbstractTableModel
+{
+    Q_OBJECT
+
+public:
+    typedef QMap<QString, AttributeInfo> AttributeMap;
+
+    explicit TDriverAttributesModel(QObject *parent = 0);
+
+    // objectId and objectType identify the object across refreshes, which create new TestObjectKeys
+    void setAttributes(const AttributeMap &attributes, const QString &objectId, const QString &objectType);
+    void clear();
+
+    const AttributeInfo &attribute(int row) const { return rowIterators.at(row).value(); }
+
+    void setFont(const QFont &font);
+
+    // width for name column, measured once for each object type and font
+    int nameColumnWidth(const QFontMetrics &metrics);
+
+    int rowCount(const QModelIndex &parent = QModelIndex()) const;
+    int columnCount(const QModelIndex &parent = QModelIndex()) const;
+    QVariant data(const QModelIndex &index, int role = Qt::DisplayRole) const;
+    QVariant headerData(int section, Qt::Orientation orientation, int role = Qt::DisplayRole) const;
+    Qt::ItemFlags flags(const QModelIndex &index) const;
+    bool setData(const QModelIndex &index, const QVariant &value, int role = Qt::EditRole);
+
+signals:
+    // attributes are changed by sending set_attribute to sut, so model itself is not changed
+    void attributeEditRequested(const QString &name, const QString &value);
+
+private:
+    static bool isWritable(const AttributeInfo &info);
+    void setRows(const AttributeMap &attributes);
+
+    AttributeMap current;   // implicitly shared with MainWindow::attributesMap
+    QVector<AttributeMap::const_iterator> rowIterators;
+    QString currentId;
+    QString currentType;
+
+    QFont font;
+    QHash<QString, int> nameWidths;
+};
+
+#endif // TDRIVERATTRIBUTESMODEL_H
@@ -18,32 +18,78 @@
 ****************************************************************************/ 
  
  
+#ifndef TDRIVER_BEHAVIOUR_H
+#define TDRIVER_BEHAVIOUR_H
+
+#include <QString>
 #include <QStringList>
-#include <QMap>
+#include <QHash>
+#include <QVector>
+#include <QDataStream>
+
+class QIODevice;
+
+
+struct BehaviourMethod {
+
+    QString name;
+    QString description;
+    QString example;
+
+};
+
 
-class Behaviour {
+// methods of one object type sorted by name; object types with same methods share one table
+typedef QVector<const BehaviourMethod *> BehaviourMethodTable;
+
+
+// Behaviours of object types parsed from get_behaviours reply. Each distinct method
+// descriptor and each distinct method table is stored once, so memory use and lookup
+// don't depend on how many object types use the same behaviour modules.
+class BehaviourRegistry {
 
 public:
 
-    Behaviour();    // constructor
-    ~Behaviour();    // destructor
+    BehaviourRegistry();
+    ~BehaviourRegistry();
+
+    // stream parses behaviours xml, methods are added to object types already known
+    bool parseXml( QIODevice *device, QString *errorString = 0 );
+
+    bool contains( const QString &objectType ) const { return types.contains( objectType ); }
 
-    void addSutType( QString sutType );
-    QStringList getSutTypes();
+    // returns NULL for unknown object type
+    const BehaviourMethodTable *methods( const QString &objectType ) const { return types.value( objectType ); }
 
-    void addControlMethod( QString controlType );
-    QStringList getControlMethods();
+    QStringList objectTypes() const { return types.keys(); }
+    int methodCount() const { return methodList.size(); }
+    int tableCount() const { return tableList.size(); }
 
-    void addMethod(QString methodName, QMap<QString, QString> methodHash );
-    QMap<QString, QString> getMethod( QString methodName );
+    // keeps objectTypes already known, returns false if stream has errors
+    bool merge( QDataStream &in );
+    void write( QDataStream &out ) const;
 
-    QStringList getMethodsList();
+    // cache file is registry data after magic number, format and key; nothing is merged
+    // from file of other format or key
+    bool readCache( QIODevice *device, const QString &key, QString *errorString = 0 );
+    bool writeCache( QIODevice *device, const QString &key ) const;
+
+    void clear();
 
 private:
 
-    QStringList sutTypes;
-    QStringList controlMethods;
-    QMap<QString, QMap<QString, QString> > methods;
+    Q_DISABLE_COPY( BehaviourRegistry )
+
+    const BehaviourMethod *internMethod( const QString &name, const QString &description, const QString &example );
+    const BehaviourMethodTable *internTable( const BehaviourMethodTable &table );
+    void addMethods( const QString &objectType, BehaviourMethodTable table );
+
+    QVector<BehaviourMethod *> methodList;
+    QHash<QString, const BehaviourMethod *> methodIndex;
+    QVector<BehaviourMethodTable *> tableList;
+    QHash<QByteArray, const BehaviourMethodTable *> tableIndex;
+    QHash<QString, const BehaviourMethodTable *> types;
 
 };
 
+#endif // TDRIVER_BEHAVIOUR_H
@@ -0,0 +1,119 @@
+/***************************************************************************
+**
+** Copyright (C) 2010 Nokia Corporation and/or its subsidiary(-ies).
+** All rights reserved.
+** Contact: Nokia Corporation (testabilitydriver@nokia.com)
+**
+** This file is part of Testability Driver.
+**
+** If you have questions regarding the use of this file, please contact
+** Nokia at testabilitydriver@nokia.com .
+**
+** This library is free software; you can redistribute it and/or
+** modify it under the terms of the GNU Lesser General Public
+** License version 2.1 as published by the Free Software Foundation
+** and appearing in the file LICENSE.LGPL included in the packaging
+** of this file.
+**
+****************************************************************************/
+
+#ifndef TDRIVERFINDINDEX_H
+#define TDRIVERFINDINDEX_H
+
+#include <QHash>
+#include <QMap>
+#include <QString>
+#include <QVector>
+
+#include "tdriver_main_types.h"
+
+// Search index of object tree for the find dialog, built once per snapshot.
+// Nodes are numbered in tree order, so subtree of a node is a range of numbers
+// and matches of a query are a sorted list, where next and previous match are
+// found with binary search. Substring queries use trigrams of case folded text
+// and whole word queries exact values to select candidates, which are then
+// checked against the texts stored in the index.
+class TDriverFindIndex
+{
+public:
+    struct Query {
+        QString text;
+        bool caseSensitive;
+        bool entireWords;
+        bool attributes;
+
+        Query() : caseSensitive(false), entireWords(false), attributes(false) {}
+        bool operator==(const Query &other) const {
+            return text == other.text && caseSensitive == other.caseSensitive
+                    && entireWords == other.entireWords && attributes == other.attributes;
+        }
+    };
+
+    TDriverFindIndex() : haveLastQuery(false) {}
+
+    void clear();
+    bool isEmpty() const { return nodes.isEmpty(); }
+    int size() const { return nodes.size(); }
+
+    // nodes must be added in tree order, parent is -1 for top level nodes, returns number of node
+    int addNode(TestObjectKey key, const TreeItemInfo &info, const QMap<QString, AttributeInfo> &attributes, int parent = -1);
+    // end is number of first node after subtree of node
+    void setSubtreeEnd(int node, int end) { nodes[node].subtreeEnd = end; }
+
+    int node(TestObjectKey key) const { return positions.value(key, -1); }
+    TestObjectKey key(int node) const { return nodes.at(node).key; }
+    int subtreeEnd(int node) const { return nodes.at(node).subtreeEnd; }
+    int parent(int node) const { return nodes.at(node).parent; }
+
+    // type, name, id or value of attribute with lower case name, null if node does not have it
+    QString fieldValue(int node, const QString &field) const;
+    // attribute name as in ui dump, as fields are in lower case
+    QString fieldName(int node, const QString &field) const;
+    // sorted nodes where field has exactly given value, index of field is built on first use
+    const QVector<int> &valueNodes(const QString &field, const QString &value);
+
+    bool matches(int node, const Query &query) const;
+    // sorted superset of matching nodes
+    QVector<int> candidates(const Query &query) const;
+    // sorted matching nodes, result of previous query is kept
+    const QVector<int> &find(const Query &query);
+
+    // match after (or before) node current within nodes first..end-1, or -1
+    static int step(const QVector<int> &matches, int current, int first, int end, bool backwards, bool wrap);
+
+private:
+    typedef QHash<quint64, QVector<int> > GramIndex;
+    typedef QHash<QString, QVector<int> > ExactIndex;
+
+    struct Node {
+        TestObjectKey key;
+        QString name;
+        QString type;
+        QString id;
+        QMap<QString, AttributeInfo> attributes; // implicitly shared with MainWindow::attributesMap
+        int subtreeEnd;
+        int parent;
+    };
+
+    static void addText(int node, const QString &text, GramIndex &grams, ExactIndex &exact);
+    static QVector<int> gramCandidates(const QString &folded, const GramIndex &grams);
+    static QVector<int> unite(const QVector<int> &a, const QVector<int> &b);
+
+    QVector<Node> nodes;
+    QHash<TestObjectKey, int> positions;
+
+    // name, type and id of objects are indexed separately from attribute values
+    GramIndex infoGrams;
+    GramIndex attributeGrams;
+    ExactIndex infoExact;
+    ExactIndex attributeExact;
+
+    // exact values of fields used by locators
+    QHash<QString, ExactIndex> fieldIndexes;
+
+    bool haveLastQuery;
+    Query lastQuery;
+    QVector<int> lastMatches;
+};
+
+#endif // TDRIVERFINDINDEX_H
@@ -52,6 +52,9 @@ public:
     ~TDriverImageView();
 
     void refreshImage(const QString &imagePath);
+    // imagePath may be empty for image which is not (or no longer) in a file
+    void showImage(const QImage &newImage, const QString &imagePath = QString());
+    QImage currentImage() const { return *image; }
 
     void drawHighlights( RectList geometries, bool multiple );
     void disableDrawHighlight();
@@ -0,0 +1,68 @@
+/***************************************************************************
+**
+** Copyright (C) 2010 Nokia Corporation and/or its subsidiary(-ies).
+** All rights reserved.
+** Contact: Nokia Corporation (testabilitydriver@nokia.com)
+**
+** This file is part of Testability Driver.
+**
+** If you have questions regarding the use of this file, please contact
+** Nokia at testabilitydriver@nokia.com .
+**
+** This library is free software; you can redistribute it and/or
+** modify it under the terms of the GNU Lesser General Public
+** License version 2.1 as published by the Free Software Foundation
+** and appearing in the file LICENSE.LGPL included in the packaging
+** of this file.
+**
+****************************************************************************/
+
+#ifndef TDRIVERLOCATOR_H
+#define TDRIVERLOCATOR_H
+
+#include <QList>
+#include <QRegularExpression>
+#include <QString>
+#include <QVector>
+
+class TDriverFindIndex;
+
+// TDriver style locator, for example
+//   sut.application( :name => 'calculator' ).QPushButton( :text => 'OK', :visible => 'true' )
+// compiled to steps, where each step selects descendants of objects selected by previous step.
+// A step starts from the shortest list of objects with an exact type or attribute value
+// from the find index, and remaining predicates are checked for those objects only.
+class TDriverLocator
+{
+public:
+    TDriverLocator() : valid(false) {}
+
+    // on error returns invalid locator, and error message with position if error is given
+    static TDriverLocator compile(const QString &text, QString *error = 0);
+
+    bool isValid() const { return valid; }
+
+    // sorted matching nodes of index
+    QVector<int> evaluate(TDriverFindIndex &index) const;
+
+private:
+    struct Predicate {
+        QString field;              // type, name, id or attribute name in lower case
+        QString value;
+        QRegularExpression regexp;  // used instead of value if valid
+        bool isRegexp() const { return !regexp.pattern().isEmpty(); }
+    };
+
+    struct Step {
+        QList<Predicate> predicates;
+        int index;                  // :__index, or -1 for all matches
+        Step() : index(-1) {}
+    };
+
+    bool matches(TDriverFindIndex &index, int node, const Step &step) const;
+
+    QList<Step> steps;
+    bool valid;
+};
+
+#endif // TDRIVERLOCATOR_H
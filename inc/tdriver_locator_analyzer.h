@@ -0,0 +1,56 @@
+/***************************************************************************
+**
+** Copyright (C) 2010 Nokia Corporation and/or its subsidiary(-ies).
+** All rights reserved.
+** Contact: Nokia Corporation (testabilitydriver@nokia.com)
+**
+** This file is part of Testability Driver.
+**
+** If you have questions regarding the use of this file, please contact
+** Nokia at testabilitydriver@nokia.com .
+**
+** This library is free software; you can redistribute it and/or
+** modify it under the terms of the GNU Lesser General Public
+** License version 2.1 as published by the Free Software Foundation
+** and appearing in the file LICENSE.LGPL included in the packaging
+** of this file.
+**
+****************************************************************************/
+
+#ifndef TDRIVERLOCATORANALYZER_H
+#define TDRIVERLOCATORANALYZER_H
+
+#include <QHash>
+#include <QString>
+#include <QVector>
+
+class TDriverFindIndex;
+
+// Finds short locators that select exactly one object of the find index.
+// An object is first identified by its type and the one or two identifying
+// attributes whose values are rarest in the snapshot, counted from the value
+// tables of the index. If that is not unique, the nearest ancestor that can be
+// located is used as parent, and :__index is the last resort. Results are kept
+// until the index changes.
+class TDriverLocatorAnalyzer
+{
+public:
+    void clear() { segments.clear(); locators.clear(); }
+
+    // locator relative to application, or empty if node is sut or application
+    QString uniqueLocator(TDriverFindIndex &index, int node);
+
+private:
+    struct Segment {
+        QString text;
+        QVector<int> matches;   // sorted nodes matching text without parent
+    };
+
+    const Segment &segment(TDriverFindIndex &index, int node);
+    static bool isScopeType(const QString &type);
+
+    QHash<int, Segment> segments;
+    QHash<int, QString> locators;
+};
+
+#endif // TDRIVERLOCATORANALYZER_H
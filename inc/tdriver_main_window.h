@@ -22,6 +22,8 @@
 #define TDRIVERMAINWINDOW_H
 
 #include <QtCore/QSettings>
+#include <QtCore/QCache>
+#include <QtCore/QDateTime>
 
 #include <QPoint>
 #include <QFlags>
@@ -38,6 +40,7 @@
 #include <QFontDialog>
 #include <QGroupBox>
 #include <QHeaderView>
+#include <QImage>
 #include <QLineEdit>
 #include <QMainWindow>
 #include <QMenu>
@@ -50,6 +53,7 @@
 #include <QPushButton>
 #include <QStackedLayout>
 #include <QStatusBar>
+#include <QTableView>
 #include <QTableWidget>
 #include <QTabWidget>
 #include <QTreeWidget>
@@ -62,16 +66,19 @@
 #include <QXmlStreamReader>
 
 class QErrorMessage;
+template <typename T> class QFutureWatcher;
+class QLabel;
 class QScrollArea;
 class QToolBar;
-class QPlainTextEdit;
 
 #include "tdriver_behaviour.h"
 #include <tdriver_util.h>
+#include <tdriver_rbimessage.h>
 
 // visualizer UI classes
 class TDriverRecorder;
 class TDriverImageView;
+class TDriverXmlView;
 
 // libeditor classes
 class TDriverTabbedEditor;
@@ -88,6 +95,10 @@ namespace Ui {
 }
 
 #include "tdriver_main_types.h"
+#include "tdriver_attributes_model.h"
+#include "tdriver_find_index.h"
+#include "tdriver_signals_cache.h"
+#include "tdriver_locator_analyzer.h"
 
 #define DOCK_FEATURES_DEFAULT (QDockWidget::DockWidgetMovable | QDockWidget::DockWidgetFloatable | QDockWidget::DockWidgetClosable)
 
@@ -103,6 +114,7 @@ public:
         commandSetOutputPath,
         commandListApps,
         commandClassMethods,
+        commandClassMethodsBatch,
         commandDisconnectSUT,
         commandRecordingStart,
         commandRecordingStop,
@@ -121,6 +133,8 @@ public:
         commandGetDeviceParameter,
         commandGetAllDeviceParameters,
         commandStartApplication,
+        commandRefreshSubtree,
+        commandSignalPrefetch,
         commandInvalid
     };
 
@@ -222,10 +236,10 @@ private:
 
     bool resendTDriverCommand(SentTDriverMsg &msg);
 
-    bool executeTDriverCommand(ExecuteCommandType commandType,
-                               const QString &commandString,
-                               const QString &additionalInformation = QString(),
-                               BAListMap *reply = NULL);
+    static bool isCoalescableCommand(ExecuteCommandType commandType);
+    static bool isSupersedableCommand(ExecuteCommandType commandType);
+    void cancelTDriverCommand(quint32 seqNum);
+    void updatePendingCommandsProgress();
 
 
     // global data & caches
@@ -256,9 +270,17 @@ private:
     QMap<QAction*, QString> applicationsActionMap;
 
     QMap<TestObjectKey, QMap<QString, AttributeInfo > > attributesMap;
-    QHash<QString, QMap<QString, QHash<QString, QString> > > apiMethodsMap;
-    QHash<QString, QStringList > apiSignalsMap;
-    QMap<QString, Behaviour> behavioursMap;
+
+    // api fixture class methods by method name, then attribute name
+    typedef QMap<QString, QHash<QString, QString> > ApiMethodMap;
+    // LRU in front of on-disk cache, max cost is memory budget in KiB
+    QCache<QString, ApiMethodMap> apiMethodsMap;
+    QString apiMethodsCacheKey;     // key of classes in apiMethodsMap
+    ApiMethodMap apiMethodsUncached; // class that did not fit in memory budget
+    TDriverSignalsCache signalsCache;
+    bool signalsPrefetchEnabled;
+    int signalsPrefetchBatchSize; // types per list_signals_batch, next batch is sent after reply
+    BehaviourRegistry behaviours;
 
     QMap<TestObjectKey, RectList> geometriesMap;
     QSet<TestObjectKey> screenshotObjects;
@@ -269,12 +291,11 @@ private:
     //    QHash<QString, QMap<QString, QString> > objectSignals;
 
     // helper functions
-    static QByteArray cleanDoneResult(QByteArray output);
-
     void updateWindowTitle();
 
     void setActiveDevice( const QString &deviceName );
-    bool getActiveDeviceParameters();
+    void sendActiveDeviceParametersRequest();
+    void applyActiveDeviceType();
     QString getDriverVersionNumber();
 
     void noDeviceSelectedPopup();
@@ -285,6 +306,10 @@ private:
 
     QString selectFolder( QString title, QString filter, QFileDialog::AcceptMode mode, const QString &saveDirKey=QString() );
 
+    // window state of additional session windows is stored under their own group
+    QString sessionSettingsKey( const QString &key ) const;
+    QVariant sessionSettingsValue( const QSettings &settings, const QString &key, const QVariant &defaultValue=QVariant() ) const;
+
     bool createStateArchive( QString target );
 
     // properties widget
@@ -299,7 +324,8 @@ private:
     void createPropertiesDockWidgetApiTabWidget();
 
 
-    QTableWidget *propertiesTable;
+    QTableView *propertiesTable;
+    TDriverAttributesModel *attributesModel;
     QTableWidget *methodsTable;
     QTableWidget *signalsTable;
 
@@ -329,6 +355,7 @@ private:
 
     QTreeWidget *objectTree;
     QString uiDumpFileName;
+    bool uiDumpFileStale;       // xmlDocument has been changed by subtree refresh
 
     void createTreeViewDockWidget();
 
@@ -350,6 +377,10 @@ private:
 
     bool parseObjectTreeXml( QString filename, QDomDocument &resultDomTree );
     void buildScreenshotObjectList(TestObjectKey parentKey=0);
+    TestObjectKey screenshotRootKey();
+    bool isInScreenshotTree( QTreeWidgetItem *item );
+
+    bool spliceObjectSubtree( const QString &objectId, const QString &filename );
 
     void buildObjectTree( QTreeWidgetItem *parentItem, QDomElement parentElement, QMap<QString, QStringList> duplicateItems );
     void buildObjectTree_new_format( QTreeWidgetItem *parentItem, QDomElement parentElement, QMap<QString, QStringList> duplicateItems );
@@ -362,6 +393,7 @@ private:
     void storeItemToObjectTreeMap( QTreeWidgetItem *item, const TreeItemInfo &data);
 
     QTreeWidgetItem * createObjectTreeItem( QTreeWidgetItem *parentItem, const TreeItemInfo &data, QMap<QString, QStringList> duplicateItems );
+    void setObjectTreeItemColumns( QTreeWidgetItem *item, const TreeItemInfo &data, const QMap<QString, QStringList> &duplicateItems );
 
     void objectTreeItemChanged();
 
@@ -398,9 +430,6 @@ private:
     // ui dump xml
     QDomDocument xmlDocument;
 
-    // behaviours xml
-    QDomDocument behaviorDomDocument;
-
     // tdriver_parameters.xml
     bool getXmlParameters( QString filename );
     void updateDevicesList(const QStringList &newDeviceList);
@@ -411,9 +440,15 @@ private:
     void resetApplicationsList();
 
     // behaviours.xml
-    void buildBehavioursMap();
+    bool buildBehavioursMap( const QString &fileName );
     bool sendUpdateBehaviourXml();
 
+    // behaviours are stored on disk for each cuTeDriver version and sut type
+    QString behavioursCacheKey; // key of cache loaded to behaviours, empty if none
+    QString currentBehavioursCacheKey();
+    void loadBehavioursCache();
+    void saveBehavioursCache();
+
     // visualizer_dump_sut_id.xml
     void parseUiDump( QString filename );
 
@@ -421,7 +456,15 @@ private:
     bool apiFixtureEnabled;
     bool apiFixtureChecked;
     void parseApiMethodsXml( QString filename );
+    QString currentApiMethodsCacheKey();
+    const ApiMethodMap *apiMethods( const QString &className );
+    bool hasApiMethods( const QString &className );
+    void storeApiMethods( const QString &className, const ApiMethodMap &methods );
+    bool sendApiMethodsPrefetch();
     QStringList parseSignalsXml( QString filename );
+    bool parseSignalsBatchXml( const QString &filename, const QString &appName );
+    bool sendSignalsPrefetch();
+    void showSignalsList( const QStringList &signalsList );
 
     // other methods
     void connectObjectTreeSignals();
@@ -467,6 +510,7 @@ private:
     QAction *aboutVisualizer;
 
     // file
+    QAction *newSessionAction;
     QAction *parseSUT;
     QAction *loadXmlAction;
     QAction *saveStateAction;
@@ -474,6 +518,7 @@ private:
     QAction *fontAction;
     QAction *appsRefreshAction;
     QAction *refreshAction;
+    QAction *refreshSubtreeAction;
     QAction *delayedRefreshAction;
     QAction *sutDisconnectAction;
     QAction *exitAction;
@@ -549,15 +594,22 @@ private:
     // properties
     QDockWidget *propertiesDock;
 
+    // RBI round-trip diagnostics
+    void createDiagnosticsDockWidget();
+    QDockWidget *diagnosticsDock;
+    QTableWidget *diagnosticsTable;
+    QLabel *diagnosticsChannelLabel;
+
     // show xml
 
     void createXMLFileDataWindow();
+    void updateXmlSourceView();
 
     // store find dialog position
     QPoint xmlViewPos;
 
     QDialog *xmlView;
-    QPlainTextEdit *sourceEdit;
+    TDriverXmlView *xmlSourceView;
     QComboBox *findStringComboBox;
 
     QCheckBox *showXmlMatchCase;
@@ -580,16 +632,25 @@ private:
     QCheckBox *findDialogWrapAround;
     QCheckBox *findDialogAttributes;
     QCheckBox *findDialogSubtreeOnly;
+    QCheckBox *findDialogLocator;
+    QTimer *findDialogLocatorTimer;
 
     TDriverComboLineEdit *findDialogText;
 
     QDialog *findDialog;
     QPushButton *findDialogFindButton;
     QPushButton *findDialogCloseButton;
+    QPushButton *findDialogFindAllButton;
+    QTreeWidget *findDialogResults;
+    QLabel *findDialogResultsLabel;
+    QFutureWatcher<QVector<int> > *findAllWatcher;
+    int findAllSearched;            // objects checked by running or finished find all
+    RectList findAllRects;          // geometries of matches on screenshot
+    QString locatorText;            // locator of locatorMatches, empty if not evaluated
+    QVector<int> locatorMatches;
     QTreeWidgetItem *findDialogSubtreeRoot;
-
-    bool containsWords( const TreeItemInfo &itemData, QString text, bool caseSensitive, bool entireWords  );
-    bool attributeContainsWords( TestObjectKey itemPtr, QString text, bool caseSensitive, bool entireWords );
+    TDriverFindIndex findIndex; // built on first search after object tree changes
+    TDriverLocatorAnalyzer locatorAnalyzer; // unique locators of findIndex nodes
 
     QErrorMessage *tdriverMsgBox;
     int tdriverMsgTotal;
@@ -598,6 +659,7 @@ private:
     QString keyLastUiStateDir;
     QString keyLastTDriverDir;
     QString keyHistoryStateDirCount;
+    int sessionIndex; // 0 for first window, lowest free index for additional session windows
 
     // start app dialog
 
@@ -633,7 +695,7 @@ private slots:
     void tabWidgetChanged( int currentTableWidget );
 
     void methodItemPressed( QTableWidgetItem *item );
-    void propertiesItemPressed( QTableWidgetItem *item );
+    void propertiesItemPressed( const QModelIndex &index );
     void apiItemPressed( QTableWidgetItem *item );
 
     void showMainVisualizerAssistant();
@@ -653,13 +715,16 @@ private slots:
     void createClipboardBar();
 
     void updateClipboardText( QString text, bool appendText );
-    void changePropertiesTableValue( QTableWidgetItem *item );
+    void changePropertiesTableValue( const QString &attributeName, const QString &value );
+
 
+    void openSessionWindow();
 
     // object tree
     void delayedRefreshData();
     void forceRefreshData();
     void forceRefreshApps();
+    void refreshSubtree();
 
     void sendAppListRequest(bool refreshAfter);
 
@@ -743,6 +808,12 @@ private slots:
 
     void showFindDialog();
     void findNextTreeObject();
+    void findAllTreeObjects();
+    void findAllResultsReady( int begin, int end );
+    void findAllFinished();
+    void findDialogResultSelected( QTreeWidgetItem *item );
+    void findDialogLocatorToggled( bool checked );
+    void evaluateFindDialogLocator();
 
     void findDialogTextChanged( const QString & text );
     void findDialogHandleTreeCurrentChange(QTreeWidgetItem*current);
@@ -756,14 +827,61 @@ private slots:
     void startAppDialogEnableStartButton(const QString & text );
     void startAppDialogReturnPress();
 
+    void receiveRbiMessage(const TDriverRbiMessage &message);
     void receiveTDriverMessage(quint32 seqNum, QByteArray name, const BAListMap &reply = BAListMap());
     void messageTimeoutSlot();
     void resetMessageSequenceFlags();
 
+    void updateDiagnostics();
+    void resetDiagnostics();
+
 private:
 
     QMap<quint32, SentTDriverMsg> sentTDriverMsgs; // maps seqnum of sent message to message type
     QTimer *messageTimeoutTimer;
+    QProgressBar *pendingCommandsProgress; // shown in status bar while sentTDriverMsgs is not empty
+    QProgressBar *uiDumpProgress;   // bytes and objects read, shown in status bar while readUiDump runs
+    int objectTreeGeneration;       // incremented whenever object tree is cleared
+    bool uiDumpReading;             // readUiDump is adding items to object tree
+
+    bool readUiDump( const QString &filename, QTreeWidgetItem *&sutItem );
+    QTreeWidgetItem *createSutItem( const QDomElement &element );
+    QTreeWidgetItem *addUiDumpObject( QTreeWidgetItem *parentItem, const QDomElement &element );
+    void markDuplicateObjectNames( QTreeWidgetItem *sutItem );
+
+    // object tree, attributes and screen capture of recently selected applications,
+    // shown when application is selected again until the refresh started by appSelected completes
+    struct AppSnapshot {
+        QTreeWidgetItem *sutItem;   // detached from objectTree, owned by snapshot
+        QMap<TestObjectKey, QMap<QString, AttributeInfo > > attributesMap;
+        QMap<TestObjectKey, RectList> geometriesMap;
+        QSet<TestObjectKey> screenshotObjects;
+        QMap<TestObjectKey, TreeItemInfo > objectTreeData;
+        QHash<QString, TestObjectKey> objectIdMap;
+        QDomDocument xmlDocument;
+        QImage image;
+        QString focusId;
+        QList<TestObjectKey> expandedKeys;
+        QDateTime captured;
+
+        AppSnapshot() : sutItem(NULL) {}
+        ~AppSnapshot() { delete sutItem; }
+        int cost() const;           // estimated memory use in KiB
+    };
+    QCache<QString, AppSnapshot> appSnapshots; // max cost is memory budget in KiB, 0 disables
+    QLabel *appSnapshotLabel;       // staleness marker shown while cached snapshot is visible
+    QDateTime appSnapshotShown;     // capture time of visible snapshot, invalid after refresh
+    QString appSnapshotPendingKey;  // previous application still shown in tree, stored when tree is replaced
+    QImage appSnapshotPendingImage; // image of previous application, captured on application selection
+
+    QString appSnapshotKey() const;
+    void storeAppSnapshot(const QString &key, const QImage &image);
+    void storePendingAppSnapshot();
+    bool restoreAppSnapshot();
+    void clearAppSnapshotMarker();
+    QTimer *diagnosticsTimer;
+    quint32 diagnosticsChangeCount;
+    QString diagnosticsJsonFile;
     bool doRefreshAfterAppList;
     int historySavingCounter; // -1 for done state; bits to reset: 1 for dui dump, 2 for image
     QWidget *richTextContainerWidget;
@@ -776,9 +894,18 @@ private:
     void closeEvent( QCloseEvent *event );
 
     QString treeObjectRubyId(TestObjectKey treeItemPtr, TestObjectKey sutItemPtr);
+    QString objectRubyPath(QTreeWidgetItem *item, bool fullPath);
     QTreeWidgetItem *findDialogSubtreeNext(QTreeWidgetItem *current, QTreeWidgetItem *root, bool wrap=false);
-    QTreeWidgetItem *findDialogSubtreePrev(QTreeWidgetItem *current, QTreeWidgetItem *root, bool wrap=false);
-    bool compareTreeItem(QTreeWidgetItem *item, const QString &findString, bool matchCase, bool entireWords, bool searchAttributes);
+    void updateFindDialogSubtreeRoot(QTreeWidgetItem *current);
+    void rebuildFindIndex();
+    void invalidateFindIndex();
+    void addFindAllResults(const QVector<int> &nodes);
+    void showFindAllCount();
+    RectList screenshotRects(const QVector<int> &nodes);
+    void highlightFindAllRects();
+    bool findDialogLocatorMatches(const QString &text, QVector<int> &matches, QString *error);
+    void cancelFindAll();
+    void addToFindIndex(QTreeWidgetItem *item, int parentNode);
     void findFromSubTree(QTreeWidgetItem *current, const QString &findString, bool backwards, bool matchCase, bool entireWords, bool searchWrapAround, bool searchAttributes);
 
 };
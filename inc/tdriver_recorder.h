@@ -29,8 +29,11 @@
 #include <QMap>
 
 #include <tdriver_rubyinterface.h>
+#include <tdriver_rbimessage.h>
 
 class QPlainTextEdit;
+class QProgressBar;
+class QTimer;
 
 class TDriverRecorder : public QDialog {
 
@@ -51,10 +54,23 @@ class TDriverRecorder : public QDialog {
         void stopRecording();
         void testRecording();
 
+    private slots:
+        void rbiMessage(const TDriverRbiMessage &message);
+        void pendingTimeout();
+
     private:
+        enum PendingCommand { NoCommand, StartCommand, StopCommand, TestCommand };
+
         void setup();
         void setActionsEnabled(bool start, bool stop, bool test);
 
+        // commands are sent asynchronously, and handled in recordingStarted etc when reply arrives
+        bool sendCommand(PendingCommand command, const BAListMap &msg, int timeout);
+        void finishCommand(bool ok, const BAListMap &reply);
+        void recordingStarted(bool ok, const BAListMap &reply);
+        void recordingStopped(bool ok, const BAListMap &reply);
+        void recordingTested(bool ok, const BAListMap &reply);
+
     private:
         QString lastRecordFileName;
 
@@ -65,6 +81,11 @@ class TDriverRecorder : public QDialog {
         QPushButton* mRecButton;
         QPushButton* mStopButton;
         QPushButton* mTestButton;
+        QProgressBar* mProgress;
+
+        PendingCommand mPendingCommand;
+        quint32 mPendingSeqNum;
+        QTimer* mPendingTimer;
 
         QString mActiveApp;
         QString mStrActiveDevice;
@@ -0,0 +1,66 @@
+/***************************************************************************
+**
+** Copyright (C) 2010 Nokia Corporation and/or its subsidiary(-ies).
+** All rights reserved.
+** Contact: Nokia Corporation (testabilitydriver@nokia.com)
+**
+** This file is part of Testability Driver.
+**
+** If you have questions regarding the use of this file, please contact
+** Nokia at testabilitydriver@nokia.com .
+**
+** This library is free software; you can redistribute it and/or
+** modify it under the terms of the GNU Lesser General Public
+** License version 2.1 as published by the Free Software Foundation
+** and appearing in the file LICENSE.LGPL included in the packaging
+** of this file.
+**
+****************************************************************************/
+
+#ifndef TDRIVER_SIGNALS_CACHE_H
+#define TDRIVER_SIGNALS_CACHE_H
+
+#include <QString>
+#include <QStringList>
+#include <QHash>
+#include <QMap>
+#include <QSet>
+
+class QIODevice;
+
+
+// Signal lists of object types, by application name and then by object type + '/' + env.
+// Signals of a type stay the same until the application is restarted, which is detected
+// from the new process id of the application. Types whose signal fixture failed are not
+// cached, only remembered so that prefetch does not request them again.
+class TDriverSignalsCache {
+
+public:
+
+    static QString typeKey( const QString &objectType, const QString &env ) { return objectType + '/' + env; }
+
+    bool contains( const QString &appName, const QString &typeKey ) const;
+    QStringList value( const QString &appName, const QString &typeKey ) const;
+
+    void insert( const QString &appName, const QString &appId, const QString &typeKey, const QStringList &signalsList );
+    void insertFailed( const QString &appName, const QString &appId, const QString &typeKey );
+    bool isFailed( const QString &appName, const QString &typeKey ) const;
+
+    // stream parses list_signals_batch reply, returns number of cached types or -1 on xml error
+    int parseBatchXml( QIODevice *device, const QString &appName, const QString &appId, QString *errorString = 0 );
+
+    // drops applications not running with the same id, applications maps process id to name
+    void invalidate( const QMap<QString, QString> &applications );
+    void clear();
+
+private:
+
+    void setAppId( const QString &appName, const QString &appId );
+
+    QHash<QString, QHash<QString, QStringList> > lists;
+    QHash<QString, QSet<QString> > failed;
+    QHash<QString, QString> appIds; // application id when signals were cached
+
+};
+
+#endif // TDRIVER_SIGNALS_CACHE_H
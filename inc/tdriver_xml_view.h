@@ -0,0 +1,96 @@
+/***************************************************************************
+**
+** Copyright (C) 2010 Nokia Corporation and/or its subsidiary(-ies).
+** All rights reserved.
+** Contact: Nokia Corporation (testabilitydriver@nokia.com)
+**
+** This file is part of Testability Driver.
+**
+** If you have questions regarding the use of this file, please contact
+** Nokia at testabilitydriver@nokia.com .
+**
+** This library is free software; you can redistribute it and/or
+** modify it under the terms of the GNU Lesser General Public
+** License version 2.1 as published by the Free Software Foundation
+** and appearing in the file LICENSE.LGPL included in the packaging
+** of this file.
+**
+****************************************************************************/
+
+#ifndef TDRIVERXMLVIEW_H
+#define TDRIVERXMLVIEW_H
+
+#include <QAbstractScrollArea>
+#include <QByteArray>
+#include <QString>
+#include <QVector>
+
+class QFile;
+
+// Read-only view of ui dump xml for Show XML. Dump is not converted to a text
+// document: a copy of the file is memory mapped and split to lines of one tag
+// or text node in a single pass, and only visible lines are decoded and painted
+// with indentation. Find searches raw bytes of the dump.
+class TDriverXmlView : public QAbstractScrollArea
+{
+    Q_OBJECT
+
+public:
+    explicit TDriverXmlView(QWidget *parent = 0);
+    ~TDriverXmlView();
+
+    // original dump file is overwritten by next refresh, so a copy is mapped
+    bool setFile(const QString &fileName);
+    void setData(const QByteArray &xml);
+    void clear();
+
+    bool isEmpty() const { return lines.isEmpty(); }
+    int lineCount() const { return lines.size(); }
+    QString lineText(int line) const;
+    QString selectedText() const;
+
+    // searches from current match or line, selects and shows found match
+    bool find(const QString &text, bool caseSensitive, bool entireWords, bool backwards, bool wrapAround);
+    // shows start tag of object element with given id
+    bool showObject(const QString &id);
+
+    // offset of first match starting at or after from, or at or before from when
+    // searching backwards; -1 when there is no match
+    static qint64 search(const char *data, qint64 size, const QByteArray &pattern, qint64 from,
+                         bool caseSensitive, bool entireWords, bool backwards);
+
+protected:
+    virtual void paintEvent(QPaintEvent *event);
+    virtual void resizeEvent(QResizeEvent *event);
+    virtual void mousePressEvent(QMouseEvent *event);
+    virtual void keyPressEvent(QKeyEvent *event);
+
+private:
+    struct Line {
+        qint64 offset;
+        int length;     // bytes, without surrounding whitespace
+        int depth;
+    };
+
+    void setBytes(const char *bytes, qint64 size);
+    void layoutLines();
+    qint64 markupEnd(qint64 pos) const;
+    void updateScrollBars();
+    void showLine(int line);
+    int lineAt(qint64 offset) const;
+    int columns(qint64 offset, qint64 bytes) const;
+
+    QFile *mappedFile;
+    QByteArray ownData;
+    const char *data;
+    qint64 dataSize;
+
+    QVector<Line> lines;
+    int maxColumns;
+
+    int currentLine;        // -1 when no line is current
+    qint64 matchOffset;     // -1 when no match is selected
+    int matchLength;
+};
+
+#endif // TDRIVERXMLVIEW_H
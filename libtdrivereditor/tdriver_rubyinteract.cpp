@@ -26,15 +26,21 @@
 #include <QToolBar>
 #include <QLabel>
 #include <QMessageBox>
+#include <QTimer>
 
 #include "tdriver_editor_common.h"
 
 #include <tdriver_rubyinterface.h>
+#include <tdriver_rbistatistics.h>
+#include <tdriver_rbidispatcher.h>
 
 #include <tdriver_debug_macros.h>
 #include <tdriver_util.h>
 
 
+static quint32 sandboxCounter = 0;
+
+
 TDriverRubyInteract::TDriverRubyInteract(QWidget *parent) :
     TDriverRunConsole(false, parent) // false means QProcess will not be created
   , resetAct(NULL)
@@ -42,6 +48,9 @@ TDriverRubyInteract::TDriverRubyInteract(QWidget *parent) :
   , stdoutFormat(new QTextCharFormat)
   , stderrFormat(new QTextCharFormat)
   , prevSeqNum(0)
+  , sandboxId(QByteArray::number(++sandboxCounter))
+  , resetSeqNum(0)
+  , resetTimer(new QTimer(this))
 {
     stdoutFormat->setForeground(QBrush(Qt::darkGray));
     stdoutFormat->setFontFixedPitch(true);
@@ -54,6 +63,9 @@ TDriverRubyInteract::TDriverRubyInteract(QWidget *parent) :
 
     createActions();
 
+    resetTimer->setSingleShot(true);
+    connect(resetTimer, SIGNAL(timeout()), this, SLOT(resetTimeout()));
+
     connect(TDriverRubyInterface::globalInstance(), SIGNAL(rubyProcessFinished()),
             this, SLOT(resetQueryQueue()));
 
@@ -62,14 +74,30 @@ TDriverRubyInteract::TDriverRubyInteract(QWidget *parent) :
     connect(TDriverRubyInterface::globalInstance(), SIGNAL(rubyOutput(int, quint32,QByteArray)),
             this, SLOT(rbiText(int, quint32,QByteArray)));
 
-    connect(TDriverRubyInterface::globalInstance(), SIGNAL(messageReceived(quint32,QByteArray,BAListMap)),
-            this, SLOT(rbiMessage(quint32,QByteArray,BAListMap)));
+    // visualization messages are not routed here, so they don't affect queryQueue
+    TDriverRbiDispatcher::globalInstance()->subscribe(TDriverUtil::interactionId, this,
+                                                      SLOT(rbiMessage(TDriverRbiMessage)));
+    TDriverRbiDispatcher::globalInstance()->subscribe("interact reset", this,
+                                                      SLOT(rbiMessage(TDriverRbiMessage)));
 
     // used for progressing in query queue after receiving a reply
     connect(this, SIGNAL(requestNextQuery()), this, SLOT(sendNextQuery()), Qt::QueuedConnection);
 }
 
 
+TDriverRubyInteract::~TDriverRubyInteract()
+{
+    // script is shared by all windows, so only the sandbox of this window is released
+    TDriverRubyInterface *rbi = TDriverRubyInterface::globalInstance();
+    if (rbi && rbi->isOnline()) {
+        BAListMap msg;
+        msg["sandbox"] << sandboxId;
+        msg["release"] << "true";
+        rbi->sendCmd("interact reset", msg);
+    }
+}
+
+
 void TDriverRubyInteract::resetQueryQueue()
 {
     while ( !queryQueue.empty() ) {
@@ -77,11 +105,11 @@ void TDriverRubyInteract::resetQueryQueue()
 
         switch (query.type) {
         case QueryQueueItem::COMPLETION:
-            qDebug() << FCFL << "completionError for statement:" << query.statement;
+            qCDebug(logEditor) << FCFL << "completionError for statement:" << query.statement;
             emit completionError(query.client, query.statement, QStringList());
             break;
         case QueryQueueItem::EVALUATION:
-            qDebug() << FCFL << "evaluationnError for statement:" << query.statement;
+            qCDebug(logEditor) << FCFL << "evaluationnError for statement:" << query.statement;
             emit evaluationError(query.client, query.statement, QStringList());
             break;
         }
@@ -109,13 +137,42 @@ static QString joinLines(const BAList &lines)
 
 void TDriverRubyInteract::resetScript()
 {
-    qDebug() << FCFL;
+    qCDebug(logEditor) << FCFL;
+
+    if (resetSeqNum != 0) return; // already waiting for reset
 
     resetQueryQueue();
     prevSeqNum = 0;
 
+    // reply is handled in rbiMessage, so editor stays responsive while waiting
     BAListMap msg;
-    bool ok = TDriverRubyInterface::globalInstance()->executeCmd("interact reset", msg, 5000, "reset");
+    msg["sandbox"] << sandboxId;
+    resetSeqNum = TDriverRubyInterface::globalInstance()->sendCmd("interact reset", msg);
+    if (resetSeqNum == 0) {
+        qCDebug(logEditor) << FCFL << "sendCmd returned failure";
+        QMessageBox::warning(this, tr("Ruby reset error"),
+                             tr("Could not send command 'interact reset'."));
+        return;
+    }
+
+    resetAct->setEnabled(false);
+    console->appendLine(tr("Resetting Ruby instance..."), console->notifyFormat);
+    resetTimer->start(5000);
+}
+
+
+void TDriverRubyInteract::resetTimeout()
+{
+    qCDebug(logEditor) << FCFL << "no reply to" << resetSeqNum;
+    finishReset(false, BAListMap());
+}
+
+
+void TDriverRubyInteract::finishReset(bool ok, const BAListMap &msg)
+{
+    resetSeqNum = 0;
+    resetTimer->stop();
+    resetAct->setEnabled(true);
 
     if (ok) {
         if (msg.contains("error")) {
@@ -126,13 +183,12 @@ void TDriverRubyInteract::resetScript()
 
         }
         else {
-            qDebug() << FCFL << "success";
-            QMessageBox::information(this, tr("Ruby instance reseted"),
-                                 tr("Successfully created a new instance for interactive Ruby evaluation."));
+            qCDebug(logEditor) << FCFL << "success";
+            console->appendLine(tr("Successfully created a new instance for interactive Ruby evaluation."),
+                                console->notifyFormat);
         }
     }
     else {
-        qDebug() << FCFL << "executeCmd returned false";
         TDriverRubyInterface::globalInstance()->requestClose();
         QMessageBox::warning(this, tr("Ruby reset time-out"),
                              tr("Reset command time-out,\nrequested closing Ruby process."));
@@ -168,7 +224,7 @@ void TDriverRubyInteract::createActions()
 
 void  TDriverRubyInteract::procStarted(void)
 {
-    qDebug() << FCFL;
+    qCDebug(logEditor) << FCFL;
     console->appendLine("PROCESS STARTED", console->notifyFormat);
     //state = READ_PROMPT;
 }
@@ -176,7 +232,7 @@ void  TDriverRubyInteract::procStarted(void)
 
 void TDriverRubyInteract::rubyIsOnline()
 {
-    qDebug() << FCFL;
+    qCDebug(logEditor) << FCFL;
 }
 
 
@@ -198,18 +254,19 @@ bool TDriverRubyInteract::sendNextQuery()
         if (query.rbiSeqNum == 0) {
             BAListMap msg;
             msg["command"] << query.command << query.statement;
+            msg["sandbox"] << sandboxId;
             query.rbiSeqNum = TDriverRubyInterface::globalInstance()->sendCmd(TDriverUtil::interactionId, msg);
             if (query.rbiSeqNum == 0) {
-                qDebug() <<FCFL << ">>>> sendCmd returned failure, command remains in queryQueue, size" << queryQueue.size();
+                qCDebug(logEditor) <<FCFL << ">>>> sendCmd returned failure, command remains in queryQueue, size" << queryQueue.size();
                 return false;
             }
             else {
-                qDebug() <<FCFL << ">>>> sendCmd returned seqnum" << query.rbiSeqNum;
+                qCDebug(logEditor) <<FCFL << ">>>> sendCmd returned seqnum" << query.rbiSeqNum;
                 return true;
             }
         }
         else {
-            qDebug() << FCFL << "Unable to send command at the moment, with queryQueue size"<< queryQueue.size();
+            qCDebug(logEditor) << FCFL << "Unable to send command at the moment, with queryQueue size"<< queryQueue.size();
             return false;
         }
     }
@@ -244,9 +301,19 @@ bool TDriverRubyInteract::evalStatement(QByteArray statement)
 }
 
 
-void TDriverRubyInteract::rbiMessage(quint32 seqNum, QByteArray name, BAListMap message)
+void TDriverRubyInteract::rbiMessage(const TDriverRbiMessage &rbiMessage)
 {
-    //qDebug() << FCFL << "ENTRY for" << seqNum << name;
+    const quint32 seqNum = rbiMessage.seqNum();
+    const QByteArray &name = rbiMessage.name();
+    const BAListMap &message = rbiMessage.map();
+
+    if (resetSeqNum != 0 && seqNum == resetSeqNum && name == "interact reset") {
+        TDriverRbiStatistics::globalInstance()->messageHandled(seqNum);
+        finishReset(true, message);
+        return;
+    }
+    if (name == "interact reset") return; // late reply after reset time-out
+
     if (queryQueue.isEmpty()) return; // no pending queries
 
     struct QueryQueueItem &query = queryQueue.first();
@@ -268,21 +335,19 @@ void TDriverRubyInteract::rbiMessage(quint32 seqNum, QByteArray name, BAListMap
                         completionLines << QString::fromLocal8Bit(line.constData(), line.size());
                     }
                 }
-                //qDebug() << FCFL << completionLines;
                 emit completionResult(query.client, query.statement, completionLines);
             }
             break;
 
         case QueryQueueItem::EVALUATION:
-            //qDebug() << FCFL << "EVALUATION RESULT" << message;
             //emit evaluationResult(query.client, query.statement, resultLines); // sent by rbiStdoutText/rbiStderrText
             emit evaluationResult(query.client, query.statement, QStringList()); // sent by rbiStdoutText/rbiStderrText
             break;
 
         }
+        TDriverRbiStatistics::globalInstance()->messageHandled(seqNum);
     }
     else {
-        //qDebug() << FCFL << "name" << name << "with received seqNum" << seqNum << "vs. removed queue seqNum" << query.rbiSeqNum;
         // NOTE: assert below assumes overlapping queries won't be send, so all except first item in queue have seqNum 0
         Q_ASSERT(queryQueue.length() < 2 || queryQueue.at(1).rbiSeqNum == 0);
     }
@@ -309,7 +374,7 @@ void TDriverRubyInteract::rbiText(int fnum, quint32 seqNum, QByteArray text)
         else if (fnum == 1)
             console->appendText(QString::fromLocal8Bit(text.constData(), text.size()), *stderrFormat);
 
-        else qDebug() << FCFL << "bad fnum" << fnum << seqNum << text;
+        else qCDebug(logEditor) << FCFL << "bad fnum" << fnum << seqNum << text;
     }
     // else not for us
 }
@@ -29,15 +29,18 @@
 #include "tdriver_runconsole.h"
 
 #include <tdriver_rubyinterface.h>
+#include <tdriver_rbimessage.h>
 
 
 class QTextCharFormat;
+class QTimer;
 
 class LIBTDRIVEREDITORSHARED_EXPORT TDriverRubyInteract : public TDriverRunConsole
 {
 Q_OBJECT
 public:
     explicit TDriverRubyInteract(QWidget *parent = 0);
+    ~TDriverRubyInteract();
 
 
 signals:
@@ -60,8 +63,9 @@ public slots:
 protected slots:
     virtual void procStarted(void); // interited from RunConsole
 
-    void rbiMessage(quint32 seqNum, QByteArray name, BAListMap message);
+    void rbiMessage(const TDriverRbiMessage &rbiMessage);
     void rbiText(int fnum, quint32 seqNum, QByteArray text);
+    void resetTimeout();
 
 protected:
     void createActions();
@@ -82,6 +86,7 @@ protected:
 
 private:
     bool checkOutputSeqNum(quint32 seqNum);
+    void finishReset(bool ok, const BAListMap &msg);
 
 private:
     bool isReady;
@@ -89,6 +94,10 @@ private:
     QTextCharFormat *stderrFormat;
 
     quint32 prevSeqNum; // used for accepting STDOUT/STDERR text coming after message text
+
+    QByteArray sandboxId; // evaluation context of this console in the shared script
+    quint32 resetSeqNum; // non-zero while "interact reset" is waiting for reply
+    QTimer *resetTimer;
 };
 
 #endif // TDRIVER_RUBYINTERACT_H
@@ -158,7 +158,7 @@ void TDriverFeaturAbstractView::aFileChanged(const QString &path)
 
 void TDriverFeaturAbstractView::resetPath(const QString &path)
 {
-    qDebug() << FCFL << path;
+    qCDebug(logFeature) << FCFL << path;
     if(path != __locationBox->currentText()) {
         setPath(path);
         reScan();
@@ -168,14 +168,14 @@ void TDriverFeaturAbstractView::resetPath(const QString &path)
 
 void TDriverFeaturAbstractView::resetPathFromIndex(const QModelIndex &index)
 {
-    qDebug() << FCFL;
+    qCDebug(logFeature) << FCFL;
 
     QString path;
 
     const QAbstractItemModel *model = index.model();
     if (index.isValid() && model) {
         path = model->data(index, ActualPathRole).toString();
-        qDebug() << FCFL << "got path from model:" << path;
+        qCDebug(logFeature) << FCFL << "got path from model:" << path;
     }
     setPath(path);
     reScan();
@@ -184,7 +184,7 @@ void TDriverFeaturAbstractView::resetPathFromIndex(const QModelIndex &index)
 void TDriverFeaturAbstractView::resetPathFromBox()
 {
     QString path = __locationBox->currentText();
-    qDebug() << FCFL << path;
+    qCDebug(logFeature) << FCFL << path;
 
     setPath(path);
     reScan();
@@ -217,7 +217,7 @@ int TDriverFeaturAbstractView::reScan()
     case FileSectionScan: ret = doFileSectionScan(); break;
     }
 
-    qDebug() << FCFL << __scanType << ret;
+    qCDebug(logFeature) << FCFL << __scanType << ret;
 
     __locationBox->setEnabled(locBoxEnabled);
 
@@ -225,7 +225,7 @@ int TDriverFeaturAbstractView::reScan()
         emit reScanned(__pathInfo->canonicalFilePath());
     }
     else {
-        qDebug() << FCFL << "Error code" << ret << "with scan type" << __scanType;
+        qCWarning(logFeature) << FCFL << "Error code" << ret << "with scan type" << __scanType;
     }
 
     return ret;
@@ -291,11 +291,11 @@ int TDriverFeaturAbstractView::doDirScan()
 {
     QString path(pathInfo().canonicalFilePath());
 
-    qDebug() << FCFL << path << __scanPattern;
+    qCDebug(logFeature) << FCFL << path << __scanPattern;
     Q_ASSERT(__listView->model());
 
     if (!pathInfo().isDir()) {
-        qDebug() << FCFL << "called when path not dir:" << path;
+        qCDebug(logFeature) << FCFL << "called when path not dir:" << path;
         return -1;
     }
 
@@ -320,8 +320,6 @@ int TDriverFeaturAbstractView::doDirScan()
     for (int row = 0; row < fileInfos.size(); ++row) {
         QModelIndex index = model()->index(row, 0);
 
-        //qDebug() << FCFL << fileInfos.at(row).filePath();
-
         if (!model()->setData(index,
                               fileInfos.at(row).baseName())) {
             qWarning() << "Failed to set default role for model row" << row;
@@ -347,7 +345,7 @@ int TDriverFeaturAbstractView::doFileScan()
 {
     QString path(pathInfo().canonicalFilePath());
 
-    qDebug() << FCFL << path << __scanPattern;
+    qCDebug(logFeature) << FCFL << path << __scanPattern;
     Q_ASSERT(__listView->model());
 
 
@@ -357,7 +355,7 @@ int TDriverFeaturAbstractView::doFileScan()
     }
 
     if (!pathInfo().isFile() && !pathInfo().isReadable()) {
-        qDebug() << FCFL << "called when path not readable file:" << path;
+        qCDebug(logFeature) << FCFL << "called when path not readable file:" << path;
         return -1;
     }
 
@@ -373,16 +371,16 @@ int TDriverFeaturAbstractView::doFileScan()
     int modelRow = model()->rowCount();
     int lineNum = 0;
 
-    qDebug() << FCFL << rx.isValid() << rx.pattern();
+    qCDebug(logFeature) << FCFL << rx.isValid() << rx.pattern();
 
-    qDebug() << FCFL << "________START FILE READ LOOP________";
+    qCDebug(logFeature) << FCFL << "________START FILE READ LOOP________";
 
     while ((line = file.readLine()).size() > 0) {
         file.unsetError();
         ++lineNum;
         QString lineStr(QString::fromUtf8(line.trimmed()));
         int pos = rx.indexIn(lineStr);
-        qDebug() << lineNum << '(' << pos << rx.captureCount() << ')' << ':' << line.trimmed();
+        qCDebug(logFeature) << lineNum << '(' << pos << rx.captureCount() << ')' << ':' << line.trimmed();
         if (pos >= 0 && rx.captureCount() >= 1) {
 
             if (!model()->insertRow(modelRow)) {
@@ -413,10 +411,10 @@ int TDriverFeaturAbstractView::doFileScan()
         }
     }
 
-    qDebug() << FCFL << "________ END FILE READ LOOP ________";
+    qCDebug(logFeature) << FCFL << "________ END FILE READ LOOP ________";
 
     if (file.error() != QFile::NoError) {
-        qDebug() << FCFL << "reading ended with readLine error" << file.errorString();
+        qCWarning(logFeature) << FCFL << "reading ended with readLine error" << file.errorString();
     }
 
     return model()->rowCount();
@@ -429,11 +427,11 @@ int TDriverFeaturAbstractView::doFileSectionScan()
 
     QString path(pathInfo().canonicalFilePath());
 
-    qDebug() << FCFL << path << scanPattern();
+    qCDebug(logFeature) << FCFL << path << scanPattern();
     Q_ASSERT(__listView->model());
 
     if (!pathInfo().isFile() && !pathInfo().isReadable()) {
-        qDebug() << FCFL << "called when path not readable file:" << path;
+        qCDebug(logFeature) << FCFL << "called when path not readable file:" << path;
         return -1;
     }
 
@@ -457,15 +455,15 @@ int TDriverFeaturAbstractView::doFileSectionScan()
     int pathLineNum = pathLineNumber();
     if (pathLineNum <= 0) pathLineNum = 1;
 
-    qDebug() << FCFL << rx.isValid() << rx.pattern();
+    qCDebug(logFeature) << FCFL << rx.isValid() << rx.pattern();
 
-    qDebug() << FCFL << "________START FILE READ LOOP________";
+    qCDebug(logFeature) << FCFL << "________START FILE READ LOOP________";
 
     while (!sectionOver && (line = file.readLine()).size() > 0) {
         file.unsetError();
         ++lineNum;
 
-        qDebug() << lineNum << line.trimmed();
+        qCDebug(logFeature) << lineNum << line.trimmed();
 
         // skip lines until first line to capture
         if (lineNum < pathLineNum) continue;
@@ -476,7 +474,7 @@ int TDriverFeaturAbstractView::doFileSectionScan()
             // exclude first line from regexp check
 
             int pos = rx.indexIn(lineStr);
-            qDebug() << "...regexp result:" << pos << rx.captureCount();
+            qCDebug(logFeature) << "...regexp result:" << pos << rx.captureCount();
             if (pos >= 0) {
                 sectionOver = true; // last line in section
 
@@ -491,7 +489,7 @@ int TDriverFeaturAbstractView::doFileSectionScan()
             return -2;
         }
 
-        qDebug() << "...adding line";
+        qCDebug(logFeature) << "...adding line";
         QModelIndex index = model()->index(modelRow, 0);
 
         if (!model()->setData(index,
@@ -507,13 +505,13 @@ int TDriverFeaturAbstractView::doFileSectionScan()
         ++modelRow;
     }
 
-    qDebug() << FCFL << "________ END FILE READ LOOP ________";
+    qCDebug(logFeature) << FCFL << "________ END FILE READ LOOP ________";
 
     if (file.error() != QFile::NoError) {
-        qDebug() << FCFL << "reading ended with readLine error" << file.errorString();
+        qCWarning(logFeature) << FCFL << "reading ended with readLine error" << file.errorString();
     }
 
-    qDebug() << FCFL << model()->rowCount();
+    qCDebug(logFeature) << FCFL << model()->rowCount();
     return model()->rowCount();
 }
 
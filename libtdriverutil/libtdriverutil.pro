@@ -44,6 +44,9 @@ DEFINES += LIBTDRIVERUTIL_LIBRARY
 SOURCES += tdriver_util.cpp \
     tdriver_rubyinterface.cpp \
     tdriver_rbiprotocol.cpp \
+    tdriver_rbistatistics.cpp \
+    tdriver_rbidispatcher.cpp \
+    tdriver_logging.cpp \
     tdriver_executedialog.cpp \
     flowlayout.cpp
 
@@ -51,7 +54,11 @@ HEADERS += libtdriverutil_global.h \
     tdriver_util.h \
     tdriver_rubyinterface.h \
     tdriver_rbiprotocol.h \
+    tdriver_rbistatistics.h \
+    tdriver_rbimessage.h \
+    tdriver_rbidispatcher.h \
     tdriver_debug_macros.h \
+    tdriver_logging.h \
     tdriver_executedialog.h \
     flowlayout.h
 
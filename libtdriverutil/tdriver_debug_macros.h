@@ -18,4 +18,6 @@ static inline QString prettyFile(const char *file) {
 
 #include <QTime>
 
+#include "tdriver_logging.h"
+
 #endif // TDRIVER_DEBUG_MACROS_H
@@ -53,6 +53,7 @@ $lg.debug " ==================================== OPEN"
 
 require 'benchmark'
 require 'socket'
+require 'thread'
 
 
 begin
@@ -71,11 +72,12 @@ else
   @tdriver_gem_version = 'error'
 end
 
-@tdriver_interface_rb_version = '2'
+@tdriver_interface_rb_version = '3'
 # tdriver_interface_rb_version history
 # 1 : initial version
 # 2 : message name changes:
 #     'listener.rb emulation' -> 'visualization', 'ruby_interact.rb emulation' -> 'interaction'
+# 3 : 'cancel' visualization command, commands run concurrently and reply out of order
 
 @server = TCPServer.new("127.0.0.1", 0)
 
@@ -560,8 +562,48 @@ class ListenerObject
   VISUALIZATION_ID = 'visualization'
   INTERACTION_ID = 'interaction'
 
+  # read-only visualization commands, which are executed in their own threads so that
+  # refresh_ui and refresh_image sent back to back complete in parallel: refresh_image talks
+  # to the sut through its own capture connection, see side_sut_id;
+  # set TDRIVER_VISUALIZER_CONCURRENT=0 to execute them one at a time
+  CONCURRENT_COMMANDS = [ :refresh_ui, :refresh_image ]
+
+  # interaction messages and these visualization commands form the interactive channel, which has
+  # its own queue and thread, while other visualization commands are queued for the bulk threads;
+  # a long refresh_ui does not delay completion, nor taps or key presses, which talk to the sut through
+  # its own interactive connection, and a long evaluation does not delay reading of cancel requests;
+  # evaluation still waits for running commands of all suts, because evaluated code may use any sut;
+  # set TDRIVER_VISUALIZER_PRIORITY=0 to handle all messages in one queue
+  INTERACTIVE_COMMANDS = [ :tap, :press_key ]
+
+  # suffixes of the ids under which copies of sut parameters are connected for screen capture,
+  # and for taps and key presses
+  CAPTURE_SUT_SUFFIX = '__visualizer_capture'
+  INTERACTIVE_SUT_SUFFIX = '__visualizer_interactive'
+
+  # bulk messages of each sut have their own queue and thread, so that visualizers showing
+  # different suts refresh in parallel while commands of one sut still execute in order;
+  # TDRIVER_VISUALIZER_CONCURRENT=0 also puts all suts in one queue
+  #
+  # cancel requests not matched within this many seconds are forgotten
+  CANCEL_EXPIRY = 300
+
+  # reply keys for channel and queueing delay, removed from the reply by TDriverRbiProtocol
+  CHANNEL_KEY = '__channel'
+  QUEUE_TIME_KEY = '__queue_ms'
+
   def initialize
 
+    @concurrent_threads = {}
+    @concurrent_mutex = Mutex.new
+    @sut_mutexes = {}
+    @side_sut_ids = {}
+    @write_mutex = Mutex.new
+    @concurrent_enabled = ( ENV[ 'TDRIVER_VISUALIZER_CONCURRENT' ] != '0' )
+    @priority_enabled = ( ENV[ 'TDRIVER_VISUALIZER_PRIORITY' ] != '0' )
+    @cancelled = {}
+    @cancel_mutex = Mutex.new
+
     # set directory where to save xml & png
     if (/win/ =~ Config::CONFIG[ 'target_os' ] or /mingw/  =~ Config::CONFIG[ 'target_os' ]) and /darwin/io !~ Config::CONFIG[ 'target_os' ]
       # windows
@@ -580,7 +622,7 @@ class ListenerObject
   end
 
   def check_version
-    @listener_reply['version'] = [ ENV['TDRIVER_VERSION'] ]
+    listener_reply['version'] = [ ENV['TDRIVER_VERSION'] ]
   end
 
 
@@ -621,7 +663,7 @@ class ListenerObject
     file_xml.close
     $lg.debug this_method + " wrote #{File.size?(filename_xml)/1024.0} KiB to '#{filename_xml}'"
 
-    @listener_reply['behaviour_filename'] = [ filename_xml ]
+    listener_reply['behaviour_filename'] = [ filename_xml ]
   end
 
 
@@ -635,36 +677,101 @@ class ListenerObject
   #    file_xml.close
   #  end
   #  $lg.debug this_method + " wrote #{File.size?(filename_xml)/1024.0} KiB to '#{filename_xml}'"
-  #  @listener_reply['fixture_filename'] = [ filename_xml ]
+  #  listener_reply['fixture_filename'] = [ filename_xml ]
   #end
 
 
-  def get_signal_xml( sut, sut_id, app_name, object_id, object_type )
-    $lg.debug this_method +
-      " : sut.application(:name => '#{app_name}').child( :type => '#{object_type}', :id => '#{object_id}', :__index => 0).fixture('signal', 'list_signals')"    
+  #DISABLE_API_TAB_PENDING_REMOVAL
+  # class methods of several classes in one reply, tasMessage of each class is wrapped in apiMethodsBatch element
+  #def get_fixture_batch_xml( sut, sut_id, class_names )
+  #  filename_xml, file_xml = create_output_file(@working_directory, "visualizer_class_methods_batch_#{ sut_id }", 'xml' )
+  #  begin
+  #    file_xml << "<apiMethodsBatch>\n"
+  #    class_names.each do | class_name |
+  #      begin
+  #        data = sut.application.fixture('tasqtapiaccessor', 'list_class_methods', { :class => class_name } )
+  #        file_xml << data.to_s.sub( /\A\s*<\?xml[^>]*\?>/, '' ) << "\n"
+  #      rescue Exception => e
+  #        $lg.debug this_method + " #{ class_name }: #{e.class} #{e.message}"
+  #      end
+  #    end
+  #    file_xml << "</apiMethodsBatch>\n"
+  #  ensure
+  #    file_xml.close
+  #  end
+  #  $lg.debug this_method + " wrote #{ class_names.size } classes, #{File.size?(filename_xml)/1024.0} KiB to '#{filename_xml}'"
+  #  listener_reply['fixture_filename'] = [ filename_xml ]
+  #end
 
+
+  NO_SIGNALS_XML = '<tasMessage version="1.3">
+      <tasInfo id="1" name="QtSignals" type="QtSignals">
+        <obj env="qt" id="0" name="no signals" type="QtSignal" />
+      </tasInfo>
+    </tasMessage>'
+
+  # returns signal list xml of object, raises if signal fixture failed
+  def signal_list_data( sut, app_name, object_id, object_type )
     if object_type=="application"
       obj = sut.application(:name => app_name.to_s)
     else
       obj = sut.application(:name => app_name.to_s).child( :type => object_type.to_s, :id => object_id.to_s, :__index => 0)
     end
+    obj.fixture('signal', 'list_signals').to_s
+  end
+
+  def xml_attribute_escape( value )
+    value.to_s.gsub( /[&<>"']/, '&' => '&amp;', '<' => '&lt;', '>' => '&gt;', '"' => '&quot;', "'" => '&apos;' )
+  end
+
+
+  def get_signal_xml( sut, sut_id, app_name, object_id, object_type )
+    $lg.debug this_method +
+      " : sut.application(:name => '#{app_name}').child( :type => '#{object_type}', :id => '#{object_id}', :__index => 0).fixture('signal', 'list_signals')"    
 
+    begin
+      data = signal_list_data( sut, app_name, object_id, object_type )
+    rescue Exception => e
+      # placeholder list is shown, signal_error tells visualizer not to cache it
+      $lg.debug this_method + " #{object_type} #{object_id}: #{e.class} #{e.message}"
+      listener_reply['signal_error'] = [ "#{e.class}: #{e.message}" ]
+      data = NO_SIGNALS_XML
+    end
 
     filename_xml, file_xml = create_output_file(@working_directory, "visualizer_class_signals_#{ sut_id }", 'xml' )
     begin
-      data = obj.fixture('signal', 'list_signals')      
       file_xml << data
-    rescue Exception => e
-      file_xml << '<tasMessage version="1.3">
-      <tasInfo id="1" name="QtSignals" type="QtSignals">
-        <obj env="qt" id="0" name="no signals" type="QtSignal" />
-      </tasInfo>
-    </tasMessage>'
     ensure
       file_xml.close
     end
     $lg.debug this_method + " wrote #{File.size?(filename_xml)/1024.0} KiB to '#{filename_xml}'"
-    @listener_reply['signal_filename'] = [ filename_xml ]
+    listener_reply['signal_filename'] = [ filename_xml ]
+  end
+
+
+  # signal lists of several object types in one reply, objects is flat array of id, type and env triplets;
+  # signal list xml of each type is wrapped in type element, which has name and env attributes,
+  # and type whose signal fixture failed is an empty type element with error attribute
+  def get_signals_batch_xml( sut, sut_id, app_name, objects )
+    filename_xml, file_xml = create_output_file(@working_directory, "visualizer_class_signals_batch_#{ sut_id }", 'xml' )
+    begin
+      file_xml << "<signalsBatch>\n"
+      objects.each_slice( 3 ) do | object_id, object_type, env |
+        attributes = "name=\"#{ xml_attribute_escape( object_type ) }\" env=\"#{ xml_attribute_escape( env ) }\""
+        begin
+          data = signal_list_data( sut, app_name, object_id, object_type ).sub( /\A\s*<\?xml[^>]*\?>/, '' )
+          file_xml << "<type #{ attributes }>\n" << data << "\n</type>\n"
+        rescue Exception => e
+          $lg.debug this_method + " #{object_type} #{object_id}: #{e.class} #{e.message}"
+          file_xml << "<type #{ attributes } error=\"#{ xml_attribute_escape( "#{e.class}: #{e.message}" ) }\"/>\n"
+        end
+      end
+      file_xml << "</signalsBatch>\n"
+    ensure
+      file_xml.close
+    end
+    $lg.debug this_method + " wrote #{ objects.size / 3 } types, #{File.size?(filename_xml)/1024.0} KiB to '#{filename_xml}'"
+    listener_reply['signal_filename'] = [ filename_xml ]
   end
 
 
@@ -687,10 +794,41 @@ class ListenerObject
     end
 
     $lg.debug this_method + " wrote #{File.size?(filename_xml)/1024.0} KiB to '#{filename_xml}'"
-    @listener_reply['ui_filename'] = [ filename_xml ]
+    listener_reply['ui_filename'] = [ filename_xml ]
   end
 
 
+  # dump rooted at given object, so that visualizer can replace just that part of its object tree;
+  # TDriver still refreshes the state of the whole application to find the object, so this saves
+  # work in visualizer only, not in the SUT or in transfer from it
+  def get_subtree_dump( sut, sut_id, app_id, object_id )
+    MobyUtil::Parameter[ sut.id ][ :filter_type] = 'none'
+
+    # child is searched from the refreshed application state, not with find_object of the agent
+    use_find_object = MobyUtil::Parameter[ sut.id ][ :use_find_object, nil ]
+    begin
+      MobyUtil::Parameter[ sut.id ][ :use_find_object] = 'false'
+      app = app_id.to_s.empty? ? sut.application : sut.application( :id => app_id )
+      data = app.child( :id => object_id ).xml_data.to_s
+    ensure
+      if use_find_object.nil?
+        MobyUtil::Parameter[ sut.id ].delete( :use_find_object )
+      else
+        MobyUtil::Parameter[ sut.id ][ :use_find_object] = use_find_object
+      end
+    end
+
+    filename_xml, file_xml = create_output_file(@working_directory, "visualizer_subtree_#{ sut_id }", 'xml' )
+    begin
+      file_xml << data
+    ensure
+      file_xml.close
+    end
+
+    $lg.debug this_method + " wrote #{File.size?(filename_xml)/1024.0} KiB to '#{filename_xml}'"
+    listener_reply['subtree_filename'] = [ filename_xml ]
+  end
+
   def capture_screen( sut, sut_id, app_id = nil )
     filename_png, file_png = create_output_file(@working_directory, "visualizer_dump_#{ sut_id }", 'png' )
     begin
@@ -717,7 +855,7 @@ class ListenerObject
       raise ex unless ex.message == "QtTasserver does not support the given service: screenShot"
       filename_png = ""
     end
-    @listener_reply['image_filename'] = [ filename_png ]
+    listener_reply['image_filename'] = [ filename_png ]
   end
 
 
@@ -733,7 +871,7 @@ class ListenerObject
       file_xml.close
     end
 
-    @listener_reply['applications_filename'] = [ filename_xml ]
+    listener_reply['applications_filename'] = [ filename_xml ]
   end
 
 
@@ -752,7 +890,7 @@ class ListenerObject
       file_rb.close
     end
     $lg.debug this_method + " wrote #{File.size?(filename_rb)/1024.0} KiB to '#{filename_rb}'"
-    @listener_reply['record_filename'] = [ filename_rb ]
+    listener_reply['record_filename'] = [ filename_rb ]
   end
 
 
@@ -768,7 +906,7 @@ class ListenerObject
 
   def get_parameter( sut_id, para )
     para_value = MobyUtil::Parameter[ sut_id.to_sym ][ para.to_sym, nil ]
-    @listener_reply['parameter'] = [ para.to_s, para_value.inspect ]
+    listener_reply['parameter'] = [ para.to_s, para_value.inspect ]
   end
 
 
@@ -780,8 +918,8 @@ class ListenerObject
       keys << key.to_s
       values << value.inspect
     end
-    @listener_reply['keys'] = keys
-    @listener_reply['values'] = values
+    listener_reply['keys'] = keys
+    listener_reply['values'] = values
   end
 
 
@@ -789,198 +927,439 @@ class ListenerObject
     old = @working_directory
     set_working_directory( MobyUtil::FileHelper.fix_path( File.expand_path( new_path.to_s ) + "/" ) )
     $lg.debug this_method + " @working_directory changed '#{old}' -> '#{@working_directory}'"
-    @listener_reply['output_path'] = [ @working_directory.to_s ]
+    listener_reply['output_path'] = [ @working_directory.to_s ]
   end
 
-  def main_loop (conn)
-    recorder = nil
-    interact = Code_evaluation_sandbox.new
+  # reply hash of the command executed by current thread
+  def listener_reply
+    Thread.current[ :listener_reply ]
+  end
 
-    while not conn.closed? do
-      STDOUT.flush
-      STDERR.flush
-      #$lg.debug this_method + " reading message"
-      seqNumIn = nameIn = dataIn = nil
-      benchtime = Benchmark.measure {
-        seqNumIn, nameIn, dataIn = readMessage(conn)
-      }.real
-      $lg.debug this_method + " GOT message after time: #{benchtime}"
-      msgIn = parseArrayHash(dataIn)
-      $lg.debug this_method + " MSG #{seqNumIn} #{nameIn} : #{msgIn.inspect}"
-
-      #listener.rb was old script, which had STDIN/STDOUT interface
-      if ((nameIn == VISUALIZATION_ID) and
-            msgIn.key?('input') and
-            not (input_array = msgIn['input']).empty?)
-      then
-        @listener_reply = Hash.new
-        # handle commands where input_array length is 1
-        break if ( input_array[0] == "quit" )
-
-        if input_array.size >= 2
-          sut_id = input_array.first.to_sym
-          cmd = input_array[1].downcase.to_sym
-          eval_cmd = ""
-          error = false
-
-          sut = nil
-          begin
-            # connect to sut, unless command does not require it
-            sut = TDriver.connect_sut( :Id => sut_id ) unless [ :get_parameter, :get_all_parameters, :set_output_path, :check_version ].include?( cmd )
+  # replies are written from concurrent command threads too, so writes must not interleave
+  def write_reply( conn, seqNum, name, msgOut, channel = nil, queueTime = nil )
+    unless channel.nil?
+      msgOut[ CHANNEL_KEY ] = [ channel.to_s ]
+      msgOut[ QUEUE_TIME_KEY ] = [ '%.1f' % ( queueTime * 1000 ) ]
+    end
+    @write_mutex.synchronize {
+      writeRawData(conn, makeMsg(seqNum, name, msgOut))
+    }
+    msgStr = msgOut.inspect.to_s
+    msgStr = msgStr[0,1020] + " ..." if msgStr.size > 1024
+    $lg.info this_method + " SNT #{seqNum} #{name} : #{msgStr}"
+  end
 
-            begin
-              if sut then
-                #$lg.debug this_method + " before adjust: #{MobyUtil::Parameter[ sut.id ][:filter_type]} #{MobyUtil::Parameter[ sut.id ][:socket_read_timeout]} #{MobyUtil::Parameter[ sut.id ][:socket_write_timeout]} #{MobyUtil::Parameter[ sut.id ][:default_timeout]}"
-                MobyUtil::Parameter[ sut.id ][ :filter_type] = 'none'
-                #              MobyUtil::Parameter[ sut.id ][ :socket_read_timeout] = '10'
-                #              MobyUtil::Parameter[ sut.id ][ :socket_write_timeout] = '10'
-                #              MobyUtil::Parameter[ sut.id ][ :default_timeout] = '10'
-                #$lg.debug this_method + " after adjust: #{MobyUtil::Parameter[ sut.id ][:filter_type]} #{MobyUtil::Parameter[ sut.id ][:socket_read_timeout]} #{MobyUtil::Parameter[ sut.id ][:socket_write_timeout]} #{MobyUtil::Parameter[ sut.id ][:default_timeout]}"
-              end
-            rescue
-            end
+  def concurrent_command?( input_array )
+    @concurrent_enabled and input_array.size >= 2 and CONCURRENT_COMMANDS.include?( input_array[1].downcase.to_sym )
+  end
+
+  # starts command in a new thread, which writes the reply when done; replies may thus be sent out of order
+  def start_concurrent_command( conn, seqNum, name, input_array, receivedAt )
+    sut_id = input_array.first
+    cmd = input_array[1].downcase.to_sym
+    # same command twice in a row would only compete for the same sut, so wait for the previous one
+    wait_concurrent_commands( sut_id, cmd )
+    $lg.debug this_method + " starting #{seqNum} #{sut_id} #{cmd} concurrently"
+    thread = Thread.new {
+      queueTime = Time.now - receivedAt
+      begin
+        connect_id = ( cmd == :refresh_image ) ? side_sut_id( sut_id, CAPTURE_SUT_SUFFIX ) : sut_id
+        reply = sut_mutex( connect_id ).synchronize { visualization_reply( input_array, connect_id ) }
+        write_reply( conn, seqNum, name, reply, :bulk, queueTime )
+      rescue => ex
+        $lg.error this_method + " concurrent #{seqNum} #{cmd} exception #{ex.class}: #{ex.message}"
+        # client waits for a reply to every request, so failure is reported like failed evaluation
+        begin
+          write_reply( conn, seqNum, name, {
+                         'exception' => [ ex.class.to_s, ex.message.to_s ],
+                         'error' => [ "Error: concurrent command (#{cmd}) failed: #{ex.message}" ] }, :bulk, queueTime )
+        rescue => writeEx
+          $lg.error this_method + " concurrent #{seqNum} error reply failed #{writeEx.class}: #{writeEx.message}"
+        end
+      end
+    }
+    @concurrent_mutex.synchronize { @concurrent_threads[ [ sut_id, cmd ] ] = thread }
+  end
+
+  # commands of one sut share its TDriver sut object and socket, which are not thread safe,
+  # so only one command talks to each sut at a time
+  def sut_mutex( sut_id )
+    @concurrent_mutex.synchronize { @sut_mutexes[ sut_id ] ||= Mutex.new }
+  end
 
-          rescue => ex
-            $lg.error this_method + " sut connect exception #{ex.class}: #{ex.message}"
-            @listener_reply['exception'] = [ ex.class.to_s, ex.message.to_s, ex.backtrace.join('\n') ]
-            @listener_reply['error'] = [ "Error: connection to sut (#{sut_id}) failed" ]
-            error = true
+  # id of the sut object used for screen capture, or for taps and key presses, of sut: a copy of the sut
+  # parameters under another id gives TDriver sut object with its own socket and mutex, so these commands
+  # don't wait for other commands of the sut; when the copy can't be connected, the shared sut object is
+  # used and the command waits for the sut mutex
+  def side_sut_id( sut_id, suffix )
+    sut_id = sut_id.to_s
+    side_id = "#{ sut_id }#{ suffix }"
+    sut_mutex( side_id ).synchronize {
+      known = @concurrent_mutex.synchronize { @side_sut_ids.key?( side_id ) }
+      unless known
+        connect_id = side_id
+        begin
+          MobyUtil::Parameter[ side_id.to_sym ] = MobyUtil::Parameter[ sut_id.to_sym ].clone
+          TDriver.connect_sut( :Id => side_id.to_sym )
+          $lg.debug this_method + " connected #{ side_id }"
+        rescue Exception => ex
+          $lg.warn this_method + " no #{ side_id } connection, using shared sut: #{ ex.class }: #{ ex.message }"
+          connect_id = sut_id
+        end
+        @concurrent_mutex.synchronize { @side_sut_ids[ side_id ] = connect_id }
+      end
+      @concurrent_mutex.synchronize { @side_sut_ids[ side_id ] }
+    }
+  end
+
+  # side connections are made again when next needed, called while sut mutex is held
+  def disconnect_side_suts( sut_id )
+    [ CAPTURE_SUT_SUFFIX, INTERACTIVE_SUT_SUFFIX ].each do | suffix |
+      side_id = "#{ sut_id }#{ suffix }"
+      connect_id = @concurrent_mutex.synchronize { @side_sut_ids.delete( side_id ) }
+      next unless connect_id == side_id
+      sut_mutex( side_id ).synchronize { TDriver.disconnect_sut( :Id => side_id.to_sym ) }
+    end
+  end
+
+  # evaluated code may use any sut, so no other command talks to a sut while it runs;
+  # only the interactive thread holds more than one sut mutex, and takes them in the same order
+  def synchronize_all_suts( &block )
+    mutexes = @concurrent_mutex.synchronize { @sut_mutexes.keys.sort_by { | key | key.to_s }.collect { | key | @sut_mutexes[ key ] } }
+    synchronize_each( mutexes, &block )
+  end
+
+  def synchronize_each( mutexes, &block )
+    return yield if mutexes.empty?
+    mutexes.first.synchronize { synchronize_each( mutexes[ 1..-1 ], &block ) }
+  end
+
+  # waits until concurrent command of sut (or all of them when cmd is nil) is done, before executing commands which depend on sut state;
+  # nil sut_id waits for commands of all suts, for messages which may use any sut
+  def wait_concurrent_commands( sut_id = nil, cmd = nil )
+    threads = @concurrent_mutex.synchronize {
+      keys = @concurrent_threads.keys.select { | key | ( sut_id.nil? or key[0] == sut_id ) and ( cmd.nil? or key[1] == cmd ) }
+      keys.collect { | key | @concurrent_threads.delete( key ) }
+    }
+    threads.each { | thread | thread.join }
+  end
+
+  # executes visualization command of input_array, and returns the reply hash;
+  # connect_id is id of the sut object to use, when other than the sut of the command
+  def visualization_reply( input_array, connect_id = nil )
+    Thread.current[ :listener_reply ] = Hash.new
+    if input_array.size >= 2
+      sut_id = input_array.first.to_sym
+      cmd = input_array[1].downcase.to_sym
+      eval_cmd = ""
+      error = false
+
+      sut = nil
+      begin
+        # connect to sut, unless command does not require it
+        sut = TDriver.connect_sut( :Id => ( connect_id || sut_id ).to_sym ) unless [ :get_parameter, :get_all_parameters, :set_output_path, :check_version ].include?( cmd )
+
+        begin
+          if sut then
+            #$lg.debug this_method + " before adjust: #{MobyUtil::Parameter[ sut.id ][:filter_type]} #{MobyUtil::Parameter[ sut.id ][:socket_read_timeout]} #{MobyUtil::Parameter[ sut.id ][:socket_write_timeout]} #{MobyUtil::Parameter[ sut.id ][:default_timeout]}"
+            MobyUtil::Parameter[ sut.id ][ :filter_type] = 'none'
+            #              MobyUtil::Parameter[ sut.id ][ :socket_read_timeout] = '10'
+            #              MobyUtil::Parameter[ sut.id ][ :socket_write_timeout] = '10'
+            #              MobyUtil::Parameter[ sut.id ][ :default_timeout] = '10'
+            #$lg.debug this_method + " after adjust: #{MobyUtil::Parameter[ sut.id ][:filter_type]} #{MobyUtil::Parameter[ sut.id ][:socket_read_timeout]} #{MobyUtil::Parameter[ sut.id ][:socket_write_timeout]} #{MobyUtil::Parameter[ sut.id ][:default_timeout]}"
           end
+        rescue
+        end
 
-          if not error
+      rescue => ex
+        $lg.error this_method + " sut connect exception #{ex.class}: #{ex.message}"
+        listener_reply['exception'] = [ ex.class.to_s, ex.message.to_s, ex.backtrace.join('\n') ]
+        listener_reply['error'] = [ "Error: connection to sut (#{sut_id}) failed" ]
+        error = true
+      end
 
-            case cmd
+      if not error
 
-            when :check_version
-              eval_cmd = "check_version"
+        case cmd
 
-            when :set_output_path
-              eval_cmd = "set_output_path( '#{ input_array[2] }' )"
+        when :check_version
+          eval_cmd = "check_version"
 
-            when :get_behaviours
-              eval_cmd = "get_behaviours_xml( sut, '#{ sut_id }', [#{ input_array[2] }] )"
+        when :set_output_path
+          eval_cmd = "set_output_path( '#{ input_array[2] }' )"
 
-            when :refresh_ui
-              eval_cmd = "get_ui_dump( sut, '#{ sut_id.to_s }', #{ input_array.size > 2 ? "'#{ input_array[2] }'" : "nil" } )"
+        when :get_behaviours
+          eval_cmd = "get_behaviours_xml( sut, '#{ sut_id }', [#{ input_array[2] }] )"
 
-            when :refresh_image
-              eval_cmd = "capture_screen( sut, '#{ sut_id.to_s }', #{ input_array.size > 2 ? "'#{ input_array[2] }'" : "nil" } )"
+        when :refresh_ui
+          eval_cmd = "get_ui_dump( sut, '#{ sut_id.to_s }', #{ input_array.size > 2 ? "'#{ input_array[2] }'" : "nil" } )"
 
-            when :list_apps
-              eval_cmd = "get_app_list( sut, '#{ sut_id }' )"
+        when :refresh_subtree
+          eval_cmd = "get_subtree_dump( sut, '#{ sut_id.to_s }', '#{ input_array[2] }', '#{ input_array[3] }' )"
 
-            when :disconnect
-              eval_cmd = "TDriver.disconnect_sut( :Id => '#{ sut_id }' )" # this does not work with qt
+        when :refresh_image
+          eval_cmd = "capture_screen( sut, '#{ sut_id.to_s }', #{ input_array.size > 2 ? "'#{ input_array[2] }'" : "nil" } )"
 
-            when :get_parameter
-              eval_cmd = "get_parameter( sut_id , '#{ input_array[2] }' )"
+        when :list_apps
+          eval_cmd = "get_app_list( sut, '#{ sut_id }' )"
 
-            when :get_all_parameters
-              eval_cmd = "get_all_parameters( sut_id )"
+        when :disconnect
+          eval_cmd = "TDriver.disconnect_sut( :Id => '#{ sut_id }' ); disconnect_side_suts( '#{ sut_id }' )" # this does not work with qt
 
-            when :tap
-              eval_cmd = "sut.application"
-              eval_cmd += "(:id=>'#{input_array[3]}')" if input_array.size > 3
-              eval_cmd += ".#{input_array[2]}.tap"
+        when :get_parameter
+          eval_cmd = "get_parameter( sut_id , '#{ input_array[2] }' )"
 
-            #DISABLE_API_TAB_PENDING_REMOVAL
-            #when :check_fixture
-            #  eval_cmd = "check_api_fixture( sut )"
+        when :get_all_parameters
+          eval_cmd = "get_all_parameters( sut_id )"
 
-            #DISABLE_API_TAB_PENDING_REMOVAL
-            #when :fixture
-            #  eval_cmd = "get_fixture_xml( sut, '#{ sut_id }', '#{ input_array[2] }' )"
+        when :tap
+          eval_cmd = "sut.application"
+          eval_cmd += "(:id=>'#{input_array[3]}')" if input_array.size > 3
+          eval_cmd += ".#{input_array[2]}.tap"
 
-            when :press_key
-              eval_cmd = "sut.press_key( #{ input_array[2].to_sym } )"
+        #DISABLE_API_TAB_PENDING_REMOVAL
+        #when :check_fixture
+        #  eval_cmd = "check_api_fixture( sut )"
 
-            when :list_signals
-              eval_cmd = "get_signal_xml( sut, '#{ sut_id }', '#{ input_array[2] }', '#{ input_array[3] }', '#{ input_array[4] }')"
+        #DISABLE_API_TAB_PENDING_REMOVAL
+        #when :fixture
+        #  eval_cmd = "get_fixture_xml( sut, '#{ sut_id }', '#{ input_array[2] }' )"
 
-            when :set_attribute
-              attributeName = input_array[4]
-              # note: with latest version of C++ code, join below is unnecessary, as input_array[5] is the entire value
-              attributeValue = input_array[ 5..input_array.size ].join(' ')
-              attributeType = input_array[3]
-              eval_cmd = "sut.application.#{ input_array[2] }.set_attribute( '#{attributeName}', '#{attributeValue}', '#{attributeType}' )"
+        #DISABLE_API_TAB_PENDING_REMOVAL
+        #when :fixture_batch
+        #  eval_cmd = "get_fixture_batch_xml( sut, '#{ sut_id }', #{ input_array[2..-1].inspect } )"
 
-            when :start_record
-              eval_cmd = "start_recording(sut, #{ ( input_array.size > 2 ? "'#{ input_array[2] }'" : "nil" ) })"
+        when :press_key
+          eval_cmd = "sut.press_key( #{ input_array[2].to_sym } )"
 
-            when :stop_record
-              eval_cmd = "get_recorded_script(sut, #{ ( input_array.size > 2 ? "'#{ input_array[2]}'" : "nil" ) })"
+        when :list_signals
+          eval_cmd = "get_signal_xml( sut, '#{ sut_id }', '#{ input_array[2] }', '#{ input_array[3] }', '#{ input_array[4] }')"
 
-            when :test_record
-              eval_cmd = "test_script(sut, '#{ input_array[2]}' )"
+        when :list_signals_batch
+          eval_cmd = "get_signals_batch_xml( sut, '#{ sut_id }', '#{ input_array[2] }', #{ input_array[3..-1].inspect } )"
 
-            when :start_application
-              eval_cmd = "sut.run(:name=>'#{input_array[2]}', :arguments=>'#{input_array[3]}' )"
+        when :set_attribute
+          attributeName = input_array[4]
+          # note: with latest version of C++ code, join below is unnecessary, as input_array[5] is the entire value
+          attributeValue = input_array[ 5..input_array.size ].join(' ')
+          attributeType = input_array[3]
+          eval_cmd = "sut.application.#{ input_array[2] }.set_attribute( '#{attributeName}', '#{attributeValue}', '#{attributeType}' )"
 
-            else
-              @listener_reply['exception'] = []
-              @listener_reply['error'] = [ "Error: no command matched (#{cmd})" ]
-              error = true
+        when :start_record
+          eval_cmd = "start_recording(sut, #{ ( input_array.size > 2 ? "'#{ input_array[2] }'" : "nil" ) })"
 
-            end #case cmd
-
-            if not error and not eval_cmd.empty?
-              benchtime = Benchmark.measure {
-                begin
-                  #MobyUtil::Retryable.while( :times => 10, :timeout => 1, :exception => Exception ) do end
-                  $lg.debug this_method + " cmd #{cmd} => eval_cmd '#{eval_cmd}'"
-                  eval( eval_cmd )
-                rescue => ex
-                  @listener_reply['exception'] = [ ex.class.to_s, ex.message.to_s, ex.backtrace.join('\n') ]
-                  @listener_reply['error'] = [ "Error: evaluating command (#{eval_cmd}) failed" ]
-                  $lg.error this_method + " eval exception"
-                  error = true
-                end
-              }.real
-              $lg.debug this_method + " eval time: #{benchtime}"
-            end
+        when :stop_record
+          eval_cmd = "get_recorded_script(sut, #{ ( input_array.size > 2 ? "'#{ input_array[2]}'" : "nil" ) })"
 
-          else
-          # error== true, because TDriver.connect_sut failed
+        when :test_record
+          eval_cmd = "test_script(sut, '#{ input_array[2]}' )"
 
-          end # if !error
+        when :start_application
+          eval_cmd = "sut.run(:name=>'#{input_array[2]}', :arguments=>'#{input_array[3]}' )"
 
         else
-          @listener_reply['exception'] = []
-          @listener_reply['error'] = [ "Error: not enough parameters in command (#{cmd})" ]
+          listener_reply['exception'] = []
+          listener_reply['error'] = [ "Error: no command matched (#{cmd})" ]
           error = true
 
-        end # if array_size >= 2
-
-        msgOut = @listener_reply
-
-      #ruby_interact.rb was old script, which had STDIN/STDOUT interface
-      elsif ((nameIn == INTERACTION_ID) and
-                msgIn.key?('command') and
-                not (inputcmd = msgIn['command']).empty?)
-      then
-        case inputcmd[0]
-          when "line_completion"
-            msgOut = interact.line_completion(inputcmd[1], seqNumIn)
-          when "line_execution"
-            msgOut = interact.line_execution(inputcmd[1], seqNumIn)
-          else
-            msgOut = interact.invalidcmd(inputcmd)
+        end #case cmd
+
+        if not error and not eval_cmd.empty?
+          benchtime = Benchmark.measure {
+            begin
+              #MobyUtil::Retryable.while( :times => 10, :timeout => 1, :exception => Exception ) do end
+              $lg.debug this_method + " cmd #{cmd} => eval_cmd '#{eval_cmd}'"
+              eval( eval_cmd )
+            rescue => ex
+              listener_reply['exception'] = [ ex.class.to_s, ex.message.to_s, ex.backtrace.join('\n') ]
+              listener_reply['error'] = [ "Error: evaluating command (#{eval_cmd}) failed" ]
+              $lg.error this_method + " eval exception"
+              error = true
+            end
+          }.real
+          $lg.debug this_method + " eval time: #{benchtime}"
         end
 
-      elsif (nameIn == 'interact reset') then
-        interact = Code_evaluation_sandbox.new
-        msgOut = {}
       else
-        msgOut = { 'error_message' => ['invalid request'] }
+      # error== true, because TDriver.connect_sut failed
+
+      end # if !error
+
+    else
+      listener_reply['exception'] = []
+      listener_reply['error'] = [ "Error: not enough parameters in command (#{cmd})" ]
+      error = true
+
+    end # if array_size >= 2
+
+    listener_reply
+  end
 
-      end # if !input
+  # returns true if message is a cancel request, and records the cancelled sequence numbers
+  def cancel_request?( nameIn, dataIn )
+    return false unless nameIn == VISUALIZATION_ID
+    input_array = parseArrayHash(dataIn)['input'].to_a
+    return false unless input_array[1].to_s.downcase == 'cancel'
+    @cancel_mutex.synchronize {
+      input_array[ 2..-1 ].to_a.each { | seq | @cancelled[ seq.to_i ] = Time.now }
+    }
+    return true
+  end
+
+  # returns true if message was cancelled before it was started
+  def take_cancelled( seqNum, channel )
+    @cancel_mutex.synchronize {
+      return true if @cancelled.delete( seqNum )
+      # bulk queues of different suts are not in sequence number order, so handled
+      # messages can't be detected from sequence numbers, and old requests just expire
+      expired = Time.now - CANCEL_EXPIRY
+      @cancelled.delete_if { | seq, cancelledAt | cancelledAt < expired } if channel == :bulk
+      return false
+    }
+  end
 
-      writeRawData(conn, makeMsg(seqNumIn, nameIn, msgOut))
-      msgStr = msgOut.inspect.to_s
-      msgStr = msgStr[0,1020] + " ..." if msgStr.size > 1024
-      $lg.info this_method + " SNT #{seqNumIn} #{nameIn} : #{msgStr}"
+  def message_channel( nameIn, msgIn )
+    return :bulk unless @priority_enabled
+    return :interactive unless nameIn == VISUALIZATION_ID
+    input_array = msgIn[ 'input' ].to_a
+    ( input_array.size >= 2 and INTERACTIVE_COMMANDS.include?( input_array[1].downcase.to_sym ) ) ? :interactive : :bulk
+  end
+
+  def quit_request?( nameIn, msgIn )
+    nameIn == VISUALIZATION_ID and msgIn[ 'input' ].to_a.first == 'quit'
+  end
+
+  # key of bulk queue handling the message, nil for messages not addressed to a sut
+  def bulk_queue_key( nameIn, msgIn )
+    return nil unless @concurrent_enabled and nameIn == VISUALIZATION_ID
+    msgIn[ 'input' ].to_a.first
+  end
+
+  # executes message of given channel and writes its reply
+  def handle_message( conn, channel, seqNumIn, nameIn, msgIn, receivedAt )
+    if take_cancelled( seqNumIn, channel )
+      $lg.debug this_method + " dropped cancelled #{seqNumIn} #{nameIn}"
+      write_reply(conn, seqNumIn, nameIn, { 'cancelled' => [ seqNumIn.to_s ] })
+      return
+    end
+
+    input_array = ( nameIn == VISUALIZATION_ID ) ? msgIn[ 'input' ].to_a : []
+
+    # interactive channel does not wait for bulk commands, taps and key presses wait only for the mutex of their connection
+    if channel == :bulk
+      if concurrent_command?( input_array )
+        start_concurrent_command( conn, seqNumIn, nameIn, input_array, receivedAt )
+        return
+      end
+      wait_concurrent_commands( input_array.first )
+    end
+    queueTime = Time.now - receivedAt
+
+    #listener.rb was old script, which had STDIN/STDOUT interface
+    if not input_array.empty?
+      connect_id = ( channel == :interactive ) ? side_sut_id( input_array.first, INTERACTIVE_SUT_SUFFIX ) : input_array.first
+      msgOut = sut_mutex( connect_id ).synchronize { visualization_reply( input_array, connect_id ) }
+
+    #ruby_interact.rb was old script, which had STDIN/STDOUT interface
+    elsif ((nameIn == INTERACTION_ID) and
+              msgIn.key?('command') and
+              not (inputcmd = msgIn['command']).empty?)
+    then
+      interact = ( @interact[ sandbox_id( msgIn ) ] ||= Code_evaluation_sandbox.new )
+      case inputcmd[0]
+        when "line_completion"
+          msgOut = interact.line_completion(inputcmd[1], seqNumIn)
+        when "line_execution"
+          msgOut = synchronize_all_suts { interact.line_execution(inputcmd[1], seqNumIn) }
+        else
+          msgOut = interact.invalidcmd(inputcmd)
+      end
+
+    elsif (nameIn == 'interact reset') then
+      if msgIn.key?('release')
+        @interact.delete( sandbox_id( msgIn ) )
+      else
+        @interact[ sandbox_id( msgIn ) ] = Code_evaluation_sandbox.new
+      end
+      msgOut = {}
+    else
+      msgOut = { 'error_message' => ['invalid request'] }
+
+    end # if !input
+
+    write_reply(conn, seqNumIn, nameIn, msgOut, channel, queueTime)
+  end
+
+  # each editor window has its own evaluation sandbox, only accessed from the interactive thread
+  def sandbox_id( msgIn )
+    ( msgIn['sandbox'] || [] ).first.to_s
+  end
+
+  # bulk and interactive threads handle queued messages of their channel in order until quit request
+  def queue_loop( conn, channel, queue, key )
+    loop do
+      seqNumIn, nameIn, msgIn, receivedAt = queue.pop
+      if quit_request?( nameIn, msgIn )
+        wait_concurrent_commands( key ) if channel == :bulk
+        break
+      end
+      handle_message( conn, channel, seqNumIn, nameIn, msgIn, receivedAt )
+    end
+  rescue => ex
+    $lg.fatal this_method + " #{channel} thread exception #{ex.class}: #{ex.message}"
+    conn.close rescue nil # causes the script to exit
+  end
+
+  def main_loop (conn)
+    recorder = nil
+    @interact = {}
+    bulk_queues = {}
+    bulk_threads = []
+    interactive_queue = Queue.new
+    interactive_thread = Thread.new { queue_loop( conn, :interactive, interactive_queue, nil ) }
+
+    while not conn.closed? do
+      STDOUT.flush
+      STDERR.flush
+      #$lg.debug this_method + " reading message"
+      seqNumIn = nameIn = dataIn = nil
+      benchtime = Benchmark.measure {
+        seqNumIn, nameIn, dataIn = readMessage(conn)
+      }.real
+      receivedAt = Time.now
+      $lg.debug this_method + " GOT message after time: #{benchtime}"
+
+      # cancel requests are handled before any queued work, and replied with empty message
+      if cancel_request?( nameIn, dataIn )
+        write_reply(conn, seqNumIn, nameIn, {})
+        next
+      end
+
+      msgIn = parseArrayHash(dataIn)
+      channel = message_channel( nameIn, msgIn )
+      $lg.debug this_method + " MSG #{seqNumIn} #{nameIn} (#{channel}) : #{msgIn.inspect}"
+
+      if channel == :interactive
+        interactive_queue << [ seqNumIn, nameIn, msgIn, receivedAt ]
+      elsif quit_request?( nameIn, msgIn )
+        # each thread finishes its queued messages before quitting
+        bulk_queues.each_value { | queue | queue << [ seqNumIn, nameIn, msgIn, receivedAt ] }
+        interactive_queue << [ seqNumIn, nameIn, msgIn, receivedAt ]
+        break
+      else
+        key = bulk_queue_key( nameIn, msgIn )
+        unless bulk_queues.key?( key )
+          queue = bulk_queues[ key ] = Queue.new
+          bulk_threads << Thread.new { queue_loop( conn, :bulk, queue, key ) }
+          $lg.debug this_method + " started bulk thread for #{key.inspect}"
+        end
+        bulk_queues[ key ] << [ seqNumIn, nameIn, msgIn, receivedAt ]
+      end
     end # while
 
+    bulk_threads.each { | thread | thread.join }
+    interactive_thread.join
+
   end # def listener_main_loop
 
 end
@@ -0,0 +1,45 @@
+/***************************************************************************
+**
+** Copyright (C) 2010 Nokia Corporation and/or its subsidiary(-ies).
+** All rights reserved.
+** Contact: Nokia Corporation (testabilitydriver@nokia.com)
+**
+** This file is part of Testability Driver.
+**
+** If you have questions regarding the use of this file, please contact
+** Nokia at testabilitydriver@nokia.com .
+**
+** This library is free software; you can redistribute it and/or
+** modify it under the terms of the GNU Lesser General Public
+** License version 2.1 as published by the Free Software Foundation
+** and appearing in the file LICENSE.LGPL included in the packaging
+** of this file.
+**
+****************************************************************************/
+
+
+#include "tdriver_logging.h"
+
+#include <QSettings>
+#include <QString>
+
+// hot path debug output is off by default, warnings are always on
+Q_LOGGING_CATEGORY(logRbi, "tdriver.rbi", QtWarningMsg)
+Q_LOGGING_CATEGORY(logUi, "tdriver.ui", QtWarningMsg)
+Q_LOGGING_CATEGORY(logTree, "tdriver.tree", QtWarningMsg)
+Q_LOGGING_CATEGORY(logImage, "tdriver.image", QtWarningMsg)
+Q_LOGGING_CATEGORY(logEditor, "tdriver.editor", QtWarningMsg)
+Q_LOGGING_CATEGORY(logFeature, "tdriver.feature", QtWarningMsg)
+
+const char TDriverLogging::settingsKey[] = "logging/rules";
+
+
+void TDriverLogging::applySettingsRules()
+{
+    QSettings settings;
+    QString rules = settings.value(settingsKey).toString();
+    if (!rules.isEmpty()) {
+        // settings use ';' as separator, QLoggingCategory expects lines
+        QLoggingCategory::setFilterRules(rules.replace(';', '\n'));
+    }
+}
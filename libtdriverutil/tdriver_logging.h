@@ -0,0 +1,51 @@
+/***************************************************************************
+**
+** Copyright (C) 2010 Nokia Corporation and/or its subsidiary(-ies).
+** All rights reserved.
+** Contact: Nokia Corporation (testabilitydriver@nokia.com)
+**
+** This file is part of Testability Driver.
+**
+** If you have questions regarding the use of this file, please contact
+** Nokia at testabilitydriver@nokia.com .
+**
+** This library is free software; you can redistribute it and/or
+** modify it under the terms of the GNU Lesser General Public
+** License version 2.1 as published by the Free Software Foundation
+** and appearing in the file LICENSE.LGPL included in the packaging
+** of this file.
+**
+****************************************************************************/
+
+
+#ifndef TDRIVER_LOGGING_H
+#define TDRIVER_LOGGING_H
+
+#include "libtdriverutil_global.h"
+
+#include <QLoggingCategory>
+
+// Logging categories, used with qCDebug(logRbi) << ...
+// Disabled category costs one branch, message arguments are not evaluated.
+// Categories can be enabled at runtime with QT_LOGGING_RULES environment variable,
+// or with "logging/rules" setting, for example "tdriver.rbi.debug=true".
+// In release builds debug output is compiled out, see visualizer.pri.
+
+LIBTDRIVERUTILSHARED_EXPORT const QLoggingCategory &logRbi();
+LIBTDRIVERUTILSHARED_EXPORT const QLoggingCategory &logUi();
+LIBTDRIVERUTILSHARED_EXPORT const QLoggingCategory &logTree();
+LIBTDRIVERUTILSHARED_EXPORT const QLoggingCategory &logImage();
+LIBTDRIVERUTILSHARED_EXPORT const QLoggingCategory &logEditor();
+LIBTDRIVERUTILSHARED_EXPORT const QLoggingCategory &logFeature();
+
+
+class LIBTDRIVERUTILSHARED_EXPORT TDriverLogging
+{
+public:
+    static const char settingsKey[];
+
+    // applies rules from QSettings, environment variable QT_LOGGING_RULES still overrides them
+    static void applySettingsRules();
+};
+
+#endif // TDRIVER_LOGGING_H
@@ -0,0 +1,186 @@
+/***************************************************************************
+**
+** Copyright (C) 2010 Nokia Corporation and/or its subsidiary(-ies).
+** All rights reserved.
+** Contact: Nokia Corporation (testabilitydriver@nokia.com)
+**
+** This file is part of Testability Driver.
+**
+** If you have questions regarding the use of this file, please contact
+** Nokia at testabilitydriver@nokia.com .
+**
+** This library is free software; you can redistribute it and/or
+** modify it under the terms of the GNU Lesser General Public
+** License version 2.1 as published by the Free Software Foundation
+** and appearing in the file LICENSE.LGPL included in the packaging
+** of this file.
+**
+****************************************************************************/
+
+
+#include "tdriver_rbidispatcher.h"
+
+#include <QMutexLocker>
+#include <QThread>
+
+
+TDriverRbiSubscription::TDriverRbiSubscription(const QByteArray &channel, QObject *receiver) :
+    QObject(NULL),
+    channelName(channel),
+    head(new Node),
+    tail(head),
+    wakePending(0),
+    active(1)
+{
+    // created in thread of receiver, so drain is called there
+    connect(receiver, SIGNAL(destroyed()), this, SLOT(receiverDestroyed()), Qt::DirectConnection);
+}
+
+
+TDriverRbiSubscription::~TDriverRbiSubscription()
+{
+    while (head) {
+        Node *next = head->next.loadAcquire();
+        delete head;
+        head = next;
+    }
+}
+
+
+bool TDriverRbiSubscription::push(const TDriverRbiMessage &message)
+{
+    if (!active.loadAcquire()) return false;
+
+    Node *node = new Node(message);
+    tail->next.storeRelease(node);
+    tail = node;
+
+    // wake consumer only if it hasn't been woken since it last drained the queue
+    if (wakePending.testAndSetOrdered(0, 1)) {
+        QMetaObject::invokeMethod(this, "drain", Qt::QueuedConnection);
+    }
+    return true;
+}
+
+
+void TDriverRbiSubscription::drain()
+{
+    // clear flag first, so that message pushed while draining gets a new wake up
+    wakePending.storeRelease(0);
+
+    Node *next;
+    while ((next = head->next.loadAcquire()) != NULL) {
+        TDriverRbiMessage message(next->message);
+        // next becomes the consumed node, producer only touches its next pointer
+        next->message = TDriverRbiMessage();
+        delete head;
+        head = next;
+        // receiver may process events, so queue state is updated before emitting
+        emit messageReceived(message);
+    }
+}
+
+
+void TDriverRbiSubscription::receiverDestroyed()
+{
+    active.storeRelease(0);
+    TDriverRbiDispatcher::globalInstance()->unsubscribe(this);
+}
+
+
+TDriverRbiDispatcher::TDriverRbiDispatcher() :
+    subscriptions(NULL),
+    postsStarted(0),
+    postsFinished(0)
+{
+}
+
+
+TDriverRbiDispatcher *TDriverRbiDispatcher::globalInstance()
+{
+    static TDriverRbiDispatcher instance;
+    return &instance;
+}
+
+
+void TDriverRbiDispatcher::subscribe(const QByteArray &channel, QObject *receiver, const char *member)
+{
+    Q_ASSERT(receiver->thread() == QThread::currentThread());
+
+    TDriverRbiSubscription *subscription = new TDriverRbiSubscription(channel, receiver);
+    QObject::connect(subscription, SIGNAL(messageReceived(TDriverRbiMessage)), receiver, member,
+                     Qt::DirectConnection);
+
+    QMutexLocker lock(&subscribeMutex);
+    const SubscriptionList *oldList = subscriptions.loadAcquire();
+    SubscriptionList *newList = oldList ? new SubscriptionList(*oldList) : new SubscriptionList;
+    newList->append(subscription);
+    replaceList(newList, NULL);
+}
+
+
+void TDriverRbiDispatcher::unsubscribe(TDriverRbiSubscription *subscription)
+{
+    QMutexLocker lock(&subscribeMutex);
+    const SubscriptionList *oldList = subscriptions.loadAcquire();
+    if (!oldList || !oldList->contains(subscription)) return;
+
+    SubscriptionList *newList = new SubscriptionList(*oldList);
+    newList->removeAll(subscription);
+    replaceList(newList, subscription);
+}
+
+
+// subscribeMutex must be locked
+void TDriverRbiDispatcher::replaceList(SubscriptionList *newList, TDriverRbiSubscription *removed)
+{
+    // post reads the list with an ordered read-modify-write after counting itself as started,
+    // so any post which got the old list is included in postsStarted read after the swap
+    Retired old;
+    old.list = subscriptions.fetchAndStoreOrdered(newList);
+    old.subscription = removed;
+    old.postCount = postsStarted.loadAcquire();
+    if (old.list || old.subscription) retired.append(old);
+
+    freeRetired();
+}
+
+
+// subscribeMutex must be locked
+void TDriverRbiDispatcher::freeRetired()
+{
+    // single producer finishes posts in the order it started them
+    const quint32 finished = postsFinished.loadAcquire();
+    QList<Retired>::iterator it = retired.begin();
+    while (it != retired.end()) {
+        if (qint32(finished - it->postCount) < 0) {
+            ++it;
+            continue;
+        }
+        delete it->list;
+        // may have a queued drain call in thread of the destroyed receiver
+        if (it->subscription) it->subscription->deleteLater();
+        it = retired.erase(it);
+    }
+}
+
+
+int TDriverRbiDispatcher::post(const TDriverRbiMessage &message)
+{
+    postsStarted.fetchAndAddOrdered(1);
+    const SubscriptionList *list = subscriptions.fetchAndAddOrdered(0);
+
+    int count = 0;
+    if (list) {
+        for (int ii = 0; ii < list->size(); ++ii) {
+            TDriverRbiSubscription *subscription = list->at(ii);
+            if ((subscription->channel() == message.name() || subscription->channel().isEmpty())
+                    && subscription->push(message)) {
+                ++count;
+            }
+        }
+    }
+
+    postsFinished.fetchAndAddRelease(1);
+    return count;
+}
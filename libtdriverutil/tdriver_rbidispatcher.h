@@ -0,0 +1,109 @@
+/***************************************************************************
+**
+** Copyright (C) 2010 Nokia Corporation and/or its subsidiary(-ies).
+** All rights reserved.
+** Contact: Nokia Corporation (testabilitydriver@nokia.com)
+**
+** This file is part of Testability Driver.
+**
+** If you have questions regarding the use of this file, please contact
+** Nokia at testabilitydriver@nokia.com .
+**
+** This library is free software; you can redistribute it and/or
+** modify it under the terms of the GNU Lesser General Public
+** License version 2.1 as published by the Free Software Foundation
+** and appearing in the file LICENSE.LGPL included in the packaging
+** of this file.
+**
+****************************************************************************/
+
+#ifndef TDRIVER_RBIDISPATCHER_H
+#define TDRIVER_RBIDISPATCHER_H
+
+#include "libtdriverutil_global.h"
+#include "tdriver_rbimessage.h"
+
+#include <QObject>
+#include <QAtomicInt>
+#include <QAtomicPointer>
+#include <QMutex>
+
+// One consumer of one channel. Messages are passed from the RBI thread through
+// a lock-free single producer, single consumer queue, and consumer is woken with
+// one queued call for all messages that arrived before it got to run.
+class LIBTDRIVERUTILSHARED_EXPORT TDriverRbiSubscription : public QObject
+{
+    Q_OBJECT
+public:
+    TDriverRbiSubscription(const QByteArray &channel, QObject *receiver);
+    ~TDriverRbiSubscription();
+
+    const QByteArray &channel() const { return channelName; }
+
+    // producer side, returns false if receiver is gone
+    bool push(const TDriverRbiMessage &message);
+
+signals:
+    void messageReceived(TDriverRbiMessage message);
+
+private slots:
+    void drain();
+    void receiverDestroyed();
+
+private:
+    struct Node {
+        Node() : next(NULL) {}
+        explicit Node(const TDriverRbiMessage &message) : message(message), next(NULL) {}
+        TDriverRbiMessage message;
+        QAtomicPointer<Node> next;
+    };
+
+    const QByteArray channelName;
+    Node *head; // consumer side, already consumed node
+    Node *tail; // producer side, last pushed node
+    QAtomicInt wakePending;
+    QAtomicInt active;
+};
+
+
+// Routes messages received by TDriverRbiProtocol to consumers by message name,
+// such as TDriverUtil::visualizationId and TDriverUtil::interactionId.
+// Subscribing is rare and takes a mutex, posting doesn't.
+class LIBTDRIVERUTILSHARED_EXPORT TDriverRbiDispatcher
+{
+public:
+    static TDriverRbiDispatcher *globalInstance();
+
+    // member is a slot taking TDriverRbiMessage, called in thread of receiver,
+    // subscription is removed when receiver is destroyed;
+    // empty channel receives messages of all channels, like the mock server does
+    void subscribe(const QByteArray &channel, QObject *receiver, const char *member);
+    void unsubscribe(TDriverRbiSubscription *subscription);
+
+    // called from the single producer thread, returns number of consumers reached
+    int post(const TDriverRbiMessage &message);
+
+private:
+    TDriverRbiDispatcher();
+
+    typedef QList<TDriverRbiSubscription *> SubscriptionList;
+
+    // replaced list, and removed subscription, are freed when posts which may use them are done
+    struct Retired {
+        const SubscriptionList *list;
+        TDriverRbiSubscription *subscription;
+        quint32 postCount;
+    };
+
+    void replaceList(SubscriptionList *newList, TDriverRbiSubscription *removed);
+    void freeRetired();
+
+    // replaced with a new list on subscribe and unsubscribe, so producer never takes a lock
+    QAtomicPointer<const SubscriptionList> subscriptions;
+    QAtomicInteger<quint32> postsStarted;
+    QAtomicInteger<quint32> postsFinished;
+    QList<Retired> retired;
+    QMutex subscribeMutex;
+};
+
+#endif // TDRIVER_RBIDISPATCHER_H
@@ -0,0 +1,62 @@
+/***************************************************************************
+**
+** Copyright (C) 2010 Nokia Corporation and/or its subsidiary(-ies).
+** All rights reserved.
+** Contact: Nokia Corporation (testabilitydriver@nokia.com)
+**
+** This file is part of Testability Driver.
+**
+** If you have questions regarding the use of this file, please contact
+** Nokia at testabilitydriver@nokia.com .
+**
+** This library is free software; you can redistribute it and/or
+** modify it under the terms of the GNU Lesser General Public
+** License version 2.1 as published by the Free Software Foundation
+** and appearing in the file LICENSE.LGPL included in the packaging
+** of this file.
+**
+****************************************************************************/
+
+#ifndef TDRIVER_RBIMESSAGE_H
+#define TDRIVER_RBIMESSAGE_H
+
+#include "libtdriverutil_global.h"
+
+#include <QByteArray>
+#include <QList>
+#include <QMap>
+#include <QMetaType>
+#include <QSharedPointer>
+
+// Immutable received RBI message. Copying only increments the reference count,
+// so one parsed message is shared by all consumers without copying the map.
+class TDriverRbiMessage
+{
+public:
+    TDriverRbiMessage() {}
+    TDriverRbiMessage(quint32 seqNum, const QByteArray &name, const BAListMap &map) :
+        d(new Data(seqNum, name, map)) {}
+
+    bool isNull() const { return d.isNull(); }
+
+    quint32 seqNum() const { return d ? d->seqNum : 0; }
+    const QByteArray &name() const { return d ? d->name : emptyData().name; }
+    const BAListMap &map() const { return d ? d->map : emptyData().map; }
+
+private:
+    struct Data {
+        Data(quint32 seqNum, const QByteArray &name, const BAListMap &map) :
+            seqNum(seqNum), name(name), map(map) {}
+        const quint32 seqNum;
+        const QByteArray name;
+        const BAListMap map;
+    };
+
+    static const Data &emptyData() { static const Data empty(0, QByteArray(), BAListMap()); return empty; }
+
+    QSharedPointer<const Data> d;
+};
+
+Q_DECLARE_METATYPE(TDriverRbiMessage)
+
+#endif // TDRIVER_RBIMESSAGE_H
@@ -23,6 +23,7 @@
 
 #include <QCoreApplication>
 #include <QDataStream>
+#include <QtEndian>
 #include <QAbstractSocket>
 #include <QHostAddress>
 
@@ -31,19 +32,23 @@
 #include <QWaitCondition>
 #include <QThread>
 
+#include "tdriver_rbistatistics.h"
+#include "tdriver_rbidispatcher.h"
 #include "tdriver_debug_macros.h"
 
+#include <cstring>
+
 // debug macros
 #define VALIDATE_THREAD Q_ASSERT(validThread == NULL || validThread == QThread::currentThread())
 #define VALIDATE_THREAD_NOT Q_ASSERT(validThread != QThread::currentThread())
 
 
-TDriverRbiProtocol::TDriverRbiProtocol(QAbstractSocket *connection, QMutex *cm, QWaitCondition *mwc, QWaitCondition *hwc, QObject *parent) :
+TDriverRbiProtocol::TDriverRbiProtocol(QAbstractSocket *connection, QMutex *cm, QWaitCondition *hwc, QObject *parent) :
     QObject(parent),
     readState(ReadDisconnected),
+    firstByteNs(0),
     conn(connection),
     syncMutex(cm),
-    msgCond(mwc),
     nextSN(0),
     haveHello(false),
     helloCond(hwc),
@@ -52,10 +57,6 @@ TDriverRbiProtocol::TDriverRbiProtocol(QAbstractSocket *connection, QMutex *cm,
 {
     helloMsg.clear();
 
-    condSeqNum = 0;
-    condName.clear();
-    condMsg.clear();
-
     connect(conn, SIGNAL(connected()), this, SLOT(connected()));
     connect(conn, SIGNAL(disconnected()), this, SLOT(disconnected()));
     connect(conn, SIGNAL(error(QAbstractSocket::SocketError)), this, SLOT(connError(QAbstractSocket::SocketError)));
@@ -71,7 +72,7 @@ TDriverRbiProtocol::TDriverRbiProtocol(QAbstractSocket *connection, QMutex *cm,
 
 TDriverRbiProtocol::~TDriverRbiProtocol()
 {
-    qDebug() << FCFL << "(destructor)";
+    qCDebug(logRbi) << FCFL << "(destructor)";
 }
 
 
@@ -84,13 +85,9 @@ void TDriverRbiProtocol::startNewMessage()
 
 void TDriverRbiProtocol::connected()
 {
-    qDebug() << FCFL << "to" << conn->peerAddress() << conn->peerPort();
+    qCDebug(logRbi) << FCFL << "to" << conn->peerAddress() << conn->peerPort();
     VALIDATE_THREAD;
 
-    condSeqNum = 0;
-    condName.clear();
-    condMsg.clear();
-
     startNewMessage();
     readBuffer.clear();
     writeBuffer.clear();
@@ -102,12 +99,12 @@ void TDriverRbiProtocol::disconnected()
 {
     VALIDATE_THREAD;
     if (readState != ReadDisconnected) {
-        qDebug() << FCFL << "Disconnected, UNREAD OUTPUT:" << conn->readAll();
+        qCDebug(logRbi) << FCFL << "Disconnected, UNREAD OUTPUT:" << conn->readAll();
         readState = ReadDisconnected;
         conn->close();
         emit gotDisconnection();
     }
-    else qDebug() << FCFL << "no action for readState" << readState;
+    else qCDebug(logRbi) << FCFL << "no action for readState" << readState;
 }
 
 
@@ -115,13 +112,13 @@ void TDriverRbiProtocol::connError(QAbstractSocket::SocketError err)
 {
     VALIDATE_THREAD;
     if (readState != ReadDisconnected) {
-        qDebug() << FCFL << err << "UNREAD OUTPUT:" << conn->readAll();
+        qCDebug(logRbi) << FCFL << err << "UNREAD OUTPUT:" << conn->readAll();
         readState = ReadDisconnected;
         conn->close();
         emit gotDisconnection();
     }
     else {
-        qDebug() << FCFL << err << "no action for readState" << readState;
+        qCDebug(logRbi) << FCFL << err << "no action for readState" << readState;
     }
 }
 
@@ -129,7 +126,10 @@ void TDriverRbiProtocol::connError(QAbstractSocket::SocketError err)
 void TDriverRbiProtocol::addWriteData(QByteArray data)
 {
     VALIDATE_THREAD;
-    writeBuffer.append(data);
+    // share the serialized buffer instead of copying it, when nothing is pending
+    if (writeBuffer.isEmpty()) writeBuffer = data;
+    else writeBuffer.append(data);
+
     qint64 written = conn->write(writeBuffer);
     if (written > 0) {
         writeBuffer.remove(0, written);
@@ -137,53 +137,102 @@ void TDriverRbiProtocol::addWriteData(QByteArray data)
 }
 
 
-void TDriverRbiProtocol::makeStringListMapMsg(QByteArray &target, const QByteArray &name, const BAListMap &msg, quint32 seqNum)
+// helpers for writing QDataStream compatible big endian data into preallocated buffer
+
+static inline char *putWord(char *dst, quint32 word)
 {
-    QDataStream msgStream(&target, QIODevice::Append | QIODevice::WriteOnly);
+    qToBigEndian(word, reinterpret_cast<uchar *>(dst));
+    return dst + sizeof(quint32);
+}
 
-    msgStream << seqNum;
-    msgStream << name;
 
-    qDebug() << FFL << msg;
-    //qDebug() << FFL << seqNum << name;
+static inline char *putBytes(char *dst, const QByteArray &data)
+{
+    // QDataStream writes null QByteArray with 0xFFFFFFFF length
+    if (data.isNull()) return putWord(dst, 0xFFFFFFFF);
 
-    QByteArray mapBuf;
-    {
-        QDataStream mapStream(&mapBuf, QIODevice::WriteOnly | QIODevice::Append);
+    dst = putWord(dst, data.size());
+    memcpy(dst, data.constData(), data.size());
+    return dst + data.size();
+}
 
-        BAListMap::const_iterator  mapIter;
-        for (mapIter = msg.constBegin(); mapIter != msg.constEnd(); ++mapIter) {
-            //qDebug() << "KEY"<< mapIter.key();
-            mapStream << mapIter.key();
 
-            QByteArray listBuf;
-            {
-                QDataStream listStream(&listBuf, QIODevice::WriteOnly | QIODevice::Append);
-                foreach(QByteArray listItem, mapIter.value()) {
-                    //qDebug() << "    VALUE" << listItem;
-                    listStream << listItem;
-                }
-            }
-            mapStream << listBuf;
+// QDataStream buffer that nothing was written to is a null QByteArray
+static inline char *putDataSize(char *dst, int size)
+{
+    return putWord(dst, size > 0 ? quint32(size) : 0xFFFFFFFF);
+}
+
+
+static inline int listDataSize(const BAList &list)
+{
+    int size = 0;
+    foreach(const QByteArray &item, list) {
+        size += sizeof(quint32) + item.size();
+    }
+    return size;
+}
+
+
+int TDriverRbiProtocol::stringListMapMsgSize(const QByteArray &name, const BAListMap &msg)
+{
+    int mapSize = 0;
+    BAListMap::const_iterator mapIter;
+    for (mapIter = msg.constBegin(); mapIter != msg.constEnd(); ++mapIter) {
+        mapSize += sizeof(quint32) + mapIter.key().size();
+        mapSize += sizeof(quint32) + listDataSize(mapIter.value());
+    }
+
+    return sizeof(quint32) // seqNum
+            + sizeof(quint32) + name.size()
+            + sizeof(quint32) + mapSize;
+}
+
+
+void TDriverRbiProtocol::makeStringListMapMsg(QByteArray &target, const QByteArray &name, const BAListMap &msg, quint32 seqNum)
+{
+    // message is written in one pass, with exactly the same byte layout
+    // that nested QDataStream buffers would produce
+
+    const int msgSize = stringListMapMsgSize(name, msg);
+    const int oldSize = target.size();
+    target.resize(oldSize + msgSize);
+
+    char *dst = target.data() + oldSize;
+    dst = putWord(dst, seqNum);
+    dst = putBytes(dst, name);
+
+    // map data length is message size without seqNum, name and map length fields
+    dst = putDataSize(dst, msgSize - 3*sizeof(quint32) - name.size());
+
+    BAListMap::const_iterator mapIter;
+    for (mapIter = msg.constBegin(); mapIter != msg.constEnd(); ++mapIter) {
+        dst = putBytes(dst, mapIter.key());
+        dst = putDataSize(dst, listDataSize(mapIter.value()));
+        foreach(const QByteArray &listItem, mapIter.value()) {
+            dst = putBytes(dst, listItem);
         }
     }
-    msgStream << mapBuf;
+
+    Q_ASSERT(dst == target.constData() + target.size());
 }
 
 
 quint32 TDriverRbiProtocol::sendStringListMapMsg(const QByteArray &name, const BAListMap &msg, quint32 seqNum)
 {
     if (seqNum == 0) {
-        if (nextSN == 0) seqNum = 1;
-        else seqNum = nextSN;
+        seqNum = nextSN.fetchAndAddOrdered(1);
+        if (seqNum == 0) seqNum = nextSN.fetchAndAddOrdered(1); // 0 is for hello, also when this wraps around
+    }
+    else {
+        raiseNextSeqNum(seqNum + 1);
     }
-    nextSN = seqNum + 1;
-    if (nextSN < seqNum) seqNum = 1, nextSN=2; // in case this ever wraps around...
-
-    //qDebug() << FCFL << "SENDING" << seqNum << name << "\n>>>>>>" << msg;
 
     QByteArray wBuf;
     makeStringListMapMsg(wBuf, name, msg, seqNum);
+    TDriverRbiStatistics::globalInstance()->messageSent(
+                seqNum, TDriverRbiStatistics::commandKey(name, msg), wBuf.size());
+    // wBuf is implicitly shared through the queued signal, and handed to socket without copying
     emit writeDataReady(wBuf);
 
     return seqNum;
@@ -230,10 +279,14 @@ BAListMap TDriverRbiProtocol::parseListMap(const QByteArray &data)
 
 void TDriverRbiProtocol::readyToRead()
 {
-    //qDebug() << FCFL << "ENTRY";
     VALIDATE_THREAD;
 
     do {
+        if (readState == ReadSeqNum && readBuffer.isEmpty() && conn->bytesAvailable() > 0) {
+            // first byte of a new message
+            firstByteNs = TDriverRbiStatistics::globalInstance()->timestamp();
+        }
+
         while (readAmount > readBuffer.size() && conn->isReadable() && conn->bytesAvailable() > 0) {
             // TODO: have timeout here, in case server works incorrectly.
             // This code assumes that server always writes as many bytes of data as it says
@@ -260,7 +313,6 @@ void TDriverRbiProtocol::readyToRead()
             {
                 QDataStream parseStream(readBuffer);
                 parseStream >> readAmount;
-                //qDebug() << FFL << "got nameLen" << readAmount;
             }
             if (readAmount == 0) {
                 readState = ReadDisconnected;
@@ -272,7 +324,6 @@ void TDriverRbiProtocol::readyToRead()
 
         case ReadName:
             currentName = readBuffer;
-            //qDebug() << FFL << "got name" << currentName;
             readAmount = sizeof(quint32);
             readState = ReadDataLen;
             break;
@@ -283,7 +334,6 @@ void TDriverRbiProtocol::readyToRead()
                 parseStream >> readAmount;
             }
             if (readAmount == 0) {
-                //qDebug() << FFL << "got dataLen" << 0;
                 currentData.clear();
                 messageOver = true;
             }
@@ -294,7 +344,6 @@ void TDriverRbiProtocol::readyToRead()
             break;
         case ReadData:
             currentData = readBuffer;
-            //qDebug() << FFL << "got data bytes" << currentData.size();
             messageOver = true;
             break;
 
@@ -307,26 +356,30 @@ void TDriverRbiProtocol::readyToRead()
         if (messageOver) {
             startNewMessage(); // reset state for reading next message
 
-            QMutexLocker lock(syncMutex);
-
-            condSeqNum = receivedSN;
+            raiseNextSeqNum(receivedSN + 1);
+            BAListMap receivedMsg(parseListMap(currentData));
 
-            if (nextSN <= receivedSN) nextSN = receivedSN+1;
-            condName = currentName;
-
-            condMsg = parseListMap(currentData);
-            if (condName == "hello") {
+            if (currentName == "hello") {
                 // handle hello message specially
+                QMutexLocker lock(syncMutex);
                 haveHello = true;
-                helloMsg = condMsg;
-                qDebug() << FCFL << "Received HELLO";
+                helloMsg = receivedMsg;
+                qCDebug(logRbi) << FCFL << "Received HELLO";
                 helloCond->wakeAll();
                 emit helloReceived();
             }
             else {
-                //qDebug() << FCFL << "RECEIVED" << condSeqNum << condName << "=>" << condMsg;
-                msgCond->wakeAll();
-                emit messageReceived(condSeqNum, condName, condMsg);
+                QByteArray channel;
+                double queueMs = -1;
+                TDriverRbiStatistics::takeQueueInfo(receivedMsg, channel, queueMs);
+                TDriverRbiStatistics::globalInstance()->messageReceived(
+                            receivedSN, firstByteNs,
+                            3*sizeof(quint32) + currentName.size() + currentData.size(),
+                            channel, queueMs);
+
+                // one shared message for all consumers of the channel
+                TDriverRbiDispatcher::globalInstance()->post(
+                            TDriverRbiMessage(receivedSN, currentName, receivedMsg));
             }
         }
 
@@ -334,16 +387,25 @@ void TDriverRbiProtocol::readyToRead()
 }
 
 
+void TDriverRbiProtocol::raiseNextSeqNum(quint32 atLeast)
+{
+    // nextSN is shared by sending threads and the reading thread
+    quint32 current;
+    do {
+        current = nextSN.loadAcquire();
+        if (current >= atLeast) return;
+    } while (!nextSN.testAndSetOrdered(current, atLeast));
+}
+
+
 void TDriverRbiProtocol::bytesWritten(qint64 written)
 {
-    //qDebug() << FFL << "written" << written << ", current writeBuffer size" << writeBuffer.size();
     VALIDATE_THREAD;
 
     if (conn->isWritable() && !writeBuffer.isEmpty()) {
         // write more!
         written = conn->write(writeBuffer);
         writeBuffer.remove(0, written);
-        //qDebug() << FFL << "more written" << written << ", remaining writeBuffer size" << writeBuffer.size();
     }
 
     if (written == 0 && !writeBuffer.isEmpty()) {
@@ -360,49 +422,17 @@ bool TDriverRbiProtocol::waitHello(unsigned long timeout)
                 : helloCond->wait(syncMutex, timeout);
 }
 
-bool TDriverRbiProtocol::waitSeqNum(quint32 seqNum, unsigned long timeout)
-{
-    qDebug() << FCFL << "seqNum" << seqNum;
-    VALIDATE_THREAD_NOT;
-
-    Q_ASSERT(syncMutex);
-    Q_ASSERT(msgCond);
-
-    // handler.condMutex must be locked when entering here!
-    forever {
-        // test timeout
-
-        if (!msgCond->wait(syncMutex, timeout)) {
-            qDebug() << FCFL << "returning false for seqNum" << seqNum << "wait timeout";
-            return false;
-        }
-        // test for success (seqNum 0 accepts any sequence number)
-        else if (seqNum == 0 || condSeqNum == seqNum) {
-            qDebug() << FCFL << "returning true for condSeqNum" << condSeqNum << "vs seqNum" << seqNum;
-            return true;
-        }
-
-        // test missed seqNum
-        else if (condSeqNum == 0 || condSeqNum > seqNum) {
-            qDebug() << FCFL << "returning false for condSeqNum" << condSeqNum << "vs seqNum" << seqNum;
-            return false;
-        }
-
-        //else qDebug() << FCFL << "ignoring condSeqNum" << condSeqNum << "vs seqNum" << seqNum;
-    }
-}
-
 
 #if 0
 void TDriverRbiProtocol::dumpReceivedMessage(quint32 seqNum, QByteArray name, QByteArray data)
 {
-    qDebug() << FFL << "seqnum" << seqNum << "name" << name << "datalen" << data.length();
+    qCDebug(logRbi) << FFL << "seqnum" << seqNum << "name" << name << "datalen" << data.length();
 }
 void TDriverRbiProtocol::bounceReceivedMessage(quint32 seqNum, QByteArray name, QByteArray data)
 {
-    qDebug() << FFL << "seqnum" << seqNum << "name" << name << "datalen" << data.length();
+    qCDebug(logRbi) << FFL << "seqnum" << seqNum << "name" << name << "datalen" << data.length();
     BAListMap map(parseListMap(data));
-    qDebug() << FFL << "map" << map;
+    qCDebug(logRbi) << FFL << "map" << map;
     sendStringListMapMsg(seqNum+1, name, map);
 }
 #endif
@@ -30,6 +30,7 @@
 #include <QList>
 #include <QMap>
 #include <QAbstractSocket>
+#include <QAtomicInteger>
 
 class QMutex;
 class QWaitCondition;
@@ -40,11 +41,10 @@ class LIBTDRIVERUTILSHARED_EXPORT TDriverRbiProtocol : public QObject
     Q_OBJECT
 
 public:
-    explicit TDriverRbiProtocol(QAbstractSocket *connection, QMutex *cm, QWaitCondition *mwc, QWaitCondition *hwc, QObject *parent = 0);
+    explicit TDriverRbiProtocol(QAbstractSocket *connection, QMutex *cm, QWaitCondition *hwc, QObject *parent = 0);
     ~TDriverRbiProtocol();
 
-    quint32 nextSeqNum() { return nextSN; }
-    BAListMap waitedMessage() { return condMsg; }
+    quint32 nextSeqNum() { return nextSN.loadAcquire(); }
 
     void setValidThread(QThread *id) { validThread = id; }
 
@@ -54,15 +54,14 @@ public:
 
 public:
     bool waitHello(unsigned long timeout);
-    bool waitSeqNum(quint32 seqNum, unsigned long timeout);
     static BAList parseList(const QByteArray &data);
     static BAListMap parseListMap(const QByteArray &data);
+    static int stringListMapMsgSize(const QByteArray &name, const BAListMap &msg);
     static void makeStringListMapMsg(QByteArray &target, const QByteArray &name, const BAListMap &msg, quint32 seqNum);
 
 signals:
     // for inter-thread communication, internal use only
     void writeDataReady(QByteArray data);
-    void messageReceived(quint32 seqNum, QByteArray name, BAListMap message);
     void helloReceived();
     void gotDisconnection();
 
@@ -83,6 +82,9 @@ private slots:
     void startNewMessage();
     void addWriteData(QByteArray data);
 
+private:
+    void raiseNextSeqNum(quint32 atLeast);
+
 private:
     enum { ReadDisconnected, ReadSeqNum, ReadNameLen, ReadName, ReadDataLen, ReadData } readState;
     qint32 readAmount;
@@ -90,6 +92,7 @@ private:
     quint32 receivedSN;
     QByteArray currentName;
     QByteArray currentData;
+    qint64 firstByteNs;
 
     QByteArray writeBuffer;
 
@@ -97,13 +100,8 @@ private:
     BAListMap helloMsg;
 
     QMutex *syncMutex;
-    QWaitCondition *msgCond;
-
-    quint32 condSeqNum;
-    BAListMap condMsg;
-    QByteArray condName;
 
-    quint32 nextSN;
+    QAtomicInteger<quint32> nextSN;
     bool haveHello;
     QWaitCondition *helloCond;
 
@@ -0,0 +1,299 @@
+/***************************************************************************
+**
+** Copyright (C) 2010 Nokia Corporation and/or its subsidiary(-ies).
+** All rights reserved.
+** Contact: Nokia Corporation (testabilitydriver@nokia.com)
+**
+** This file is part of Testability Driver.
+**
+** If you have questions regarding the use of this file, please contact
+** Nokia at testabilitydriver@nokia.com .
+**
+** This library is free software; you can redistribute it and/or
+** modify it under the terms of the GNU Lesser General Public
+** License version 2.1 as published by the Free Software Foundation
+** and appearing in the file LICENSE.LGPL included in the packaging
+** of this file.
+**
+****************************************************************************/
+
+
+#include "tdriver_rbistatistics.h"
+#include "tdriver_util.h"
+
+#include <QMutexLocker>
+#include <QJsonObject>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QDateTime>
+#include <QFile>
+#include <QString>
+
+#include <cstring>
+
+// messages without reply or without handling are forgotten after this
+static const qint64 inFlightLimitNs = Q_INT64_C(600) * 1000 * 1000 * 1000;
+static const int inFlightPruneSize = 256;
+
+static inline double nsToMs(qint64 ns) { return double(ns) / 1.0e6; }
+
+// reply keys written by tdriver_interface.rb
+static const char channelKey[] = "__channel";
+static const char queueTimeKey[] = "__queue_ms";
+
+
+TDriverRbiStatistics::CommandStats::CommandStats() :
+    count(0),
+    bytesSent(0),
+    bytesReceived(0),
+    sumReplyWaitMs(0),
+    sumTransferMs(0),
+    sumHandlingMs(0),
+    sumTotalMs(0),
+    maxTotalMs(0)
+{
+    memset(histogram, 0, sizeof(histogram));
+}
+
+
+double TDriverRbiStatistics::CommandStats::percentileMs(double fraction) const
+{
+    // returns upper limit of the bucket containing the percentile
+    quint32 target = quint32(fraction * count + 0.5);
+    quint32 cumulative = 0;
+    for (int bucket = 0; bucket < HistogramBuckets; ++bucket) {
+        cumulative += histogram[bucket];
+        if (cumulative >= target && cumulative > 0) return bucketLimitMs(bucket);
+    }
+    return maxTotalMs;
+}
+
+
+TDriverRbiStatistics::ChannelStats::ChannelStats() :
+    count(0),
+    sumQueueMs(0),
+    maxQueueMs(0),
+    lastQueueMs(0)
+{
+}
+
+
+TDriverRbiStatistics::TDriverRbiStatistics() :
+    changes(0)
+{
+    clock.start();
+}
+
+
+TDriverRbiStatistics *TDriverRbiStatistics::globalInstance()
+{
+    static TDriverRbiStatistics instance;
+    return &instance;
+}
+
+
+QByteArray TDriverRbiStatistics::commandKey(const QByteArray &name, const BAListMap &msg)
+{
+    if (name == TDriverUtil::visualizationId && msg.value("input").size() >= 2) {
+        return msg.value("input").at(1);
+    }
+    if (name == TDriverUtil::interactionId && !msg.value("command").isEmpty()) {
+        return msg.value("command").first();
+    }
+    return name;
+}
+
+
+double TDriverRbiStatistics::bucketLimitMs(int bucket)
+{
+    return double(1 << bucket);
+}
+
+
+bool TDriverRbiStatistics::takeQueueInfo(BAListMap &msg, QByteArray &channel, double &queueMs)
+{
+    if (!msg.contains(channelKey)) return false;
+
+    channel = msg.take(channelKey).value(0);
+    bool ok = false;
+    double value = msg.take(queueTimeKey).value(0).toDouble(&ok);
+    if (!ok || channel.isEmpty()) return false;
+
+    queueMs = value;
+    return true;
+}
+
+
+void TDriverRbiStatistics::messageSent(quint32 seqNum, const QByteArray &command, int bytes)
+{
+    QMutexLocker lock(&mutex);
+    InFlight &msg = inFlight[seqNum];
+    msg.command = command;
+    msg.sentNs = timestamp();
+    msg.firstByteNs = 0;
+    msg.receivedNs = 0;
+    msg.bytesSent = bytes;
+    msg.bytesReceived = 0;
+    msg.channel.clear();
+
+    if (inFlight.size() > inFlightPruneSize) pruneInFlight(msg.sentNs);
+}
+
+
+void TDriverRbiStatistics::messageReceived(quint32 seqNum, qint64 firstByteNs, int bytes,
+                                           const QByteArray &channel, double queueMs)
+{
+    QMutexLocker lock(&mutex);
+
+    if (!channel.isEmpty() && queueMs >= 0) {
+        // counted also for messages without handling, such as cancelled ones
+        ChannelStats &ch = channels[channel];
+        ++ch.count;
+        ch.sumQueueMs += queueMs;
+        if (queueMs > ch.maxQueueMs) ch.maxQueueMs = queueMs;
+        ch.lastQueueMs = queueMs;
+        ++changes;
+    }
+
+    QHash<quint32, InFlight>::iterator it = inFlight.find(seqNum);
+    if (it == inFlight.end()) return;
+
+    it->firstByteNs = firstByteNs;
+    it->receivedNs = timestamp();
+    it->bytesReceived = bytes;
+    it->channel = channel;
+}
+
+
+void TDriverRbiStatistics::messageHandled(quint32 seqNum)
+{
+    QMutexLocker lock(&mutex);
+    QHash<quint32, InFlight>::iterator it = inFlight.find(seqNum);
+    if (it == inFlight.end() || it->receivedNs == 0) return;
+
+    const qint64 handledNs = timestamp();
+    CommandStats &cmd = stats[it->command];
+
+    double totalMs = nsToMs(handledNs - it->sentNs);
+    ++cmd.count;
+    cmd.bytesSent += it->bytesSent;
+    cmd.bytesReceived += it->bytesReceived;
+    cmd.sumReplyWaitMs += nsToMs(it->firstByteNs - it->sentNs);
+    cmd.sumTransferMs += nsToMs(it->receivedNs - it->firstByteNs);
+    cmd.sumHandlingMs += nsToMs(handledNs - it->receivedNs);
+    cmd.sumTotalMs += totalMs;
+    if (totalMs > cmd.maxTotalMs) cmd.maxTotalMs = totalMs;
+    if (!it->channel.isEmpty()) cmd.channel = it->channel;
+
+    int bucket = 0;
+    while (bucket < HistogramBuckets-1 && totalMs >= bucketLimitMs(bucket)) ++bucket;
+    ++cmd.histogram[bucket];
+
+    inFlight.erase(it);
+    ++changes;
+}
+
+
+void TDriverRbiStatistics::pruneInFlight(qint64 now)
+{
+    QHash<quint32, InFlight>::iterator it = inFlight.begin();
+    while (it != inFlight.end()) {
+        if (now - it->sentNs > inFlightLimitNs) it = inFlight.erase(it);
+        else ++it;
+    }
+}
+
+
+QMap<QByteArray, TDriverRbiStatistics::CommandStats> TDriverRbiStatistics::commandStats() const
+{
+    QMutexLocker lock(&mutex);
+    return stats;
+}
+
+
+QMap<QByteArray, TDriverRbiStatistics::ChannelStats> TDriverRbiStatistics::channelStats() const
+{
+    QMutexLocker lock(&mutex);
+    return channels;
+}
+
+
+quint32 TDriverRbiStatistics::changeCount() const
+{
+    QMutexLocker lock(&mutex);
+    return changes;
+}
+
+
+void TDriverRbiStatistics::reset()
+{
+    QMutexLocker lock(&mutex);
+    stats.clear();
+    channels.clear();
+    ++changes;
+}
+
+
+QJsonObject TDriverRbiStatistics::toJson() const
+{
+    QMap<QByteArray, CommandStats> snapshot(commandStats());
+    QMap<QByteArray, ChannelStats> channelSnapshot(channelStats());
+
+    QJsonObject commands;
+    QMap<QByteArray, CommandStats>::const_iterator it;
+    for (it = snapshot.constBegin(); it != snapshot.constEnd(); ++it) {
+        const CommandStats &cmd = it.value();
+        const double count = qMax(1u, cmd.count);
+
+        QJsonArray histogram;
+        for (int bucket = 0; bucket < HistogramBuckets; ++bucket) {
+            histogram.append(double(cmd.histogram[bucket]));
+        }
+
+        QJsonObject obj;
+        obj.insert("count", double(cmd.count));
+        obj.insert("bytes_sent", double(cmd.bytesSent));
+        obj.insert("bytes_received", double(cmd.bytesReceived));
+        obj.insert("avg_reply_wait_ms", cmd.sumReplyWaitMs / count);
+        obj.insert("avg_transfer_ms", cmd.sumTransferMs / count);
+        obj.insert("avg_handling_ms", cmd.sumHandlingMs / count);
+        obj.insert("avg_total_ms", cmd.sumTotalMs / count);
+        obj.insert("max_total_ms", cmd.maxTotalMs);
+        obj.insert("p50_total_ms", cmd.percentileMs(0.5));
+        obj.insert("p90_total_ms", cmd.percentileMs(0.9));
+        obj.insert("histogram_total_ms", histogram);
+        if (!cmd.channel.isEmpty()) obj.insert("channel", QString::fromLatin1(cmd.channel));
+        commands.insert(QString::fromLatin1(it.key()), obj);
+    }
+
+    QJsonObject channelsObj;
+    QMap<QByteArray, ChannelStats>::const_iterator ch;
+    for (ch = channelSnapshot.constBegin(); ch != channelSnapshot.constEnd(); ++ch) {
+        QJsonObject obj;
+        obj.insert("count", double(ch->count));
+        obj.insert("avg_queue_ms", ch->sumQueueMs / qMax(1u, ch->count));
+        obj.insert("max_queue_ms", ch->maxQueueMs);
+        obj.insert("last_queue_ms", ch->lastQueueMs);
+        channelsObj.insert(QString::fromLatin1(ch.key()), obj);
+    }
+
+    QJsonArray bucketLimits;
+    for (int bucket = 0; bucket < HistogramBuckets-1; ++bucket) {
+        bucketLimits.append(bucketLimitMs(bucket));
+    }
+
+    QJsonObject root;
+    root.insert("timestamp", QDateTime::currentDateTime().toString(Qt::ISODate));
+    root.insert("histogram_upper_limits_ms", bucketLimits);
+    root.insert("commands", commands);
+    root.insert("channels", channelsObj);
+    return root;
+}
+
+
+bool TDriverRbiStatistics::writeJson(const QString &fileName) const
+{
+    QFile file(fileName);
+    if (!file.open(QIODevice::WriteOnly | QIODevice::Truncate)) return false;
+    return file.write(QJsonDocument(toJson()).toJson()) > 0;
+}
@@ -0,0 +1,123 @@
+/***************************************************************************
+**
+** Copyright (C) 2010 Nokia Corporation and/or its subsidiary(-ies).
+** All rights reserved.
+** Contact: Nokia Corporation (testabilitydriver@nokia.com)
+**
+** This file is part of Testability Driver.
+**
+** If you have questions regarding the use of this file, please contact
+** Nokia at testabilitydriver@nokia.com .
+**
+** This library is free software; you can redistribute it and/or
+** modify it under the terms of the GNU Lesser General Public
+** License version 2.1 as published by the Free Software Foundation
+** and appearing in the file LICENSE.LGPL included in the packaging
+** of this file.
+**
+****************************************************************************/
+
+
+#ifndef TDRIVER_RBISTATISTICS_H
+#define TDRIVER_RBISTATISTICS_H
+
+#include "libtdriverutil_global.h"
+
+#include <QByteArray>
+#include <QList>
+#include <QMap>
+#include <QHash>
+#include <QMutex>
+#include <QElapsedTimer>
+
+class QJsonObject;
+class QString;
+
+// Round-trip timing and byte counts of RBI messages, collected per command.
+// Message is timestamped when sent, when first byte of reply arrives,
+// when full reply is received, and when receiver has handled it.
+// Queueing delay inside the Ruby script is collected per channel, see takeQueueInfo.
+// All methods are thread safe.
+class LIBTDRIVERUTILSHARED_EXPORT TDriverRbiStatistics
+{
+public:
+    // histogram of total round-trip time, bucket 0 is < 1 ms, bucket N is [2^(N-1), 2^N) ms,
+    // last bucket includes everything longer
+    enum { HistogramBuckets = 18 };
+
+    struct CommandStats {
+        quint32 count;
+        qint64 bytesSent;
+        qint64 bytesReceived;
+        double sumReplyWaitMs;  // sent -> first byte: script, SUT and file writing
+        double sumTransferMs;   // first byte -> full message
+        double sumHandlingMs;   // full message -> handled: parsing, tree building
+        double sumTotalMs;
+        double maxTotalMs;
+        quint32 histogram[HistogramBuckets];
+
+        QByteArray channel;     // channel of latest reply, empty if script did not report it
+
+        CommandStats();
+        double percentileMs(double fraction) const;
+    };
+
+    // time from script reading the message to starting its execution
+    struct ChannelStats {
+        quint32 count;
+        double sumQueueMs;
+        double maxQueueMs;
+        double lastQueueMs;
+
+        ChannelStats();
+    };
+
+    static TDriverRbiStatistics *globalInstance();
+
+    // command of visualization message is input[1], of interaction message command[0]
+    static QByteArray commandKey(const QByteArray &name, const BAListMap &msg);
+    static double bucketLimitMs(int bucket);
+
+    // removes channel and queueing delay keys added by the script from reply msg,
+    // returns false if reply did not have them
+    static bool takeQueueInfo(BAListMap &msg, QByteArray &channel, double &queueMs);
+
+    qint64 timestamp() const { return clock.nsecsElapsed(); }
+
+    void messageSent(quint32 seqNum, const QByteArray &command, int bytes);
+    void messageReceived(quint32 seqNum, qint64 firstByteNs, int bytes,
+                         const QByteArray &channel = QByteArray(), double queueMs = -1);
+    void messageHandled(quint32 seqNum);
+
+    QMap<QByteArray, CommandStats> commandStats() const;
+    QMap<QByteArray, ChannelStats> channelStats() const;
+    quint32 changeCount() const;
+    void reset();
+
+    QJsonObject toJson() const;
+    bool writeJson(const QString &fileName) const;
+
+private:
+    TDriverRbiStatistics();
+
+    struct InFlight {
+        QByteArray command;
+        qint64 sentNs;
+        qint64 firstByteNs;
+        qint64 receivedNs;
+        int bytesSent;
+        int bytesReceived;
+        QByteArray channel;
+    };
+
+    void pruneInFlight(qint64 now);
+
+    mutable QMutex mutex;
+    QElapsedTimer clock;
+    QHash<quint32, InFlight> inFlight;
+    QMap<QByteArray, CommandStats> stats;
+    QMap<QByteArray, ChannelStats> channels;
+    quint32 changes;
+};
+
+#endif // TDRIVER_RBISTATISTICS_H
@@ -18,6 +18,7 @@
 ****************************************************************************/
 
 #include <cstdlib>
+#include <cstring>
 
 #include "tdriver_rubyinterface.h"
 
@@ -32,7 +33,8 @@
 #include <QMutexLocker>
 #include <QWaitCondition>
 #include <QMutex>
-#include <QMessageBox>
+#include <QSettings>
+#include <QElapsedTimer>
 
 #include "tdriver_debug_macros.h"
 
@@ -40,6 +42,9 @@
 static const char delimChar = 032; // note: octal
 static const char InteractDelimCstr[] = { delimChar, delimChar, 0 };
 
+// same as startup line wait of startScript
+static const int standbyStartupTimeout = 20000;
+
 
 // debug macros
 #define VALIDATE_THREAD Q_ASSERT(validThread == QThread::currentThread())
@@ -57,9 +62,10 @@ TDriverRubyInterface::TDriverRubyInterface() :
     process(NULL),
     conn(NULL),
     handler(NULL),
+    standbyProcess(NULL),
+    standbyPort(0),
+    standbyVersion(0),
     initState(Closed),
-    stderrEvalSeqNum(0),
-    stdoutEvalSeqNum(0),
 
     delimStr(InteractDelimCstr),
     evalStartStr(delimStr + "START "),
@@ -80,7 +86,7 @@ TDriverRubyInterface::~TDriverRubyInterface()
 
 void TDriverRubyInterface::startGlobalInstance()
 {
-    qDebug() << FFL;
+    qCDebug(logRbi) << FFL;
     Q_ASSERT (!pGlobalInstance);
 
     pGlobalInstance = new TDriverRubyInterface();
@@ -100,7 +106,7 @@ void TDriverRubyInterface::startGlobalInstance()
 void TDriverRubyInterface::requestClose()
 {
     VALIDATE_THREAD_NOT;
-    qDebug() << FCFL;
+    qCDebug(logRbi) << FCFL;
     emit requestCloseSignal();
 }
 
@@ -111,17 +117,20 @@ void TDriverRubyInterface::run()
     // override moveToThread and move setValidThread there,
     // and use plain QThread object as the thread,
     // and maybe have startGlobalInstance(QThread *thread)
-    qDebug() << FCFL << "THREAD START";
+    qCDebug(logRbi) << FCFL << "THREAD START";
     setValidThread(currentThread());
 
     int result = exec();
-    qDebug() << FCFL << "THREAD EXIT with" << result;
+    qCDebug(logRbi) << FCFL << "THREAD EXIT with" << result;
 
     if (handler) { delete handler; handler = NULL; }
     if (conn) { delete conn; conn = NULL; }
 
     delete process; // will kill the process
     process = NULL;
+
+    delete standbyProcess;
+    standbyProcess = NULL;
 }
 
 
@@ -131,14 +140,14 @@ QString TDriverRubyInterface::goOnline()
 
     QString errorMessage;
 
-    qDebug() << FCFL << "entry in initstate" << initState;
+    qCDebug(logRbi) << FCFL << "entry in initstate" << initState;
 
     Q_ASSERT(isRunning()); // must only be called when thread is running
     QMutexLocker lock(syncMutex);
     if (initState == Closed) {
         static int counter=0;
         ++counter;
-        qDebug() << FCFL << "Emitting requestrubyconnection #" << counter;
+        qCDebug(logRbi) << FCFL << "Emitting requestrubyconnection #" << counter;
         emit requestRubyConnection(counter);
         if (!msgCond->wait(syncMutex, 80*1000)) {
             qWarning() << "Request to starting ruby process failed unexpectedly!";
@@ -149,21 +158,21 @@ QString TDriverRubyInterface::goOnline()
     if (initState == Running) {
         if (!handler->isHelloReceived()) {
             // now there should be a TCP connection, but no messages received yet
-            qDebug() << FCFL << "Waiting for HELLO";
+            qCDebug(logRbi) << FCFL << "Waiting for HELLO";
             bool ok = handler->waitHello(30000);
-            qDebug() << FCFL << "after waitHello:" << ok << handler->isHelloReceived();
+            qCDebug(logRbi) << FCFL << "after waitHello:" << ok << handler->isHelloReceived();
             if (!handler->isHelloReceived()) {
                 errorMessage = tr("TDriver interface did not send valid hello message!");
                 qWarning() << "Ruby script tdriver_interface.rb did not say hello to us (initState" << initState << "), closing.";
                 requestClose();
             }
             else {
-                qDebug() << FCFL << "Running -> Connected after hello wait";
+                qCDebug(logRbi) << FCFL << "Running -> Connected after hello wait";
                 initState = Connected;
             }
         }
         else {
-            qDebug() << FCFL << "Running -> Connected as hello already received";
+            qCDebug(logRbi) << FCFL << "Running -> Connected as hello already received";
             initState = Connected;
         }
     }
@@ -171,7 +180,7 @@ QString TDriverRubyInterface::goOnline()
         errorMessage = tr("Could not bring TDriver interface to running state!");
     }
 
-    qDebug() << FCFL << "return in initstate" << initState << ", connected" << (initState == Connected);
+    qCDebug(logRbi) << FCFL << "return in initstate" << initState << ", connected" << (initState == Connected);
 
     if (initState == Connected) return QString(); // success
     else if (errorMessage.isNull()) return tr("Unknown goOnline error!");
@@ -190,7 +199,7 @@ bool TDriverRubyInterface::isOnline()
 void TDriverRubyInterface::recreateConn()
 {
     VALIDATE_THREAD;
-    qDebug() << FCFL;
+    qCDebug(logRbi) << FCFL;
     if (handler) {
         delete handler;
         handler = NULL;
@@ -202,7 +211,7 @@ void TDriverRubyInterface::recreateConn()
             conn->close();
             if (conn->bytesAvailable() > 0) {
                 QByteArray tmp = conn->readAll();
-                qDebug() << FCFL << tmp.size() << "bytes";
+                qCDebug(logRbi) << FCFL << tmp.size() << "bytes";
             }
         }
     }
@@ -230,7 +239,7 @@ void TDriverRubyInterface::resetProcess()
     }
     // else aready not running
 
-    qDebug() << FCFL << "reporting exitcode" << process->exitCode() << "exitstatus" << process->exitStatus();
+    qCDebug(logRbi) << FCFL << "reporting exitcode" << process->exitCode() << "exitstatus" << process->exitStatus();
     process->disconnect(); // disconnect any stray signals
     readProcessStdout();
     readProcessStderr();
@@ -240,7 +249,7 @@ void TDriverRubyInterface::resetProcess()
 
 void TDriverRubyInterface::recreateProcess()
 {
-    qDebug() << FCFL << "ENTRY";
+    qCDebug(logRbi) << FCFL << "ENTRY";
     VALIDATE_THREAD;
     // reset or create QProcess instance
     if (process) {
@@ -249,19 +258,64 @@ void TDriverRubyInterface::recreateProcess()
         Q_ASSERT(initState == Closed);
     }
     else {
-        process = new QProcess(this);
-
-        // set RUBYOPT env. setting if system doesn't have it already
-        QStringList envSettings = QProcess::systemEnvironment();
-        if ( QString( getenv( "RUBYOPT" ) ) != "rubygems" ) { envSettings << "RUBYOPT=rubygems"; }
-        process->setEnvironment( envSettings );
+        process = createProcess();
     }
 
     Q_ASSERT(process && process->state() == QProcess::NotRunning && process->bytesAvailable() == 0);
 
     // (re)connect signals
     connect(process, SIGNAL(finished(int,QProcess::ExitStatus)), this, SIGNAL(rubyProcessFinished()));
-    qDebug() << FCFL << "EXIT";
+    qCDebug(logRbi) << FCFL << "EXIT";
+}
+
+
+QProcess *TDriverRubyInterface::createProcess()
+{
+    QProcess *newProcess = new QProcess(this);
+
+    // set RUBYOPT env. setting if system doesn't have it already
+    QStringList envSettings = QProcess::systemEnvironment();
+    if ( QString( getenv( "RUBYOPT" ) ) != "rubygems" ) { envSettings << "RUBYOPT=rubygems"; }
+    newProcess->setEnvironment( envSettings );
+    newProcess->setTextModeEnabled(true);
+
+    return newProcess;
+}
+
+
+static inline bool isValidStartupList(const BAList &startupList)
+{
+    // Ruby string printed at script startup:
+    // "TDriverVisualizerRubyInterface version #{tdriver_interface_rb_version} port #{server.addr[1]} tdriver #{tdriver_gem_version}"
+    return (startupList.length() >= 7 &&
+            startupList.at(0) == "TDriverVisualizerRubyInterface" &&
+            startupList.at(1) == "version" &&
+            startupList.at(2).toInt() != 0 &&
+            startupList.at(3) == "port" &&
+            startupList.at(4).toInt() != 0 &&
+            startupList.at(5) == "tdriver" &&
+            !startupList.at(6).isEmpty());
+}
+
+
+// listener is normally a Ruby script, but TDRIVER_VISUALIZER_LISTENER may also
+// point to an executable, such as tdriver_mockrbi
+static inline bool isRubyListener(const QString &scriptFile)
+{
+    return scriptFile.endsWith(".rb", Qt::CaseInsensitive);
+}
+
+
+static inline void startListener(QProcess *proc, const QString &scriptFile)
+{
+    if (isRubyListener(scriptFile)) proc->start("ruby", QStringList() << scriptFile);
+    else proc->start(scriptFile, QStringList());
+}
+
+
+static inline QString listenerCommandLine(const QString &scriptFile)
+{
+    return isRubyListener(scriptFile) ? "ruby " + scriptFile : scriptFile;
 }
 
 
@@ -277,16 +331,75 @@ static inline QString getStdErrText(const QByteArray &data)
 void TDriverRubyInterface::resetRubyConnection(int counter)
 {
     VALIDATE_THREAD;
-    qDebug() << FCFL << "with counter value" << counter;
+    qCDebug(logRbi) << FCFL << "with counter value" << counter;
 
     QMutexLocker lock(syncMutex);
     recreateConn();
-    recreateProcess();
 
-    bool ok = true;
     initErrorMsg.clear();
     QString errorTitle(tr("Failed to initialize TDriver"));
 
+    // partial lines of previous process must not be joined with output of this one,
+    // promoted standby continues with its own scanner state
+    bool ok = promoteStandbyProcess();
+    if (!ok) {
+        recreateProcess();
+        ok = startScript(errorTitle);
+        stdoutScanner = OutputScanner();
+        stderrScanner = OutputScanner();
+    }
+    connect(process, SIGNAL(readyReadStandardError()), this, SLOT(readProcessStderr()));
+    connect(process, SIGNAL(readyReadStandardOutput()), this, SLOT(readProcessStdout()));
+    // read and ignore any extra output
+    readProcessStderr();
+    readProcessStdout();
+
+    if (ok) {
+        Q_ASSERT(!handler);
+        handler = new TDriverRbiProtocol(conn, syncMutex, helloCond, this);
+        handler->setValidThread(currentThread());
+
+        connect(handler, SIGNAL(helloReceived()),
+                SIGNAL(rubyOnline()));
+
+        connect(handler, SIGNAL(helloReceived()),
+                SLOT(startStandbyProcess()));
+
+        // received messages are routed to consumers by TDriverRbiDispatcher
+
+        connect(handler, SIGNAL(gotDisconnection()),
+                SLOT(close()));
+
+        qCDebug(logRbi) << FCFL << "Connecting localhost :" << rbiPort;
+        conn->connectToHost(QHostAddress(QHostAddress::LocalHost), rbiPort);
+        if (!conn->waitForConnected(30000)) {
+            initErrorMsg = tr("Failed to connect to Ruby process via TCP/IP!");
+            qCDebug(logRbi) << FCFL << "emit error" << errorTitle << initErrorMsg;
+            emit rbiError(errorTitle, initErrorMsg, "");
+            ok = false;
+        }
+    }
+
+    if (ok) {
+        initState = Running;
+    }
+    qCDebug(logRbi) << FCFL << "RESULT" << ok << initState;
+
+    // Notify the thread that called resetRubyConnection
+    msgCond->wakeAll();
+
+
+    if (!ok) {
+        helloCond->wakeAll();
+    }
+}
+
+
+bool TDriverRubyInterface::startScript(const QString &errorTitle)
+{
+    VALIDATE_THREAD;
+    bool ok = true;
+
     // if TDRIVER_VISUALIZER_LISTENER environment variable is set, use a custom file to use as the listener
     QString scriptFile = TDriverUtil::tdriverHelperFilePath("tdriver_interface.rb", "TDRIVER_VISUALIZER_LISTENER");
 
@@ -294,20 +407,18 @@ void TDriverRubyInterface::resetRubyConnection(int counter)
         // verify that script file exists
         if (!QFile::exists( scriptFile )) {
             initErrorMsg = tr("Could not find Visualizer listener server file '%1'" ).arg(scriptFile);
-            qDebug() << FCFL << "emit error" << errorTitle << initErrorMsg;
+            qCDebug(logRbi) << FCFL << "emit error" << errorTitle << initErrorMsg;
             emit rbiError(errorTitle, initErrorMsg, "");
             ok = false;
         }
     }
 
-    if (ok) process->setTextModeEnabled(true);
-
-    if (ok) process->start( "ruby", QStringList() << scriptFile );
-    QString startCmdLine("\n\nStart command: ruby " + scriptFile);
+    if (ok) startListener(process, scriptFile);
+    QString startCmdLine("\n\nStart command: " + listenerCommandLine(scriptFile));
 
     if ( ok && !process->waitForStarted( 20000 ) ) {
         initErrorMsg = tr("Could not start Ruby script '%1'" ).arg(scriptFile);
-        qDebug() << FCFL << "emit error" << errorTitle << initErrorMsg;
+        qCDebug(logRbi) << FCFL << "emit error" << errorTitle << initErrorMsg;
         emit rbiError(errorTitle, initErrorMsg, "");
         ok = false;
     }
@@ -317,7 +428,7 @@ void TDriverRubyInterface::resetRubyConnection(int counter)
         initErrorMsg += startCmdLine;
         initErrorMsg += getStdErrText(process->readAllStandardError());
 
-        qDebug() << FCFL << "emit error" << errorTitle << initErrorMsg;
+        qCDebug(logRbi) << FCFL << "emit error" << errorTitle << initErrorMsg;
         emit rbiError(errorTitle, initErrorMsg, "");
         ok = false;
     }
@@ -326,7 +437,7 @@ void TDriverRubyInterface::resetRubyConnection(int counter)
         initErrorMsg = tr("Could not read full line of startup parameters." );
         initErrorMsg += startCmdLine;
         initErrorMsg += getStdErrText(process->readAllStandardError());
-        qDebug() << FCFL << "emit error" << errorTitle << initErrorMsg;
+        qCDebug(logRbi) << FCFL << "emit error" << errorTitle << initErrorMsg;
         emit rbiError(errorTitle, initErrorMsg, "");
         ok = false;
     }
@@ -336,27 +447,17 @@ void TDriverRubyInterface::resetRubyConnection(int counter)
         startupLine = process->readLine().simplified();
         BAList startupList(startupLine.split(' '));
 
-        // Ruby string printed at script startup:
-        // "TDriverVisualizerRubyInterface version #{tdriver_interface_rb_version} port #{server.addr[1]} tdriver #{tdriver_gem_version}"
         int scriptVersion = 0;
-        if (startupList.length() < 7 ||
-                startupList.at(0) != "TDriverVisualizerRubyInterface" ||
-                startupList.at(1) != "version" ||
-                (scriptVersion = startupList.at(2).toInt()) == 0 ||
-                startupList.at(3) != "port" ||
-                startupList.at(4).toInt() == 0 ||
-                startupList.at(5) != "tdriver" ||
-                startupList.at(6).isEmpty())
-        {
+        if (!isValidStartupList(startupList)) {
             initErrorMsg = tr("Invalid first line '%1'.").arg(QString::fromLocal8Bit(startupLine));
             initErrorMsg += startCmdLine;
             initErrorMsg += getStdErrText(process->readAllStandardError());
 
-            qDebug() << FCFL << "emit error" << errorTitle << initErrorMsg;
+            qCDebug(logRbi) << FCFL << "emit error" << errorTitle << initErrorMsg;
             emit rbiError(errorTitle, initErrorMsg, process->readAllStandardOutput());
             ok = false;
         }
-        else if (REQUIRED_TDRIVER_INTERFACE_RB_VERSION != scriptVersion) {
+        else if (REQUIRED_TDRIVER_INTERFACE_RB_VERSION != (scriptVersion = startupList.at(2).toInt())) {
             initErrorMsg = tr("Script reported version %1, but %2 is required.\n"
                               "Last Visualizer update may not have been fully successful.\n"
                               "Please find and remove obsolete tdriver_interface.rb file and reinstall.")
@@ -364,7 +465,7 @@ void TDriverRubyInterface::resetRubyConnection(int counter)
                     .arg(REQUIRED_TDRIVER_INTERFACE_RB_VERSION);
             initErrorMsg += startCmdLine;
             initErrorMsg += getStdErrText(process->readAllStandardError());
-            qDebug() << FCFL << "emit error" << errorTitle << initErrorMsg;
+            qCDebug(logRbi) << FCFL << "emit error" << errorTitle << initErrorMsg;
             emit rbiError(errorTitle, initErrorMsg, process->readAllStandardOutput());
             ok = false;
         }
@@ -379,53 +480,182 @@ void TDriverRubyInterface::resetRubyConnection(int counter)
         initErrorMsg = tr("Invalid values on first line: rbiPort %1, rbiVersion %2").arg(rbiPort).arg(rbiVersion);
         initErrorMsg += startCmdLine;
         initErrorMsg += getStdErrText(process->readAllStandardError());
-        qDebug() << FCFL << "emit error" << errorTitle << initErrorMsg;
+        qCDebug(logRbi) << FCFL << "emit error" << errorTitle << initErrorMsg;
         emit rbiError(errorTitle, initErrorMsg, process->readAllStandardOutput());
         ok = false;
     }
 
-    connect(process, SIGNAL(readyReadStandardError()), this, SLOT(readProcessStderr()));
-    connect(process, SIGNAL(readyReadStandardOutput()), this, SLOT(readProcessStdout()));
-    // read and ignore any extra output
-    readProcessStderr();
-    readProcessStdout();
+    return ok;
+}
 
-    if (ok) {
-        Q_ASSERT(!handler);
-        handler = new TDriverRbiProtocol(conn, syncMutex, msgCond, helloCond, this);
-        handler->setValidThread(currentThread());
 
-        connect(handler, SIGNAL(helloReceived()),
-                SIGNAL(rubyOnline()));
+bool TDriverRubyInterface::isStandbyEnabled()
+{
+    return QSettings().value("rubyinterface/warm_standby", false).toBool();
+}
 
-        connect(handler, SIGNAL(messageReceived(quint32,QByteArray,BAListMap)),
-                SIGNAL(messageReceived(quint32,QByteArray,BAListMap)));
 
-        connect(handler, SIGNAL(gotDisconnection()),
-                SLOT(close()));
+void TDriverRubyInterface::startStandbyProcess()
+{
+    VALIDATE_THREAD;
+    if (standbyProcess || !isStandbyEnabled()) return;
 
-        qDebug() << FCFL << "Connecting localhost :" << rbiPort;
-        conn->connectToHost(QHostAddress(QHostAddress::LocalHost), rbiPort);
-        if (!conn->waitForConnected(30000)) {
-            initErrorMsg = tr("Failed to connect to Ruby process via TCP/IP!");
-            qDebug() << FCFL << "emit error" << errorTitle << initErrorMsg;
-            emit rbiError(errorTitle, initErrorMsg, "");
-            ok = false;
-        }
+    QString scriptFile = TDriverUtil::tdriverHelperFilePath("tdriver_interface.rb", "TDRIVER_VISUALIZER_LISTENER");
+    if (!QFile::exists(scriptFile)) return;
+
+    qCDebug(logRbi) << FCFL << "starting standby" << scriptFile;
+    standbyPort = 0;
+    standbyVersion = 0;
+    standbyTDriverVersion.clear();
+
+    standbyStdoutScanner = OutputScanner();
+    standbyStderrScanner = OutputScanner();
+    standbyProcess = createProcess();
+    connect(standbyProcess, SIGNAL(readyReadStandardOutput()), this, SLOT(readStandbyStartup()));
+    // errors of loading tdriver must not be lost, and a full pipe would block the standby
+    connect(standbyProcess, SIGNAL(readyReadStandardError()), this, SLOT(readStandbyStderr()));
+    connect(standbyProcess, SIGNAL(finished(int,QProcess::ExitStatus)), this, SLOT(standbyFinished()));
+    startListener(standbyProcess, scriptFile);
+}
+
+
+void TDriverRubyInterface::readStandbyStartup()
+{
+    VALIDATE_THREAD;
+    if (!standbyProcess || standbyPort != 0 || !standbyProcess->canReadLine()) return;
+
+    QByteArray startupLine = standbyProcess->readLine().simplified();
+    BAList startupList(startupLine.split(' '));
+
+    if (!isValidStartupList(startupList) || startupList.at(2).toInt() != REQUIRED_TDRIVER_INTERFACE_RB_VERSION) {
+        qWarning() << FCFL << "invalid standby startup line" << startupLine << ", discarding standby";
+        discardStandbyProcess();
+        return;
     }
 
-    if (ok) {
-        initState = Running;
+    standbyVersion = startupList.at(2).toInt();
+    standbyPort = startupList.at(4).toInt();
+    standbyTDriverVersion = startupList.at(6);
+    disconnect(standbyProcess, SIGNAL(readyReadStandardOutput()), this, SLOT(readStandbyStartup()));
+    connect(standbyProcess, SIGNAL(readyReadStandardOutput()), this, SLOT(readStandbyStdout()));
+    qCDebug(logRbi) << FCFL << "standby ready at port" << standbyPort;
+
+    // anything after startup line is kept until the standby is promoted
+    readStandbyStdout();
+}
+
+
+// output of standby is not shown while another process is active, it is scanned after promotion
+void TDriverRubyInterface::bufferStandbyOutput(OutputScanner &scanner, const QByteArray &bytes)
+{
+    static const int maxStandbyOutput = 1024 * 1024;
+
+    scanner.buffer.append(bytes);
+    if (scanner.buffer.size() <= maxStandbyOutput) return;
+
+    // oldest whole lines are dropped, so scanning still starts at a line start
+    int cut = scanner.buffer.indexOf('\n', scanner.buffer.size() - maxStandbyOutput);
+    cut = (cut < 0) ? scanner.buffer.size() : cut + 1;
+    qWarning() << FCFL << "dropping" << cut << "bytes of standby output:" << scanner.buffer.left(qMin(cut, 200));
+    scanner.buffer.remove(0, cut);
+    scanner.atLineStart = true;
+}
+
+
+void TDriverRubyInterface::readStandbyStdout()
+{
+    VALIDATE_THREAD;
+    if (standbyProcess) bufferStandbyOutput(standbyStdoutScanner, standbyProcess->readAllStandardOutput());
+}
+
+
+void TDriverRubyInterface::readStandbyStderr()
+{
+    VALIDATE_THREAD;
+    if (standbyProcess) bufferStandbyOutput(standbyStderrScanner, standbyProcess->readAllStandardError());
+}
+
+
+void TDriverRubyInterface::standbyFinished()
+{
+    VALIDATE_THREAD;
+    qWarning() << FCFL << "standby ruby process finished unexpectedly";
+    readStandbyStdout();
+    readStandbyStderr();
+    discardStandbyProcess();
+}
+
+
+void TDriverRubyInterface::discardStandbyProcess()
+{
+    VALIDATE_THREAD;
+    if (!standbyProcess) return;
+
+    standbyProcess->disconnect();
+    if (standbyProcess->state() != QProcess::NotRunning) {
+        standbyProcess->kill();
+        standbyProcess->waitForFinished(5000);
     }
-    qDebug() << FCFL << "RESULT" << ok << initState;
+    standbyProcess->deleteLater();
+    standbyProcess = NULL;
+    standbyPort = 0;
 
-    // Notify the thread that called resetRubyConnection
-    msgCond->wakeAll();
+    // output of a standby which never became active is only logged
+    if (!standbyStdoutScanner.buffer.isEmpty()) {
+        qWarning() << FCFL << "discarded standby STDOUT" << standbyStdoutScanner.buffer;
+    }
+    if (!standbyStderrScanner.buffer.isEmpty()) {
+        qWarning() << FCFL << "discarded standby STDERR" << standbyStderrScanner.buffer;
+    }
+    standbyStdoutScanner = OutputScanner();
+    standbyStderrScanner = OutputScanner();
+}
 
 
-    if (!ok) {
-        helloCond->wakeAll();
+bool TDriverRubyInterface::promoteStandbyProcess()
+{
+    VALIDATE_THREAD;
+
+    // standby which is still loading tdriver is waited for, that is still faster than a cold start
+    QElapsedTimer startupTimer;
+    startupTimer.start();
+    while (standbyProcess && standbyPort == 0 && standbyProcess->state() != QProcess::NotRunning) {
+        const int remaining = standbyStartupTimeout - int(startupTimer.elapsed());
+        if (remaining <= 0 || !standbyProcess->waitForReadyRead(remaining)) break;
+        readStandbyStartup();
     }
+
+    if (!standbyProcess || standbyPort == 0 || standbyProcess->state() != QProcess::Running) {
+        if (standbyProcess) qWarning() << FCFL << "standby did not become ready, discarding standby";
+        discardStandbyProcess();
+        return false;
+    }
+
+    qCDebug(logRbi) << FCFL << "promoting standby at port" << standbyPort;
+
+    if (process) {
+        initState = Closing;
+        resetProcess();
+        Q_ASSERT(initState == Closed);
+        delete process;
+    }
+
+    process = standbyProcess;
+    standbyProcess = NULL;
+    process->disconnect();
+    connect(process, SIGNAL(finished(int,QProcess::ExitStatus)), this, SIGNAL(rubyProcessFinished()));
+    stdoutScanner = standbyStdoutScanner;
+    stderrScanner = standbyStderrScanner;
+    standbyStdoutScanner = OutputScanner();
+    standbyStderrScanner = OutputScanner();
+
+    rbiVersion = standbyVersion;
+    rbiPort = standbyPort;
+    rbiTDriverVersion = standbyTDriverVersion;
+    standbyPort = 0;
+
+    // new standby is started after this one has said hello
+    return true;
 }
 
 
@@ -445,7 +675,7 @@ void TDriverRubyInterface::close()
 
 
     if (initState == Closed || initState == Closing) {
-        qDebug() << FCFL << "initState already" << initState;
+        qCDebug(logRbi) << FCFL << "initState already" << initState;
     }
     else {
         initState = Closing;
@@ -453,7 +683,7 @@ void TDriverRubyInterface::close()
         msgCond->wakeAll();
         helloCond->wakeAll();
 
-        qDebug() << FCFL << "TDriverRubyInterface: Closing process, process state" << process->state() << ", conn state" << conn->state();
+        qCDebug(logRbi) << FCFL << "TDriverRubyInterface: Closing process, process state" << process->state() << ", conn state" << conn->state();
         if (conn->isOpen()) {
             conn->close();
         }
@@ -466,66 +696,120 @@ void TDriverRubyInterface::close()
 }
 
 
-void TDriverRubyInterface::readProcessHelper(int fnum, QByteArray &readBuffer, quint32 &seqNum, QByteArray &evalBuffer)
+static bool bytesStartWith(const char *data, int length, const QByteArray &prefix)
 {
-    QByteArray data( (fnum == 0)
-                     ? process->readAllStandardOutput()
-                     : process->readAllStandardError());
+    return length >= prefix.size() && memcmp(data, prefix.constData(), prefix.size()) == 0;
+}
 
-    const char *streamName = (fnum == 0) ? "STDOUT" : "STDERR";
 
-    readBuffer.append(data);
-    BAList lines = readBuffer.split('\n');
-    readBuffer = lines.takeLast(); // put empty or partial line back to buffer
+void TDriverRubyInterface::readProcessHelper(QProcess *proc, int fnum, OutputScanner &scanner)
+{
+    scanner.buffer.append( (fnum == 0)
+                           ? proc->readAllStandardOutput()
+                           : proc->readAllStandardError());
+
+    const char *data = scanner.buffer.constData();
+    const int size = scanner.buffer.size();
+    int lineStart = 0;
+
+    // bytes kept from previous reads are known to have no line end, so search only new data
+    int pos = scanner.scannedSize;
+    while (pos < size) {
+        const char *lineEnd = static_cast<const char *>(memchr(data + pos, '\n', size - pos));
+        if (!lineEnd) break;
+        const int lineLength = (lineEnd - data) - lineStart;
+        scanOutputLine(fnum, scanner, data + lineStart, lineLength);
+        scanner.atLineStart = true;
+        lineStart += lineLength + 1;
+        pos = lineStart;
+    }
 
-    foreach(QByteArray line, lines) {
-        if (line.startsWith(delimStr)) {
-            if (seqNum > 0) {
-                qDebug() << FCFL << streamName << "seqNum" << seqNum << "output" << evalBuffer;
-                emit rubyOutput(fnum, seqNum, evalBuffer);
+    // evaluation output without line end, such as a long inspected value, is passed on
+    // right away unless it may still turn out to be a delimiter line
+    if (scanner.evalSeqNum > 0 && lineStart < size) {
+        const char *partial = data + lineStart;
+        const int partialLength = size - lineStart;
+        if (!scanner.atLineStart
+                || memcmp(partial, delimStr.constData(), qMin(partialLength, delimStr.size())) != 0) {
+            // keep trailing non-ASCII bytes, they may be an incomplete multibyte character
+            int emitLength = partialLength;
+            while (emitLength > 0 && static_cast<uchar>(partial[emitLength-1]) >= 0x80) --emitLength;
+            if (emitLength > 0) {
+                scanner.evalChunk.append(partial, emitLength);
+                scanner.atLineStart = false;
+                lineStart += emitLength;
             }
-            evalBuffer.clear();
-            seqNum = 0;
-
-            if (line.startsWith(evalStartStr)) {
-                static const QRegExp start_ex("START ([0-9]+)");
-                if (start_ex.indexIn(QString(line)) > 0) {
-                    seqNum = start_ex.capturedTexts().at(1).toUInt();
-                }
-                else {
-                    qWarning() << FCFL << "invalid start line" << line;
-                }
+        }
+    }
+    flushEvalChunk(fnum, scanner);
+
+    if (lineStart > 0) scanner.buffer.remove(0, lineStart);
+    scanner.scannedSize = scanner.buffer.size();
+}
+
+
+void TDriverRubyInterface::scanOutputLine(int fnum, OutputScanner &scanner, const char *line, int length)
+{
+    const char *streamName = (fnum == 0) ? "STDOUT" : "STDERR";
+
+    if (scanner.atLineStart && bytesStartWith(line, length, delimStr)) {
+        flushEvalChunk(fnum, scanner);
+        scanner.evalSeqNum = 0;
+
+        if (bytesStartWith(line, length, evalStartStr)) {
+            quint32 seqNum = 0;
+            int ii = evalStartStr.size();
+            for ( ; ii < length && line[ii] >= '0' && line[ii] <= '9'; ++ii) {
+                seqNum = seqNum * 10 + (line[ii] - '0');
             }
-            else if (line.startsWith(evalEndStr)) {
-                // nothing
+            if (ii > evalStartStr.size()) {
+                scanner.evalSeqNum = seqNum;
             }
             else {
-                qDebug() << FCFL << streamName << "IGNORING" << line;
+                qWarning() << FCFL << "invalid start line" << QByteArray(line, length);
             }
         }
-        else if (seqNum > 0) {
-            evalBuffer.append(line);
-            evalBuffer.append('\n');
+        else if (bytesStartWith(line, length, evalEndStr)) {
+            // nothing
         }
         else {
-            qDebug() << FCFL << streamName << "untagged line" << line;
-            emit rubyOutput(fnum, line);
+            qCDebug(logRbi) << FCFL << streamName << "IGNORING" << QByteArray(line, length);
         }
     }
+    else if (scanner.evalSeqNum > 0) {
+        scanner.evalChunk.append(line, length);
+        scanner.evalChunk.append('\n');
+    }
+    else {
+        QByteArray untagged(line, length);
+        qCDebug(logRbi) << FCFL << streamName << "untagged line" << untagged;
+        emit rubyOutput(fnum, untagged);
+    }
+}
+
+
+void TDriverRubyInterface::flushEvalChunk(int fnum, OutputScanner &scanner)
+{
+    if (scanner.evalSeqNum > 0 && !scanner.evalChunk.isEmpty()) {
+        qCDebug(logRbi) << FCFL << ((fnum == 0) ? "STDOUT" : "STDERR")
+                        << "seqNum" << scanner.evalSeqNum << "output" << scanner.evalChunk;
+        emit rubyOutput(fnum, scanner.evalSeqNum, scanner.evalChunk);
+    }
+    scanner.evalChunk.clear();
 }
 
 
 void TDriverRubyInterface::readProcessStdout()
 {
     VALIDATE_THREAD;
-    readProcessHelper(0, stdoutBuffer, stdoutEvalSeqNum, stdoutEvalBuffer);
+    readProcessHelper(process, 0, stdoutScanner);
 }
 
 
 void TDriverRubyInterface::readProcessStderr()
 {
     VALIDATE_THREAD;
-    readProcessHelper(1, stderrBuffer, stderrEvalSeqNum, stderrEvalBuffer);
+    readProcessHelper(process, 1, stderrScanner);
 }
 
 
@@ -535,7 +819,7 @@ quint32 TDriverRubyInterface::sendCmdMessage( const QByteArray &name, const BALi
         return 0;
     }
 
-    qDebug() << FFL << cmd;
+    qCDebug(logRbi) << FFL << cmd;
     quint32 seqNum = handler->sendStringListMapMsg(name, cmd);
     Q_ASSERT(seqNum > 0);
     return seqNum;
@@ -549,67 +833,17 @@ quint32 TDriverRubyInterface::sendCmd(const QByteArray &name, const BAListMap &c
 
     QString goOnlineError;
     if (!(goOnlineError = goOnline()).isNull()) {
-        qDebug() << FCFL << "goOnline error" << goOnlineError;
+        qCDebug(logRbi) << FCFL << "goOnline error" << goOnlineError;
     }
     else {
         QMutexLocker lock(syncMutex);
         seqNum = sendCmdMessage(name, cmd);
-        qDebug() << FCFL << "SENT" << seqNum << cmd;
+        qCDebug(logRbi) << FCFL << "SENT" << seqNum << cmd;
     }
     return seqNum;
 }
 
 
-bool TDriverRubyInterface::executeCmd(const QByteArray &name, BAListMap &cmd_reply, unsigned long timeout, const QString &showCommand)
-{
-    VALIDATE_THREAD_NOT;
-    QString goOnlineError;
-    if (!(goOnlineError = goOnline()).isNull()) {
-        cmd_reply["error"] << ("Could not connect to TDriver framework: "+goOnlineError.toLatin1());
-        return false;
-    }
-
-    QMutexLocker lock(syncMutex);
-    qDebug() << FCFL << "SENDING" << cmd_reply;
-    quint32 seqNum = sendCmdMessage(name, cmd_reply);
-    //qDebug() << FCFL << "Sent" << seqNum << name << cmd_reply;
-    if (seqNum != 0) {
-        QMessageBox *box = NULL;
-        if (!showCommand.isNull()) {
-            box = new QMessageBox(
-                        QMessageBox::Information,
-                        tr("Executing tdriver_interface.rb command"),
-                        tr("Command information: %1\nTimeout: %2 ms").arg(showCommand).arg(timeout),
-                        QMessageBox::Cancel);
-            foreach (QAbstractButton *button, box->buttons()) box->removeButton(button);
-            box->show();
-            box->repaint();
-        }
-        bool success = handler->waitSeqNum(seqNum, timeout);
-        if (box) {
-            box->hide();
-            box->repaint();
-            delete box;
-        }
-        if (success) {
-            cmd_reply = handler->waitedMessage();
-            // TODO: make final decision about which logic to use here, and change tdriver_interface.rb accordingly:
-#if 1
-            if (cmd_reply.contains("error") && cmd_reply.value("error").isEmpty()) cmd_reply["error"] << "Unknown error";
-#else
-            if (cmd_reply.contains("error") && cmd_reply.value("error").isEmpty()) cmd_reply.remove("error");
-#endif
-            //qDebug() << FCFL << "REPLY" << cmd_reply;
-            return true;
-        }
-    }
-    qDebug() << FCFL << "FAIL";
-    cmd_reply.clear();
-    cmd_reply["error"] << "Error: Timeout waiting for TDriver interface script";
-    return false;
-}
-
-
 int TDriverRubyInterface::getPort()
 {
     VALIDATE_THREAD_NOT;
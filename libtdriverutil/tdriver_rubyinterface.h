@@ -35,7 +35,7 @@ class LIBTDRIVERUTILSHARED_EXPORT TDriverRubyInterface : public QThread
 {
 Q_OBJECT
 public:
-    enum { REQUIRED_TDRIVER_INTERFACE_RB_VERSION=2};
+    enum { REQUIRED_TDRIVER_INTERFACE_RB_VERSION=3};
 
     explicit TDriverRubyInterface();
     ~TDriverRubyInterface();
@@ -49,7 +49,6 @@ public:
 
     quint32 sendCmdMessage( const QByteArray &name, const BAListMap &cmd);
     quint32 sendCmd(const QByteArray &name, const BAListMap &cmd);
-    bool executeCmd( const QByteArray &name, BAListMap &cmd_reply, unsigned long timeout, const QString &showCommand = QString());
 
     int getPort();
     int getRbiVersion();
@@ -67,7 +66,6 @@ signals:
     void rubyProcessFinished();
     void rubyOnline();
     void rubyOffline();
-    void messageReceived(quint32 seqNum, QByteArray name, BAListMap message);
 
     void rubyOutput(int fnum, QByteArray line);
     void rubyOutput(int fnum, quint32 seqNum, QByteArray text);
@@ -83,10 +81,37 @@ private slots:
     void recreateConn();
     void resetProcess();
     void recreateProcess();
+
+    // optional warm standby process, enabled by rubyinterface/warm_standby setting
+    void startStandbyProcess();
+    void readStandbyStartup();
+    void readStandbyStdout();
+    void readStandbyStderr();
+    void standbyFinished();
     //void messageFromHandler(quint32 seqNum, QByteArray name, BAListMap message);
 
 private:
-    void readProcessHelper(int fnum, QByteArray &readBuffer, quint32 &seqNum, QByteArray &evalBuffer);
+    QProcess *createProcess();
+    bool startScript(const QString &errorTitle);
+    static bool isStandbyEnabled();
+    bool promoteStandbyProcess();
+    void discardStandbyProcess();
+
+    // incremental scanner state for stdout or stderr of the Ruby process
+    struct OutputScanner {
+        QByteArray buffer;      // bytes not yet handled, never contains a complete line
+        int scannedSize;        // leading part of buffer already searched for line end
+        bool atLineStart;       // buffer begins a new line, so it may become a delimiter line
+        quint32 evalSeqNum;     // non-zero between START and END delimiter lines
+        QByteArray evalChunk;   // evaluation output collected during one read
+
+        OutputScanner() : scannedSize(0), atLineStart(true), evalSeqNum(0) {}
+    };
+
+    void readProcessHelper(QProcess *proc, int fnum, OutputScanner &scanner);
+    static void bufferStandbyOutput(OutputScanner &scanner, const QByteArray &bytes);
+    void scanOutputLine(int fnum, OutputScanner &scanner, const char *line, int length);
+    void flushEvalChunk(int fnum, OutputScanner &scanner);
 
 private:
     int rbiPort;
@@ -103,18 +128,22 @@ private:
     QAbstractSocket *conn;
     TDriverRbiProtocol *handler;
 
+    // started when active process is online, promoted by resetRubyConnection
+    QProcess *standbyProcess;
+    int standbyPort;
+    int standbyVersion;
+    QString standbyTDriverVersion;
+
     static TDriverRubyInterface *pGlobalInstance;
 
     enum { Closed, Running, Connected, Closing } initState;
     QString initErrorMsg;
 
 
-    QByteArray stderrBuffer;
-    QByteArray stdoutBuffer;
-    QByteArray stderrEvalBuffer;
-    QByteArray stdoutEvalBuffer;
-    quint32 stderrEvalSeqNum;
-    quint32 stdoutEvalSeqNum;
+    OutputScanner stdoutScanner;
+    OutputScanner stderrScanner;
+    OutputScanner standbyStdoutScanner;
+    OutputScanner standbyStderrScanner;
 
     const QByteArray delimStr;
     const QByteArray evalStartStr;
@@ -0,0 +1,175 @@
+/***************************************************************************
+**
+** Copyright (C) 2010 Nokia Corporation and/or its subsidiary(-ies).
+** All rights reserved.
+** Contact: Nokia Corporation (testabilitydriver@nokia.com)
+**
+** This file is part of Testability Driver.
+**
+** If you have questions regarding the use of this file, please contact
+** Nokia at testabilitydriver@nokia.com .
+**
+** This library is free software; you can redistribute it and/or
+** modify it under the terms of the GNU Lesser General Public
+** License version 2.1 as published by the Free Software Foundation
+** and appearing in the file LICENSE.LGPL included in the packaging
+** of this file.
+**
+****************************************************************************/
+
+#include "tdriver_main_window.h"
+#include <tdriver_rubyinterface.h>
+#include <tdriver_debug_macros.h>
+
+#include <QCryptographicHash>
+#include <QDir>
+#include <QSaveFile>
+#include <QStandardPaths>
+
+
+static const quint32 apiMethodsCacheMagic = 0x54444143; // "TDAC"
+static const qint32 apiMethodsCacheFormat = 1;
+
+// one file per class, in directory of cuTeDriver version, sut type and device
+static QString apiMethodsCacheDir( const QString &key )
+{
+    return QStandardPaths::writableLocation(QStandardPaths::CacheLocation)
+            + "/api_methods_"
+            + QCryptographicHash::hash(key.toUtf8(), QCryptographicHash::Md5).toHex();
+}
+
+
+static QString apiMethodsCacheFileName( const QString &key, const QString &className )
+{
+    return apiMethodsCacheDir( key ) + '/'
+            + QCryptographicHash::hash(className.toUtf8(), QCryptographicHash::Md5).toHex()
+            + ".bin";
+}
+
+
+// estimated memory use in KiB
+static int apiMethodsCost( const QMap<QString, QHash<QString, QString> > &methods )
+{
+    qint64 bytes = 0;
+    QMap<QString, QHash<QString, QString> >::const_iterator it;
+    for ( it = methods.constBegin(); it != methods.constEnd(); ++it ) {
+        bytes += 64 + it.key().size() * 2;
+        QHash<QString, QString>::const_iterator attr;
+        for ( attr = it.value().constBegin(); attr != it.value().constEnd(); ++attr ) {
+            bytes += 32 + ( attr.key().size() + attr.value().size() ) * 2;
+        }
+    }
+    return int( qMax( Q_INT64_C(1), bytes / 1024 ) );
+}
+
+
+// class methods come from Qt of the device, so cache is not shared between devices
+QString MainWindow::currentApiMethodsCacheKey()
+{
+    const QString key = currentBehavioursCacheKey();
+    if ( key.isEmpty() || activeDevice.isEmpty() ) return QString();
+    return key + '|' + activeDevice;
+}
+
+
+const MainWindow::ApiMethodMap *MainWindow::apiMethods( const QString &className )
+{
+    const QString key = currentApiMethodsCacheKey();
+    if ( key != apiMethodsCacheKey ) {
+        apiMethodsMap.clear();
+        apiMethodsCacheKey = key;
+    }
+
+    if ( ApiMethodMap *methods = apiMethodsMap.object( className ) ) return methods;
+    if ( key.isEmpty() ) return NULL;
+
+    QFile file( apiMethodsCacheFileName( key, className ) );
+    if ( !file.open( QIODevice::ReadOnly ) ) return NULL;
+
+    QDataStream in( &file );
+    in.setVersion( QDataStream::Qt_5_0 );
+
+    quint32 magic = 0;
+    qint32 format = 0;
+    QString storedKey;
+    QString storedClass;
+    ApiMethodMap *methods = new ApiMethodMap;
+
+    in >> magic >> format;
+    if ( magic == apiMethodsCacheMagic && format == apiMethodsCacheFormat ) {
+        in >> storedKey >> storedClass >> *methods;
+    }
+    if ( in.status() != QDataStream::Ok || storedKey != key || storedClass != className ) {
+        qWarning() << FCFL << "ignoring invalid api methods cache" << file.fileName();
+        delete methods;
+        return NULL;
+    }
+
+    qCDebug(logTree) << FCFL << "loaded" << methods->size() << "api methods of" << className;
+    if ( !apiMethodsMap.insert( className, methods, apiMethodsCost( *methods ) ) ) {
+        // larger than whole memory budget, read again from disk next time
+        apiMethodsUncached = *methods;
+        return &apiMethodsUncached;
+    }
+    return methods;
+}
+
+
+bool MainWindow::hasApiMethods( const QString &className )
+{
+    if ( apiMethodsMap.contains( className ) ) return true;
+
+    const QString key = currentApiMethodsCacheKey();
+    return !key.isEmpty() && QFile::exists( apiMethodsCacheFileName( key, className ) );
+}
+
+
+void MainWindow::storeApiMethods( const QString &className, const ApiMethodMap &methods )
+{
+    const QString key = currentApiMethodsCacheKey();
+    if ( key != apiMethodsCacheKey ) {
+        apiMethodsMap.clear();
+        apiMethodsCacheKey = key;
+    }
+
+    if ( !apiMethodsMap.insert( className, new ApiMethodMap( methods ), apiMethodsCost( methods ) ) ) {
+        apiMethodsUncached = methods;
+    }
+    if ( key.isEmpty() ) return;
+
+    QDir().mkpath( apiMethodsCacheDir( key ) );
+    QSaveFile file( apiMethodsCacheFileName( key, className ) );
+    if ( !file.open( QIODevice::WriteOnly ) ) {
+        qWarning() << FCFL << "failed to write api methods cache" << file.fileName() << file.errorString();
+        return;
+    }
+
+    QDataStream out( &file );
+    out.setVersion( QDataStream::Qt_5_0 );
+    out << apiMethodsCacheMagic << apiMethodsCacheFormat << key << className << methods;
+
+    if ( out.status() != QDataStream::Ok || !file.commit() ) {
+        qWarning() << FCFL << "failed to write api methods cache" << file.fileName();
+    }
+}
+
+
+bool MainWindow::sendApiMethodsPrefetch()
+{
+    if ( !apiFixtureEnabled || !apiFixtureChecked ) return false;
+
+    QSet<QString> classNames;
+    foreach ( const TreeItemInfo &info, objectTreeData ) {
+        if ( info.type.isEmpty() || info.type == "sut" || !info.env.contains( "qt" ) ) continue;
+        if ( classNames.contains( info.type ) || hasApiMethods( info.type ) ) continue;
+        classNames.insert( info.type );
+    }
+
+    if ( classNames.isEmpty() ) return false;
+
+    QStringList cmd( QStringList() << activeDevice << "fixture_batch" );
+    cmd << classNames.toList();
+
+    qCDebug(logTree) << FCFL << "prefetching api methods of" << classNames.size() << "classes";
+    return sendTDriverCommand( commandClassMethodsBatch, cmd, "class methods of snapshot" );
+}
@@ -0,0 +1,170 @@
+/***************************************************************************
+**
+** Copyright (C) 2010 Nokia Corporation and/or its subsidiary(-ies).
+** All rights reserved.
+** Contact: Nokia Corporation (testabilitydriver@nokia.com)
+**
+** This file is part of Testability Driver.
+**
+** If you have questions regarding the use of this file, please contact
+** Nokia at testabilitydriver@nokia.com .
+**
+** This library is free software; you can redistribute it and/or
+** modify it under the terms of the GNU Lesser General Public
+** License version 2.1 as published by the Free Software Foundation
+** and appearing in the file LICENSE.LGPL included in the packaging
+** of this file.
+**
+****************************************************************************/
+
+#include "tdriver_main_window.h"
+#include "tdriver_image_view.h"
+
+#include <tdriver_debug_macros.h>
+
+
+int MainWindow::AppSnapshot::cost() const
+{
+    // rough estimate for tree item, tree data, dom node and id mapping of each object
+    qint64 bytes = image.sizeInBytes() + qint64(objectTreeData.size()) * 512;
+
+    QMap<TestObjectKey, QMap<QString, AttributeInfo > >::const_iterator it;
+    for (it = attributesMap.constBegin(); it != attributesMap.constEnd(); ++it) {
+        bytes += qint64(it.value().size()) * 128;
+    }
+
+    return int(qMax(Q_INT64_C(1), bytes / 1024));
+}
+
+
+QString MainWindow::appSnapshotKey() const
+{
+    // foreground application changes without selection, so it is never cached
+    if (activeDevice.isEmpty() || currentApplication.id.isEmpty() || currentApplication.id == "0") {
+        return QString();
+    }
+    return activeDevice + '/' + currentApplication.id + '/' + currentApplication.name;
+}
+
+
+void MainWindow::storeAppSnapshot(const QString &key, const QImage &image)
+{
+    // partially read tree is not worth caching
+    if (key.isEmpty() || appSnapshots.maxCost() <= 0 || uiDumpReading
+            || objectTree->topLevelItemCount() != 1) {
+        return;
+    }
+
+    AppSnapshot *snapshot = new AppSnapshot;
+    snapshot->focusId = objectTreeData.value(ptr2TestObjectKey(objectTree->currentItem())).id;
+    snapshot->captured = appSnapshotShown.isValid() ? appSnapshotShown : QDateTime::currentDateTime();
+
+    // expanded state is kept by view, so it is lost when item is taken from tree
+    foreach (TestObjectKey itemKey, objectTreeData.keys()) {
+        if (testObjectKey2Ptr(itemKey)->isExpanded()) snapshot->expandedKeys << itemKey;
+    }
+
+    snapshot->sutItem = objectTree->takeTopLevelItem(0);
+    snapshot->attributesMap.swap(attributesMap);
+    snapshot->geometriesMap.swap(geometriesMap);
+    snapshot->screenshotObjects.swap(screenshotObjects);
+    snapshot->objectTreeData.swap(objectTreeData);
+    snapshot->objectIdMap.swap(objectIdMap);
+
+    // QDomDocument is explicitly shared, and parseXml reuses xmlDocument
+    snapshot->xmlDocument = xmlDocument;
+    xmlDocument = QDomDocument();
+
+    snapshot->image = image;
+
+    // remaining state refers to items now owned by snapshot
+    clearObjectTreeMappings();
+    objectTree->clear();
+    uiDumpFileName.clear();
+    lastHighlightedObjectKey = 0;
+    collapsedObjectTreeItemPtr = 0;
+    expandedObjectTreeItemPtr = 0;
+    imageWidget->clearImage();
+    clearPropertiesTableContents();
+    clearAppSnapshotMarker();
+    updateXmlSourceView();
+
+    const int cost = snapshot->cost();
+    qCDebug(logTree) << FCFL << "storing" << key << cost << "KiB, total" << appSnapshots.totalCost();
+
+    // too large snapshot is deleted by QCache
+    appSnapshots.insert(key, snapshot, cost);
+}
+
+
+// Stores tree of previously selected application, if it is still shown.
+// Called just before tree is replaced, so it is never left empty while waiting for refresh.
+void MainWindow::storePendingAppSnapshot()
+{
+    if (appSnapshotPendingKey.isEmpty()) return;
+
+    const QString key = appSnapshotPendingKey;
+    const QImage image = appSnapshotPendingImage;
+    appSnapshotPendingKey.clear();
+    appSnapshotPendingImage = QImage();
+
+    storeAppSnapshot(key, image);
+}
+
+
+bool MainWindow::restoreAppSnapshot()
+{
+    const QString key = appSnapshotKey();
+    AppSnapshot *snapshot = key.isEmpty() ? NULL : appSnapshots.take(key);
+
+    if (!snapshot) return false;
+
+    qCDebug(logTree) << FCFL << "restoring" << key << "captured" << snapshot->captured;
+
+    clearObjectTreeMappings();
+    objectTree->clear();
+
+    attributesMap.swap(snapshot->attributesMap);
+    geometriesMap.swap(snapshot->geometriesMap);
+    screenshotObjects.swap(snapshot->screenshotObjects);
+    objectTreeData.swap(snapshot->objectTreeData);
+    objectIdMap.swap(snapshot->objectIdMap);
+    xmlDocument = snapshot->xmlDocument;
+
+    // files of snapshot have been overwritten by later refreshes
+    uiDumpFileName.clear();
+
+    objectTree->addTopLevelItem(snapshot->sutItem);
+    foreach (TestObjectKey itemKey, snapshot->expandedKeys) {
+        testObjectKey2Ptr(itemKey)->setExpanded(true);
+    }
+
+    TestObjectKey focusKey = objectIdMap.value(snapshot->focusId);
+    objectTree->setCurrentItem(focusKey ? testObjectKey2Ptr(focusKey) : snapshot->sutItem);
+    snapshot->sutItem = NULL;
+    updateXmlSourceView();
+
+    lastHighlightedObjectKey = 0;
+    imageWidget->disableDrawHighlight();
+    imageWidget->showImage(snapshot->image);
+
+    drawHighlight( ptr2TestObjectKey(objectTree->currentItem()), true );
+    doPropertiesTableUpdate();
+
+    appSnapshotShown = snapshot->captured;
+    appSnapshotLabel->setText(tr("Cached %1").arg(appSnapshotShown.toString("hh:mm:ss")));
+    appSnapshotLabel->setToolTip(tr("Showing cached state of application captured at %1, refreshing")
+                                 .arg(appSnapshotShown.toString()));
+    appSnapshotLabel->setVisible(true);
+    titleFileText = tr("cached");
+
+    delete snapshot;
+    return true;
+}
+
+
+void MainWindow::clearAppSnapshotMarker()
+{
+    appSnapshotShown = QDateTime();
+    if (appSnapshotLabel) appSnapshotLabel->setVisible(false);
+}
@@ -0,0 +1,187 @@
+/***************************************************************************
+**
+** Copyright (C) 2010 Nokia Corporation and/or its subsidiary(-ies).
+** All rights reserved.
+** Contact: Nokia Corporation (testabilitydriver@nokia.com)
+**
+** This file is part of Testability Driver.
+**
+** If you have questions regarding the use of this file, please contact
+** Nokia at testabilitydriver@nokia.com .
+**
+** This library is free software; you can redistribute it and/or
+** modify it under the terms of the GNU Lesser General Public
+** License version 2.1 as published by the Free Software Foundation
+** and appearing in the file LICENSE.LGPL included in the packaging
+** of this file.
+**
+****************************************************************************/
+
+
+#include "tdriver_attributes_model.h"
+
+#include <QBrush>
+#include <QFontMetrics>
+
+
+TDriverAttributesModel::TDriverAttributesModel(QObject *parent) :
+    QAbstractTableModel(parent)
+{
+}
+
+
+bool TDriverAttributesModel::isWritable(const AttributeInfo &info)
+{
+    // non writable attributes must not be accessible - "w" or "writable"
+    return info.type.contains('w', Qt::CaseInsensitive);
+}
+
+
+void TDriverAttributesModel::setRows(const AttributeMap &attributes)
+{
+    current = attributes;
+    rowIterators.clear();
+    rowIterators.reserve(current.size());
+    for (AttributeMap::const_iterator it = current.constBegin(); it != current.constEnd(); ++it) {
+        rowIterators.append(it);
+    }
+}
+
+
+void TDriverAttributesModel::setAttributes(const AttributeMap &attributes, const QString &objectId, const QString &objectType)
+{
+    // same object with same attributes after refresh: keep rows, selection and scroll position
+    if (objectId == currentId && objectType == currentType && !currentId.isEmpty()
+            && attributes.size() == current.size()
+            && attributes.keys() == current.keys()) {
+
+        AttributeMap previous(current);
+        setRows(attributes);
+
+        int row = 0;
+        for (AttributeMap::const_iterator it = previous.constBegin(); it != previous.constEnd(); ++it, ++row) {
+            const AttributeInfo &info = rowIterators.at(row).value();
+            if (it.value().value != info.value || isWritable(it.value()) != isWritable(info)) {
+                emit dataChanged(index(row, 0), index(row, 1));
+            }
+        }
+        return;
+    }
+
+    beginResetModel();
+    setRows(attributes);
+    currentId = objectId;
+    currentType = objectType;
+    endResetModel();
+}
+
+
+void TDriverAttributesModel::clear()
+{
+    beginResetModel();
+    setRows(AttributeMap());
+    currentId.clear();
+    currentType.clear();
+    endResetModel();
+}
+
+
+void TDriverAttributesModel::setFont(const QFont &newFont)
+{
+    font = newFont;
+    nameWidths.clear();
+    if (!rowIterators.isEmpty()) {
+        emit dataChanged(index(0, 0), index(rowIterators.size() - 1, 1));
+    }
+}
+
+
+int TDriverAttributesModel::nameColumnWidth(const QFontMetrics &metrics)
+{
+    const QString key = currentType + '/' + QString::number(rowIterators.size());
+
+    QHash<QString, int>::const_iterator cached = nameWidths.constFind(key);
+    if (cached != nameWidths.constEnd()) return cached.value();
+
+    int width = metrics.width(headerData(0, Qt::Horizontal).toString());
+    foreach (const AttributeMap::const_iterator &it, rowIterators) {
+        width = qMax(width, metrics.width(it.value().name));
+    }
+    nameWidths.insert(key, width);
+    return width;
+}
+
+
+int TDriverAttributesModel::rowCount(const QModelIndex &parent) const
+{
+    return parent.isValid() ? 0 : rowIterators.size();
+}
+
+
+int TDriverAttributesModel::columnCount(const QModelIndex &parent) const
+{
+    return parent.isValid() ? 0 : 2;
+}
+
+
+QVariant TDriverAttributesModel::data(const QModelIndex &index, int role) const
+{
+    if (!index.isValid() || index.row() >= rowIterators.size()) return QVariant();
+
+    const AttributeInfo &info = rowIterators.at(index.row()).value();
+
+    switch (role) {
+    case Qt::DisplayRole:
+    case Qt::EditRole:
+        return (index.column() == 0) ? info.name : info.value;
+
+    case Qt::FontRole:
+        return font;
+
+    case Qt::BackgroundRole:
+        // read-only values are painted gray
+        if (index.column() == 1 && !isWritable(info)) return QBrush(Qt::lightGray);
+        break;
+
+    default:
+        break;
+    }
+    return QVariant();
+}
+
+
+QVariant TDriverAttributesModel::headerData(int section, Qt::Orientation orientation, int role) const
+{
+    if (orientation == Qt::Horizontal && role == Qt::DisplayRole) {
+        switch (section) {
+        case 0: return tr("Name");
+        case 1: return tr("Value");
+        }
+    }
+    return QAbstractTableModel::headerData(section, orientation, role);
+}
+
+
+Qt::ItemFlags TDriverAttributesModel::flags(const QModelIndex &index) const
+{
+    if (!index.isValid()) return Qt::NoItemFlags;
+
+    Qt::ItemFlags result = Qt::ItemIsSelectable | Qt::ItemIsEnabled;
+    if (index.column() == 1 && isWritable(rowIterators.at(index.row()).value())) {
+        result |= Qt::ItemIsEditable;
+    }
+    return result;
+}
+
+
+bool TDriverAttributesModel::setData(const QModelIndex &index, const QVariant &value, int role)
+{
+    if (role != Qt::EditRole || !(flags(index) & Qt::ItemIsEditable)) return false;
+
+    const AttributeInfo &info = rowIterators.at(index.row()).value();
+    if (value.toString() != info.value) {
+        emit attributeEditRequested(info.name, value.toString());
+    }
+    // value shown is updated by refresh after the attribute has been set
+    return false;
+}
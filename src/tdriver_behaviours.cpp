@@ -21,69 +21,286 @@
 
 #include "tdriver_behaviour.h"
 
-// constructor
-Behaviour::Behaviour() {
+#include <QIODevice>
+#include <QXmlStreamReader>
 
-    sutTypes.clear();
-    controlMethods.clear();
-    methods.clear();
+#include <algorithm>
 
-}
 
-// destructor
-Behaviour::~Behaviour() {
+static const quint32 cacheMagic = 0x54444243; // "TDBC"
+static const qint32 cacheFormat = 2;
 
-    sutTypes.clear();
-    controlMethods.clear();
-    methods.clear();
 
+static bool methodNameLessThan( const BehaviourMethod *a, const BehaviourMethod *b )
+{
+    return a->name < b->name;
 }
 
-void Behaviour::addSutType( QString sutType ) {
 
-    if ( !sutTypes.contains( sutType ) ) { sutTypes << sutType; } 
+static QString methodKey( const QString &name, const QString &description, const QString &example )
+{
+    return name + QChar(0) + description + QChar(0) + example;
+}
+
 
+BehaviourRegistry::BehaviourRegistry()
+{
 }
 
 
-QStringList Behaviour::getSutTypes() {
+BehaviourRegistry::~BehaviourRegistry()
+{
+    clear();
+}
 
-    return sutTypes;
 
+void BehaviourRegistry::clear()
+{
+    types.clear();
+    tableIndex.clear();
+    qDeleteAll( tableList );
+    tableList.clear();
+    methodIndex.clear();
+    qDeleteAll( methodList );
+    methodList.clear();
 }
 
-void Behaviour::addControlMethod( QString controlMethod ) {
 
-    if ( !controlMethods.contains( controlMethod ) ) { controlMethods << controlMethod; } 
-    
+const BehaviourMethod *BehaviourRegistry::internMethod( const QString &name, const QString &description, const QString &example )
+{
+    const QString key = methodKey( name, description, example );
+    const BehaviourMethod *method = methodIndex.value( key );
+
+    if ( !method ) {
+        BehaviourMethod *newMethod = new BehaviourMethod;
+        newMethod->name = name;
+        newMethod->description = description;
+        newMethod->example = example;
+        methodList.append( newMethod );
+        methodIndex.insert( key, newMethod );
+        method = newMethod;
+    }
+    return method;
 }
 
-QStringList Behaviour::getControlMethods() {
 
-    return controlMethods;
+const BehaviourMethodTable *BehaviourRegistry::internTable( const BehaviourMethodTable &table )
+{
+    // interned methods are unique, so their addresses identify the table
+    const QByteArray key( reinterpret_cast<const char *>( table.constData() ),
+                          table.size() * int( sizeof( const BehaviourMethod * ) ) );
+    const BehaviourMethodTable *result = tableIndex.value( key );
 
+    if ( !result ) {
+        BehaviourMethodTable *newTable = new BehaviourMethodTable( table );
+        tableList.append( newTable );
+        tableIndex.insert( key, newTable );
+        result = newTable;
+    }
+    return result;
 }
 
-void Behaviour::addMethod(QString methodName, QMap<QString, QString> methodHash ) {
 
-    if ( !methods.contains( methodName ) ) { methods.insert( methodName, methodHash ); }
+// adds methods to object type, methods already in object type are kept
+void BehaviourRegistry::addMethods( const QString &objectType, BehaviourMethodTable table )
+{
+    std::stable_sort( table.begin(), table.end(), methodNameLessThan );
 
-}
+    const BehaviourMethodTable *existing = types.value( objectType );
+    BehaviourMethodTable merged;
+    merged.reserve( table.size() + ( existing ? existing->size() : 0 ) );
 
-QMap<QString, QString> Behaviour::getMethod( QString methodName ) {
+    BehaviourMethodTable::const_iterator oldIt = existing ? existing->constBegin() : table.constEnd();
+    BehaviourMethodTable::const_iterator oldEnd = existing ? existing->constEnd() : table.constEnd();
+    BehaviourMethodTable::const_iterator newIt = table.constBegin();
 
-    QMap<QString, QString> result;
+    while ( oldIt != oldEnd || newIt != table.constEnd() ) {
 
-    if ( methods.contains( methodName ) ) { result = methods.value( methodName ); }
+        if ( newIt == table.constEnd() || ( oldIt != oldEnd && (*oldIt)->name <= (*newIt)->name ) ) {
+            // same name from new methods is skipped
+            while ( newIt != table.constEnd() && (*newIt)->name == (*oldIt)->name ) ++newIt;
+            merged.append( *oldIt++ );
+        }
+        else {
+            const QString &name = (*newIt)->name;
+            merged.append( *newIt );
+            while ( newIt != table.constEnd() && (*newIt)->name == name ) ++newIt;
+        }
+    }
 
-    return result;
+    types.insert( objectType, internTable( merged ) );
+}
 
+
+/*
+<?xml version="1.0"?>
+<behaviours>
+<behaviour object_type="sut">
+<object_method name="kill_started_processes">
+        <description>Kills all of the application processed started through the server.</description>
+        <example>kill_started_processes</example>
+      </object_method><object_method name="list_apps">
+...
+*/
+bool BehaviourRegistry::parseXml( QIODevice *device, QString *errorString )
+{
+    QXmlStreamReader reader( device );
+
+    QString objectType;
+    BehaviourMethodTable table;
+    bool inBehaviour = false;
+
+    while ( !reader.atEnd() ) {
+
+        reader.readNext();
+
+        if ( reader.isStartElement() ) {
+
+            if ( reader.name() == QLatin1String( "behaviour" ) ) {
+                objectType = reader.attributes().value( "object_type" ).toString();
+                table.clear();
+                inBehaviour = true;
+            }
+            else if ( inBehaviour && reader.name() == QLatin1String( "object_method" ) ) {
+
+                QString name = reader.attributes().value( "name" ).toString();
+                QString description;
+                QString example;
+
+                while ( reader.readNextStartElement() ) {
+                    // text of nested elements is included, like QDomElement::text does
+                    if ( reader.name() == QLatin1String( "description" ) ) {
+                        description = reader.readElementText( QXmlStreamReader::IncludeChildElements );
+                    }
+                    else if ( reader.name() == QLatin1String( "example" ) ) {
+                        example = reader.readElementText( QXmlStreamReader::IncludeChildElements );
+                    }
+                    else {
+                        reader.skipCurrentElement();
+                    }
+                }
+
+                table.append( internMethod( name, description, example ) );
+            }
+        }
+        else if ( reader.isEndElement() && reader.name() == QLatin1String( "behaviour" ) ) {
+            addMethods( objectType, table );
+            inBehaviour = false;
+        }
+    }
+
+    if ( reader.hasError() ) {
+        if ( errorString ) {
+            *errorString = QString( "%1 at line %2" ).arg( reader.errorString() ).arg( reader.lineNumber() );
+        }
+        return false;
+    }
+    return true;
 }
 
-QStringList Behaviour::getMethodsList() {
 
-    return methods.keys();
+// format: methods as (name, description, example), tables as method indexes, types as table indexes
+void BehaviourRegistry::write( QDataStream &out ) const
+{
+    QHash<const BehaviourMethod *, qint32> methodNumbers;
+    out << qint32( methodList.size() );
+    for ( int ii = 0; ii < methodList.size(); ++ii ) {
+        const BehaviourMethod *method = methodList.at( ii );
+        methodNumbers.insert( method, ii );
+        out << method->name << method->description << method->example;
+    }
+
+    QHash<const BehaviourMethodTable *, qint32> tableNumbers;
+    out << qint32( tableList.size() );
+    for ( int ii = 0; ii < tableList.size(); ++ii ) {
+        const BehaviourMethodTable *table = tableList.at( ii );
+        tableNumbers.insert( table, ii );
+        out << qint32( table->size() );
+        foreach ( const BehaviourMethod *method, *table ) {
+            out << methodNumbers.value( method );
+        }
+    }
+
+    out << qint32( types.size() );
+    QHash<QString, const BehaviourMethodTable *>::const_iterator it;
+    for ( it = types.constBegin(); it != types.constEnd(); ++it ) {
+        out << it.key() << tableNumbers.value( it.value() );
+    }
+}
+
 
+bool BehaviourRegistry::merge( QDataStream &in )
+{
+    qint32 count = 0;
+    QVector<const BehaviourMethod *> methods;
+
+    in >> count;
+    for ( qint32 ii = 0; ii < count && in.status() == QDataStream::Ok; ++ii ) {
+        QString name, description, example;
+        in >> name >> description >> example;
+        methods.append( internMethod( name, description, example ) );
+    }
+
+    QVector<BehaviourMethodTable> tables;
+    in >> count;
+    for ( qint32 ii = 0; ii < count && in.status() == QDataStream::Ok; ++ii ) {
+        qint32 size = 0;
+        in >> size;
+        BehaviourMethodTable table;
+        for ( qint32 jj = 0; jj < size && in.status() == QDataStream::Ok; ++jj ) {
+            qint32 number = -1;
+            in >> number;
+            if ( number < 0 || number >= methods.size() ) return false;
+            table.append( methods.at( number ) );
+        }
+        tables.append( table );
+    }
+
+    in >> count;
+    for ( qint32 ii = 0; ii < count && in.status() == QDataStream::Ok; ++ii ) {
+        QString objectType;
+        qint32 number = -1;
+        in >> objectType >> number;
+        if ( number < 0 || number >= tables.size() ) return false;
+        if ( !types.contains( objectType ) ) addMethods( objectType, tables.at( number ) );
+    }
+
+    return in.status() == QDataStream::Ok;
 }
 
 
+bool BehaviourRegistry::readCache( QIODevice *device, const QString &key, QString *errorString )
+{
+    QDataStream in( device );
+    in.setVersion( QDataStream::Qt_5_0 );
+
+    quint32 magic = 0;
+    qint32 format = 0;
+    QString storedKey;
+
+    in >> magic >> format;
+    if ( magic != cacheMagic || format != cacheFormat ) {
+        if ( errorString ) *errorString = "unknown format";
+        return false;
+    }
+    in >> storedKey;
+    if ( storedKey != key ) {
+        if ( errorString ) *errorString = "other key " + storedKey;
+        return false;
+    }
+    if ( !merge( in ) ) {
+        if ( errorString ) *errorString = "invalid data";
+        return false;
+    }
+    return true;
+}
+
+
+bool BehaviourRegistry::writeCache( QIODevice *device, const QString &key ) const
+{
+    QDataStream out( device );
+    out.setVersion( QDataStream::Qt_5_0 );
+    out << cacheMagic << cacheFormat << key;
+    write( out );
+    return out.status() == QDataStream::Ok;
+}
@@ -0,0 +1,140 @@
+/***************************************************************************
+**
+** Copyright (C) 2010 Nokia Corporation and/or its subsidiary(-ies).
+** All rights reserved.
+** Contact: Nokia Corporation (testabilitydriver@nokia.com)
+**
+** This file is part of Testability Driver.
+**
+** If you have questions regarding the use of this file, please contact
+** Nokia at testabilitydriver@nokia.com .
+**
+** This library is free software; you can redistribute it and/or
+** modify it under the terms of the GNU Lesser General Public
+** License version 2.1 as published by the Free Software Foundation
+** and appearing in the file LICENSE.LGPL included in the packaging
+** of this file.
+**
+****************************************************************************/
+
+
+#include "tdriver_main_window.h"
+
+#include <tdriver_rbistatistics.h>
+
+#include <QTimer>
+#include <QDir>
+#include <QVBoxLayout>
+#include <QLabel>
+
+#include <tdriver_debug_macros.h>
+
+
+void MainWindow::createDiagnosticsDockWidget()
+{
+    diagnosticsDock = new QDockWidget(tr(" Diagnostics "), this);
+    diagnosticsDock->setObjectName("diagnostics");
+    diagnosticsDock->setFeatures( DOCK_FEATURES_DEFAULT );
+
+    QWidget *diagnosticsBox = new QWidget(diagnosticsDock);
+    QVBoxLayout *layout = new QVBoxLayout(diagnosticsBox);
+    layout->setContentsMargins(0, 0, 0, 0);
+
+    diagnosticsTable = new QTableWidget(diagnosticsBox);
+    diagnosticsTable->setObjectName("diagnostics table");
+    diagnosticsTable->setEditTriggers(QAbstractItemView::NoEditTriggers);
+    diagnosticsTable->setSelectionBehavior(QAbstractItemView::SelectRows);
+    diagnosticsTable->verticalHeader()->hide();
+    setupTableWidgetHeader(tr("Command|Channel|Count|Avg ms|P50 ms|P90 ms|Max ms|Reply wait ms|Transfer ms|Handling ms|Bytes sent|Bytes received"),
+                           diagnosticsTable);
+    layout->addWidget(diagnosticsTable);
+
+    // queueing delay inside the Ruby script, per priority channel
+    diagnosticsChannelLabel = new QLabel(diagnosticsBox);
+    diagnosticsChannelLabel->setObjectName("diagnostics channels");
+    layout->addWidget(diagnosticsChannelLabel);
+
+    QPushButton *resetButton = new QPushButton(tr("Reset"), diagnosticsBox);
+    resetButton->setObjectName("diagnostics reset");
+    connect(resetButton, SIGNAL(clicked()), SLOT(resetDiagnostics()));
+    layout->addWidget(resetButton, 0, Qt::AlignRight);
+
+    diagnosticsDock->setWidget(diagnosticsBox);
+
+    // statistics are also written periodically to a JSON file, empty file name setting disables it
+    QSettings settings;
+    diagnosticsJsonFile = settings.value("diagnostics/json_file",
+                                         QDir::tempPath() + "/cutedriver_visualizer_rbi_stats.json").toString();
+    connect(diagnosticsTimer, SIGNAL(timeout()), SLOT(updateDiagnostics()));
+    diagnosticsTimer->start(settings.value("diagnostics/interval_ms", 5000).toInt());
+}
+
+
+void MainWindow::updateDiagnostics()
+{
+    TDriverRbiStatistics *statistics = TDriverRbiStatistics::globalInstance();
+
+    quint32 changeCount = statistics->changeCount();
+    if (changeCount == diagnosticsChangeCount) return;
+    diagnosticsChangeCount = changeCount;
+
+    if (!diagnosticsJsonFile.isEmpty() && !statistics->writeJson(diagnosticsJsonFile)) {
+        qWarning() << FCFL << "failed to write" << diagnosticsJsonFile;
+    }
+
+    QMap<QByteArray, TDriverRbiStatistics::CommandStats> stats(statistics->commandStats());
+    diagnosticsTable->setRowCount(stats.size());
+
+    int row = 0;
+    QMap<QByteArray, TDriverRbiStatistics::CommandStats>::const_iterator it;
+    for (it = stats.constBegin(); it != stats.constEnd(); ++it, ++row) {
+        const TDriverRbiStatistics::CommandStats &cmd = it.value();
+        const double count = qMax(1u, cmd.count);
+
+        QStringList values;
+        values << QString::fromLatin1(it.key())
+               << QString::fromLatin1(cmd.channel)
+               << QString::number(cmd.count)
+               << QString::number(cmd.sumTotalMs / count, 'f', 1)
+               << QString::number(cmd.percentileMs(0.5), 'f', 0)
+               << QString::number(cmd.percentileMs(0.9), 'f', 0)
+               << QString::number(cmd.maxTotalMs, 'f', 1)
+               << QString::number(cmd.sumReplyWaitMs / count, 'f', 1)
+               << QString::number(cmd.sumTransferMs / count, 'f', 1)
+               << QString::number(cmd.sumHandlingMs / count, 'f', 1)
+               << QString::number(cmd.bytesSent)
+               << QString::number(cmd.bytesReceived);
+
+        for (int column = 0; column < values.size(); ++column) {
+            QTableWidgetItem *item = diagnosticsTable->item(row, column);
+            if (!item) {
+                item = new QTableWidgetItem;
+                if (column > 1) item->setTextAlignment(Qt::AlignRight | Qt::AlignVCenter);
+                diagnosticsTable->setItem(row, column, item);
+            }
+            item->setText(values.at(column));
+        }
+    }
+
+    QMap<QByteArray, TDriverRbiStatistics::ChannelStats> channels(statistics->channelStats());
+    QStringList channelTexts;
+    QMap<QByteArray, TDriverRbiStatistics::ChannelStats>::const_iterator ch;
+    for (ch = channels.constBegin(); ch != channels.constEnd(); ++ch) {
+        channelTexts << tr("%1 queue: avg %2 ms, max %3 ms, last %4 ms (%5 replies)")
+                        .arg(QString::fromLatin1(ch.key()))
+                        .arg(ch->sumQueueMs / qMax(1u, ch->count), 0, 'f', 1)
+                        .arg(ch->maxQueueMs, 0, 'f', 1)
+                        .arg(ch->lastQueueMs, 0, 'f', 1)
+                        .arg(ch->count);
+    }
+    diagnosticsChannelLabel->setText(channelTexts.join("\n"));
+
+    if (diagnosticsDock->isVisible()) diagnosticsTable->resizeColumnsToContents();
+}
+
+
+void MainWindow::resetDiagnostics()
+{
+    TDriverRbiStatistics::globalInstance()->reset();
+    updateDiagnostics();
+}
@@ -21,6 +21,7 @@
 
 #include "tdriver_main_window.h"
 #include <tdriver_util.h>
+#include <tdriver_logging.h>
 #include <QDateTime>
 #include <QProcess>
 
@@ -69,6 +70,8 @@ int main(int argc, char *argv[])
     app.setOrganizationName("cuTeDriver Team");
     app.setApplicationName("cuTeDriver_Visualizer");
 
+    TDriverLogging::applySettingsRules();
+
     debugOutFile = new QFile(QDir::tempPath() + "/cutedriver_visualizer_main.log" );
 
     // workaround for deadlock in Qt 4.7.2+
@@ -20,53 +20,41 @@
 
 #include <tdriver_combolineedit.h>
 #include "tdriver_main_window.h"
+#include "tdriver_image_view.h"
+#include "tdriver_locator.h"
 #include <tdriver_debug_macros.h>
 
 #include <QGridLayout>
+#include <QLabel>
 #include <QShortcut>
+#include <QThread>
+#include <QTimer>
+#include <QtConcurrent>
 
-bool MainWindow::containsWords( const TreeItemInfo &itemData, QString text, bool caseSensitive, bool entireWords )
-{
-    bool result = false;
-    Qt::CaseSensitivity caseSensitivity = caseSensitive ? Qt::CaseSensitive : Qt::CaseInsensitive;
-
-    if ( entireWords ) {
-        result = (
-            itemData.name.compare( text, caseSensitivity ) == 0 ||
-            itemData.type.compare( text, caseSensitivity ) == 0 ||
-            itemData.id.compare( text, caseSensitivity ) == 0 );
-    }
-
-    else {
-        result = (
-            itemData.name.contains( text, caseSensitivity ) ||
-            itemData.type.contains( text, caseSensitivity ) ||
-            itemData.id.contains( text, caseSensitivity ));
-    }
+#include <algorithm>
 
-    return result;
-}
 
-bool MainWindow::attributeContainsWords( TestObjectKey itemPtr, QString text, bool caseSensitive, bool entireWords )
+// checks one range of candidate nodes of find all in a worker thread,
+// index is not changed while find all runs, see MainWindow::cancelFindAll
+struct FindAllChunk
 {
-    bool result = false;
-
-    Qt::CaseSensitivity caseSensitivity = caseSensitive ? Qt::CaseSensitive : Qt::CaseInsensitive;
-    QMapIterator<QString, AttributeInfo > iterator( attributesMap.value( itemPtr ) );
+    typedef QVector<int> result_type;
 
-    while ( iterator.hasNext() && !result ) {
+    FindAllChunk(const TDriverFindIndex *index, const TDriverFindIndex::Query &query) :
+        index(index), query(query) {}
 
-        iterator.next();
-        QString value = iterator.value().value;
-
-        if ( entireWords ? ( value.compare( text, caseSensitivity ) == 0 ) : ( value.contains( text, caseSensitivity ) ) ) {
-            result = true;
-            break;
+    QVector<int> operator()(const QVector<int> &nodes) const
+    {
+        QVector<int> result;
+        foreach (int node, nodes) {
+            if (index->matches(node, query)) result.append(node);
         }
+        return result;
     }
 
-    return result;
-}
+    const TDriverFindIndex *index;
+    TDriverFindIndex::Query query;
+};
 
 
 void MainWindow::findNextTreeObject()
@@ -90,7 +78,15 @@ void MainWindow::findNextTreeObject()
     bool searchAttributes = findDialogAttributes->isChecked();
 
     QTreeWidgetItem *current = objectTree->currentItem();
+    updateFindDialogSubtreeRoot( current );
+
+    findFromSubTree(current, findString, backwards, matchCase, entireWords, searchWrapAround, searchAttributes);
+
+}
 
+
+void MainWindow::updateFindDialogSubtreeRoot( QTreeWidgetItem *current )
+{
     switch ( findDialogSubtreeOnly->checkState() ) {
 
     case Qt::Unchecked:
@@ -110,9 +106,254 @@ void MainWindow::findNextTreeObject()
         findDialogSubtreeRoot = current;
         break;
     }
+}
 
-    findFromSubTree(current, findString, backwards, matchCase, entireWords, searchWrapAround, searchAttributes);
 
+void MainWindow::findAllTreeObjects()
+{
+    QString findString = findDialogText->currentText();
+    if ( findString.isEmpty() ) return;
+
+    if ( objectTree->columnCount() < 1 || objectTree->invisibleRootItem()->childCount() < 1 ) {
+        QMessageBox::warning(this,
+                             tr("Find"),
+                             tr("No matches found with '%1'").arg(findString));
+        return;
+    }
+
+    updateFindDialogSubtreeRoot( objectTree->currentItem() );
+    Q_ASSERT(findDialogSubtreeRoot);
+
+    cancelFindAll();
+    if (findIndex.node(ptr2TestObjectKey(findDialogSubtreeRoot)) < 0) {
+        rebuildFindIndex();
+    }
+    const int rootNode = findIndex.node(ptr2TestObjectKey(findDialogSubtreeRoot));
+    if (rootNode < 0) return;
+    const int endNode = findIndex.subtreeEnd(rootNode);
+
+    if (findDialogResults->isHidden()) {
+        findDialogResults->show();
+        findDialogResultsLabel->show();
+        findDialog->resize(findDialog->width(), qMax(findDialog->height(), 420));
+    }
+    findDialogResults->clear();
+    findAllRects.clear();
+    findAllSearched = endNode - rootNode;
+
+    if (findDialogLocator->isChecked()) {
+        // locator is evaluated with indexes, so there is nothing to gain from threads
+        QVector<int> matches;
+        QString error;
+        if (!findDialogLocatorMatches(findString, matches, &error)) {
+            findDialogResultsLabel->setText(error);
+            return;
+        }
+        matches.erase(matches.begin(), std::lower_bound(matches.begin(), matches.end(), rootNode));
+        matches.erase(std::lower_bound(matches.begin(), matches.end(), endNode), matches.end());
+        addFindAllResults(matches);
+        showFindAllCount();
+        return;
+    }
+
+    TDriverFindIndex::Query query;
+    query.text = findString;
+    query.caseSensitive = findDialogMatchCase->isChecked();
+    query.entireWords = findDialogEntireWords->isChecked();
+    query.attributes = findDialogAttributes->isChecked();
+
+    // candidates of subtree are split to chunks, so results are shown while later chunks are checked
+    QVector<int> candidates = findIndex.candidates(query);
+    candidates.erase(candidates.begin(), std::lower_bound(candidates.begin(), candidates.end(), rootNode));
+    candidates.erase(std::lower_bound(candidates.begin(), candidates.end(), endNode), candidates.end());
+
+    const int chunkSize = qMax(256, candidates.size() / (qMax(1, QThread::idealThreadCount()) * 8) + 1);
+    QList<QVector<int> > chunks;
+    for (int ii = 0; ii < candidates.size(); ii += chunkSize) {
+        chunks << candidates.mid(ii, chunkSize);
+    }
+
+    findDialogResultsLabel->setText(tr("Searching %1 objects...").arg(findAllSearched));
+
+    findAllWatcher->setFuture(QtConcurrent::mapped(chunks, FindAllChunk(&findIndex, query)));
+}
+
+
+void MainWindow::findAllResultsReady( int begin, int end )
+{
+    QVector<int> nodes;
+    for (int ii = begin; ii < end; ++ii) {
+        nodes << findAllWatcher->resultAt(ii);
+    }
+    if (nodes.isEmpty()) return;
+
+    addFindAllResults(nodes);
+    findDialogResultsLabel->setText(tr("%1 matches, searching %2 objects...")
+                                    .arg(findDialogResults->topLevelItemCount()).arg(findAllSearched));
+}
+
+
+void MainWindow::addFindAllResults( const QVector<int> &nodes )
+{
+    QList<QTreeWidgetItem*> items;
+
+    foreach (int node, nodes) {
+        TestObjectKey itemKey = findIndex.key(node);
+        const TreeItemInfo &info = objectTreeData.value(itemKey);
+
+        QTreeWidgetItem *item = new QTreeWidgetItem;
+        item->setData(0, Qt::DisplayRole, node);
+        item->setData(0, Qt::UserRole, testObjectKey2Str(itemKey));
+        item->setText(1, info.type);
+        item->setText(2, info.name);
+        item->setText(3, info.id);
+        items << item;
+    }
+    findDialogResults->addTopLevelItems(items);
+
+    findAllRects << screenshotRects(nodes);
+    highlightFindAllRects();
+}
+
+
+RectList MainWindow::screenshotRects( const QVector<int> &nodes )
+{
+    RectList rects;
+    foreach (int node, nodes) {
+        TestObjectKey itemKey = findIndex.key(node);
+        if (screenshotObjects.contains(itemKey)) {
+            RectList geometries;
+            collectGeometries(testObjectKey2Ptr(itemKey), geometries);
+            if (!geometries.isEmpty()) rects << geometries.first();
+        }
+    }
+    return rects;
+}
+
+
+void MainWindow::highlightFindAllRects()
+{
+    // all matches on screenshot are highlighted at once, until other object is highlighted
+    if (!findAllRects.isEmpty()) {
+        imageWidget->drawHighlights(findAllRects, true);
+        imageWidget->update();
+        lastHighlightedObjectKey = 0;
+    }
+}
+
+
+bool MainWindow::findDialogLocatorMatches( const QString &text, QVector<int> &matches, QString *error )
+{
+    if (findIndex.isEmpty()) rebuildFindIndex();
+
+    if (text != locatorText || text.isEmpty()) {
+        QString compileError;
+        TDriverLocator locator = TDriverLocator::compile(text, &compileError);
+        if (!locator.isValid()) {
+            if (error) *error = compileError;
+            return false;
+        }
+        locatorMatches = locator.evaluate(findIndex);
+        locatorText = text;
+    }
+    matches = locatorMatches;
+    return true;
+}
+
+
+void MainWindow::findDialogLocatorToggled( bool checked )
+{
+    // locator has its own rules for case and attributes
+    findDialogMatchCase->setEnabled( !checked );
+    findDialogEntireWords->setEnabled( !checked );
+    findDialogAttributes->setEnabled( !checked );
+
+    findDialogResultsLabel->setVisible( checked || !findDialogResults->isHidden() );
+    findDialogResultsLabel->clear();
+    if (checked) findDialogLocatorTimer->start();
+}
+
+
+void MainWindow::evaluateFindDialogLocator()
+{
+    if (!findDialogLocator->isChecked() || findAllWatcher->isRunning()) return;
+
+    const QString text = findDialogText->currentText();
+    if (text.isEmpty() || objectTree->invisibleRootItem()->childCount() < 1) {
+        findDialogResultsLabel->clear();
+        return;
+    }
+
+    QVector<int> matches;
+    QString error;
+    if (!findDialogLocatorMatches(text, matches, &error)) {
+        findDialogResultsLabel->setText(error);
+        return;
+    }
+
+    if (matches.size() == 1) findDialogResultsLabel->setText(tr("Locator is unique"));
+    else findDialogResultsLabel->setText(tr("Locator matches %1 objects").arg(matches.size()));
+
+    findAllRects = screenshotRects(matches);
+    if (findAllRects.isEmpty()) {
+        imageWidget->disableDrawHighlight();
+        lastHighlightedObjectKey = 0;
+    }
+    highlightFindAllRects();
+}
+
+
+void MainWindow::findAllFinished()
+{
+    if (findAllWatcher->isCanceled()) return;
+    showFindAllCount();
+}
+
+
+void MainWindow::showFindAllCount()
+{
+    const int count = findDialogResults->topLevelItemCount();
+    if (count == 0) {
+        findDialogResultsLabel->setText(tr("No matches found with '%1'").arg(findDialogText->currentText()));
+    }
+    else {
+        findDialogResultsLabel->setText(tr("%1 matches in %2 objects, %3 on screenshot")
+                                        .arg(count).arg(findAllSearched).arg(findAllRects.size()));
+    }
+}
+
+
+void MainWindow::findDialogResultSelected( QTreeWidgetItem *item )
+{
+    if (!item) return;
+    highlightByKey(str2TestObjectKey(item->data(0, Qt::UserRole).toString()), true);
+}
+
+
+void MainWindow::cancelFindAll()
+{
+    if (!findAllWatcher) return;
+
+    // workers read the index, so they must be done before it changes
+    findAllWatcher->cancel();
+    findAllWatcher->waitForFinished();
+    findAllWatcher->setFuture(QFuture<QVector<int> >());
+}
+
+
+void MainWindow::invalidateFindIndex()
+{
+    cancelFindAll();
+    findIndex.clear();
+    locatorAnalyzer.clear();
+    locatorText.clear();
+    findAllRects.clear();
+    findAllSearched = 0;
+
+    if (findDialogResults) {
+        findDialogResults->clear();
+        findDialogResultsLabel->clear();
+    }
 }
 
 
@@ -142,86 +383,82 @@ QTreeWidgetItem *MainWindow::findDialogSubtreeNext(QTreeWidgetItem *current, QTr
 }
 
 
-static inline QTreeWidgetItem *goToBottomChild(QTreeWidgetItem *node)
+void MainWindow::addToFindIndex(QTreeWidgetItem *item, int parentNode)
 {
-    forever {
-        int count = node->childCount();
-        if (count <= 0) return node;
-        node = node->child(count-1);
-    }
-}
-
-
-QTreeWidgetItem *MainWindow::findDialogSubtreePrev(QTreeWidgetItem *current, QTreeWidgetItem *root, bool wrap)
-{
-    if (!current) return NULL; // invalid current item
+    TestObjectKey itemKey = ptr2TestObjectKey(item);
 
-    Q_ASSERT(current != objectTree->invisibleRootItem());
-
-    if (current == root || current == objectTree->topLevelItem(0)) {
-        if (!wrap) return NULL; // at subtree root, no next
-        else return goToBottomChild(current); // wrap to end of tree
-        // not reached
+    // item without object data is skipped, its children are indexed under its parent
+    int node = -1;
+    if (objectTreeData.contains(itemKey)) {
+        node = findIndex.addNode(itemKey, objectTreeData.value(itemKey), attributesMap.value(itemKey), parentNode);
     }
 
-    // can't use QTreeWidget::itemAbove because it will not iterate into hidden subtrees
-
-    QTreeWidgetItem *par = current->parent();
-    Q_ASSERT(par && par != objectTree->invisibleRootItem());
+    for (int ii = 0; ii < item->childCount(); ++ii) {
+        addToFindIndex(item->child(ii), node >= 0 ? node : parentNode);
+    }
 
-    int ind = par->indexOfChild(current);
-    Q_ASSERT(ind >= 0 && ind < par->childCount());
-    if (ind == 0) return par; // no previous sibling, so parent is previous
-    else return goToBottomChild(par->child(ind-1)); // last descendant of previous sibling is previous
+    if (node >= 0) findIndex.setSubtreeEnd(node, findIndex.size());
 }
 
 
-bool MainWindow::compareTreeItem(QTreeWidgetItem *item, const QString &findString, bool matchCase, bool entireWords, bool searchAttributes)
+void MainWindow::rebuildFindIndex()
 {
-    if (!item) return false;
-
-    TestObjectKey itemIndex = ptr2TestObjectKey(item);
-    Q_ASSERT(objectTreeData.contains( itemIndex) );
-
-    // check values in itemData
-    if ( containsWords( objectTreeData.value( itemIndex ), findString, matchCase, entireWords ) ) {
-        return true;
+    cancelFindAll();
+    findIndex.clear();
+    locatorAnalyzer.clear();
+    locatorText.clear();
+
+    QTreeWidgetItem *root = objectTree->invisibleRootItem();
+    for (int ii = 0; ii < root->childCount(); ++ii) {
+        addToFindIndex(root->child(ii), -1);
     }
-
-    // check attribute values if that option is checked
-    if ( searchAttributes ) {
-        if ( attributeContainsWords( itemIndex, findString, matchCase, entireWords ) ) {
-            return true;
-        }
-    }
-
-    return false;
+    qCDebug(logTree) << FCFL << "indexed" << findIndex.size() << "objects";
 }
 
 
 void MainWindow::findFromSubTree(QTreeWidgetItem *current, const QString &findString, bool backwards, bool matchCase, bool entireWords, bool searchWrapAround, bool searchAttributes)
 {
     Q_ASSERT(findDialogSubtreeRoot);
-    QTreeWidgetItem *startItem = current;
 
-    forever {
-
-        current = backwards ?
-                  findDialogSubtreePrev(current, findDialogSubtreeRoot, searchWrapAround) :
-                  findDialogSubtreeNext(current, findDialogSubtreeRoot, searchWrapAround);
-
-        if (compareTreeItem(current, findString, matchCase, entireWords, searchAttributes)) {
-            // found
-            objectTree->setCurrentItem( current );
+    if (findIndex.node(ptr2TestObjectKey(findDialogSubtreeRoot)) < 0) {
+        rebuildFindIndex();
+    }
+    const int rootNode = findIndex.node(ptr2TestObjectKey(findDialogSubtreeRoot));
+
+    TDriverFindIndex::Query query;
+    query.text = findString;
+    query.caseSensitive = matchCase;
+    query.entireWords = entireWords;
+    query.attributes = searchAttributes;
+
+    QVector<int> matches;
+    if (findDialogLocator->isChecked()) {
+        QString error;
+        if (!findDialogLocatorMatches(findString, matches, &error)) {
+            QMessageBox::warning(this, tr("Find"), tr("Invalid locator: %1").arg(error));
             return;
         }
+    }
+    else {
+        matches = findIndex.find(query);
+    }
 
-        if (!current || current == startItem) {
-            QMessageBox::warning(this,
-                                 tr("Find"),
-                                 tr("No matches found with '%1'").arg(findDialogText->currentText()) );
-            return;
-        }
+    // matches of same query are kept, so repeated find next only does a binary search
+    int found = -1;
+    if (rootNode >= 0) {
+        found = TDriverFindIndex::step(matches,
+                                       findIndex.node(ptr2TestObjectKey(current)),
+                                       rootNode, findIndex.subtreeEnd(rootNode),
+                                       backwards, searchWrapAround);
+    }
+
+    if (found >= 0) {
+        objectTree->setCurrentItem( testObjectKey2Ptr(findIndex.key(found)) );
+    }
+    else {
+        QMessageBox::warning(this,
+                             tr("Find"),
+                             tr("No matches found with '%1'").arg(findDialogText->currentText()) );
     }
 }
 
@@ -229,6 +466,8 @@ void MainWindow::findFromSubTree(QTreeWidgetItem *current, const QString &findSt
 void MainWindow::findDialogTextChanged( const QString & text )
 {
     findDialogFindButton->setEnabled( !text.isEmpty() );
+    findDialogFindAllButton->setEnabled( !text.isEmpty() );
+    if ( findDialogLocator->isChecked() ) findDialogLocatorTimer->start();
 }
 
 
@@ -298,7 +537,9 @@ void MainWindow::createFindDialog() {
     findDialog->setObjectName( "main find" );
     findDialog->setWindowTitle( "Find" );
 
-    findDialog->setFixedSize( 560, 155 );
+    // results of find all are shown below search options
+    findDialog->setMinimumSize( 560, 180 );
+    findDialog->resize( 560, 180 );
 
     // reset find dialog position, stored before closing the dialog and restored when dialog opened
     findDialogPos = QPoint(-1, -1);
@@ -327,6 +568,11 @@ void MainWindow::createFindDialog() {
     findDialogFindButton->setDefault( true );
     findDialogFindButton->setAutoDefault( true );
 
+    findDialogFindAllButton = new QPushButton( "Find A&ll", this );
+    findDialogFindAllButton->setObjectName("main find findall");
+    findDialogFindAllButton->setEnabled( false );
+    findDialogFindAllButton->setAutoDefault( false );
+
     findDialogCloseButton = new QPushButton( "&Close", this );
     findDialogCloseButton->setObjectName("main find close");
     findDialogCloseButton->setDefault( false );
@@ -352,9 +598,18 @@ void MainWindow::createFindDialog() {
     findDialogSubtreeOnly->setObjectName("main find subtree");
     findDialogSubtreeOnly->setTristate(false);
 
+    findDialogLocator = new QCheckBox( "TDriver &locator, e.g. QPushButton( :text => 'OK' )" );
+    findDialogLocator->setObjectName("main find locator");
+
+    // locator is evaluated as it is typed, after a short pause
+    findDialogLocatorTimer = new QTimer( this );
+    findDialogLocatorTimer->setSingleShot( true );
+    findDialogLocatorTimer->setInterval( 200 );
+
     // populate widgets
     findDialogText->setSizePolicy(QSizePolicy::Expanding, QSizePolicy::Fixed);
-    groupBoxLayout->addWidget( findDialogText, 0, 0, 1, -1 );
+    groupBoxLayout->addWidget( findDialogText, 0, 0, 1, 3 );
+    groupBoxLayout->addWidget( findDialogFindAllButton, 0, 3 );
 
     groupBoxLayout->addWidget( findDialogMatchCase, 1, 0 );
     groupBoxLayout->addWidget( findDialogBackwards, 1, 1 );
@@ -363,12 +618,35 @@ void MainWindow::createFindDialog() {
     groupBoxLayout->addWidget( findDialogEntireWords, 2, 0 );
     groupBoxLayout->addWidget( findDialogWrapAround, 2, 1 );
     groupBoxLayout->addWidget( findDialogSubtreeOnly, 2, 2 );
+    groupBoxLayout->addWidget( findDialogLocator, 3, 0, 1, 3 );
 
     groupBoxLayout->addWidget( findDialogFindButton, 1, 3 );
     groupBoxLayout->addWidget( findDialogCloseButton, 2, 3 );
 
     layout->addWidget( groupBox );
 
+    findDialogResults = new QTreeWidget();
+    findDialogResults->setObjectName("main find results");
+    findDialogResults->setRootIsDecorated( false );
+    findDialogResults->setHeaderLabels( QStringList() << "#" << "Type" << "Name" << "Id" );
+    findDialogResults->setSortingEnabled( true );
+    findDialogResults->sortByColumn( 0, Qt::AscendingOrder );
+    findDialogResults->hide();
+    layout->addWidget( findDialogResults, 1 );
+
+    findDialogResultsLabel = new QLabel();
+    findDialogResultsLabel->setObjectName("main find results count");
+    findDialogResultsLabel->hide();
+    layout->addWidget( findDialogResultsLabel );
+
+    findAllWatcher = new QFutureWatcher<QVector<int> >( this );
+    connect( findAllWatcher, SIGNAL(resultsReadyAt(int,int)), this, SLOT(findAllResultsReady(int,int)));
+    connect( findAllWatcher, SIGNAL(finished()), this, SLOT(findAllFinished()));
+    connect( findDialogResults, SIGNAL(currentItemChanged(QTreeWidgetItem*,QTreeWidgetItem*)),
+             this, SLOT(findDialogResultSelected(QTreeWidgetItem*)));
+    connect( findDialogLocator, SIGNAL(toggled(bool)), this, SLOT(findDialogLocatorToggled(bool)));
+    connect( findDialogLocatorTimer, SIGNAL(timeout()), this, SLOT(evaluateFindDialogLocator()));
+
     connect( findDialogSubtreeOnly, SIGNAL(stateChanged(int)),
              this, SLOT(findDialogSubtreeChanged(int)));
     connect( findDialogText, SIGNAL( editTextChanged( const QString & ) ),
@@ -377,6 +655,8 @@ void MainWindow::createFindDialog() {
 
     connect( findDialogFindButton, SIGNAL( clicked() ), findDialogText, SLOT(externallyTriggered()));
     connect( findDialogFindButton, SIGNAL( clicked() ), this, SLOT( findNextTreeObject() ) );
+    connect( findDialogFindAllButton, SIGNAL( clicked() ), findDialogText, SLOT(externallyTriggered()));
+    connect( findDialogFindAllButton, SIGNAL( clicked() ), this, SLOT( findAllTreeObjects() ) );
 
     connect( findDialogCloseButton, SIGNAL( clicked() ), this, SLOT( closeFindDialog() ) );
 
@@ -0,0 +1,256 @@
+/***************************************************************************
+**
+** Copyright (C) 2010 Nokia Corporation and/or its subsidiary(-ies).
+** All rights reserved.
+** Contact: Nokia Corporation (testabilitydriver@nokia.com)
+**
+** This file is part of Testability Driver.
+**
+** If you have questions regarding the use of this file, please contact
+** Nokia at testabilitydriver@nokia.com .
+**
+** This library is free software; you can redistribute it and/or
+** modify it under the terms of the GNU Lesser General Public
+** License version 2.1 as published by the Free Software Foundation
+** and appearing in the file LICENSE.LGPL included in the packaging
+** of this file.
+**
+****************************************************************************/
+
+#include "tdriver_find_index.h"
+
+#include <algorithm>
+
+
+static inline quint64 trigram(const QChar *text)
+{
+    return (quint64(text[0].unicode()) << 32) | (quint64(text[1].unicode()) << 16) | text[2].unicode();
+}
+
+
+static bool shorterList(const QVector<int> *a, const QVector<int> *b)
+{
+    return a->size() < b->size();
+}
+
+
+void TDriverFindIndex::clear()
+{
+    nodes.clear();
+    positions.clear();
+    infoGrams.clear();
+    attributeGrams.clear();
+    infoExact.clear();
+    attributeExact.clear();
+    fieldIndexes.clear();
+    haveLastQuery = false;
+    lastMatches.clear();
+}
+
+
+void TDriverFindIndex::addText(int node, const QString &text, GramIndex &grams, ExactIndex &exact)
+{
+    if (text.isEmpty()) return;
+
+    const QString folded = text.toCaseFolded();
+
+    QVector<int> &exactNodes = exact[folded];
+    if (exactNodes.isEmpty() || exactNodes.last() != node) exactNodes.append(node);
+
+    const QChar *data = folded.constData();
+    for (int ii = 0; ii + 3 <= folded.size(); ++ii) {
+        QVector<int> &gramNodes = grams[trigram(data + ii)];
+        // nodes are added in increasing order, so lists stay sorted
+        if (gramNodes.isEmpty() || gramNodes.last() != node) gramNodes.append(node);
+    }
+}
+
+
+int TDriverFindIndex::addNode(TestObjectKey key, const TreeItemInfo &info, const QMap<QString, AttributeInfo> &attributes, int parent)
+{
+    const int number = nodes.size();
+    haveLastQuery = false;
+
+    Node node;
+    node.key = key;
+    node.name = info.name;
+    node.type = info.type;
+    node.id = info.id;
+    node.attributes = attributes;
+    node.subtreeEnd = number + 1;
+    node.parent = parent;
+
+    addText(number, info.name, infoGrams, infoExact);
+    addText(number, info.type, infoGrams, infoExact);
+    addText(number, info.id, infoGrams, infoExact);
+
+    QMap<QString, AttributeInfo>::const_iterator it;
+    for (it = attributes.constBegin(); it != attributes.constEnd(); ++it) {
+        addText(number, it.value().value, attributeGrams, attributeExact);
+    }
+
+    nodes.append(node);
+    fieldIndexes.clear();
+    positions.insert(key, number);
+    return number;
+}
+
+
+bool TDriverFindIndex::matches(int number, const Query &query) const
+{
+    const Node &node = nodes.at(number);
+    const Qt::CaseSensitivity cs = query.caseSensitive ? Qt::CaseSensitive : Qt::CaseInsensitive;
+
+    if (query.entireWords) {
+        if (node.name.compare(query.text, cs) == 0
+                || node.type.compare(query.text, cs) == 0
+                || node.id.compare(query.text, cs) == 0) return true;
+    }
+    else {
+        if (node.name.contains(query.text, cs)
+                || node.type.contains(query.text, cs)
+                || node.id.contains(query.text, cs)) return true;
+    }
+
+    if (query.attributes) {
+        QMap<QString, AttributeInfo>::const_iterator it;
+        for (it = node.attributes.constBegin(); it != node.attributes.constEnd(); ++it) {
+            const QString &value = it.value().value;
+            if (query.entireWords ? value.compare(query.text, cs) == 0 : value.contains(query.text, cs)) return true;
+        }
+    }
+    return false;
+}
+
+
+QString TDriverFindIndex::fieldValue(int number, const QString &field) const
+{
+    const Node &node = nodes.at(number);
+
+    if (field == QLatin1String("type")) return node.type;
+    if (field == QLatin1String("name")) return node.name;
+    if (field == QLatin1String("id")) return node.id;
+
+    QMap<QString, AttributeInfo>::const_iterator found = node.attributes.constFind(field);
+    return (found != node.attributes.constEnd()) ? found.value().value : QString();
+}
+
+
+QString TDriverFindIndex::fieldName(int number, const QString &field) const
+{
+    QMap<QString, AttributeInfo>::const_iterator found = nodes.at(number).attributes.constFind(field);
+    if (found == nodes.at(number).attributes.constEnd() || found.value().name.isEmpty()) return field;
+    return found.value().name;
+}
+
+
+const QVector<int> &TDriverFindIndex::valueNodes(const QString &field, const QString &value)
+{
+    static const QVector<int> noNodes;
+
+    QHash<QString, ExactIndex>::iterator found = fieldIndexes.find(field);
+    if (found == fieldIndexes.end()) {
+        ExactIndex index;
+        for (int number = 0; number < nodes.size(); ++number) {
+            const QString nodeValue = fieldValue(number, field);
+            if (!nodeValue.isNull()) index[nodeValue].append(number);
+        }
+        found = fieldIndexes.insert(field, index);
+    }
+
+    ExactIndex::const_iterator nodesFound = found.value().constFind(value);
+    return (nodesFound != found.value().constEnd()) ? nodesFound.value() : noNodes;
+}
+
+
+QVector<int> TDriverFindIndex::unite(const QVector<int> &a, const QVector<int> &b)
+{
+    if (a.isEmpty()) return b;
+    if (b.isEmpty()) return a;
+
+    QVector<int> result(a.size() + b.size());
+    result.resize(std::set_union(a.constBegin(), a.constEnd(), b.constBegin(), b.constEnd(), result.begin()) - result.begin());
+    return result;
+}
+
+
+QVector<int> TDriverFindIndex::gramCandidates(const QString &folded, const GramIndex &grams)
+{
+    QVector<const QVector<int> *> lists;
+    const QChar *data = folded.constData();
+
+    for (int ii = 0; ii + 3 <= folded.size(); ++ii) {
+        GramIndex::const_iterator found = grams.constFind(trigram(data + ii));
+        if (found == grams.constEnd()) return QVector<int>();
+        lists.append(&found.value());
+    }
+
+    // intersect shortest lists first
+    std::sort(lists.begin(), lists.end(), shorterList);
+
+    QVector<int> result = *lists.first();
+    for (int ii = 1; ii < lists.size() && !result.isEmpty(); ++ii) {
+        const QVector<int> &other = *lists.at(ii);
+        QVector<int> common(result.size());
+        common.resize(std::set_intersection(result.constBegin(), result.constEnd(),
+                                            other.constBegin(), other.constEnd(), common.begin()) - common.begin());
+        result.swap(common);
+    }
+    return result;
+}
+
+
+QVector<int> TDriverFindIndex::candidates(const Query &query) const
+{
+    const QString folded = query.text.toCaseFolded();
+
+    if (query.entireWords) {
+        QVector<int> result = infoExact.value(folded);
+        if (query.attributes) result = unite(result, attributeExact.value(folded));
+        return result;
+    }
+
+    if (folded.size() >= 3) {
+        QVector<int> result = gramCandidates(folded, infoGrams);
+        if (query.attributes) result = unite(result, gramCandidates(folded, attributeGrams));
+        return result;
+    }
+
+    // too short for trigrams, every node is a candidate
+    QVector<int> result(nodes.size());
+    for (int ii = 0; ii < result.size(); ++ii) result[ii] = ii;
+    return result;
+}
+
+
+const QVector<int> &TDriverFindIndex::find(const Query &query)
+{
+    if (haveLastQuery && query == lastQuery) return lastMatches;
+
+    lastMatches.clear();
+    foreach (int number, candidates(query)) {
+        if (matches(number, query)) lastMatches.append(number);
+    }
+    lastQuery = query;
+    haveLastQuery = true;
+    return lastMatches;
+}
+
+
+int TDriverFindIndex::step(const QVector<int> &matches, int current, int first, int end, bool backwards, bool wrap)
+{
+    QVector<int>::const_iterator lo = std::lower_bound(matches.constBegin(), matches.constEnd(), first);
+    QVector<int>::const_iterator hi = std::lower_bound(lo, matches.constEnd(), end);
+    if (lo == hi) return -1;
+
+    if (backwards) {
+        QVector<int>::const_iterator it = std::lower_bound(lo, hi, current);
+        if (it != lo) return *(it - 1);
+        return wrap ? *(hi - 1) : -1;
+    }
+    else {
+        QVector<int>::const_iterator it = std::upper_bound(lo, hi, current);
+        if (it != hi) return *it;
+        return wrap ? *lo : -1;
+    }
+}
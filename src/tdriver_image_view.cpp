@@ -107,7 +107,6 @@ void TDriverImageView::clearImage()
 
 void TDriverImageView::paintEvent(QPaintEvent *)
 {
-    //qDebug() << FCFL;
     QPainter painter( this );
 
     if( !pixmap || updatePixmap) {
@@ -191,8 +190,6 @@ void TDriverImageView::mousePressEvent(QMouseEvent *event)
 // Stores current position and emits a signal that mouse was clicked
 void TDriverImageView::mouseReleaseEvent(QMouseEvent *event)
 {
-    //qDebug() << "mousePressEvent";
-
     if (event->button() == Qt::LeftButton) {
 
         mousePos = event->pos();
@@ -497,7 +494,6 @@ static TestObjectKey idFromActionData(QObject *sender)
 void TDriverImageView::forwardTapById()
 {
     TestObjectKey id = idFromActionData(sender());
-    //qDebug() << __FUNCTION__ << id;
     if (id != 0) emit imageTapById(id);
 }
 
@@ -505,7 +501,6 @@ void TDriverImageView::forwardTapById()
 void TDriverImageView::forwardInspectById()
 {
     TestObjectKey id = idFromActionData(sender());
-    //qDebug() << __FUNCTION__ << id;
     if (id != 0) emit imageInspectById(id);
 }
 
@@ -518,16 +513,21 @@ void TDriverImageView::forwardInsertObjectById()
 
 
 void TDriverImageView::refreshImage(const QString &imagePath)
+{
+    showImage(QImage( imagePath ), imagePath);
+}
+
+
+void TDriverImageView::showImage(const QImage &newImage, const QString &imagePath)
 {
     delete image;
-    image = new QImage( imagePath );
+    image = new QImage( newImage );
 
     imageFileName = (image->isNull()) ? QString() : imagePath;
     imageOffset = QPoint();
 
     if (!scaleImage)
         resize(image->size());
-    //qDebug() << FCFL << image->text();
 
     imageTasId  = image->text("tas_id");
     emit imageTasIdChanged(imageTasId);
@@ -546,8 +546,6 @@ void TDriverImageView::disableDrawHighlight()
 
 void TDriverImageView::drawHighlights( RectList geometries, bool multiple )
 {
-    //qDebug() << "drawHighlight";
-
     highlightEnabledMode = (multiple) ? 2 : 1;
 
     rects = geometries;
@@ -86,14 +86,12 @@ void MainWindow::imageInsertCoords()
 
 void MainWindow::imageInsertObjectFromId(TestObjectKey id)
 {
-    //qDebug() << __FUNCTION__ << id;
     highlightByKey(id, true, "");
 }
 
 
 void MainWindow::imageInspectFromId(TestObjectKey id)
 {
-    //qDebug() << __FUNCTION__ << id;
     highlightByKey(id, true);
 }
 
@@ -119,7 +117,7 @@ void MainWindow::imageTapFromId(TestObjectKey id)
 // Send tap command to SUT.
 void MainWindow::sendTapScreen(const QStringList &target)
 {
-    qDebug() << FCFL << target;
+    qCDebug(logImage) << FCFL << target;
     statusbar(tr("Tapping..."));
     typedef QList<QByteArray> QByteArrayList;
 
@@ -173,7 +171,6 @@ void MainWindow::drawHighlight( TestObjectKey itemKey, bool multiple )
 
         if (!valid) {
             // nothing valid to highlight
-            //qDebug() << FCFL << "not on screenshot:" << testObjectKey2Str(itemKey);
             imageWidget->disableDrawHighlight();
             lastHighlightedObjectKey = 0;
         }
@@ -215,8 +212,6 @@ bool MainWindow::collectMatchingVisibleObjects( QPoint pos, QList<TestObjectKey>
 // Get smallest object from list of objects
 bool MainWindow::getSmallestObjectFromMatches( QList<TestObjectKey> *matchingObjects, TestObjectKey & objectPtr ) {
 
-    //qDebug() << "getSmallestObjectFromMatches";
-
     bool result = false;
     int smallestObjectSize = -1;
     TestObjectKey smallestObjectPtr = 0;
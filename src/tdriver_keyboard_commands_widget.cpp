@@ -63,26 +63,10 @@ void MainWindow::deviceActionButtonPressed()
     if (button) {
         QString keyToPress = button->text();
 
-#if 0
-        QProgressDialog progressDialog(this);
-        progressDialog.setCancelButtonText(tr("&Cancel"));
-        progressDialog.setMinimumDuration(0);
-        progressDialog.setRange(0, 100);
-        progressDialog.setWindowTitle(tr("Press_key"));
-        progressDialog.setLabelText(tr("Sending keypress"));
-        progressDialog.setValue(1);
-        progressDialog.setValue(15);
-#endif
-        //bool cmd_result = false;
-
-        if ( executeTDriverCommand( commandKeyPress,
-                              QString( activeDevice + " press_key :" + keyToPress ),
-                              keyToPress) ) {
-#if 0
-            progressDialog.reset();
-#endif
-            sendAppListRequest();
-        }
+        // application list is refreshed by receiveTDriverMessage after key press is done
+        sendTDriverCommand( commandKeyPress,
+                            QStringList() << activeDevice << "press_key" << ":" + keyToPress,
+                            keyToPress);
     }
 }
 #endif
@@ -0,0 +1,305 @@
+/***************************************************************************
+**
+** Copyright (C) 2010 Nokia Corporation and/or its subsidiary(-ies).
+** All rights reserved.
+** Contact: Nokia Corporation (testabilitydriver@nokia.com)
+**
+** This file is part of Testability Driver.
+**
+** If you have questions regarding the use of this file, please contact
+** Nokia at testabilitydriver@nokia.com .
+**
+** This library is free software; you can redistribute it and/or
+** modify it under the terms of the GNU Lesser General Public
+** License version 2.1 as published by the Free Software Foundation
+** and appearing in the file LICENSE.LGPL included in the packaging
+** of this file.
+**
+****************************************************************************/
+
+#include "tdriver_locator.h"
+#include "tdriver_find_index.h"
+
+#include <QObject>
+
+
+namespace {
+
+// recursive descent parser for locator text
+class LocatorParser
+{
+public:
+    explicit LocatorParser(const QString &text) : text(text), pos(0) {}
+
+    QString text;
+    int pos;
+    QString error;
+
+    void skipSpace()
+    {
+        while (pos < text.size() && text.at(pos).isSpace()) ++pos;
+    }
+
+    bool atEnd() { skipSpace(); return pos >= text.size(); }
+
+    bool accept(const QString &token)
+    {
+        skipSpace();
+        if (text.midRef(pos, token.size()) != token) return false;
+        pos += token.size();
+        return true;
+    }
+
+    bool fail(const QString &message)
+    {
+        if (error.isEmpty()) error = QObject::tr("%1 at position %2").arg(message).arg(pos + 1);
+        return false;
+    }
+
+    static bool isIdentifierChar(QChar ch) { return ch.isLetterOrNumber() || ch == '_'; }
+
+    // identifier, may be prefixed with @ and contain :: for namespaced types
+    bool identifier(QString &result)
+    {
+        skipSpace();
+        int start = pos;
+        if (pos < text.size() && text.at(pos) == '@') ++pos;
+        if (pos >= text.size() || !(text.at(pos).isLetter() || text.at(pos) == '_')) {
+            pos = start;
+            return false;
+        }
+        forever {
+            while (pos < text.size() && isIdentifierChar(text.at(pos))) ++pos;
+            if (text.midRef(pos, 2) == QLatin1String("::") && pos + 2 < text.size() && text.at(pos + 2).isLetter()) {
+                pos += 2;
+                continue;
+            }
+            break;
+        }
+        result = text.mid(start, pos - start);
+        return true;
+    }
+
+    bool quoted(QString &result)
+    {
+        skipSpace();
+        if (pos >= text.size()) return false;
+        const QChar quote = text.at(pos);
+        if (quote != '\'' && quote != '"') return false;
+
+        result.clear();
+        for (++pos; pos < text.size(); ++pos) {
+            QChar ch = text.at(pos);
+            if (ch == quote) {
+                ++pos;
+                return true;
+            }
+            if (ch == '\\' && pos + 1 < text.size()) ch = text.at(++pos);
+            result.append(ch);
+        }
+        return fail(QObject::tr("Unterminated string"));
+    }
+
+    bool regexp(QRegularExpression &result)
+    {
+        skipSpace();
+        if (pos >= text.size() || text.at(pos) != '/') return false;
+
+        QString pattern;
+        for (++pos; pos < text.size() && text.at(pos) != '/'; ++pos) {
+            if (text.at(pos) == '\\' && pos + 1 < text.size() && text.at(pos + 1) == '/') ++pos;
+            pattern.append(text.at(pos));
+        }
+        if (pos >= text.size()) return fail(QObject::tr("Unterminated regular expression"));
+        ++pos;
+
+        QRegularExpression::PatternOptions options = QRegularExpression::NoPatternOption;
+        while (pos < text.size() && text.at(pos).isLetter()) {
+            switch (text.at(pos).toLatin1()) {
+            case 'i': options |= QRegularExpression::CaseInsensitiveOption; break;
+            case 'm': options |= QRegularExpression::DotMatchesEverythingOption; break;
+            case 'x': options |= QRegularExpression::ExtendedPatternSyntaxOption; break;
+            default: return fail(QObject::tr("Unknown regular expression option"));
+            }
+            ++pos;
+        }
+
+        result = QRegularExpression(pattern.isEmpty() ? QString("(?:)") : pattern, options);
+        if (!result.isValid()) return fail(QObject::tr("Invalid regular expression: %1").arg(result.errorString()));
+        return true;
+    }
+
+    // bare numbers, true, false and nil are compared as their text
+    bool literal(QString &result)
+    {
+        skipSpace();
+        int start = pos;
+        if (pos < text.size() && (text.at(pos) == '-' || text.at(pos) == '+')) ++pos;
+        while (pos < text.size() && (isIdentifierChar(text.at(pos)) || text.at(pos) == '.')) ++pos;
+        if (pos == start) return false;
+        result = text.mid(start, pos - start);
+        if (result == QLatin1String("nil")) result.clear();
+        return true;
+    }
+
+    // :key => value, 'key' => value or key: value
+    bool key(QString &result)
+    {
+        skipSpace();
+        if (accept(":")) {
+            if (!identifier(result) && !quoted(result)) return fail(QObject::tr("Attribute name expected"));
+            return accept("=>") || fail(QObject::tr("=> expected"));
+        }
+        if (quoted(result)) {
+            return accept("=>") || fail(QObject::tr("=> expected"));
+        }
+        if (identifier(result)) {
+            return accept(":") || fail(QObject::tr(": expected"));
+        }
+        return fail(QObject::tr("Attribute name expected"));
+    }
+};
+
+} // namespace
+
+
+TDriverLocator TDriverLocator::compile(const QString &text, QString *error)
+{
+    TDriverLocator locator;
+    LocatorParser parser(text);
+    bool leading = true;
+
+    do {
+        QString name;
+        if (!parser.identifier(name)) {
+            parser.fail(QObject::tr("Object type expected"));
+            break;
+        }
+
+        Step step;
+        bool haveArguments = false;
+
+        if (parser.accept("(")) {
+            haveArguments = true;
+            if (!parser.accept(")")) {
+                do {
+                    Predicate predicate;
+                    if (!parser.key(predicate.field)) break;
+                    predicate.field = predicate.field.toLower();
+
+                    if (!parser.quoted(predicate.value)
+                            && !parser.regexp(predicate.regexp)
+                            && parser.error.isEmpty()
+                            && !parser.literal(predicate.value)) {
+                        parser.fail(QObject::tr("Value expected"));
+                    }
+                    if (!parser.error.isEmpty()) break;
+
+                    if (predicate.field == QLatin1String("__index")) {
+                        bool ok;
+                        step.index = predicate.value.toInt(&ok);
+                        if (!ok || step.index < 0) parser.fail(QObject::tr("Invalid :__index"));
+                    }
+                    else if (!predicate.field.startsWith(QLatin1String("__"))) {
+                        // other TDriver options such as :__timeout do not select objects
+                        step.predicates << predicate;
+                    }
+                } while (parser.error.isEmpty() && parser.accept(","));
+
+                if (parser.error.isEmpty() && !parser.accept(")")) parser.fail(QObject::tr(") expected"));
+            }
+        }
+        if (!parser.error.isEmpty()) break;
+
+        // sut part of locator selects the whole tree
+        if (leading && (name == QLatin1String("TDriver") && !haveArguments)) continue;
+        if (leading && (name == QLatin1String("sut") || name == QLatin1String("@sut"))) {
+            leading = false;
+            continue;
+        }
+        leading = false;
+
+        // child and children take type as attribute, other names are object types
+        if (name != QLatin1String("child") && name != QLatin1String("children")) {
+            Predicate type;
+            type.field = "type";
+            type.value = name;
+            step.predicates.prepend(type);
+        }
+        locator.steps << step;
+
+    } while (parser.accept("."));
+
+    if (parser.error.isEmpty() && !parser.atEnd()) parser.fail(QObject::tr("Unexpected text"));
+    if (parser.error.isEmpty() && locator.steps.isEmpty()) parser.fail(QObject::tr("Object type expected"));
+
+    locator.valid = parser.error.isEmpty();
+    if (error) *error = parser.error;
+    if (!locator.valid) locator.steps.clear();
+    return locator;
+}
+
+
+bool TDriverLocator::matches(TDriverFindIndex &index, int node, const Step &step) const
+{
+    foreach (const Predicate &predicate, step.predicates) {
+        const QString value = index.fieldValue(node, predicate.field);
+        if (value.isNull()) return false;
+        if (predicate.isRegexp() ? !predicate.regexp.match(value).hasMatch() : value != predicate.value) return false;
+    }
+    return true;
+}
+
+
+QVector<int> TDriverLocator::evaluate(TDriverFindIndex &index) const
+{
+    QVector<int> current;
+    if (!valid) return current;
+
+    bool first = true;
+
+    foreach (const Step &step, steps) {
+
+        // seed is shortest list of nodes with exact value
+        const QVector<int> *seed = NULL;
+        foreach (const Predicate &predicate, step.predicates) {
+            if (predicate.isRegexp()) continue;
+            const QVector<int> &nodes = index.valueNodes(predicate.field, predicate.value);
+            if (!seed || nodes.size() < seed->size()) seed = &nodes;
+            if (seed->isEmpty()) return QVector<int>();
+        }
+
+        QVector<int> next;
+        int scopeIndex = 0;
+        int scopeEnd = -1;  // nodes before this are inside subtree of current[scopeIndex-1]
+
+        const int count = seed ? seed->size() : index.size();
+        for (int ii = 0; ii < count; ++ii) {
+            const int node = seed ? seed->at(ii) : ii;
+
+            if (!first) {
+                // node must be descendant of some node of previous step, both lists are sorted
+                while (scopeIndex < current.size() && current.at(scopeIndex) < node) {
+                    scopeEnd = qMax(scopeEnd, index.subtreeEnd(current.at(scopeIndex)));
+                    ++scopeIndex;
+                }
+                if (node >= scopeEnd) {
+                    if (scopeIndex >= current.size()) break;
+                    continue;
+                }
+            }
+
+            if (matches(index, node, step)) next.append(node);
+        }
+
+        if (step.index >= 0) {
+            if (step.index < next.size()) next = QVector<int>() << next.at(step.index);
+            else next.clear();
+        }
+
+        current.swap(next);
+        first = false;
+        if (current.isEmpty()) break;
+    }
+    return current;
+}
@@ -0,0 +1,177 @@
+/***************************************************************************
+**
+** Copyright (C) 2010 Nokia Corporation and/or its subsidiary(-ies).
+** All rights reserved.
+** Contact: Nokia Corporation (testabilitydriver@nokia.com)
+**
+** This file is part of Testability Driver.
+**
+** If you have questions regarding the use of this file, please contact
+** Nokia at testabilitydriver@nokia.com .
+**
+** This library is free software; you can redistribute it and/or
+** modify it under the terms of the GNU Lesser General Public
+** License version 2.1 as published by the Free Software Foundation
+** and appearing in the file LICENSE.LGPL included in the packaging
+** of this file.
+**
+****************************************************************************/
+
+#include "tdriver_locator_analyzer.h"
+#include "tdriver_find_index.h"
+#include "tdriver_locator.h"
+
+#include <tdriver_util.h>
+
+#include <QDebug>
+#include <QStringList>
+
+#include <algorithm>
+
+
+// attributes that identify objects, in order of preference when equally rare;
+// geometry, visibility and focus change while application is used
+static const char *const identifyingFields[] = {
+    "name", "text", "windowtitle", "title", "label", "accessiblename", "tooltip", "placeholdertext", "icontext"
+};
+static const int identifyingFieldCount = sizeof(identifyingFields) / sizeof(identifyingFields[0]);
+
+
+static QVector<int> intersect(const QVector<int> &a, const QVector<int> &b)
+{
+    QVector<int> result(qMin(a.size(), b.size()));
+    result.resize(std::set_intersection(a.constBegin(), a.constEnd(), b.constBegin(), b.constEnd(), result.begin()) - result.begin());
+    return result;
+}
+
+
+// number of nodes in sorted list that are inside subtree of parent
+static int countInSubtree(const TDriverFindIndex &index, const QVector<int> &nodes, int parent)
+{
+    return std::lower_bound(nodes.constBegin(), nodes.constEnd(), index.subtreeEnd(parent))
+            - std::upper_bound(nodes.constBegin(), nodes.constEnd(), parent);
+}
+
+
+bool TDriverLocatorAnalyzer::isScopeType(const QString &type)
+{
+    return type == QLatin1String("sut") || type == QLatin1String("application");
+}
+
+
+const TDriverLocatorAnalyzer::Segment &TDriverLocatorAnalyzer::segment(TDriverFindIndex &index, int node)
+{
+    QHash<int, Segment>::const_iterator found = segments.constFind(node);
+    if (found != segments.constEnd()) return found.value();
+
+    struct Candidate {
+        int field;
+        QString value;
+        QVector<int> matches;
+    };
+
+    const QString type = index.fieldValue(node, "type");
+    const QVector<int> &typeNodes = index.valueNodes("type", type);
+
+    QList<Candidate> candidates;
+    for (int ii = 0; ii < identifyingFieldCount && typeNodes.size() > 1; ++ii) {
+        Candidate candidate;
+        candidate.field = ii;
+        candidate.value = index.fieldValue(node, identifyingFields[ii]);
+        if (candidate.value.isEmpty() || candidate.value == QLatin1String("NoName")) continue;
+
+        candidate.matches = intersect(typeNodes, index.valueNodes(identifyingFields[ii], candidate.value));
+        if (candidate.matches.size() >= typeNodes.size()) continue;
+
+        // keep candidates sorted by rarity, earlier field wins ties
+        int pos = 0;
+        while (pos < candidates.size() && candidates.at(pos).matches.size() <= candidate.matches.size()) ++pos;
+        candidates.insert(pos, candidate);
+    }
+
+    QList<int> chosen;
+    QVector<int> matches = typeNodes;
+
+    if (!candidates.isEmpty()) {
+        chosen << 0;
+        matches = candidates.first().matches;
+    }
+
+    // second attribute only if one is not enough, pairs of rarest few are tried
+    const int pairLimit = qMin(candidates.size(), 4);
+    for (int ii = 0; ii < pairLimit && matches.size() > 1; ++ii) {
+        for (int jj = ii + 1; jj < pairLimit && matches.size() > 1; ++jj) {
+            QVector<int> both = intersect(candidates.at(ii).matches, candidates.at(jj).matches);
+            if (both.size() < matches.size()) {
+                matches = both;
+                chosen = QList<int>() << ii << jj;
+            }
+        }
+    }
+
+    // attributes are written in order of preference, not rarity
+    if (chosen.size() == 2 && candidates.at(chosen.at(0)).field > candidates.at(chosen.at(1)).field) {
+        chosen.swap(0, 1);
+    }
+
+    QStringList arguments;
+    foreach (int ii, chosen) {
+        const QString field = index.fieldName(node, identifyingFields[candidates.at(ii).field]);
+        arguments << QString(":%1 => %2").arg(field).arg(TDriverUtil::rubySingleQuote(candidates.at(ii).value));
+    }
+
+    Segment result;
+    result.text = arguments.isEmpty() ? type + "()" : type + "( " + arguments.join(", ") + " )";
+    result.matches = matches;
+    return segments.insert(node, result).value();
+}
+
+
+QString TDriverLocatorAnalyzer::uniqueLocator(TDriverFindIndex &index, int node)
+{
+    QHash<int, QString>::const_iterator found = locators.constFind(node);
+    if (found != locators.constEnd()) return found.value();
+
+    QString result;
+
+    if (!isScopeType(index.fieldValue(node, "type"))) {
+        const Segment own = segment(index, node);
+
+        if (own.matches.size() == 1) {
+            result = own.text;
+        }
+        else {
+            // nearest ancestor that can be located, and where own segment is unique
+            int anchor = -1;
+            for (int parent = index.parent(node); parent >= 0 && anchor < 0; parent = index.parent(parent)) {
+                if (isScopeType(index.fieldValue(parent, "type"))) break;
+                if (countInSubtree(index, own.matches, parent) != 1) continue;
+                const QString parentLocator = uniqueLocator(index, parent);
+                if (parentLocator.isEmpty()) continue;
+                anchor = parent;
+                result = parentLocator + '.' + own.text;
+            }
+
+            if (anchor < 0) {
+                // position among objects with same type and attributes, :__index counts from 0
+                const int position = std::lower_bound(own.matches.constBegin(), own.matches.constEnd(), node)
+                        - own.matches.constBegin();
+                QString text = own.text;
+                const QString indexArgument = QString(":__index => %1").arg(position);
+                if (text.endsWith("()")) text.insert(text.size() - 1, " " + indexArgument + " ");
+                else text.insert(text.size() - 2, ", " + indexArgument);
+                result = text;
+            }
+        }
+
+        // checked with locator engine, so a locator that is not unique is never given out
+        const QVector<int> check = TDriverLocator::compile(result).evaluate(index);
+        if (check.size() != 1 || check.first() != node) {
+            qWarning() << "TDriverLocatorAnalyzer: synthesized locator is not unique:" << result;
+            result.clear();
+        }
+    }
+
+    locators.insert(node, result);
+    return result;
+}
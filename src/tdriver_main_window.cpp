@@ -25,6 +25,8 @@
 
 #include <tdriver_tabbededitor.h>
 #include <tdriver_rubyinterface.h>
+#include <tdriver_rbistatistics.h>
+#include <tdriver_rbidispatcher.h>
 #include "../common/version.h"
 #include <ui_tdriver_richtextcontainer.h>
 
@@ -38,13 +40,27 @@
 
 MainWindow::MainWindow() :
     QMainWindow(),
+    signalsPrefetchEnabled(true),
+    signalsPrefetchBatchSize(16),
+    uiDumpFileStale(false),
+    findDialogResults(NULL),
+    findAllWatcher(NULL),
+    findAllSearched(0),
     tdriverMsgBox(new QErrorMessage(this)),
     tdriverMsgTotal(0),
     tdriverMsgShown(1),
     keyLastUiStateDir("files/last_uistate_dir"),
     keyLastTDriverDir("files/last_tdriver_dir"),
     keyHistoryStateDirCount("files/state_history_count"),
+    sessionIndex(-1),
     messageTimeoutTimer(new QTimer(this)),
+    pendingCommandsProgress(NULL),
+    uiDumpProgress(NULL),
+    objectTreeGeneration(0),
+    uiDumpReading(false),
+    appSnapshotLabel(NULL),
+    diagnosticsTimer(new QTimer(this)),
+    diagnosticsChangeCount(0),
     doRefreshAfterAppList(false),
     historySavingCounter(-1),
     richTextContainerWidget(new QWidget),
@@ -61,7 +77,6 @@ MainWindow::MainWindow() :
     foreach(QObject *child, tdriverMsgBox->children()) {
         QCheckBox *cb = qobject_cast<QCheckBox*>(child);
         if (cb) {
-            //qDebug() << FCFL << "hiding tdriverMsgBox QCheckBox" << cb->text();
             cb->hide();
             cb->setDisabled(true);
             cb->setCheckState(Qt::Checked);
@@ -69,7 +84,6 @@ MainWindow::MainWindow() :
         else {
             QPushButton *pb = qobject_cast<QPushButton*>(child);
             if (pb) {
-                //qDebug() << FCFL << "connecting tdriverMsgBox QPushButton" << pb->text();
                 connect(pb, SIGNAL(clicked()), this, SLOT(tdriverMsgOkClicked()));
             }
         }
@@ -83,6 +97,8 @@ MainWindow::MainWindow() :
 
 MainWindow::~MainWindow()
 {
+    // find all workers use findIndex
+    cancelFindAll();
     delete richTextContainer;
     delete richTextContainerWidget;
 }
@@ -92,7 +108,6 @@ void MainWindow::tdriverMsgSetTitleText()
     tdriverMsgBox->setWindowTitle(tr("cuTeDriver Notification %1/%2").
                                   arg(qMin(tdriverMsgShown, tdriverMsgTotal)).
                                   arg(tdriverMsgTotal));
-    //qDebug() << FCFL << "set tdriverMsgBox title to" << tdriverMsgBox->windowTitle();
 }
 
 
@@ -174,6 +189,15 @@ bool MainWindow::setup()
 {
     setObjectName("main");
 
+    // session windows open in turn, so index is chosen before the next one is created
+    QList<int> usedIndexes;
+    foreach (QWidget *widget, QApplication::topLevelWidgets()) {
+        MainWindow *session = qobject_cast<MainWindow*>(widget);
+        if (session && session != this) usedIndexes << session->sessionIndex;
+    }
+    sessionIndex = 0;
+    while (usedIndexes.contains(sessionIndex)) ++sessionIndex;
+
     QSettings settings;
 
     // xml/screen capture output path depending on OS
@@ -184,14 +208,30 @@ bool MainWindow::setup()
     stateHistoryFilePathPrefix = QStandardPaths::writableLocation(QStandardPaths::DataLocation);
     QDir().mkpath(stateHistoryFilePathPrefix);
     stateHistoryFilePathPrefix += "/tdriver_visualizer_state_";
+    if (sessionIndex > 0) {
+        stateHistoryFilePathPrefix += QString("session%1_").arg(sessionIndex);
+    }
 
-    TDriverRubyInterface::startGlobalInstance();
+    // additional session windows share the interface process started by the first one
+    if (!TDriverRubyInterface::globalInstance()) {
+        TDriverRubyInterface::startGlobalInstance();
+    }
 
     connect(TDriverRubyInterface::globalInstance(), SIGNAL(rbiError(QString,QString,QString)),
             SLOT(handleRbiError(QString,QString,QString)));
 
-    connect(TDriverRubyInterface::globalInstance(), SIGNAL(messageReceived(quint32,QByteArray,BAListMap)),
-            SLOT(receiveTDriverMessage(quint32,QByteArray,BAListMap)));
+    TDriverRbiDispatcher::globalInstance()->subscribe(TDriverUtil::visualizationId, this,
+                                                      SLOT(receiveRbiMessage(TDriverRbiMessage)));
+
+    // memory budget for cached snapshots of previously selected applications
+    appSnapshots.setMaxCost(qMax(0, settings.value("app_snapshots/memory_budget_mb", 64).toInt()) * 1024);
+
+    // memory budget for api fixture class methods, all classes are also cached on disk
+    apiMethodsMap.setMaxCost(qMax(0, settings.value("api_methods/memory_budget_kb", 2048).toInt()));
+
+    // signal lists of all object types are requested in one batch after each refresh
+    signalsPrefetchEnabled = settings.value("signals/prefetch", true).toBool();
+    signalsPrefetchBatchSize = qMax(1, settings.value("signals/prefetch_batch_size", 16).toInt());
 
     // determine if connection to TDriver established -- if not, allow user to run TDriver Visualizer in viewer/offline mode
     offlineMode = true;
@@ -238,7 +278,7 @@ bool MainWindow::setup()
 
 
     // default sut
-    QString defaultDevice = settings.value( "sut/activesut", QString( "sut_qt" ) ).toString();
+    QString defaultDevice = sessionSettingsValue( settings, "sut/activesut", QString( "sut_qt" ) ).toString();
 
     // if default sut is empty (in ini file), set it as 'sut_qt'
     if ( defaultDevice.isEmpty() ) { defaultDevice = "sut_qt"; }
@@ -346,6 +386,10 @@ void MainWindow::restoreDefaultLayout()
     addDockWidget( Qt::LeftDockWidgetArea, imageViewDock, Qt::Horizontal );
     imageViewDock->setVisible( true );
 
+    diagnosticsDock->setFloating(false);
+    addDockWidget(Qt::BottomDockWidgetArea, diagnosticsDock, Qt::Vertical);
+    diagnosticsDock->setVisible( false );
+
     propertiesDock->setFloating(false);
     addDockWidget(Qt::RightDockWidgetArea, propertiesDock, Qt::Horizontal);
     propertiesDock->setVisible( true );
@@ -372,87 +416,75 @@ void MainWindow::restoreDefaultLayout()
 void MainWindow::setActiveDevice(const QString &deviceName )
 {
     if ( !deviceName.isEmpty() && deviceList.contains( deviceName ) ) {
+        if (deviceName != activeDevice) activeDeviceParams.clear();
         activeDevice = deviceName;
-        getActiveDeviceParameters();
-
-        // enable recording menu if device type is 'kind of' qt
-        recordMenu->setEnabled( !applicationsNamesMap.empty()
-                                && TDriverUtil::isQtSut(activeDeviceParams.value( "type" )));
-        qDebug() << FCFL << deviceName << "was set";
+        // device type is applied to UI when the parameters arrive, not with cleared parameters
+        sendActiveDeviceParametersRequest();
+        qCDebug(logUi) << FCFL << deviceName << "was set";
     }
     else {
         activeDevice.clear();
         activeDeviceParams.clear();
-        qDebug() << FCFL << deviceName << "not valid device, clearing activeDevice";
+        qCDebug(logUi) << FCFL << deviceName << "not valid device, clearing activeDevice";
+        applyActiveDeviceType();
     }
 
     collapsedObjectTreeItemPtr = 0;
     expandedObjectTreeItemPtr = 0;
     lastHighlightedObjectKey = 0;
     //currentApplication.setForeground(TDriverUtil::isSymbianSut(activeDeviceParams.value( "type" )));
-    tabEditor->setSutParamMap(activeDeviceParams);
 }
 
 
 QString MainWindow::getDriverVersionNumber()
 {
-#if 1
+    // version is received in hello message of tdriver_interface.rb, so no command is needed
     QString ver(TDriverRubyInterface::globalInstance()->getTDriverVersion());
-    qDebug() << FCFL << "got version" << ver;
+    qCDebug(logUi) << FCFL << "got version" << ver;
     return  (ver.isEmpty()) ? "Unknown" : ver;
-#else
-    QByteArray result = "Unknown";
-    BAListMap reply;
-
-    if ( executeTDriverCommand(commandGetVersionNumber, "listener check_version", "", &reply ) ) {
-        result = cleanDoneResult(reply["OUTPUT"].first());
-    }
-
-    qDebug() << FCFL << "GOT VERSION" << result;
-    return QString(result);
-#endif
 }
 
-QByteArray MainWindow::cleanDoneResult(QByteArray output)
+
+void MainWindow::sendActiveDeviceParametersRequest()
 {
-    int doneIndex = output.indexOf("done");
-    if ( doneIndex > -1 ) {
-        // remove done from the end of string
-        output.truncate(doneIndex);
-    }
-    // remove linefeed characters
-    return output.trimmed();
+    qCDebug(logRbi) << FCFL << activeDevice;
+    // reply is handled in receiveTDriverMessage, which calls applyActiveDeviceType
+    sendTDriverCommand(commandGetAllDeviceParameters,
+                       QStringList() << activeDevice << "get_all_parameters",
+                       tr("device parameters"),
+                       activeDevice);
 }
 
 
-bool MainWindow::getActiveDeviceParameters()
+// Updates UI parts which depend on device type, called again when device parameters are received
+void MainWindow::applyActiveDeviceType()
 {
-    qDebug() << FCFL << activeDevice;
-    BAListMap reply;
-    QString command = activeDevice + " get_all_parameters";
-
-    bool result = false;
-    if ( executeTDriverCommand( commandGetAllDeviceParameters, command, activeDevice, &reply ) ) {
-        const BAList &keys = reply["keys"];
-        const BAList &values = reply["values"];
-        int count = keys.count();
-        if (count > 0 && count == values.count() ) {
-            activeDeviceParams.clear();
-            result = true;
-            for (int ii=0; ii < count; ++ii) {
-                activeDeviceParams.insert(keys.at(ii), values.at(ii));
-            }
-            //qDebug() << FCFL << activeDevice << ":" << activeDeviceParams;
-        } else {
-            qDebug() << FCFL << "BAD get_parameter keys and/or values counts:" << keys.count() << values.count();
-        }
-    }
-    else {
-        qDebug() << FCFL << "FAILED get_all_parameters" << activeDevice;
-    }
+    tabEditor->setSutParamMap(activeDeviceParams);
+
+    if (activeDevice.isEmpty()) return;
+
+    // sut type may have changed, or become known
+    loadBehavioursCache();
+
+    bool deviceIsQt = TDriverUtil::isQtSut(activeDeviceParams.value("type"));
+
+#if DEVICE_BUTTONS_ENABLED
+    // enable s60 buttons selection if device type is 'kind of' symbian
+    viewButtons->setEnabled( deviceType.contains( "symbian", Qt::CaseInsensitive ) );
+#endif
+
+#if DISABLE_API_TAB_PENDING_REMOVAL
+    apiFixtureEnabled = false;
+    apiFixtureChecked = true;
+#else
+    // enable api tab if if device type is 'kind of' qt
+    tabWidget->setTabEnabled( tabWidget->indexOf( apiTab ), deviceIsQt);
+    apiFixtureEnabled = deviceIsQt;
+    apiFixtureChecked = false;
+#endif
 
-    qDebug() << FCFL << "got" << result;
-    return result;
+    // enable recording menu if device type is 'kind of' qt
+    recordMenu->setEnabled( deviceIsQt && !applicationsNamesMap.empty() );
 }
 
 
@@ -462,29 +494,38 @@ void MainWindow::closeEvent( QCloseEvent *event )
     QSettings settings;
 
     if (tabEditor && !tabEditor->mainCloseEvent(event)) {
-        qDebug() << "closeEvent rejected by code editor";
+        qCDebug(logUi) << "closeEvent rejected by code editor";
         event->ignore();
         return;
     }
 
-    TDriverRubyInterface::globalInstance()->requestClose();
+    // interface process is shared by all session windows, so only the last one closes it
+    bool lastSession = true;
+    foreach (QWidget *widget, QApplication::topLevelWidgets()) {
+        if (widget != this && widget->isVisible() && qobject_cast<MainWindow*>(widget)) {
+            lastSession = false;
+        }
+    }
+    if (lastSession) {
+        TDriverRubyInterface::globalInstance()->requestClose();
+    }
 
     // save tdriver path
     settings.setValue( "files/location", tdriverPath );
 
     // default window size & position
-    settings.setValue("window/pos", pos());
-    settings.setValue("window/size", size());
+    settings.setValue(sessionSettingsKey("window/pos"), pos());
+    settings.setValue(sessionSettingsKey("window/size"), size());
 
     // default sut
-    settings.setValue("sut/activesut", activeDevice);
+    settings.setValue(sessionSettingsKey("sut/activesut"), activeDevice);
     settings.remove("sut/activesuttype"); // this is no longer stored in application settings
 
     // object tree settings
     //for ( int i = 0; i < 3 ; i++ ) { settings.setValue( QString("objecttree/column" + QString::number( i ) ), objectTree->columnWidth( i ) ); }
 
     // image settings
-    settings.setValue("image/resize", checkBoxResize->isChecked());
+    settings.setValue(sessionSettingsKey("image/resize"), checkBoxResize->isChecked());
 
     // clipboard contents
 
@@ -527,8 +568,6 @@ bool MainWindow::eventFilter(QObject * object, QEvent *event) {
 
         QKeyEvent *ke = static_cast<QKeyEvent *>(event);
 
-        //qDebug() << "modifiers(): " << ke->modifiers() << ", key(): " << ke->key();
-
         if (ke->key() == Qt::Key_F1 || ke->key() == Qt::Key_Help) {
 
             //QWidget *widget = 0;
@@ -558,7 +597,6 @@ bool MainWindow::eventFilter(QObject * object, QEvent *event) {
 // MainWindow listener for keypresses
 void MainWindow::keyPressEvent ( QKeyEvent * event )
 {
-    // qDebug() << "MainWindow::keyPressEvent: " << event->key();
     if ( QApplication::focusWidget() == objectTree && objectTree->currentItem() != NULL )
         objectTreeKeyPressEvent( event );
     else
@@ -615,9 +653,22 @@ QString MainWindow::selectFolder(QString title, QString filter, QFileDialog::Acc
 }
 
 
+QString MainWindow::sessionSettingsKey( const QString &key ) const
+{
+    return (sessionIndex > 0) ? QString("session%1/%2").arg(sessionIndex).arg(key) : key;
+}
+
+
+// Value of additional session window falls back to the value stored by first window
+QVariant MainWindow::sessionSettingsValue( const QSettings &settings, const QString &key, const QVariant &defaultValue ) const
+{
+    return settings.value(sessionSettingsKey(key), settings.value(key, defaultValue));
+}
+
+
 void MainWindow::statusbar( QString text, int timeout )
 {
-    qDebug() << FCFL << timeout << "ms for message" << text;
+    qCDebug(logUi) << FCFL << timeout << "ms for message" << text;
     statusBar()->showMessage( text, timeout );
     statusBar()->repaint();
     qApp->processEvents();
@@ -643,19 +694,31 @@ void MainWindow::handleRbiError(QString title, QString text, QString details)
 }
 
 
+void MainWindow::receiveRbiMessage(const TDriverRbiMessage &message)
+{
+    // map is shared with other consumers of the message, and only read here
+    receiveTDriverMessage(message.seqNum(), message.name(), message.map());
+}
+
+
 void MainWindow::receiveTDriverMessage(quint32 seqNum, QByteArray name, const BAListMap &reply)
 {
     if (name != TDriverUtil::visualizationId) return; // not for us
 
     if (!sentTDriverMsgs.contains(seqNum)) {
-        qDebug() << FCFL << "received visualization message with unknown seqNum:" << seqNum << name;
+        qCDebug(logRbi) << FCFL << "received visualization message with unknown seqNum:" << seqNum << name;
         return;
     }
 
-    qDebug() << FCFL << "received visualization message:" << seqNum << reply;
+    qCDebug(logRbi) << FCFL << "received visualization message:" << seqNum << reply;
 
     SentTDriverMsg sentMsg(sentTDriverMsgs.take(seqNum));
 
+    // tdriver_interface.rb executes refresh_ui and refresh_image concurrently, so replies
+    // may arrive in any order, and time-out is stopped only after the last pending reply
+    if (sentTDriverMsgs.isEmpty()) messageTimeoutTimer->stop();
+    updatePendingCommandsProgress();
+
     bool handleError = false;
     bool handleNormally = false;
 
@@ -666,16 +729,29 @@ void MainWindow::receiveTDriverMessage(quint32 seqNum, QByteArray name, const BA
         processErrorMessage(sentMsg.type, "<N/A>", reply, "<unknown>",
                             resultEnum, clearError, shortError, fullError);
 
-        qDebug() << FCFL << "Sending disconnect after error:" << resultEnum << fullError;
-        statusbar(tr("Sending disconnect after error!"));
+        if (resultEnum & DISCONNECT) {
+            qCDebug(logRbi) << FCFL << "Sending disconnect after error:" << resultEnum << fullError;
+            statusbar(tr("Sending disconnect after error!"));
+
+            // disconnect is queued before the retry for the same sut, so retry gets a new connection
+            BAListMap msg;
+            msg["input"] << sentMsg.msg.value("input").value(0) << "disconnect";
+            TDriverRubyInterface::globalInstance()->sendCmd(TDriverUtil::visualizationId, msg);
+            statusbar(tr("Disconnect request sent"));
+            currentApplication.clearInfo();
+
+            if ((resultEnum & RETRY) && !(resultEnum & FAIL) && sentMsg.resends == 0) {
+                // error is shown only if the retry fails too, and its reply does the followup
+                qCDebug(logRbi) << FCFL << "Retrying after disconnect:" << sentMsg.msg;
+                resendTDriverCommand(sentMsg);
+                return;
+            }
+            fullError += "\n\nDisconnect request sent!";
+        }
 
-        BAListMap msg;
-        msg["input"] << activeDevice.toLatin1() << "disconnect";
-        TDriverRubyInterface::globalInstance()->sendCmd(TDriverUtil::visualizationId, msg);
-        fullError += "\n\nDisconnect request sent!";
-        statusbar(tr("Disconnect request sent"));
-        currentApplication.clearInfo();
-        tdriverMsgAppend(fullError);
+        if (!(resultEnum & SILENT)) {
+            tdriverMsgAppend(fullError);
+        }
     }
 
     else if (seqNum > 0) {
@@ -688,7 +764,7 @@ void MainWindow::receiveTDriverMessage(quint32 seqNum, QByteArray name, const BA
 
     case commandListApps:
         if (handleNormally) {
-            qDebug() << FCFL << "got app list:" << applicationsNamesMap;
+            qCDebug(logRbi) << FCFL << "got app list:" << applicationsNamesMap;
             statusbar(tr("Parsing applications list..."));
             parseApplicationsXml( reply.value("applications_filename").value(0) );
             statusbar(tr("Applications list updated!"), 2000);
@@ -703,7 +779,7 @@ void MainWindow::receiveTDriverMessage(quint32 seqNum, QByteArray name, const BA
 
     case commandDisconnectSUT:
         // if disconnection request had error, assume disconnected state anyway
-        qDebug() << FCFL << "Disconnection" << !handleError;
+        qCDebug(logRbi) << FCFL << "Disconnection" << !handleError;
         statusbar(tr("SUT disconnected"), 2000);
         emit disconnectionOk(true);
         break;
@@ -735,6 +811,8 @@ void MainWindow::receiveTDriverMessage(quint32 seqNum, QByteArray name, const BA
                 statusbar(tr("Could not send behaviour update!"), 2000);
                 propertiesDock->setDisabled(false);
             }
+            sendSignalsPrefetch();
+            sendApiMethodsPrefetch();
         }
         else {
             // re-enable if not normal handling above
@@ -743,6 +821,18 @@ void MainWindow::receiveTDriverMessage(quint32 seqNum, QByteArray name, const BA
         objectTree->setDisabled(false);
         break;
 
+    case commandRefreshSubtree:
+        if (handleNormally) {
+            statusbar(tr("Subtree refresh done, updating object tree..."));
+            if (spliceObjectSubtree(sentMsg.msg.value("input").value(3), reply.value("subtree_filename").value(0))) {
+                statusbar(tr("Subtree updated"), 2000);
+            }
+            else {
+                statusbar(tr("Subtree was not updated"), 2000);
+            }
+        }
+        break;
+
     case commandRefreshImage:
         if (handleNormally) {
             if (historySavingCounter > 0) {
@@ -761,6 +851,9 @@ void MainWindow::receiveTDriverMessage(quint32 seqNum, QByteArray name, const BA
         break;
 
     case commandKeyPress:
+        if (handleNormally) {
+            sendAppListRequest();
+        }
         break;
 
     case commandSetAttribute:
@@ -783,7 +876,7 @@ void MainWindow::receiveTDriverMessage(quint32 seqNum, QByteArray name, const BA
             sendUpdateApiTableContent();
         }
         else {
-            qDebug() << FCFL << "got error reply";
+            qCDebug(logRbi) << FCFL << "got error reply";
             tabWidget->setTabEnabled( tabWidget->indexOf( apiTab ), false );
             apiFixtureEnabled = false;
             apiFixtureChecked = true;
@@ -802,30 +895,36 @@ void MainWindow::receiveTDriverMessage(quint32 seqNum, QByteArray name, const BA
             statusbar(tr("Api methods received"), 2000);
             parseApiMethodsXml( reply.value("fixture_filename").value(0));
 
-            if (apiMethodsMap.contains( sentMsg.typeStr )) {
+            if (hasApiMethods( sentMsg.typeStr )) {
                 // call updateApiTableContent() only if parseApiMethodsXml is of correct object,
                 // must be checked to avoid looping
                 sendUpdateApiTableContent();
             }
             else {
-                qDebug() << FCFL << "Did not get api methods for " << sentMsg.typeStr;
+                qCDebug(logRbi) << FCFL << "Did not get api methods for " << sentMsg.typeStr;
             }
         }
         else {
-            qDebug() << FCFL << "got error reply";
+            qCDebug(logRbi) << FCFL << "got error reply";
+        }
+        break;
+
+    case commandClassMethodsBatch:
+        if (handleNormally) {
+            parseApiMethodsXml( reply.value("fixture_filename").value(0));
         }
         break;
 
     case commandBehavioursXml:
         if (handleNormally) {
             statusbar(tr("Behaviours received"), 2000);
-            if (parseXml( reply.value("behaviour_filename").value(0) , behaviorDomDocument )) {
-                buildBehavioursMap();
+            if (buildBehavioursMap( reply.value("behaviour_filename").value(0) )) {
+                saveBehavioursCache();
                 doPropertiesTableUpdate();
                 // todo: handle properties dock disabling better
                 propertiesDock->setDisabled(false);
             }
-            else qDebug() << FCFL << "parseXml fail";
+            else qCWarning(logTree) << FCFL << "buildBehavioursMap fail";
         }
         break;
 
@@ -838,23 +937,26 @@ void MainWindow::receiveTDriverMessage(quint32 seqNum, QByteArray name, const BA
 
             QString fileName(reply.value("signal_filename").value(0));
             if (!fileName.isEmpty()) {
+                // input is device, list_signals, application name, object id, object type, env
+                const BAList &input = sentMsg.msg.value("input");
+                const QString appName(input.value(2));
+                const QString typeKey = TDriverSignalsCache::typeKey(input.value(4), input.value(5));
                 const QStringList signalsList = parseSignalsXml( fileName );
-                apiSignalsMap[sentMsg.typeStr] = signalsList;
-
-                foreach(const QString &signalName, signalsList) {
-                    // add signal name
-                    QTableWidgetItem *signalItem = new QTableWidgetItem( signalName );
-                    signalItem->setFlags( Qt::ItemIsSelectable | Qt::ItemIsEnabled );
-                    signalItem->setFont( *defaultFont );
-
-                    // append new line to table
-                    int rowNumber = signalsTable->rowCount();
-                    signalsTable->insertRow( rowNumber );
-                    signalsTable->setItem( rowNumber, 0, signalItem );
+
+                // list of failed signal fixture is only shown, it is requested again next time
+                if (reply.contains("signal_error")) {
+                    qCDebug(logRbi) << FCFL << "signal fixture failed for" << typeKey << reply.value("signal_error");
+                }
+                else {
+                    signalsCache.insert(appName, applicationsNamesMap.key(appName), typeKey, signalsList);
+                }
+
+                TestObjectKey currentItemKey = ptr2TestObjectKey(objectTree->currentItem());
+                const TreeItemInfo &treeItemData = objectTreeData.value(currentItemKey);
+                if (typeKey == TDriverSignalsCache::typeKey(treeItemData.type, treeItemData.env)
+                        && propertyTabLastTimeUpdated.value("signals") == currentItemKey) {
+                    showSignalsList(signalsList);
                 }
-                // sort signals table
-                signalsTable->sortItems( 0 );
-                signalsTable->resizeColumnToContents (0);
 
                 statusbar(tr("Signal list received."), 2000);
             }
@@ -862,7 +964,18 @@ void MainWindow::receiveTDriverMessage(quint32 seqNum, QByteArray name, const BA
 
         }
         else {
-            qDebug() << FCFL << "got error reply";
+            qCDebug(logRbi) << FCFL << "got error reply";
+        }
+        break;
+
+    case commandSignalPrefetch:
+        if (handleNormally) {
+            QString fileName(reply.value("signal_filename").value(0));
+            // types left over from capped batch are requested only now, so that list_signals
+            // and get_behaviours sent meanwhile are not queued behind all of them
+            if (!fileName.isEmpty() && parseSignalsBatchXml(fileName, sentMsg.typeStr)) {
+                sendSignalsPrefetch();
+            }
         }
         break;
 
@@ -870,9 +983,36 @@ void MainWindow::receiveTDriverMessage(quint32 seqNum, QByteArray name, const BA
         break;
 
     case commandGetAllDeviceParameters:
+        if (handleNormally && sentMsg.typeStr == activeDevice) {
+            const BAList &keys = reply["keys"];
+            const BAList &values = reply["values"];
+            int count = keys.count();
+            if (count > 0 && count == values.count() ) {
+                activeDeviceParams.clear();
+                for (int ii=0; ii < count; ++ii) {
+                    activeDeviceParams.insert(keys.at(ii), values.at(ii));
+                }
+                applyActiveDeviceType();
+            } else {
+                qCWarning(logRbi) << FCFL << "BAD get_parameter keys and/or values counts:" << keys.count() << values.count();
+            }
+        }
+        else {
+            qCWarning(logRbi) << FCFL << "FAILED get_all_parameters" << sentMsg.typeStr;
+            // UI still shows what it was set to for the previous device
+            if (sentMsg.typeStr == activeDevice) applyActiveDeviceType();
+        }
         break;
 
     case commandStartApplication:
+        if (handleNormally) {
+            statusbar(tr("Applicaton started, refreshing..."), 1000 );
+            sendAppListRequest(true);
+        }
+        else {
+            statusbar(tr("Error: Failed to start application."), 1000 );
+            disconnectExclusiveSUT();
+        }
         break;
 
     case commandRecordingStart:
@@ -886,14 +1026,16 @@ void MainWindow::receiveTDriverMessage(quint32 seqNum, QByteArray name, const BA
 
 
     case commandInvalid:
-        qDebug() << FCFL << "got message type commandInvalid!";
+        qCWarning(logRbi) << FCFL << "got message type commandInvalid!";
     }
 
     if (historySavingCounter == 0) {
         historySavingCounter = -1;
-        qDebug() << FCFL << "Saving state to state history";
+        qCDebug(logUi) << FCFL << "Saving state to state history";
         historySaveCurrentState();
     }
+
+    TDriverRbiStatistics::globalInstance()->messageHandled(seqNum);
 }
 
 
@@ -932,10 +1074,13 @@ void MainWindow::processErrorMessage(ExecuteCommandType commandType, const QStri
         switch ( commandType ) {
         case commandListApps: clearError = tr("Error retrieving applications list."); break;
         case commandClassMethods: clearError = tr("Error retrieving methods list for %1.").arg(additionalInformation); break;
+        case commandClassMethodsBatch: clearError = tr("Error retrieving methods lists of %1.").arg(additionalInformation); break;
         case commandSignalList: clearError = tr("Error retrieving signal list for %1.").arg(additionalInformation); break;
+        case commandSignalPrefetch: clearError = tr("Error retrieving signal lists of %1.").arg(additionalInformation); break;
         case commandDisconnectSUT: clearError = tr("Error disconnecting SUT %1.").arg(additionalInformation); break;
         case commandTapScreen: clearError = tr("Error performing tap to screen."); break;
         case commandRefreshUI: clearError = tr("Failed to refresh UI data."); break;
+        case commandRefreshSubtree: clearError = tr("Failed to refresh UI data of object %1.").arg(additionalInformation); break;
         case commandRefreshImage: clearError = tr("Failed to refresh screen capture image."); break;
         case commandKeyPress: clearError = tr("Failed to press key %1.").arg(additionalInformation); break;
         case commandSetAttribute: clearError = tr("Failed to set attribute %1.").arg(additionalInformation); break;
@@ -947,6 +1092,11 @@ void MainWindow::processErrorMessage(ExecuteCommandType commandType, const QStri
 
     // do shortError
     {
+        // background prefetch, data is requested again when its tab is shown
+        if ( commandType == commandSignalPrefetch || commandType == commandClassMethodsBatch ) {
+            resultEnum = SILENT;
+        }
+        else
 #if !DISABLE_API_TAB_PENDING_REMOVAL
         if ( commandType == commandCheckApiFixture) {
             resultEnum = SILENT;
@@ -1008,6 +1158,72 @@ void MainWindow::processErrorMessage(ExecuteCommandType commandType, const QStri
 }
 
 
+bool MainWindow::isCoalescableCommand(ExecuteCommandType commandType)
+{
+    // commands which only read data, so identical pending request gives the same result
+    switch (commandType) {
+    case commandListApps:
+    case commandClassMethods:
+    case commandRefreshUI:
+    case commandRefreshSubtree:
+    case commandRefreshImage:
+    case commandBehavioursXml:
+    case commandGetVersionNumber:
+    case commandSignalList:
+    case commandGetDeviceParameter:
+    case commandGetAllDeviceParameters:
+        return true;
+    default:
+        return false;
+    }
+}
+
+
+bool MainWindow::isSupersedableCommand(ExecuteCommandType commandType)
+{
+    // commands where only the reply to the latest request is useful
+    switch (commandType) {
+    case commandListApps:
+    case commandRefreshUI:
+    case commandRefreshImage:
+    case commandSignalList:
+    case commandSignalPrefetch:
+    case commandClassMethodsBatch:
+        return true;
+    default:
+        return false;
+    }
+}
+
+
+void MainWindow::cancelTDriverCommand(quint32 seqNum)
+{
+    // reply to removed seqNum is discarded by receiveTDriverMessage before parsing,
+    // and cancel message lets tdriver_interface.rb drop the request if it is still queued
+    SentTDriverMsg sentMsg(sentTDriverMsgs.take(seqNum));
+    qCDebug(logRbi) << FCFL << "superseded" << seqNum << sentMsg.msg;
+    updatePendingCommandsProgress();
+
+    // request may have been sent to a device which is no longer the active one
+    BAListMap msg;
+    msg["input"] << sentMsg.msg.value("input").value(0) << "cancel" << QByteArray::number(seqNum);
+    TDriverRubyInterface::globalInstance()->sendCmd(TDriverUtil::visualizationId, msg);
+}
+
+
+void MainWindow::updatePendingCommandsProgress()
+{
+    if (!pendingCommandsProgress) return;
+
+    QStringList pendingNames;
+    foreach (const SentTDriverMsg &sentMsg, sentTDriverMsgs) {
+        pendingNames << (sentMsg.err.isEmpty() ? QString(sentMsg.msg.value("input").value(1)) : sentMsg.err);
+    }
+    pendingCommandsProgress->setToolTip(tr("Waiting for cuTeDriver:\n%1").arg(pendingNames.join("\n")));
+    pendingCommandsProgress->setVisible(!pendingNames.isEmpty());
+}
+
+
 bool MainWindow::sendTDriverCommand( ExecuteCommandType commandType,
                                      const QStringList &inputList,
                                      const QString &errorName,
@@ -1016,9 +1232,34 @@ bool MainWindow::sendTDriverCommand( ExecuteCommandType commandType,
     BAListMap msg;
     msg["input"] = TDriverUtil::toBAList(inputList);
 
+    // prefetch batches are not coalescable, each asks for different types,
+    // but a new batch is computed from the current tree and replaces any pending one
+    if (isCoalescableCommand(commandType) || isSupersedableCommand(commandType)) {
+        QList<quint32> superseded;
+        QMap<quint32, SentTDriverMsg>::iterator it;
+        for (it = sentTDriverMsgs.begin(); it != sentTDriverMsgs.end(); ++it) {
+            if (it.key() == 0 || it.value().type != commandType) continue;
+
+            if (isCoalescableCommand(commandType) && it.value().msg == msg) {
+                // identical request is pending, its reply is handled as if sent by this caller
+                qCDebug(logRbi) << FCFL << "merged with pending" << it.key() << msg;
+                it.value().err = errorName;
+                it.value().typeStr = typeStr;
+                updatePendingCommandsProgress();
+                return true;
+            }
+            if (isSupersedableCommand(commandType)) {
+                superseded << it.key();
+            }
+        }
+        foreach (quint32 oldSeqNum, superseded) {
+            cancelTDriverCommand(oldSeqNum);
+        }
+    }
+
     quint32 seqNum = TDriverRubyInterface::globalInstance()->sendCmd(TDriverUtil::visualizationId, msg);
 
-    qDebug() << FCFL << "SENT SEQNUM" << seqNum;
+    qCDebug(logRbi) << FCFL << "SENT SEQNUM" << seqNum;
 
     if (seqNum > 0) {
         sentTDriverMsgs[seqNum] = SentTDriverMsg(commandType, msg, errorName, typeStr);
@@ -1026,6 +1267,7 @@ bool MainWindow::sendTDriverCommand( ExecuteCommandType commandType,
         int default_timeout = TDriverUtil::quotedToInt(activeDeviceParams.value("default_timeout"))*1000;
         if (default_timeout <= 0) default_timeout=35000;
         messageTimeoutTimer->start(default_timeout);
+        updatePendingCommandsProgress();
         return true;
     }
     else {
@@ -1035,7 +1277,6 @@ bool MainWindow::sendTDriverCommand( ExecuteCommandType commandType,
         }
         sentTDriverMsgs[0] = SentTDriverMsg(commandType, msg, errorName, typeStr, -1);
         receiveTDriverMessage(0, TDriverUtil::visualizationId);
-        //        qDebug() << FCFL << "called receiveTDriverMessage explicitly";
         return false;
     }
 }
@@ -1047,12 +1288,13 @@ bool MainWindow::resendTDriverCommand(SentTDriverMsg &msg)
 
     quint32 seqNum = TDriverRubyInterface::globalInstance()->sendCmd(
                 TDriverUtil::visualizationId, msg.msg);
-    qDebug() << FCFL << "RESENT SEQNUM" << seqNum;
+    qCDebug(logRbi) << FCFL << "RESENT SEQNUM" << seqNum;
     if (seqNum > 0) {
         sentTDriverMsgs[seqNum] = SentTDriverMsg(msg);
         int default_timeout = TDriverUtil::quotedToInt(activeDeviceParams.value("default_timeout"))*1000;
         if (default_timeout <= 0) default_timeout=35000;
         messageTimeoutTimer->start(default_timeout);
+        updatePendingCommandsProgress();
         return true;
     }
     else {
@@ -1061,99 +1303,11 @@ bool MainWindow::resendTDriverCommand(SentTDriverMsg &msg)
         }
         sentTDriverMsgs[0] = msg;
         receiveTDriverMessage(0, TDriverUtil::visualizationId);
-        //        qDebug() << FCFL << "called receiveTDriverMessage explicitly";
         return false;
     }
 }
 
 
-bool MainWindow::executeTDriverCommand( ExecuteCommandType commandType,
-                                        const QString &commandString,
-                                        const QString &additionalInformation,
-                                        BAListMap *reply )
-{
-    QMessageBox infoBox(QMessageBox::Information,
-                        tr("Synchronous cuTeDriver Command"),
-                        tr("Executing cuTeDriver command:\n\n")+commandString);
-
-    infoBox.setStandardButtons(0);
-    infoBox.show();
-    infoBox.repaint();
-    qApp->processEvents();
-
-    QString clearError;
-    QString shortError;
-    QString fullError;
-    bool exit = false;
-    bool result = true;
-    int iteration = 0;
-    int default_timeout = TDriverUtil::quotedToInt(activeDeviceParams.value("default_timeout"))*1000;
-    unsigned resultEnum = OK;
-
-    if (default_timeout <= 0){
-        default_timeout=35000;
-    }
-
-    do {
-        BAListMap msg;
-        msg["input"] = commandString.toLatin1().split(' ');
-
-        qDebug() << FCFL << "going to execute" << msg << "Using timeout: " << default_timeout;
-        QTime t;
-        t.start();
-        /*bool response1 =*/
-        TDriverRubyInterface::globalInstance()->executeCmd(TDriverUtil::visualizationId, msg, default_timeout );
-        if (msg.contains("error")) {
-            qDebug() << FCFL << "failure time" << float(t.elapsed())/1000.0 << "reply" << msg;
-
-            result = false;
-            exit = true;
-            processErrorMessage(commandType, commandString, msg, additionalInformation,
-                                resultEnum, clearError, shortError, fullError);
-
-            if ( resultEnum & FAIL || iteration > 0 ) {
-                // exit if failed again or no retries allowed..
-                exit = true;
-            }
-
-            if ( resultEnum & DISCONNECT ) {
-                // disconnect
-                msg.clear();
-                msg["input"] << activeDevice.toLatin1() << "disconnect";
-                /*bool response2 =*/
-                TDriverRubyInterface::globalInstance()->executeCmd(TDriverUtil::visualizationId, msg, default_timeout );
-                if (msg.contains("error")) {
-                    fullError += "\n\nDisconnect after error failed!";
-                    result = false;
-                    exit = true;
-                }
-                else {
-                    fullError += "\n\nDisconnect after error succeeded.";
-                    // disconnect passed -- retry
-                    currentApplication.clearInfo();
-                    result = false;
-                    if (!(resultEnum & FAIL)) exit = false;
-                }
-            }
-        }
-        else {
-            qDebug() << FCFL << "success time" << float(t.elapsed())/1000.0 << "reply keys" << msg.keys();
-            if (reply) {
-                *reply = msg;
-            }
-            result = true;
-            exit = true;
-        }
-
-        iteration++;
-    } while (!exit);
-
-    if ( !result && !(resultEnum & SILENT) ) {
-        tdriverMsgAppend(fullError);
-    }
-
-    return result;
-}
 
 
 void MainWindow::createActions()
@@ -1196,6 +1350,12 @@ void MainWindow::createActions()
     connect(stateHistoryAction->menu(), SIGNAL(activated(QString)),
             SLOT(loadStateFromHistoryDir(QString)));
 
+    newSessionAction = new QAction(tr("New Session &Window"), this);
+    newSessionAction->setObjectName("main new session");
+    newSessionAction->setShortcut(QKeySequence(tr("Ctrl+Shift+N")));
+
+    connect( newSessionAction, SIGNAL( triggered() ), this, SLOT(openSessionWindow()));
+
     fontAction = new QAction(tr( "Select default font..." ), this);
     fontAction->setObjectName("main font");
     //fontAction->setShortcut( QKeySequence( Qt::ControlModifier + Qt::Key_T ) );
@@ -1214,6 +1374,12 @@ void MainWindow::createActions()
 
     connect( refreshAction, SIGNAL( triggered() ), this, SLOT(forceRefreshData()));
 
+    refreshSubtreeAction = new QAction(tr("Refresh &Subtree"), this);
+    refreshSubtreeAction->setObjectName("main refresh subtree");
+    refreshSubtreeAction->setShortcut(QKeySequence(tr("Ctrl+Shift+R")));
+
+    connect( refreshSubtreeAction, SIGNAL( triggered() ), this, SLOT(refreshSubtree()));
+
     delayedRefreshAction = new QAction(tr("Refresh in 5 secs"), this );
     delayedRefreshAction->setObjectName("main delayed delayedRefresh");
     delayedRefreshAction->setShortcut(QKeySequence(tr("Ctrl+Alt+R")));
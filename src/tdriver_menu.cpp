@@ -59,6 +59,9 @@ void MainWindow::createFileMenu() {
     fileMenu = new QMenu( tr( "&File" ), this );
     fileMenu->setObjectName("main file");
 
+    // another window with its own device, applications and refreshes
+    fileMenu->addAction( newSessionAction );
+
     // parse tdriver parameters xml
     fileMenu->addAction(parseSUT);
 
@@ -82,6 +85,7 @@ void MainWindow::createFileMenu() {
     // refresh
 
     fileMenu->addAction( refreshAction );
+    fileMenu->addAction( refreshSubtreeAction );
     fileMenu->addAction( delayedRefreshAction );
 
     // tap and auto-refresh on Image View click
@@ -486,17 +490,51 @@ void MainWindow::appSelected() {
         }
 
         QString processId = applicationsActionMap.value( action );
+        // tree keeps showing previous application until it is replaced by cached state or refresh,
+        // and tree of an application selected only in between was never shown
+        if (processId != currentApplication.id && appSnapshotPendingKey.isEmpty()) {
+            appSnapshotPendingKey = appSnapshotKey();
+            appSnapshotPendingImage = imageWidget->currentImage();
+        }
         currentApplication.set(processId, applicationsNamesMap.value( processId ));
 
         action->setChecked( true );
         currentApplication.setForeground((processId == "0")
                                          /*|| TDriverUtil::isSymbianSut(activeDeviceParams.value( "type" ))*/);
+        if (appSnapshotKey() == appSnapshotPendingKey) {
+            appSnapshotPendingKey.clear();
+            appSnapshotPendingImage = QImage();
+        }
+        else if (appSnapshots.contains(appSnapshotKey())) {
+            storePendingAppSnapshot();
+        }
+        if (restoreAppSnapshot()) {
+            statusbar(tr("Showing cached state, refreshing..."));
+        }
         sendAppListRequest(true);
     }
     updateWindowTitle();
 }
 
 
+// Opens another visualizer window, for example to show a different device side by side.
+// Each window has its own device, application, snapshots and pending commands, and
+// replies are routed by sequence number, so windows only share the interface process.
+void MainWindow::openSessionWindow()
+{
+    MainWindow *session = new MainWindow();
+    session->setAttribute(Qt::WA_DeleteOnClose);
+
+    if (session->setup()) {
+        session->setStartupLayout();
+        session->show();
+    }
+    else {
+        delete session;
+    }
+}
+
+
 // Helper function, called when device is selected from list
 void MainWindow::deviceSelected()
 {
@@ -515,6 +553,12 @@ void MainWindow::deviceSelected()
             resetApplicationsList();
             currentApplication.clearInfo();
 
+            // snapshots are per device
+            appSnapshots.clear();
+            appSnapshotPendingKey.clear();
+            appSnapshotPendingImage = QImage();
+            clearAppSnapshotMarker();
+
             // disable applications menu
             //appsMenu->setDisabled( true ); // Now we have extra item in the menu so always show
 
@@ -533,32 +577,15 @@ void MainWindow::deviceSelected()
         }
     }
 
-    if (!activeDevice.isEmpty()) {
+    // applications list may have been reset above
+    applyActiveDeviceType();
 
-        bool deviceIsQt = TDriverUtil::isQtSut(activeDeviceParams.value("type"));
-
-#if DEVICE_BUTTONS_ENABLED
-        // enable s60 buttons selection if device type is 'kind of' symbian
-        viewButtons->setEnabled( deviceType.contains( "symbian", Qt::CaseInsensitive ) );
-#endif
-
-#if DISABLE_API_TAB_PENDING_REMOVAL
-        apiFixtureEnabled = false;
-        apiFixtureChecked = true;
-#else
-        // enable api tab if if device type is 'kind of' qt
-        tabWidget->setTabEnabled( tabWidget->indexOf( apiTab ), deviceIsQt);
-        apiFixtureEnabled = deviceIsQt;
-        apiFixtureChecked = false;
-#endif
-
-        // enable recording menu if device type is 'kind of' qt
-        recordMenu->setEnabled( deviceIsQt && !applicationsNamesMap.empty() );
-        //        sendAppListRequest(false);
-    }
     // update window title
     updateWindowTitle();
-    behavioursMap.clear();
+    behaviours.clear();
+    behavioursCacheKey.clear();
+    signalsCache.clear();
+    loadBehavioursCache();
     propertyTabLastTimeUpdated.clear();
 }
 
@@ -26,6 +26,7 @@
 #include <QTimer>
 #include <QProgressDialog>
 #include <QErrorMessage>
+#include <QSet>
 
 #include "ui_tdriver_richtextcontainer.h"
 
@@ -79,8 +80,6 @@ bool MainWindow::getParentItemOffset( QTreeWidgetItem * item, int & x, int & y )
 
 void MainWindow::collectGeometries( QTreeWidgetItem * item, RectList & geometries)
 {
-    //qDebug() << "collectGeometries";
-
     if ( item != NULL ) {
         TestObjectKey itemPtr = ptr2TestObjectKey( item );
 
@@ -147,7 +146,6 @@ void MainWindow::collectGeometries( QTreeWidgetItem * item, RectList & geometrie
 
 void MainWindow::objectTreeItemChanged()
 {
-    //qDebug() << "objectTreeItemChanged";
     // if item changed, tabs in properties table willss be updated when activated next time
     propertyTabLastTimeUpdated.clear();
     // update current properties table
@@ -160,9 +158,19 @@ QTreeWidgetItem * MainWindow::createObjectTreeItem(QTreeWidgetItem *parentItem,
                                                    const TreeItemInfo &data,
                                                    QMap<QString, QStringList> duplicateItems )
 {
-    //qDebug() << "createObjectTreeItem";
     QTreeWidgetItem *item = new QTreeWidgetItem( parentItem );
+    setObjectTreeItemColumns( item, data, duplicateItems );
+    parentItem->addChild( item );
+
+    return item;
+}
 
+
+// sets type, name and id columns of item, also when an existing item gets new data
+void MainWindow::setObjectTreeItemColumns(QTreeWidgetItem *item,
+                                          const TreeItemInfo &data,
+                                          const QMap<QString, QStringList> &duplicateItems )
+{
     // if type or id is empty...
     QString type = data.type;
     QString id = data.id;
@@ -296,10 +304,6 @@ QTreeWidgetItem * MainWindow::createObjectTreeItem(QTreeWidgetItem *parentItem,
     item->setFont( 0, *defaultFont );
     item->setFont( 1, *defaultFont );
     item->setFont( 2, *defaultFont );
-
-    parentItem->addChild( item );
-
-    return item;
 }
 
 
@@ -328,26 +332,49 @@ void MainWindow::refreshScreenshotObjectList()
 /* Recursive function.
    First call from outside should omit arguments, so default value for parentKey is used.
 */
+TestObjectKey MainWindow::screenshotRootKey()
+{
+    TestObjectKey rootKey = 0;
+    QString id = imageWidget->tasIdString();
+    if (id.isEmpty()) {
+        // image metadata didn't have id, so find first object included in attributesMap
+        QTreeWidgetItem *item = objectTree->invisibleRootItem();
+        rootKey = ptr2TestObjectKey(item);
+
+        while (item) {
+            if (attributesMap.contains(rootKey)) break; // found!
+            item = item->child(0);
+            rootKey = ptr2TestObjectKey(item);
+        }
+    }
+    else {
+        // get parent based on id received in image metadata
+        rootKey = objectIdMap.value(id);
+    }
+    return rootKey;
+}
+
+
+// true if buildScreenshotObjectList() would recurse into item
+bool MainWindow::isInScreenshotTree( QTreeWidgetItem *item )
+{
+    const TestObjectKey rootKey = screenshotRootKey();
+    if (ptr2TestObjectKey(item) == rootKey) return true;
+
+    for (QTreeWidgetItem *ancestor = item->parent(); ancestor; ancestor = ancestor->parent()) {
+        const TestObjectKey key = ptr2TestObjectKey(ancestor);
+        if (!attributesMap.contains(key)) return false;
+        if (key == rootKey) return true;
+    }
+    return false;
+}
+
+
 void MainWindow::buildScreenshotObjectList(TestObjectKey parentKey)
 {
     if (!parentKey) {
         // first call
-        QString id = imageWidget->tasIdString();
-        if (id.isEmpty()) {
-            // image metadata didn't have id, so find first object included in attributesMap
-            QTreeWidgetItem *item = objectTree->invisibleRootItem();
-            parentKey = ptr2TestObjectKey(item);
-
-            while (item) {
-                if (attributesMap.contains(parentKey)) break; // found!
-                item = item->child(0);
-                parentKey = ptr2TestObjectKey(item);
-            }
-        }
-        else {
-            // get parent based on id received in image metadata
-            parentKey = objectIdMap.value(id);
-        }
+        parentKey = screenshotRootKey();
     }
     // check validity
     if ( parentKey && attributesMap.contains(parentKey) ) {
@@ -451,7 +478,6 @@ QMap<QString, QStringList> MainWindow::findDuplicateObjectNames( QList<QMap<QStr
 
         for ( int i = 0; i < objects.size(); i++ ) {
 
-            //qDebug() << "--";
             QMap<QString, QString> object = objects.at( i );
             QString objectName = object.value( "name" );
             QString objectId = object.value( "id" );
@@ -461,10 +487,8 @@ QMap<QString, QStringList> MainWindow::findDuplicateObjectNames( QList<QMap<QStr
             if ( foundObjects.count( objectName ) != 0 ) {
 
                 objectIds = foundObjects[ objectName ];
-                //qDebug() << "objectIds: " << objectIds;
 
                 if ( objectIds.contains( objectId ) == true ){
-                    //qDebug() << "objects name and id are identical, show warning...";
                     duplicate = true;
                 }
                 else {
@@ -474,7 +498,6 @@ QMap<QString, QStringList> MainWindow::findDuplicateObjectNames( QList<QMap<QStr
                 }
 
                 results[ objectName ] = objectIds;
-                //qDebug() << objectIds;
             }
             else {
                 objectIds << objectId;
@@ -482,12 +505,9 @@ QMap<QString, QStringList> MainWindow::findDuplicateObjectNames( QList<QMap<QStr
             }
 
             if ( duplicate == false ) {
-                //qDebug() << " not duplicate... " << object;
             }
             else {
-                //qDebug() << " duplicate... " << object;
             }
-            //qDebug() << object;
         }
     }
 
@@ -501,7 +521,6 @@ void MainWindow::buildObjectTree_new_format(QTreeWidgetItem *parentItem,
                                  QDomElement parentElement,
                                  QMap<QString, QStringList> duplicateItems )
 {
-    //qDebug() << "buildObjectTree_new_format";
     // create attribute hash for each attribute
 
     QTreeWidgetItem *childItem = 0;
@@ -540,7 +559,7 @@ void MainWindow::buildObjectTree_new_format(QTreeWidgetItem *parentItem,
 
             // store id of current application ui dump
             if ( data.type.compare("application", Qt::CaseInsensitive )==0 ) {
-                qDebug() << FCFL << "got application id" << data.id << "name" << data.name;
+                qCDebug(logTree) << FCFL << "got application id" << data.id << "name" << data.name;
                 currentApplication.set(data.id, data.name);
             }
 
@@ -568,8 +587,6 @@ void MainWindow::buildObjectTree(QTreeWidgetItem *parentItem,
                                  QDomElement parentElement,
                                  QMap<QString, QStringList> duplicateItems )
 {
-    //qDebug() << "buildObjectTree";
-
     // create attribute hash for each attribute
 
     QTreeWidgetItem *childItem = 0;
@@ -616,7 +633,7 @@ void MainWindow::buildObjectTree(QTreeWidgetItem *parentItem,
 
             // store id of current application ui dump
             if ( data.type.compare("application", Qt::CaseInsensitive )==0 ) {
-                qDebug() << FCFL << "got application id" << data.id << "name" << data.name;
+                qCDebug(logTree) << FCFL << "got application id" << data.id << "name" << data.name;
                 currentApplication.set(data.id, data.name);
             }
 
@@ -656,14 +673,23 @@ void MainWindow::clearObjectTreeMappings()
     // empty object tree data mappings (eg. type, name & id)
     objectTreeData.clear();
     objectIdMap.clear();
+
+    // search index refers to object tree items
+    invalidateFindIndex();
+
+    // tells readUiDump that items it is adding are gone
+    ++objectTreeGeneration;
 }
 
 
 void MainWindow::updateObjectTree( QString filename )
 {
-    qDebug() << FCFL << "from file" << filename;
+    qCDebug(logTree) << FCFL << "from file" << filename;
     QTreeWidgetItem *sutItem  = NULL;
 
+    // tree of previously selected application is cached only now that it gets replaced
+    storePendingAppSnapshot();
+
     // store id value of focused node in object tree
     QString currentFocusId = objectTreeData.value(ptr2TestObjectKey( objectTree->currentItem())).id;
 
@@ -671,94 +697,25 @@ void MainWindow::updateObjectTree( QString filename )
     // empty object tree
     objectTree->clear();
     uiDumpFileName.clear();
+    clearAppSnapshotMarker();
 
-    // parse ui dump xml
-    if (parseXml( filename, xmlDocument )) {
-
+    // read ui dump xml, painting the tree while it grows
+    const int generation = objectTreeGeneration;
+    if (readUiDump( filename, sutItem )) {
         uiDumpFileName = filename;
-
-        QDomNode node = xmlDocument.documentElement().firstChild();
-
-        QString version = xmlDocument.documentElement().toElement().attribute("version");
-
-/*
-
-        QDomElement root = appDocument.documentElement();
-
-        // retrieve version from tas message
-        QString version = root.toElement().attribute("version");
-
-        nodeInfo = root.firstChild();
-
-*/
-
-        while ( !node.isNull() ) {
-
-            // find tasInfo element from xmlDocument
-            if ( node.isElement() && node.nodeName() == "tasInfo" ) {
-                if (sutItem) {
-                    qWarning("%s:%i: Duplicate tasInfo element, ignoring remaining XML!", __FILE__, __LINE__);
-                    break;
-                }
-                sutItem = new QTreeWidgetItem(0);
-
-                QDomElement element = node.toElement();
-                QString sutId = element.attribute( "id" );
-
-                TreeItemInfo treeItemData = {
-                    QString("sut"),
-                    element.attribute("name"),
-                    element.attribute("id"),
-                    element.attribute("env") };
-
-                if (treeItemData.name != activeDevice) {
-                    qDebug() << FCFL << "device/sut name mismatch:" << activeDevice << treeItemData.name;
-                }
-
-                // add sut to the top of the object tree
-                sutItem->setData( 0, Qt::DisplayRole, QString("sut") );
-                sutItem->setData( 1, Qt::DisplayRole, treeItemData.name );
-                sutItem->setData( 2, Qt::DisplayRole, sutId );
-
-                sutItem->setForeground( 0, QColor(Qt::darkCyan).darker(180) );
-                sutItem->setForeground( 1, QColor(Qt::darkGreen) );
-                sutItem->setForeground( 2, QColor(Qt::darkYellow) );
-
-                sutItem->setFont( 0, *defaultFont );
-                sutItem->setFont( 1, *defaultFont );
-                sutItem->setFont( 2, *defaultFont );
-
-                objectTree->addTopLevelItem ( sutItem );
-                objectIdMap.insert(sutId, ptr2TestObjectKey(sutItem));
-
-                TestObjectKey itemPtr = ptr2TestObjectKey( sutItem );
-
-                // store object tree data
-                objectTreeData.insert( itemPtr, treeItemData );
-
-                // determine whether to use new xml structure or not... (new == 1.3+)
-                if ( !checkVersion( version, "1.3" ) ) {
-
-                  QList<QMap<QString,QString> > objectNamesList = collectObjectData( element );
-                  QMap<QString, QStringList> duplicateItems = findDuplicateObjectNames( objectNamesList );
-
-                  // build object tree with xml
-                  buildObjectTree( sutItem, element, duplicateItems );
-
-                } else {
-
-                  QList<QMap<QString,QString> > objectNamesList = collectObjectData_new_format( element );
-                  QMap<QString, QStringList> duplicateItems = findDuplicateObjectNames( objectNamesList );
-
-                  buildObjectTree_new_format( sutItem, element, duplicateItems );
-
-                }
-
-                break; // while node is not null
-            }
-
-            node = node.nextSibling();
-        }
+        uiDumpFileStale = false;
+        markDuplicateObjectNames( sutItem );
+    }
+    else if (generation != objectTreeGeneration) {
+        // tree was replaced while this dump was being read
+        qCDebug(logTree) << FCFL << "tree replaced while reading" << filename;
+        return;
+    }
+    else {
+        // do not leave partially read tree behind
+        clearObjectTreeMappings();
+        objectTree->clear();
+        sutItem = NULL;
     }
 
     if (sutItem) {
@@ -795,6 +752,144 @@ void MainWindow::updateObjectTree( QString filename )
         qWarning("%s:%i: got no tasInfo elements from XML file '%s', returning from method",
                  __FILE__, __LINE__, qPrintable(filename));
     }
+
+    updateXmlSourceView();
+}
+
+
+// finds object element with given id from element and its descendants
+static QDomElement findObjectElement( const QDomElement &element, const QString &id )
+{
+    if ((element.nodeName() == "obj" || element.nodeName() == "object") && element.attribute("id") == id) {
+        return element;
+    }
+
+    for (QDomElement child = element.firstChildElement(); !child.isNull(); child = child.nextSiblingElement()) {
+        QDomElement found = findObjectElement(child, id);
+        if (!found.isNull()) return found;
+    }
+    return QDomElement();
+}
+
+
+static void collectSubtreeKeys( QTreeWidgetItem *item, QSet<TestObjectKey> &keys )
+{
+    for (int ii = 0; ii < item->childCount(); ++ii) {
+        keys.insert(ptr2TestObjectKey(item->child(ii)));
+        collectSubtreeKeys(item->child(ii), keys);
+    }
+}
+
+
+// Replaces children and attributes of object with given id by contents of subtree dump,
+// leaving rest of the object tree and its mappings untouched.
+bool MainWindow::spliceObjectSubtree( const QString &objectId, const QString &filename )
+{
+    // pending full refresh replaces the whole tree anyway
+    foreach (const SentTDriverMsg &sentMsg, sentTDriverMsgs) {
+        if (sentMsg.type == commandRefreshUI) return false;
+    }
+    // tree is still being read from previous dump
+    if (uiDumpReading) return false;
+
+    const TestObjectKey itemKey = objectIdMap.value(objectId);
+    QTreeWidgetItem *item = testObjectKey2Ptr(itemKey);
+    if (!item) {
+        qCDebug(logTree) << FCFL << "object" << objectId << "no longer in tree";
+        return false;
+    }
+
+    QDomDocument subtreeDocument;
+    if (!parseXml( filename, subtreeDocument )) return false;
+
+    // subtree dump may still be wrapped in tasMessage and tasInfo elements
+    QDomElement rootElement = findObjectElement(subtreeDocument.documentElement(), objectId);
+    if (rootElement.isNull()) {
+        qWarning() << FCFL << "object" << objectId << "not found in" << filename;
+        return false;
+    }
+    const bool newFormat = (rootElement.nodeName() == "obj");
+
+    const TestObjectKey currentKey = ptr2TestObjectKey(objectTree->currentItem());
+    const QString currentFocusId = objectTreeData.value(currentKey).id;
+
+    // forget mappings of items below item, and cached geometries of item and its ancestors
+    QSet<TestObjectKey> removedKeys;
+    collectSubtreeKeys(item, removedKeys);
+    foreach (TestObjectKey key, removedKeys) {
+        attributesMap.remove(key);
+        geometriesMap.remove(key);
+        const QString id = objectTreeData.take(key).id;
+        if (objectIdMap.value(id) == key) objectIdMap.remove(id);
+    }
+    attributesMap.remove(itemKey);
+    for (QTreeWidgetItem *ancestor = item; ancestor; ancestor = ancestor->parent()) {
+        geometriesMap.remove(ptr2TestObjectKey(ancestor));
+    }
+
+    screenshotObjects.remove(itemKey);
+    screenshotObjects.subtract(removedKeys);
+
+    QMap<QString, TestObjectKey>::iterator tabIt = propertyTabLastTimeUpdated.begin();
+    while (tabIt != propertyTabLastTimeUpdated.end()) {
+        if (tabIt.value() == itemKey || removedKeys.contains(tabIt.value())) tabIt = propertyTabLastTimeUpdated.erase(tabIt);
+        else ++tabIt;
+    }
+
+    if (lastHighlightedObjectKey == itemKey || removedKeys.contains(lastHighlightedObjectKey)) {
+        lastHighlightedObjectKey = 0;
+    }
+
+    qDeleteAll(item->takeChildren());
+    invalidateFindIndex();
+
+    // names outside the subtree count for duplicates, though their items are not updated
+    QList<QMap<QString, QString> > objectNamesList;
+    foreach (const TreeItemInfo &info, objectTreeData) {
+        if (info.name.isEmpty()) continue;
+        QMap<QString, QString> nameAndId;
+        nameAndId.insert( "name", info.name );
+        nameAndId.insert( "id", info.id );
+        objectNamesList << nameAndId;
+    }
+    objectNamesList << (newFormat
+                        ? collectObjectData_new_format( rootElement )
+                        : collectObjectData( rootElement ));
+    QMap<QString, QStringList> duplicateItems = findDuplicateObjectNames( objectNamesList );
+
+    TreeItemInfo data = {
+        rootElement.attribute( "type" ),
+        rootElement.attribute( "name" ),
+        rootElement.attribute( "id" ),
+        rootElement.attribute( "env" ) };
+    objectTreeData.insert( itemKey, data );
+    setObjectTreeItemColumns( item, data, duplicateItems );
+
+    if (newFormat) buildObjectTree_new_format( item, rootElement, duplicateItems );
+    else buildObjectTree( item, rootElement, duplicateItems );
+
+    if (imageWidget) {
+        if (isInScreenshotTree(item)) buildScreenshotObjectList(itemKey);
+        imageWidget->update();
+    }
+
+    // keep Show XML in sync with the tree
+    QDomElement oldElement = findObjectElement(xmlDocument.documentElement(), objectId);
+    if (!oldElement.isNull()) {
+        oldElement.parentNode().replaceChild(xmlDocument.importNode(rootElement, true), oldElement);
+        uiDumpFileStale = true;
+        updateXmlSourceView();
+    }
+
+    // focus was on an item which was replaced
+    if (currentKey == itemKey || removedKeys.contains(currentKey)) {
+        TestObjectKey focusKey = objectIdMap.value(currentFocusId);
+        objectTree->setCurrentItem(focusKey ? testObjectKey2Ptr(focusKey) : item);
+    }
+
+    drawHighlight( ptr2TestObjectKey(objectTree->currentItem()), true );
+    doPropertiesTableUpdate();
+    return true;
 }
 
 
@@ -859,6 +954,37 @@ void MainWindow::forceRefreshApps()
 }
 
 
+void MainWindow::refreshSubtree()
+{
+    if  ( !isDeviceSelected() ) {
+        noDeviceSelectedPopup();
+        return;
+    }
+
+    QTreeWidgetItem *item = objectTree->currentItem();
+    const TreeItemInfo data = objectTreeData.value(ptr2TestObjectKey(item));
+
+    // sut and application items are the whole dump, so they get a full refresh
+    if (!item || !item->parent() || data.id.isEmpty()
+            || data.type.compare("application", Qt::CaseInsensitive) == 0) {
+        forceRefreshData();
+        return;
+    }
+
+    QStringList cmd;
+    cmd << activeDevice << "refresh_subtree"
+        << (currentApplication.useId() ? currentApplication.id : QString())
+        << data.id;
+
+    if (sendTDriverCommand(commandRefreshSubtree, cmd, tr("subtree refresh"))) {
+        statusbar(tr("Sent subtree refresh request for %1...").arg(data.name.isEmpty() ? data.id : data.name));
+    }
+    else {
+        statusbar(tr("Sending subtree refresh failed"), 2000);
+    }
+}
+
+
 void MainWindow::sendAppListRequest(bool refreshAfter)
 {
     if (refreshAfter) {
@@ -901,7 +1027,7 @@ QStringList MainWindow::constructRefreshCmd(const QString &command)
                      " Refreshing foreground application.");
         }
     }
-    qDebug() << FCFL << "result" << ret;
+    qCDebug(logTree) << FCFL << "result" << ret;
 
     return ret;
 }
@@ -961,6 +1087,7 @@ void MainWindow::refreshAppearance()
     if (defaultFont) {
         if (objectTree) objectTree->setFont(*defaultFont);
         if (propertiesTable) propertiesTable->setFont(*defaultFont);
+        if (attributesModel) attributesModel->setFont(*defaultFont);
         if (methodsTable) methodsTable->setFont(*defaultFont);
         if (signalsTable) signalsTable->setFont(*defaultFont);
     }
@@ -987,14 +1114,15 @@ void MainWindow::resizeObjectTree() {
 
 void MainWindow::objectViewCurrentItemChanged ( QTreeWidgetItem * itemCurrent, QTreeWidgetItem * /*itemPrevious*/ )
 {
-    Q_UNUSED( itemCurrent );
-    // qDebug() << "objectViewCurrentItemChanged";
-
     collapsedObjectTreeItemPtr = 0;
     expandedObjectTreeItemPtr = 0;
     objectTreeItemChanged();
     imageWidget->update();
     resizeObjectTree();
+
+    if ( xmlView->isVisible() ) {
+        xmlSourceView->showObject( objectTreeData.value( ptr2TestObjectKey( itemCurrent ) ).id );
+    }
 }
 
 
@@ -1027,6 +1155,39 @@ QString MainWindow::treeObjectRubyId(TestObjectKey treeItemPtr, TestObjectKey su
 }
 
 
+// shortest unique locator of item, prefixed with sut and application if fullPath is true,
+// or the traditional name/text based path if no unique locator is found
+QString MainWindow::objectRubyPath( QTreeWidgetItem *item, bool fullPath )
+{
+    TestObjectKey sutItemPtr = ptr2TestObjectKey(objectTree->topLevelItem(0));
+    TestObjectKey itemKey = ptr2TestObjectKey(item);
+
+    if (findIndex.node(itemKey) < 0) rebuildFindIndex();
+    const int node = findIndex.node(itemKey);
+    QString result = (node >= 0) ? locatorAnalyzer.uniqueLocator(findIndex, node) : QString();
+
+    if (result.isEmpty()) {
+        do {
+            result = TDriverUtil::smartJoin(
+                        treeObjectRubyId(ptr2TestObjectKey(item), sutItemPtr), '.', result);
+        } while (fullPath && ptr2TestObjectKey(item) != sutItemPtr && (item = item->parent()));
+    }
+    else if (fullPath) {
+        // unique locator is relative to application
+        QString prefix;
+        while ((item = item->parent())) {
+            const QString type = objectTreeData.value(ptr2TestObjectKey(item)).type;
+            if (type == "application" || type == "sut") {
+                prefix = TDriverUtil::smartJoin(
+                            treeObjectRubyId(ptr2TestObjectKey(item), sutItemPtr), '.', prefix);
+            }
+        }
+        result = TDriverUtil::smartJoin(prefix, '.', result);
+    }
+    return result;
+}
+
+
 void MainWindow::objectViewItemAction( QTreeWidgetItem * item, int column, ContextMenuSelection action, QString method ) {
 
     Q_UNUSED( column );
@@ -1036,13 +1197,7 @@ void MainWindow::objectViewItemAction( QTreeWidgetItem * item, int column, Conte
         TestObjectKey sutItemPtr = ptr2TestObjectKey(objectTree->topLevelItem(0));
         const bool fullPath = (ptr2TestObjectKey(item) == sutItemPtr) || isPathAction(action) ;
 
-        // TODO: use XPath to determine if object is unique, and eg. insert line in comments if it's not unique
-        QString result;
-
-        do {
-            result = TDriverUtil::smartJoin(
-                        treeObjectRubyId(ptr2TestObjectKey(item), sutItemPtr), '.', result);
-        } while (fullPath && ptr2TestObjectKey(item) != sutItemPtr && (item = item->parent()));
+        QString result = objectRubyPath(item, fullPath);
 
         switch (action) {
 
@@ -1063,7 +1218,7 @@ void MainWindow::objectViewItemAction( QTreeWidgetItem * item, int column, Conte
             break;
 
         default:
-            qDebug() << __FILE__ << __FUNCTION__ << __LINE__ << "Unhandled context menu action" << action;
+            qCDebug(logTree) << __FILE__ << __FUNCTION__ << __LINE__ << "Unhandled context menu action" << action;
         }
     }
 }
@@ -21,6 +21,8 @@
 #include "tdriver_main_window.h"
 #include <tdriver_tabbededitor.h>
 
+#include <QStyle>
+
 #include <tdriver_debug_macros.h>
 
 void MainWindow::tabWidgetChanged( int currentTableWidget ) {
@@ -46,8 +48,7 @@ void MainWindow::clearPropertiesTableContents() {
     signalsTable->setRowCount( 0 );
 
     // clear properties table contents
-    propertiesTable->clearContents();
-    propertiesTable->setRowCount( 0 );
+    attributesModel->clear();
 
     propertyTabLastTimeUpdated.clear();
 
@@ -95,7 +96,7 @@ void MainWindow::sendUpdateApiTableContent()
         if ( !objectType.isEmpty() ) {
 
             if ( !apiFixtureChecked ) {
-                qDebug() << "requesting API fixture check";
+                qCDebug(logTree) << "requesting API fixture check";
                 sendTDriverCommand(commandCheckApiFixture,
                                    QStringList() << activeDevice << "check_fixture",
                                    "checking API fixture");
@@ -104,8 +105,9 @@ void MainWindow::sendUpdateApiTableContent()
             }
 
             // retrieve methods using fixture if not already found from api methods cache
-            if ( !apiMethodsMap.contains( objectType ) ) {
-                qDebug() << "requesting apiMethods for " << objectType;
+            const ApiMethodMap *cachedMethods = apiMethods( objectType );
+            if ( !cachedMethods ) {
+                qCDebug(logTree) << "requesting apiMethods for " << objectType;
                 sendTDriverCommand(commandClassMethods,
                                    QStringList() << activeDevice << "fixture" << objectType,
                                    "class methods for " + objectType,
@@ -114,10 +116,10 @@ void MainWindow::sendUpdateApiTableContent()
                 return;
 
             } else {
-                qDebug() << "apiMethods for " << objectType << " found";
+                qCDebug(logTree) << "apiMethods for " << objectType << " found";
             }
 
-            QMap<QString, QHash<QString, QString> > methodsMap = apiMethodsMap.value( objectType );
+            ApiMethodMap methodsMap = *cachedMethods;
 
             QMap<QString, QHash<QString, QString> >::iterator methodsIterator;
             for ( methodsIterator = methodsMap.begin(); methodsIterator != methodsMap.end(); ++methodsIterator ) {
@@ -154,8 +156,6 @@ void MainWindow::sendUpdateApiTableContent()
                 if ( arguments.isEmpty() ) { methodArguments->setBackground( QBrush( Qt::lightGray ) ); }
                 apiTable->setItem( rowNumber, 2, methodArguments );
 
-                // qDebug() << methodsIterator.key() << ": " << methodsIterator.value() << endl;
-
             }
 
         }
@@ -173,12 +173,8 @@ void MainWindow::sendUpdateApiTableContent()
 
 void MainWindow::updateMethodsTableContent() {
 
-    // qDebug() << "updateMethodsTableContent";
-
     TestObjectKey currentItemPtr = ptr2TestObjectKey( objectTree->currentItem() );
 
-    Behaviour behaviour;
-
     // clear methods table contents
     methodsTable->clearContents();
     methodsTable->setRowCount( 0 );
@@ -197,36 +193,29 @@ void MainWindow::updateMethodsTableContent() {
         // retrieve methods ( behaving-object/test-object[@value = "*"] and behaving-object/test-object[@value = objectType] )
         for ( int objectTypeIndex = 0; objectTypeIndex < objectTypes.size(); objectTypeIndex++ ) {
 
-            if ( behavioursMap.contains( objectTypes.at( objectTypeIndex ) ) ) {
-
-                behaviour = behavioursMap.value( objectTypes.at( objectTypeIndex ) );
+            const BehaviourMethodTable *methods = behaviours.methods( objectTypes.at( objectTypeIndex ) );
 
-                QStringList methodsList = behaviour.getMethodsList();
+            if ( methods ) {
 
-                for ( int methodIndex = 0; methodIndex < methodsList.size(); methodIndex++ ) {
+                methodsTable->setRowCount( methodsTable->rowCount() + methods->size() );
+                int rowNumber = methodsTable->rowCount() - methods->size();
 
-                    // retrieve method hash
-                    QMap<QString, QString> method = behaviour.getMethod( methodsList.at( methodIndex ) );
-
-                    // retrieve current item count
-                    int rowNumber = methodsTable->rowCount();
-
-                    // insert new line to table
-                    methodsTable->insertRow( rowNumber );
+                foreach ( const BehaviourMethod *method, *methods ) {
 
                     // add method name
-                    QTableWidgetItem *methodName = new QTableWidgetItem( methodsList.at( methodIndex ) );
+                    QTableWidgetItem *methodName = new QTableWidgetItem( method->name );
                     methodName->setFlags( Qt::ItemIsSelectable | Qt::ItemIsEnabled );
-                    methodName->setToolTip( method.value( "description" ) );
+                    methodName->setToolTip( method->description );
                     methodName->setFont( *defaultFont );
                     methodsTable->setItem( rowNumber, 0, methodName );
 
                     // add method example
-                    QTableWidgetItem *methodExample = new QTableWidgetItem( method.value( "example" ) );
+                    QTableWidgetItem *methodExample = new QTableWidgetItem( method->example );
                     methodExample->setFlags( Qt::ItemIsSelectable | Qt::ItemIsEnabled );
-                    methodExample->setToolTip( method.value( "description" ) );
+                    methodExample->setToolTip( method->description );
                     methodExample->setFont( *defaultFont );
                     methodsTable->setItem( rowNumber, 1, methodExample );
+                    ++rowNumber;
 
                 }
 
@@ -247,8 +236,6 @@ void MainWindow::updateMethodsTableContent() {
 
 bool MainWindow::sendUpdateSignalsTableContent()
 {
-    // qDebug() << "updateSignalsTableContent";
-
     TestObjectKey currentItemPtr = ptr2TestObjectKey( objectTree->currentItem() );
 
     // store pointer of current item to table, so signals table won't be updated unless item is changed on object tree
@@ -272,11 +259,18 @@ bool MainWindow::sendUpdateSignalsTableContent()
             // list_signals
             if (env.contains("qt")){
 
-            statusbar(tr("Getting signals..."), 3000);
-                    QStringList cmd(QStringList()
-                                    << activeDevice << "list_signals" << currentApplication.name << objectId << objectType);
-                     qDebug() << FCFL << "List signals:" << cmd;
-                    return sendTDriverCommand(commandSignalList, cmd, "signal list", objectType);                
+                // signals of a type stay the same until the application is restarted
+                const QString typeKey = TDriverSignalsCache::typeKey(objectType, env);
+                if (signalsCache.contains(currentApplication.name, typeKey)) {
+                    showSignalsList(signalsCache.value(currentApplication.name, typeKey));
+                    return false;
+                }
+
+                statusbar(tr("Getting signals..."), 3000);
+                QStringList cmd(QStringList()
+                                << activeDevice << "list_signals" << currentApplication.name << objectId << objectType << env);
+                qCDebug(logTree) << FCFL << "List signals:" << cmd;
+                return sendTDriverCommand(commandSignalList, cmd, "signal list", objectType);
             }
         }
         signalsTable->resizeColumnsToContents();
@@ -285,66 +279,78 @@ bool MainWindow::sendUpdateSignalsTableContent()
 }
 
 
-void MainWindow::updateAttributesTableContent()
+void MainWindow::showSignalsList(const QStringList &signalsList)
 {
-    // disconnect itemChanged signal listening, reconnect after table is updated
-    disconnect(propertiesTable, SIGNAL(itemChanged(QTableWidgetItem*)),
-               this, SLOT(changePropertiesTableValue(QTableWidgetItem*)) );
+    signalsTable->clearContents();
+    signalsTable->setRowCount( 0 );
 
-    // retrieve pointer of currently selected objectTree item
-    TestObjectKey currentItemPtr = ptr2TestObjectKey( objectTree->currentItem() );
+    foreach(const QString &signalName, signalsList) {
+        // add signal name
+        QTableWidgetItem *signalItem = new QTableWidgetItem( signalName );
+        signalItem->setFlags( Qt::ItemIsSelectable | Qt::ItemIsEnabled );
+        signalItem->setFont( *defaultFont );
 
-    // clear properties table contents
-    propertiesTable->clearContents();
-    propertiesTable->setRowCount( 0 );
+        // append new line to table
+        int rowNumber = signalsTable->rowCount();
+        signalsTable->insertRow( rowNumber );
+        signalsTable->setItem( rowNumber, 0, signalItem );
+    }
+    // sort signals table
+    signalsTable->sortItems( 0 );
+    signalsTable->resizeColumnToContents (0);
+}
 
-    if ( attributesMap.contains( currentItemPtr ) && objectTree->currentItem() != NULL ) {
 
-        // set number of attributes in table
-        propertiesTable->setRowCount( attributesMap.value( currentItemPtr ).size() );
+bool MainWindow::sendSignalsPrefetch()
+{
+    if (!signalsPrefetchEnabled || currentApplication.name.isEmpty()) return false;
 
-        // retrieve current objects attributes (using pointer of QTreeWidgetItem)
-        QMapIterator<QString, AttributeInfo > iterator( attributesMap.value( currentItemPtr ) );
+    const QString &appName = currentApplication.name;
+    QSet<QString> requestedKeys;
+    QStringList cmd(QStringList() << activeDevice << "list_signals_batch" << appName);
 
-        int index = 0;
-        while ( iterator.hasNext() ) {
+    // one object of each distinct type is enough, signals are a property of the type;
+    // QAction is skipped like in sendUpdateSignalsTableContent, signals tab never shows it
+    QMap<TestObjectKey, TreeItemInfo>::const_iterator iter;
+    for (iter = objectTreeData.constBegin(); iter != objectTreeData.constEnd(); ++iter) {
+        const TreeItemInfo &info = iter.value();
+        if (info.type == "sut" || info.type == "QAction" || !info.env.contains("qt")) continue;
 
-            iterator.next();
+        const QString typeKey = TDriverSignalsCache::typeKey(info.type, info.env);
+        if (signalsCache.contains(appName, typeKey) || signalsCache.isFailed(appName, typeKey)
+                || requestedKeys.contains(typeKey)) continue;
 
-            QString attributeName      = iterator.value().name;
-            QString attributeValue     = iterator.value().value;
-            QString attributeType      = iterator.value().type;
+        // capped, so that each batch delays on-demand requests of the same sut only a little
+        if (requestedKeys.size() >= signalsPrefetchBatchSize) break;
 
-            // Attribute name
-            QTableWidgetItem *attributeNameItem = new QTableWidgetItem( attributeName );
-            attributeNameItem->setFont( *defaultFont );
-            attributeNameItem->setFlags( Qt::ItemIsSelectable | Qt::ItemIsEnabled );
-            propertiesTable->setItem( index, 0, attributeNameItem );
+        requestedKeys.insert(typeKey);
+        cmd << info.id << info.type << info.env;
+    }
 
-            // Attribute value
-            QTableWidgetItem *attributeValueItem = new QTableWidgetItem( attributeValue );
-            attributeValueItem->setFont( *defaultFont );
+    if (requestedKeys.isEmpty()) return false;
 
-            // Attribute type - non writable attributes must not be accessible - "w" or "writable"
-            if ( !attributeType.contains( "w", Qt::CaseInsensitive ) ) {
+    qCDebug(logTree) << FCFL << "prefetching signals of" << requestedKeys.size() << "types";
+    return sendTDriverCommand(commandSignalPrefetch, cmd, "signal lists", appName);
+}
 
-                // make item selectabe & enabled for copying, but not editable
-                //Qt::ItemFlags newFlags = Qt::ItemIsSelectable | Qt::ItemIsEnabled;
-                attributeValueItem->setFlags( Qt::ItemIsSelectable | Qt::ItemIsEnabled );
 
-                // paint item gray
-                attributeValueItem->setBackground( QBrush( Qt::lightGray ) );
+void MainWindow::updateAttributesTableContent()
+{
+    // retrieve pointer of currently selected objectTree item
+    TestObjectKey currentItemPtr = ptr2TestObjectKey( objectTree->currentItem() );
 
-            }
+    if ( attributesMap.contains( currentItemPtr ) && objectTree->currentItem() != NULL ) {
 
-            propertiesTable->setItem( index, 1, attributeValueItem );
-            index++;
-        }
+        // model shares the attribute map, and only signals changed rows if object is the same as before
+        const TreeItemInfo &treeItemData = objectTreeData.value( currentItemPtr );
+        attributesModel->setAttributes( attributesMap.value( currentItemPtr ), treeItemData.id, treeItemData.type );
 
-        connect(propertiesTable, SIGNAL(itemChanged(QTableWidgetItem*)),
-                SLOT(changePropertiesTableValue(QTableWidgetItem*)) );
-        propertiesTable->update();
-        propertiesTable->resizeColumnsToContents();
+        // same text margins as used by item delegate on both sides
+        int margin = 2 * (propertiesTable->style()->pixelMetric( QStyle::PM_FocusFrameHMargin, 0, propertiesTable ) + 1);
+        propertiesTable->setColumnWidth( 0, attributesModel->nameColumnWidth( propertiesTable->fontMetrics() ) + margin );
+    }
+    else {
+        attributesModel->clear();
     }
     propertyTabLastTimeUpdated.insert( "attributes", currentItemPtr );
 }
@@ -358,8 +364,11 @@ void MainWindow::connectTabWidgetSignals()
     connect(methodsTable, SIGNAL(itemPressed(QTableWidgetItem*)),
             SLOT(methodItemPressed(QTableWidgetItem*)) );
 
-    connect(propertiesTable, SIGNAL(itemPressed(QTableWidgetItem*)),
-            SLOT(propertiesItemPressed(QTableWidgetItem*)) );
+    connect(propertiesTable, SIGNAL(pressed(QModelIndex)),
+            SLOT(propertiesItemPressed(QModelIndex)) );
+
+    connect(attributesModel, SIGNAL(attributeEditRequested(QString,QString)),
+            SLOT(changePropertiesTableValue(QString,QString)) );
 
 #if !DISABLE_API_TAB_PENDING_REMOVAL
     connect(apiTable, SIGNAL(itemPressed(QTableWidgetItem*)),
@@ -368,7 +377,7 @@ void MainWindow::connectTabWidgetSignals()
 }
 
 
-void MainWindow::changePropertiesTableValue( QTableWidgetItem *item )
+void MainWindow::changePropertiesTableValue( const QString &attributeName, const QString &value )
 {
     TestObjectKey currentItemPtr = ptr2TestObjectKey( objectTree->currentItem() );
     const TreeItemInfo &treeItemData = objectTreeData.value( currentItemPtr );
@@ -376,8 +385,6 @@ void MainWindow::changePropertiesTableValue( QTableWidgetItem *item )
     // this feature is not supported in with env != qt
     if (treeItemData.env.toLower() == "qt") {
 
-        QTableWidgetItem *currentItem = propertiesTable->item( propertiesTable->row( item ), 0 );
-        QString attributeName = currentItem->text();
         QString objRubyId = treeItemData.type;
 
         objRubyId.append('(');
@@ -397,7 +404,7 @@ void MainWindow::changePropertiesTableValue( QTableWidgetItem *item )
         } else {
             QStringList cmd(QStringList()
                             << activeDevice << "set_attribute"
-                            << objRubyId << targetDataType << attributeName << item->text());
+                            << objRubyId << targetDataType << attributeName << value);
 
             if (sendTDriverCommand(commandSetAttribute, cmd, tr("set attribute")) ) {
                 propertiesDock->setDisabled(true);
@@ -411,7 +418,7 @@ void MainWindow::changePropertiesTableValue( QTableWidgetItem *item )
         }
     }
     else {
-        qDebug() << FCFL << "tried to change non-qt property, fail";
+        qCWarning(logTree) << FCFL << "tried to change non-qt property, fail";
         QMessageBox::warning(this,
                              tr("Not Supported by Current Device"),
                              tr("Current device / SUT does not support changing attributes"));
@@ -429,13 +436,8 @@ void MainWindow::methodItemPressed( QTableWidgetItem * item ) {
             QString text(item->text());
             bool fullPath = isPathAction(action);
 
-            if (fullPath) {
-                QTreeWidgetItem * treeItem = objectTree->currentItem();
-                TestObjectKey sutItemPtr = ptr2TestObjectKey(objectTree->topLevelItem(0));
-                do {
-                    text = TDriverUtil::smartJoin(
-                                treeObjectRubyId(ptr2TestObjectKey(treeItem), sutItemPtr), '.', text);
-                } while (ptr2TestObjectKey(treeItem) != sutItemPtr && (treeItem = treeItem->parent()));
+            if (fullPath && objectTree->currentItem()) {
+                text = TDriverUtil::smartJoin(objectRubyPath(objectTree->currentItem(), true), '.', text);
             }
 
             switch (action) {
@@ -462,8 +464,10 @@ void MainWindow::methodItemPressed( QTableWidgetItem * item ) {
 
 
 // Handle (right) clicks on properties table: display context menu
-void MainWindow::propertiesItemPressed ( QTableWidgetItem * item )
+void MainWindow::propertiesItemPressed ( const QModelIndex &index )
 {
+    Q_UNUSED( index );
+
     if (QApplication::mouseButtons() == Qt::RightButton) {
 
         ContextMenuSelection action = showCopyAppendContextMenu();
@@ -476,7 +480,7 @@ void MainWindow::propertiesItemPressed ( QTableWidgetItem * item )
             QTreeWidgetItem * treeItem = objectTree->currentItem();
             QString objectType = treeItem->data( 0, Qt::DisplayRole ).toString();
 
-            QList<QTableWidgetItem *> selectedItems = item->tableWidget()->selectedItems();
+            QModelIndexList selectedItems = propertiesTable->selectionModel()->selectedIndexes();
 
             // combine object type and selected attribute rows into a TDriver ruby test object selection script
             QString objRubyId = objectType + "(";
@@ -486,10 +490,10 @@ void MainWindow::propertiesItemPressed ( QTableWidgetItem * item )
                 }
 
                 objRubyId += ":"
-                        + propertiesTable->item( selectedItems[ i ]->row(), 0 )->text()
+                        + attributesModel->attribute( selectedItems[ i ].row() ).name
                         + " => "
-                        + TDriverUtil::rubySingleQuote(propertiesTable->item( selectedItems[ i ]->row(), 1 )->text());
-                qDebug() << FCFL << objRubyId;
+                        + TDriverUtil::rubySingleQuote(attributesModel->attribute( selectedItems[ i ].row() ).value);
+                qCDebug(logTree) << FCFL << objRubyId;
             }
 
             objRubyId += ")";
@@ -517,7 +521,7 @@ void MainWindow::propertiesItemPressed ( QTableWidgetItem * item )
                 break;
 
             default:
-                qDebug() << FCFL << "Unhandled context menu action" << action;
+                qCDebug(logTree) << FCFL << "Unhandled context menu action" << action;
             }
         }
     }
@@ -19,6 +19,8 @@
 
 #include "tdriver_recorder.h"
 #include <tdriver_util.h>
+#include <tdriver_rbistatistics.h>
+#include <tdriver_rbidispatcher.h>
 
 #include <QtCore/QFile>
 
@@ -27,6 +29,8 @@
 #include <QProgressDialog>
 #include <QMessageBox>
 #include <QGridLayout>
+#include <QProgressBar>
+#include <QTimer>
 
 #include <QPlainTextEdit>
 
@@ -42,9 +46,18 @@
  */
 
 TDriverRecorder::TDriverRecorder( QWidget* parent ) :
-        QDialog( parent )
+        QDialog( parent ),
+        mPendingCommand( NoCommand ),
+        mPendingSeqNum( 0 ),
+        mPendingTimer( new QTimer( this ) )
 {
     setup();
+
+    mPendingTimer->setSingleShot( true );
+    connect( mPendingTimer, SIGNAL( timeout() ), this, SLOT( pendingTimeout() ) );
+
+    TDriverRbiDispatcher::globalInstance()->subscribe( TDriverUtil::visualizationId, this,
+                                                       SLOT( rbiMessage(TDriverRbiMessage) ) );
 }
 
 TDriverRecorder::~TDriverRecorder() {
@@ -84,12 +97,19 @@ void TDriverRecorder::setup() {
     QPushButton* close = new QPushButton( tr( "&Close" ) );
     close->setObjectName("recorder close");
 
+    // busy indicator while waiting for reply, dialog stays usable
+    mProgress = new QProgressBar;
+    mProgress->setObjectName("recorder progress");
+    mProgress->setRange( 0, 0 );
+    mProgress->setVisible( false );
+
     QHBoxLayout *layout = new QHBoxLayout;
     layout->setObjectName("recorder buttons");
 
     layout->addWidget( mRecButton );
     layout->addWidget( mStopButton );
     layout->addWidget( mTestButton );
+    layout->addWidget( mProgress );
     layout->addWidget( close );
 
     connect( mRecButton, SIGNAL( clicked() ), this, SLOT( startRecording() ) );
@@ -118,6 +138,75 @@ void TDriverRecorder::setActionsEnabled(bool start, bool stop, bool test)
 }
 
 
+bool TDriverRecorder::sendCommand( PendingCommand command, const BAListMap &msg, int timeout )
+{
+    quint32 seqNum = TDriverRubyInterface::globalInstance()->sendCmd( TDriverUtil::visualizationId, msg );
+    if ( seqNum == 0 ) {
+        return false;
+    }
+
+    mPendingCommand = command;
+    mPendingSeqNum = seqNum;
+    mPendingTimer->start( timeout );
+    mProgress->setVisible( true );
+    return true;
+}
+
+
+void TDriverRecorder::rbiMessage( const TDriverRbiMessage &message )
+{
+    if ( mPendingCommand == NoCommand || message.seqNum() != mPendingSeqNum ) {
+        return; // not for us
+    }
+
+    TDriverRbiStatistics::globalInstance()->messageHandled( message.seqNum() );
+
+    const BAListMap &reply = message.map();
+    if ( reply.contains( "error" ) && reply.value( "error" ).isEmpty() ) {
+        BAListMap errorReply( reply );
+        errorReply["error"] << "Unknown error";
+        finishCommand( false, errorReply );
+    }
+    else {
+        finishCommand( !reply.contains( "error" ), reply );
+    }
+}
+
+
+void TDriverRecorder::pendingTimeout()
+{
+    // reply arriving after this is ignored
+    BAListMap reply;
+    reply["error"] << "Error: Timeout waiting for TDriver interface script";
+    finishCommand( false, reply );
+}
+
+
+void TDriverRecorder::finishCommand( bool ok, const BAListMap &reply )
+{
+    PendingCommand command = mPendingCommand;
+
+    mPendingCommand = NoCommand;
+    mPendingSeqNum = 0;
+    mPendingTimer->stop();
+    mProgress->setVisible( false );
+
+    switch ( command ) {
+    case StartCommand:
+        recordingStarted( ok, reply );
+        break;
+    case StopCommand:
+        recordingStopped( ok, reply );
+        break;
+    case TestCommand:
+        recordingTested( ok, reply );
+        break;
+    case NoCommand:
+        break;
+    }
+}
+
+
 void TDriverRecorder::startRecording()
 {
     mScriptField->clear();
@@ -127,13 +216,23 @@ void TDriverRecorder::startRecording()
     msg["input"] << mStrActiveDevice.toLatin1() << "start_record" << mActiveApp.toLatin1();
 
     setActionsEnabled(false, false, false);
-    if (TDriverRubyInterface::globalInstance()->executeCmd(TDriverUtil::visualizationId, msg, 15000, "start_record")) {
+    if ( !sendCommand( StartCommand, msg, 15000 ) ) {
+        BAListMap reply;
+        reply["error"] << "Could not send command to TDriver interface script";
+        recordingStarted( false, reply );
+    }
+}
+
+
+void TDriverRecorder::recordingStarted( bool ok, const BAListMap &reply )
+{
+    if ( ok ) {
         qDebug("Recording started");
         setActionsEnabled(false, true, false);
     }
     else {
         qWarning("Recording start failed");
-        QMessageBox::critical(this, tr( "Can't start recording" ), msg.value("error").first());
+        QMessageBox::critical(this, tr( "Can't start recording" ), reply.value("error").value(0));
         setActionsEnabled(true, false, true);
     }
 }
@@ -145,11 +244,21 @@ void TDriverRecorder::stopRecording()
     msg["input"] << mStrActiveDevice.toLatin1() << "stop_record" << mActiveApp.toLatin1();
     setActionsEnabled(false, false, false);
 
-    if (TDriverRubyInterface::globalInstance()->executeCmd(TDriverUtil::visualizationId, msg, 30000, "stop_record")) {
+    if ( !sendCommand( StopCommand, msg, 30000 ) ) {
+        BAListMap reply;
+        reply["error"] << "Could not send command to TDriver interface script";
+        recordingStopped( false, reply );
+    }
+}
+
+
+void TDriverRecorder::recordingStopped( bool ok, const BAListMap &reply )
+{
+    if ( ok ) {
         mScriptField->clear();
         mScriptField->setEnabled( true );
 
-        lastRecordFileName = msg.value("record_filename").value(0);
+        lastRecordFileName = reply.value("record_filename").value(0);
         QFile data( lastRecordFileName );
 
         if ( data.open( QFile::ReadOnly ) ) {
@@ -174,7 +283,7 @@ void TDriverRecorder::stopRecording()
         QMessageBox::critical(this,
                               tr( "Can't stop recording" ),
                               tr( "Requesting tdriver_interact.rb termination after error:\n\n%1")
-                              .arg(QString::fromLatin1(msg.value("error").first() )));
+                              .arg(QString::fromLatin1(reply.value("error").value(0) )));
         qDebug("Recording stop failed, aborting anyway");
     }
     setActionsEnabled(true, false, true);
@@ -209,14 +318,22 @@ void TDriverRecorder::testRecording()
         BAListMap msg;
         msg["input"] << mStrActiveDevice.toLatin1() << "test_record" << file.fileName().toLocal8Bit();
         setActionsEnabled(false, false, false);
-        if (TDriverRubyInterface::globalInstance()->executeCmd(TDriverUtil::visualizationId, msg, 15000, "test_record")) {
-            QMessageBox::critical( this, tr( "Recording test ok" ), tr("Success"));
+        if ( !sendCommand( TestCommand, msg, 15000 ) ) {
+            BAListMap reply;
+            reply["error"] << "Could not send command to TDriver interface script";
+            recordingTested( false, reply );
         }
-        else {
-            QMessageBox::critical( this, tr( "Can't test recording" ), msg.value("error").first() );
-        }
-        setActionsEnabled(true, false, true);
     }
 }
 
 
+void TDriverRecorder::recordingTested( bool ok, const BAListMap &reply )
+{
+    if ( ok ) {
+        QMessageBox::critical( this, tr( "Recording test ok" ), tr("Success"));
+    }
+    else {
+        QMessageBox::critical( this, tr( "Can't test recording" ), reply.value("error").value(0) );
+    }
+    setActionsEnabled(true, false, true);
+}
@@ -42,8 +42,8 @@ void MainWindow::settingsSaveLayouts()
     }
     settings.endArray();
 
-    settings.setValue("view/startup_geometry", saveGeometry());
-    settings.setValue("view/startup_state", saveState());
+    settings.setValue(sessionSettingsKey("view/startup_geometry"), saveGeometry());
+    settings.setValue(sessionSettingsKey("view/startup_state"), saveState());
 
 }
 
@@ -149,8 +149,8 @@ void MainWindow::restoreALayout(QAction *layoutSetAction)
 void MainWindow::setStartupLayout()
 {
     QSettings settings;
-    QByteArray geom = settings.value("view/startup_geometry").toByteArray();
-    QByteArray state = settings.value("view/startup_state").toByteArray();
+    QByteArray geom = sessionSettingsValue(settings, "view/startup_geometry").toByteArray();
+    QByteArray state = sessionSettingsValue(settings, "view/startup_state").toByteArray();
     if (!state.isEmpty() && !geom.isEmpty()) {
         bool gOk = restoreGeometry(geom);
         bool sOk = restoreState(state);
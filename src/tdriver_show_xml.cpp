@@ -20,23 +20,45 @@
 
 
 #include "tdriver_main_window.h"
+#include "tdriver_xml_view.h"
 
 #include <QGridLayout>
-#include <QPlainTextEdit>
 
 void MainWindow::showXMLDialog() {
 
-    sourceEdit->setPlainText( xmlDocument.toString() );
-
     xmlView->show();
     xmlView->activateWindow();
 
+    if ( xmlSourceView->isEmpty() ) {
+        updateXmlSourceView();
+    } else {
+        xmlSourceView->showObject( objectTreeData.value( ptr2TestObjectKey( objectTree->currentItem() ) ).id );
+    }
+
     if ( xmlViewPos != QPoint( -1, -1 ) ) { xmlView->move( xmlViewPos ); }
 
     findStringComboBox->setFocus();
 
 }
 
+// Loads current ui dump to Show XML, or releases previous dump while the dialog is hidden,
+// so that dumps are not read for nothing on every refresh.
+void MainWindow::updateXmlSourceView() {
+
+    if ( !xmlView->isVisible() ) {
+        xmlSourceView->clear();
+        return;
+    }
+
+    // after subtree refresh or snapshot restore the dump file does not match xmlDocument
+    if ( uiDumpFileName.isEmpty() || uiDumpFileStale || !xmlSourceView->setFile( uiDumpFileName ) ) {
+        xmlSourceView->setData( xmlDocument.toByteArray( -1 ) );
+    }
+
+    xmlSourceView->showObject( objectTreeData.value( ptr2TestObjectKey( objectTree->currentItem() ) ).id );
+
+}
+
 // This function just shows the xml file, that has been loaded into memory, in a new window.
 void MainWindow::createXMLFileDataWindow() {
 
@@ -59,11 +81,10 @@ void MainWindow::createXMLFileDataWindow() {
     QGridLayout* gridLayout = new QGridLayout( xmlBox );
     gridLayout->setObjectName("xmlview edit");
 
-    sourceEdit = new QPlainTextEdit;
-    sourceEdit->setObjectName("xmlview edit");
-    sourceEdit->setTextInteractionFlags( Qt::TextSelectableByMouse | Qt::TextSelectableByKeyboard );
+    xmlSourceView = new TDriverXmlView;
+    xmlSourceView->setObjectName("xmlview edit");
 
-    gridLayout->addWidget( sourceEdit );
+    gridLayout->addWidget( xmlSourceView );
 
     layout->addWidget( xmlBox );
 
@@ -142,69 +163,25 @@ void MainWindow::findStringFromXml() {
 
     //qDebug() << "findStringFromXml";
 
-    bool found = false;
-    bool result = false;
-
-    int retry = 0;
+    const QString text = findStringComboBox->currentText();
 
     // do not perform search with empty string...
-    if ( findStringComboBox->currentText().isEmpty() ) { return; }
-
-    QTextCursor beginPos = sourceEdit->textCursor();
-
-    while ( !result )  {
-
-        QTextCursor cursorPos = sourceEdit->textCursor();
-
-        QTextDocument::FindFlags flags;
-
-        if ( showXmlBackwards->isChecked() )       { flags = flags | QTextDocument::FindBackward; }
-        if ( showXmlMatchCase->isChecked() )       { flags = flags | QTextDocument::FindCaseSensitively; }
-        if ( showXmlMatchEntireWord->isChecked() ) { flags = flags | QTextDocument::FindWholeWords; }
-
-        found = sourceEdit->find ( findStringComboBox->currentText(), flags );
-
-        if ( found )  {
-
-            if ( cursorPos == sourceEdit->textCursor() && showXmlWrapAround->isChecked() ) {
-
-                //qDebug() << "cursor didn't move, move to top";
-                sourceEdit->moveCursor( showXmlBackwards->isChecked() ? QTextCursor::End : QTextCursor::Start );
-
-            } else {
-                result = true;
-            }
-
-        } else {
-
-            // not found, wrap if checkbox enabled
-            if ( retry == 0 && showXmlWrapAround->isChecked() ) {
-
-                sourceEdit->moveCursor( showXmlBackwards->isChecked() ? QTextCursor::End : QTextCursor::Start );
-
-                retry++;
-
-            } else {
-
-                // no matches found, check if text already selected? if not, show warning popup
-                if ( !sourceEdit->textCursor()
-                        .selectedText()
-                        .contains(findStringComboBox->currentText(),
-                                  showXmlMatchCase->isChecked() ? Qt::CaseSensitive : Qt::CaseInsensitive ) ) {
-
-                    sourceEdit->setTextCursor( beginPos );
-
-                    QMessageBox::warning(
-                                this,
-                                tr("Find"),
-                                tr("No matches found with '%1'").arg(findStringComboBox->currentText()));
+    if ( text.isEmpty() ) { return; }
 
+    bool found = xmlSourceView->find( text,
+                                      showXmlMatchCase->isChecked(),
+                                      showXmlMatchEntireWord->isChecked(),
+                                      showXmlBackwards->isChecked(),
+                                      showXmlWrapAround->isChecked() );
 
-                }
+    // no matches found, check if text already selected? if not, show warning popup
+    if ( !found && !xmlSourceView->selectedText().contains(
+             text, showXmlMatchCase->isChecked() ? Qt::CaseSensitive : Qt::CaseInsensitive ) ) {
 
-                break;
-            }
-        }
+        QMessageBox::warning(
+                    this,
+                    tr("Find"),
+                    tr("No matches found with '%1'").arg(text));
 
     }
 
@@ -216,6 +193,7 @@ void MainWindow::closeXmlDialog() {
     xmlViewPos = xmlView->pos();
 
     xmlView->close();
+    xmlSourceView->clear();
 
 }
 
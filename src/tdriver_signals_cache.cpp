@@ -0,0 +1,142 @@
+/***************************************************************************
+**
+** Copyright (C) 2010 Nokia Corporation and/or its subsidiary(-ies).
+** All rights reserved.
+** Contact: Nokia Corporation (testabilitydriver@nokia.com)
+**
+** This file is part of Testability Driver.
+**
+** If you have questions regarding the use of this file, please contact
+** Nokia at testabilitydriver@nokia.com .
+**
+** This library is free software; you can redistribute it and/or
+** modify it under the terms of the GNU Lesser General Public
+** License version 2.1 as published by the Free Software Foundation
+** and appearing in the file LICENSE.LGPL included in the packaging
+** of this file.
+**
+****************************************************************************/
+
+#include "tdriver_signals_cache.h"
+
+#include <QIODevice>
+#include <QXmlStreamReader>
+
+
+bool TDriverSignalsCache::contains( const QString &appName, const QString &typeKey ) const
+{
+    return lists.value( appName ).contains( typeKey );
+}
+
+
+QStringList TDriverSignalsCache::value( const QString &appName, const QString &typeKey ) const
+{
+    return lists.value( appName ).value( typeKey );
+}
+
+
+void TDriverSignalsCache::insert( const QString &appName, const QString &appId, const QString &typeKey, const QStringList &signalsList )
+{
+    if ( appName.isEmpty() ) return;
+
+    setAppId( appName, appId );
+    lists[ appName ].insert( typeKey, signalsList );
+    if ( failed.contains( appName ) ) failed[ appName ].remove( typeKey );
+}
+
+
+void TDriverSignalsCache::insertFailed( const QString &appName, const QString &appId, const QString &typeKey )
+{
+    if ( appName.isEmpty() ) return;
+
+    setAppId( appName, appId );
+    failed[ appName ].insert( typeKey );
+}
+
+
+bool TDriverSignalsCache::isFailed( const QString &appName, const QString &typeKey ) const
+{
+    return failed.value( appName ).contains( typeKey );
+}
+
+
+void TDriverSignalsCache::setAppId( const QString &appName, const QString &appId )
+{
+    // lists of previous process are dropped already by invalidate, unless application list was not refreshed
+    if ( appIds.value( appName, appId ) != appId ) {
+        lists.remove( appName );
+        failed.remove( appName );
+    }
+    appIds.insert( appName, appId );
+}
+
+
+// signal list xml of each type is in a type element, see get_signals_batch_xml in tdriver_interface.rb;
+// type element with error attribute has no signal list
+int TDriverSignalsCache::parseBatchXml( QIODevice *device, const QString &appName, const QString &appId, QString *errorString )
+{
+    QXmlStreamReader reader( device );
+    QString typeKey;
+    QStringList signalsList;
+    bool inType = false;
+    bool typeFailed = false;
+    int typeCount = 0;
+
+    while ( !reader.atEnd() ) {
+        reader.readNext();
+
+        if ( reader.isStartElement() ) {
+            if ( reader.name() == QLatin1String( "type" ) ) {
+                const QXmlStreamAttributes attributes = reader.attributes();
+                typeKey = TDriverSignalsCache::typeKey( attributes.value( "name" ).toString(), attributes.value( "env" ).toString() );
+                typeFailed = attributes.hasAttribute( "error" );
+                signalsList.clear();
+                inType = true;
+            }
+            else if ( inType && ( reader.name() == QLatin1String( "obj" ) || reader.name() == QLatin1String( "object" ) ) ) {
+                signalsList.append( reader.attributes().value( "name" ).toString() );
+            }
+        }
+        else if ( inType && reader.isEndElement() && reader.name() == QLatin1String( "type" ) ) {
+            if ( typeFailed ) {
+                insertFailed( appName, appId, typeKey );
+            }
+            else {
+                insert( appName, appId, typeKey, signalsList );
+                ++typeCount;
+            }
+            inType = false;
+        }
+    }
+
+    if ( reader.hasError() ) {
+        if ( errorString ) {
+            *errorString = QString( "%1 at line %2" ).arg( reader.errorString() ).arg( reader.lineNumber() );
+        }
+        return -1;
+    }
+    return typeCount;
+}
+
+
+void TDriverSignalsCache::invalidate( const QMap<QString, QString> &applications )
+{
+    // application id changes when application is restarted, and signals may then differ
+    QMutableHashIterator<QString, QString> iter( appIds );
+    while ( iter.hasNext() ) {
+        iter.next();
+        if ( applications.value( iter.value() ) != iter.key() ) {
+            lists.remove( iter.key() );
+            failed.remove( iter.key() );
+            iter.remove();
+        }
+    }
+}
+
+
+void TDriverSignalsCache::clear()
+{
+    lists.clear();
+    failed.clear();
+    appIds.clear();
+}
@@ -40,18 +40,14 @@ void MainWindow::closeStartAppDialog() {
 void MainWindow::startApp(){
     QString app_name = startAppDialogTextLineEdit->text();
     QString app_arguments = ( startAppDialogWithTestability->isChecked() ) ? "-testability" : "";
-    QString cmd = activeDevice + " start_application " + app_name + " " + app_arguments;
 
-    //qDebug() << "Executing app" + cmd;
+    //qDebug() << "Executing app" << app_name << app_arguments;
 
-    if ( !executeTDriverCommand( commandStartApplication, cmd)) {
-        statusbar(tr("Error: Failed to start application."), 1000 );
-        disconnectExclusiveSUT();
-    }
-    else {
-        startAppDialog->hide();
-        statusbar(tr("Applicaton started, refreshing..."), 1000 );
-        sendAppListRequest(true);
+    // result is handled in receiveTDriverMessage
+    if (sendTDriverCommand(commandStartApplication,
+                           QStringList() << activeDevice << "start_application" << app_name << app_arguments,
+                           tr("start application"))) {
+        statusbar(tr("Starting application..."));
     }
     startAppDialog->close();
 }
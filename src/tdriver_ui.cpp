@@ -28,6 +28,7 @@
 #include "tdriver_featureditor.h"
 
 #include <QUrl>
+#include <QLabel>
 #include <QScrollArea>
 #include <QToolBar>
 
@@ -120,6 +121,7 @@ void MainWindow::createUi()
     createImageViewDockWidget();
     createTreeViewDockWidget();
     createPropertiesDockWidget();
+    createDiagnosticsDockWidget();
     createTopMenuBar();
     createAppsBar();
     createShortcutsBar();
@@ -136,6 +138,28 @@ void MainWindow::createUi()
 
     // layout of main window: add objecttree to central and set it, add menubar as menu
     statusBar()->setObjectName("main");
+
+    // busy indicator instead of modal boxes, while waiting for replies from tdriver_interface.rb
+    pendingCommandsProgress = new QProgressBar;
+    pendingCommandsProgress->setObjectName("pending commands");
+    pendingCommandsProgress->setRange(0, 0);
+    pendingCommandsProgress->setMaximumWidth(100);
+    pendingCommandsProgress->setVisible(false);
+    statusBar()->addPermanentWidget(pendingCommandsProgress);
+
+    // progress of reading ui dump into object tree, which may take a while for large applications
+    uiDumpProgress = new QProgressBar;
+    uiDumpProgress->setObjectName("ui dump");
+    uiDumpProgress->setMaximumWidth(250);
+    uiDumpProgress->setVisible(false);
+    statusBar()->addPermanentWidget(uiDumpProgress);
+
+    // age of cached application snapshot, visible until refresh replaces it
+    appSnapshotLabel = new QLabel;
+    appSnapshotLabel->setObjectName("app snapshot");
+    appSnapshotLabel->setVisible(false);
+    statusBar()->addPermanentWidget(appSnapshotLabel);
+
     setCentralWidget( objectTree );
     setMenuBar( menubar );
 
@@ -258,14 +282,17 @@ void MainWindow::createPropertiesDockWidgetPropertiesTabWidget() {
     propertiesLayout->setObjectName("properties attributes");
     propertiesTab->setLayout(propertiesLayout);
 
-    propertiesTable = new QTableWidget(propertiesTab);
+    attributesModel = new TDriverAttributesModel(this);
+    attributesModel->setObjectName("properties attributes");
+    attributesModel->setFont( *defaultFont );
+
+    propertiesTable = new QTableView(propertiesTab);
     propertiesTable->setObjectName("properties attributes");
+    propertiesTable->setModel(attributesModel);
+    // name column width is cached by the model, values get the rest
+    propertiesTable->horizontalHeader()->setStretchLastSection(true);
 
     propertiesLayout->addWidget(propertiesTable);
-    propertiesTable->clear();
-    propertiesTable->setColumnCount(2);
-    //    propertiesTable->setFont( *defaultFont );
-    setupTableWidgetHeader( "Name|Value", propertiesTable );
 
     tabWidget->addTab(propertiesTab, QString());
 
@@ -353,7 +380,7 @@ void MainWindow::createPropertiesDockWidgetApiTabWidget()
 void MainWindow::createImageViewDockWidget()
 {
     // image resize setting
-    bool resizeSetting = QSettings().value( "image/resize", true ).toBool();
+    bool resizeSetting = sessionSettingsValue( QSettings(), "image/resize", true ).toBool();
 
     // Add imagewidged and resize checkbox
     imageViewDock = new QDockWidget( tr(" Image View "), this );
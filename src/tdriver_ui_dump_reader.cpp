@@ -0,0 +1,297 @@
+/***************************************************************************
+**
+** Copyright (C) 2010 Nokia Corporation and/or its subsidiary(-ies).
+** All rights reserved.
+** Contact: Nokia Corporation (testabilitydriver@nokia.com)
+**
+** This file is part of Testability Driver.
+**
+** If you have questions regarding the use of this file, please contact
+** Nokia at testabilitydriver@nokia.com .
+**
+** This library is free software; you can redistribute it and/or
+** modify it under the terms of the GNU Lesser General Public
+** License version 2.1 as published by the Free Software Foundation
+** and appearing in the file LICENSE.LGPL included in the packaging
+** of this file.
+**
+****************************************************************************/
+
+#include "tdriver_main_window.h"
+
+#include <tdriver_debug_macros.h>
+
+#include <QElapsedTimer>
+#include <QFile>
+#include <QXmlStreamReader>
+
+#include <limits.h>
+
+
+// bytes read at a time, and interval of painting tree and progress while reading
+static const int uiDumpChunkSize = 64 * 1024;
+static const int uiDumpPaintInterval = 100;
+
+
+// open element of ui dump, with tree item whose attributes and children it contains,
+// or NULL for elements which object tree does not look into
+struct UiDumpLevel {
+    QDomElement element;
+    QTreeWidgetItem *item;
+};
+
+
+// Reads ui dump into object tree and xmlDocument in one pass, a chunk at a time.
+// Items are added as their start tags are read, and tree and progress are painted
+// between chunks, so top of a large tree is shown while the rest is still read.
+// Returns false on error, and also when object tree was cleared while painting.
+bool MainWindow::readUiDump( const QString &filename, QTreeWidgetItem *&sutItem )
+{
+    sutItem = NULL;
+
+    QFile file( filename );
+    if ( !file.open( QIODevice::ReadOnly ) ) {
+        qCWarning(logTree) << FCFL << filename << "open error";
+        QMessageBox::critical( this, tr( "XML Error" ), tr( "Cannot open XML file %1" ).arg( filename ) );
+        return false;
+    }
+
+    const int generation = objectTreeGeneration;
+    const qint64 totalBytes = file.size();
+    qint64 readBytes = 0;
+    int objectCount = 0;
+
+    QDomDocument document;
+    QList<UiDumpLevel> levels;
+    bool newFormat = false;
+
+    QXmlStreamReader reader;
+    reader.setNamespaceProcessing( false );
+
+    uiDumpReading = true;
+    uiDumpProgress->setRange( 0, int( qMin<qint64>( totalBytes / 1024 + 1, INT_MAX ) ) );
+    uiDumpProgress->setValue( 0 );
+    QElapsedTimer paintTimer;
+    paintTimer.start();
+
+    forever {
+        const QXmlStreamReader::TokenType token = reader.readNext();
+
+        if ( token == QXmlStreamReader::Invalid ) {
+            if ( reader.error() != QXmlStreamReader::PrematureEndOfDocumentError || file.atEnd() ) break;
+
+            const QByteArray chunk = file.read( uiDumpChunkSize );
+            readBytes += chunk.size();
+            reader.addData( chunk );
+
+            if ( paintTimer.hasExpired( uiDumpPaintInterval ) ) {
+                uiDumpProgress->setValue( int( qMin<qint64>( readBytes / 1024, INT_MAX ) ) );
+                uiDumpProgress->setFormat( tr( "%1 of %2 KiB, %3 objects" )
+                                           .arg( readBytes / 1024 ).arg( totalBytes / 1024 ).arg( objectCount ) );
+                uiDumpProgress->setVisible( true );
+
+                // user input waits, it could act on a partial tree
+                qApp->processEvents( QEventLoop::ExcludeUserInputEvents );
+                if ( generation != objectTreeGeneration ) {
+                    qCDebug(logTree) << FCFL << "object tree cleared while reading" << filename;
+                    uiDumpReading = false;
+                    uiDumpProgress->setVisible( false );
+                    return false;
+                }
+                paintTimer.restart();
+            }
+            continue;
+        }
+
+        if ( token == QXmlStreamReader::EndDocument ) break;
+
+        QDomNode parentNode = levels.isEmpty() ? QDomNode( document ) : QDomNode( levels.last().element );
+
+        switch ( token ) {
+
+        case QXmlStreamReader::StartElement: {
+            QDomElement element = document.createElement( reader.qualifiedName().toString() );
+            foreach ( const QXmlStreamAttribute &attribute, reader.attributes() ) {
+                element.setAttribute( attribute.qualifiedName().toString(), attribute.value().toString() );
+            }
+            parentNode.appendChild( element );
+
+            // same elements as buildObjectTree and buildObjectTree_new_format look into
+            QTreeWidgetItem *parentItem = levels.isEmpty() ? NULL : levels.last().item;
+            QTreeWidgetItem *item = NULL;
+            const QString name = element.tagName();
+
+            if ( levels.isEmpty() ) {
+                // determine whether to use new xml structure or not... (new == 1.3+)
+                newFormat = checkVersion( element.attribute( "version" ), "1.3" );
+            }
+            else if ( levels.size() == 1 && name == "tasInfo" ) {
+                if ( sutItem ) {
+                    qWarning( "%s:%i: Duplicate tasInfo element, ignoring remaining XML!", __FILE__, __LINE__ );
+                }
+                else {
+                    item = sutItem = createSutItem( element );
+                }
+            }
+            else if ( parentItem ) {
+                if ( name == ( newFormat ? "obj" : "object" ) ) {
+                    item = addUiDumpObject( parentItem, element );
+                    ++objectCount;
+                }
+                else if ( !newFormat && ( name == "attributes" || name == "objects" ) ) {
+                    item = parentItem;
+                }
+            }
+
+            UiDumpLevel level = { element, item };
+            levels.append( level );
+            break;
+        }
+
+        case QXmlStreamReader::EndElement: {
+            const UiDumpLevel level = levels.takeLast();
+            QTreeWidgetItem *parentItem = levels.isEmpty() ? NULL : levels.last().item;
+            const QString name = level.element.tagName();
+
+            // attribute value is complete only at its end tag
+            if ( parentItem && name == ( newFormat ? "attr" : "attribute" ) ) {
+                const QDomElement &element = level.element;
+                AttributeInfo attributeData = {
+                    element.attribute( "name" ),
+                    element.attribute( newFormat ? "type" : "dataType" ),
+                    element.attribute( newFormat ? "access" : "type" ),
+                    newFormat ? element.text() : element.elementsByTagName( "value" ).item( 0 ).toElement().text() };
+
+                attributesMap[ptr2TestObjectKey( parentItem )][attributeData.name.toLower()] = attributeData;
+            }
+            break;
+        }
+
+        case QXmlStreamReader::Characters:
+            // like QDomDocument::setContent, whitespace only text is not kept
+            if ( !reader.isWhitespace() ) {
+                parentNode.appendChild( reader.isCDATA()
+                                        ? QDomNode( document.createCDATASection( reader.text().toString() ) )
+                                        : QDomNode( document.createTextNode( reader.text().toString() ) ) );
+            }
+            break;
+
+        case QXmlStreamReader::Comment:
+            parentNode.appendChild( document.createComment( reader.text().toString() ) );
+            break;
+
+        case QXmlStreamReader::ProcessingInstruction:
+            parentNode.appendChild( document.createProcessingInstruction( reader.processingInstructionTarget().toString(),
+                                                                          reader.processingInstructionData().toString() ) );
+            break;
+
+        default:
+            break;
+        }
+    }
+
+    uiDumpReading = false;
+    uiDumpProgress->setVisible( false );
+
+    if ( reader.hasError() ) {
+        qCWarning(logTree) << FCFL << filename << 'l' << reader.lineNumber() << 'c' << reader.columnNumber() << ':' << reader.errorString();
+        QMessageBox::critical(
+                this,
+                tr( "XML Error" ),
+                tr( "XML parse error in file %1 line %2 column %3:\n\n%4" )
+                    .arg( filename )
+                    .arg( reader.lineNumber() )
+                    .arg( reader.columnNumber() )
+                    .arg( reader.errorString() )
+                );
+        return false;
+    }
+
+    qCDebug(logTree) << FCFL << filename << readBytes << "bytes" << objectCount << "objects";
+    xmlDocument = document;
+    return true;
+}
+
+
+QTreeWidgetItem *MainWindow::createSutItem( const QDomElement &element )
+{
+    QTreeWidgetItem *sutItem = new QTreeWidgetItem(0);
+    QString sutId = element.attribute( "id" );
+
+    TreeItemInfo treeItemData = {
+        QString("sut"),
+        element.attribute("name"),
+        element.attribute("id"),
+        element.attribute("env") };
+
+    if (treeItemData.name != activeDevice) {
+        qCDebug(logTree) << FCFL << "device/sut name mismatch:" << activeDevice << treeItemData.name;
+    }
+
+    // add sut to the top of the object tree
+    sutItem->setData( 0, Qt::DisplayRole, QString("sut") );
+    sutItem->setData( 1, Qt::DisplayRole, treeItemData.name );
+    sutItem->setData( 2, Qt::DisplayRole, sutId );
+
+    sutItem->setForeground( 0, QColor(Qt::darkCyan).darker(180) );
+    sutItem->setForeground( 1, QColor(Qt::darkGreen) );
+    sutItem->setForeground( 2, QColor(Qt::darkYellow) );
+
+    sutItem->setFont( 0, *defaultFont );
+    sutItem->setFont( 1, *defaultFont );
+    sutItem->setFont( 2, *defaultFont );
+
+    objectTree->addTopLevelItem ( sutItem );
+    objectIdMap.insert(sutId, ptr2TestObjectKey(sutItem));
+
+    // store object tree data
+    objectTreeData.insert( ptr2TestObjectKey( sutItem ), treeItemData );
+    return sutItem;
+}
+
+
+QTreeWidgetItem *MainWindow::addUiDumpObject( QTreeWidgetItem *parentItem, const QDomElement &element )
+{
+    TreeItemInfo data = {
+        element.attribute( "type" ),
+        element.attribute( "name" ),
+        element.attribute( "id" ),
+        element.attribute( "env" ) };
+
+    // store id of current application ui dump
+    if ( data.type.compare("application", Qt::CaseInsensitive )==0 ) {
+        qCDebug(logTree) << FCFL << "got application id" << data.id << "name" << data.name;
+        currentApplication.set(data.id, data.name);
+    }
+
+    // duplicate names are known only when whole dump has been read
+    QTreeWidgetItem *item = createObjectTreeItem( parentItem, data, QMap<QString, QStringList>() );
+    storeItemToObjectTreeMap( item, data );
+    return item;
+}
+
+
+// marks objects whose name is not unique, after the whole tree has been read
+void MainWindow::markDuplicateObjectNames( QTreeWidgetItem *sutItem )
+{
+    const TestObjectKey sutKey = ptr2TestObjectKey( sutItem );
+
+    QList<QMap<QString, QString> > objectNamesList;
+    QMap<TestObjectKey, TreeItemInfo>::const_iterator it;
+    for (it = objectTreeData.constBegin(); it != objectTreeData.constEnd(); ++it) {
+        if (it.key() == sutKey || it.value().name.isEmpty()) continue;
+        QMap<QString, QString> nameAndId;
+        nameAndId.insert( "name", it.value().name );
+        nameAndId.insert( "id", it.value().id );
+        objectNamesList << nameAndId;
+    }
+
+    const QMap<QString, QStringList> duplicateItems = findDuplicateObjectNames( objectNamesList );
+    if (duplicateItems.isEmpty()) return;
+
+    for (it = objectTreeData.constBegin(); it != objectTreeData.constEnd(); ++it) {
+        if (it.key() != sutKey && duplicateItems.contains( it.value().name )) {
+            setObjectTreeItemColumns( testObjectKey2Ptr( it.key() ), it.value(), duplicateItems );
+        }
+    }
+}
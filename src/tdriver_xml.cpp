@@ -20,10 +20,15 @@
 
 
 #include "tdriver_main_window.h"
+#include <tdriver_rubyinterface.h>
 #include <tdriver_debug_macros.h>
 
 #include <QToolBar>
 #include <QMenu>
+#include <QCryptographicHash>
+#include <QDir>
+#include <QSaveFile>
+#include <QStandardPaths>
 
 #include <QDebug>
 
@@ -41,7 +46,7 @@ bool MainWindow::sendUpdateBehaviourXml()
 
         QString objectType = objectTreeData.value(ptr2TestObjectKey(node)).type;
 
-        if ( !objectTypes.contains( objectType ) && !behavioursMap.contains( objectType ) ) {
+        if ( !objectTypes.contains( objectType ) && !behaviours.contains( objectType ) ) {
             objectTypes << objectType;
         }
     }
@@ -59,103 +64,102 @@ bool MainWindow::sendUpdateBehaviourXml()
 
     propertyTabLastTimeUpdated.insert( "methods", 0 );
 
+    // all types found from behaviours cache, so no need to ask tdriver_interface.rb
+    if ( objectTypes.isEmpty() ) {
+        qCDebug(logTree) << FCFL << "all behaviours known";
+        doPropertiesTableUpdate();
+        propertiesDock->setDisabled(false);
+        return true;
+    }
+
     QStringList cmd;
     cmd << activeDevice << "get_behaviours" << objectType;
-    qDebug() << FCFL << cmd;
+    qCDebug(logTree) << FCFL << cmd;
 
     return sendTDriverCommand(commandBehavioursXml, cmd, tr("behaviour get"), objectType);
 }
 
 
-void MainWindow::buildBehavioursMap() {
-
-    // qDebug() << "buildBehavioursMap()";
-
-    // behavioursMap.clear();
-
-    QDomNodeList nodeList = behaviorDomDocument.documentElement().elementsByTagName( "behaviour" );
-
-    for ( int behaviourIndex = 0; behaviourIndex < nodeList.size(); behaviourIndex++ ) {
-
-        QDomNode node = nodeList.item( behaviourIndex );
-
-        if ( node.isElement() ) {
-
-            /*
-<?xml version="1.0"?>
-<behaviours>
-<behaviour object_type="sut">
-<object_method name="kill_started_processes">
-        <description>Kills all of the application processed started through the server.</description>
-        <example>kill_started_processes</example>
-      </object_method><object_method name="list_apps">
-        <description>Lists all applications known to server running on SUT.</description>
-        <example>list_apps</example>
-
-
-*/
-            // retrieve element from node
-            QDomElement domElement = node.toElement();
-
-            // retrieve target object name
-            QString targetObject       = domElement.attribute( "object_type" );
-
-            // retrieve object methods
-            QDomNodeList methodsNodeList = domElement.elementsByTagName( "object_method" );
+static QString behavioursCacheFileName( const QString &key )
+{
+    return QStandardPaths::writableLocation(QStandardPaths::CacheLocation)
+            + "/behaviours_"
+            + QCryptographicHash::hash(key.toUtf8(), QCryptographicHash::Md5).toHex()
+            + ".bin";
+}
 
-            //qDebug() << "target object: " << targetObject;
 
-            Behaviour behaviour;
+// behaviours only change with cuTeDriver installation and sut type, empty if either is not known
+QString MainWindow::currentBehavioursCacheKey()
+{
+    QString version = TDriverRubyInterface::globalInstance()->getTDriverVersion();
+    QString sutType = activeDeviceParams.value( "type" );
 
-            // retrieve method from behaviours list if one already exists
-            if ( behavioursMap.contains( targetObject ) ) {
-                behaviour = behavioursMap.value( targetObject );
-            }
+    if ( offlineMode || version.isEmpty() || sutType.isEmpty() ) return QString();
+    return version + '|' + sutType;
+}
 
-            for ( int methodIndex = 0; methodIndex < methodsNodeList.size(); methodIndex++ ) {
 
-                QDomElement methodElement = methodsNodeList.item( methodIndex ).toElement();
-                QString methodName = methodElement.attribute( "name" );
-/*
-                QString methodDescription("");
-                QXmlStreamReader xmlReader(methodElement.elementsByTagName( "description" ).item( 0 ).toElement().text());
-                while (!xmlReader.atEnd()) {
-                    if ( xmlReader.readNext() == QXmlStreamReader::Characters ) {
-                        methodDescription += xmlReader.text();
-                    }
-                }
-                QString methodExample("");
-                xmlReader.clear();
-                xmlReader.addData(methodElement.elementsByTagName( "example" ).item( 0 ).toElement().text());
-                while (!xmlReader.atEnd()) {
-                    if ( xmlReader.readNext() == QXmlStreamReader::Characters ) {
-                        methodExample += xmlReader.text();
-                    }
-                }
-                //qDebug() << methodName << methodDescription << methodExample;
-                QMap<QString, QString> methodDetails;
-                methodDetails.insert( "description", methodDescription );
-                methodDetails.insert( "example", methodExample );
-*/
-                //QString methodDescription = methodElement.elementsByTagName( "description" ).item( 0 ).toElement().text();
-                //QString methodExample = methodElement.elementsByTagName( "example" ).item( 0 ).toElement().text();
-                //qDebug() << methodName << methodDescription << methodExample;
+void MainWindow::loadBehavioursCache()
+{
+    const QString key = currentBehavioursCacheKey();
+    if ( key == behavioursCacheKey ) return;
+    behavioursCacheKey = key;
+    if ( key.isEmpty() ) return;
+
+    QFile file( behavioursCacheFileName( key ) );
+    if ( !file.open( QIODevice::ReadOnly ) ) {
+        qCDebug(logTree) << FCFL << "no behaviours cache for" << key;
+        return;
+    }
 
-                QMap<QString, QString> methodDetails;
+    // behaviours received before cache was loaded are kept
+    QString errorString;
+    if ( !behaviours.readCache( &file, key, &errorString ) ) {
+        qWarning() << FCFL << "ignoring behaviours cache" << file.fileName() << errorString;
+        return;
+    }
+    qCDebug(logTree) << FCFL << "loaded" << behaviours.objectTypes().size() << "behaviours for" << key;
+}
 
-                methodDetails.insert("description", methodElement.elementsByTagName( "description" ).item( 0 ).toElement().text() );
-                methodDetails.insert("example", methodElement.elementsByTagName( "example" ).item( 0 ).toElement().text() );
-                behaviour.addMethod( methodName, methodDetails );
 
-            }
+void MainWindow::saveBehavioursCache()
+{
+    // behaviours may still be those of previous device type
+    const QString key = currentBehavioursCacheKey();
+    if ( key.isEmpty() || key != behavioursCacheKey ) return;
+
+    QDir().mkpath( QStandardPaths::writableLocation(QStandardPaths::CacheLocation) );
+    QSaveFile file( behavioursCacheFileName( key ) );
+    if ( !file.open( QIODevice::WriteOnly ) ) {
+        qWarning() << FCFL << "failed to write behaviours cache" << file.fileName() << file.errorString();
+        return;
+    }
 
-            behavioursMap.insert( targetObject, behaviour );
+    if ( !behaviours.writeCache( &file, key ) || !file.commit() ) {
+        qWarning() << FCFL << "failed to write behaviours cache" << file.fileName();
+    }
+}
 
-        }
 
+bool MainWindow::buildBehavioursMap( const QString &fileName )
+{
+    QFile file( fileName );
+    if ( !file.open( QIODevice::ReadOnly ) ) {
+        qWarning() << FCFL << "cannot open behaviours file" << fileName << file.errorString();
+        return false;
+    }
 
+    QString errorString;
+    bool ok = behaviours.parseXml( &file, &errorString );
+    if ( !ok ) {
+        qWarning() << FCFL << "behaviours xml error" << errorString << "in" << fileName;
     }
 
+    qCDebug(logTree) << FCFL << behaviours.objectTypes().size() << "types share"
+                     << behaviours.tableCount() << "method tables of"
+                     << behaviours.methodCount() << "methods";
+    return ok;
 }
 
 void MainWindow::updateApplicationsList()
@@ -254,7 +258,7 @@ void MainWindow::updateApplicationsList()
     }
 
     else {
-        qDebug() << FCFL << "currentApplication remains foreground application.";
+        qCDebug(logTree) << FCFL << "currentApplication remains foreground application.";
     }
 
     updateWindowTitle();
@@ -284,54 +288,60 @@ void MainWindow::parseApiMethodsXml( QString filename ) {
 
     if ( parseXml( filename, apiDocument ) ) {
 
-        QMap<QString, QHash<QString, QString> > methodMap;
+        // batch reply has tasInfo of each class
+        QDomNodeList infoNodes = apiDocument.documentElement().elementsByTagName( "tasInfo" );
 
-        QDomElement infoElement = apiDocument.documentElement().elementsByTagName( "tasInfo" ).item( 0 ).toElement();
+        for ( int infoIndex = 0; infoIndex < infoNodes.size(); infoIndex++ ) {
 
-        QString className = infoElement.attribute("name");
+            ApiMethodMap methodMap;
 
-        QDomNodeList methodNodes = infoElement.elementsByTagName( "object" );
+            QDomElement infoElement = infoNodes.item( infoIndex ).toElement();
 
-        // collect method names, arguments and return value types
-        for ( int methodIndex = 0; methodIndex < methodNodes.size(); methodIndex++ ) {
+            QString className = infoElement.attribute("name");
 
-            QHash<QString, QString> attributes;
+            QDomNodeList methodNodes = infoElement.elementsByTagName( "object" );
 
-            /*
-            <tasMessage dateTime="2009.09.03 13:39:48.503" version="0.4.3-1" >
-              <tasInfo id="0" name="Button" type="QtMethods" >
-                  <object id="0" name="attributeName" parent="" type="QtMethod" >
-                  <attributes>
-                      <attribute name="returnValueType" type="" >
-                      <value>
-                        const QString
-                      </value>
-                      </attribute>
-                      <attribute name="arguments" type="" >
-                      <value>
-                      </value>
-                      </attribute>
-                  </attributes>
-                  </object>
-              </tasInfo>
-            </tasMessage>
-            */
-
-            QDomElement methodElement = methodNodes.item( methodIndex ).toElement();
-            QDomNodeList attributesNodeList = methodElement.firstChildElement( "attributes" ).elementsByTagName( "attribute" );
-
-            for ( int attributeIndex = 0; attributeIndex < attributesNodeList.size(); attributeIndex++ ) {
-
-                QDomElement attributeElement = attributesNodeList.item( attributeIndex ).toElement();
-                attributes.insert( attributeElement.attribute( "name" ), attributeElement.firstChildElement( "value" ).text() );
+            // collect method names, arguments and return value types
+            for ( int methodIndex = 0; methodIndex < methodNodes.size(); methodIndex++ ) {
 
-            }
+                QHash<QString, QString> attributes;
 
-            methodMap.insert( methodElement.attribute( "name" ), attributes );
+                /*
+                <tasMessage dateTime="2009.09.03 13:39:48.503" version="0.4.3-1" >
+                  <tasInfo id="0" name="Button" type="QtMethods" >
+                      <object id="0" name="attributeName" parent="" type="QtMethod" >
+                      <attributes>
+                          <attribute name="returnValueType" type="" >
+                          <value>
+                            const QString
+                          </value>
+                          </attribute>
+                          <attribute name="arguments" type="" >
+                          <value>
+                          </value>
+                          </attribute>
+                      </attributes>
+                      </object>
+                  </tasInfo>
+                </tasMessage>
+                */
+
+                QDomElement methodElement = methodNodes.item( methodIndex ).toElement();
+                QDomNodeList attributesNodeList = methodElement.firstChildElement( "attributes" ).elementsByTagName( "attribute" );
+
+                for ( int attributeIndex = 0; attributeIndex < attributesNodeList.size(); attributeIndex++ ) {
+
+                    QDomElement attributeElement = attributesNodeList.item( attributeIndex ).toElement();
+                    attributes.insert( attributeElement.attribute( "name" ), attributeElement.firstChildElement( "value" ).text() );
 
-        }
+                }
+
+                methodMap.insert( methodElement.attribute( "name" ), attributes );
 
-        if ( !apiMethodsMap.contains( className ) ) { apiMethodsMap.insert( className, methodMap ); }
+            }
+
+            storeApiMethods( className, methodMap );
+        }
 
     }
 
@@ -407,6 +417,26 @@ QStringList MainWindow::parseSignalsXml( QString filename ) {
     return signalList;
 }
 
+// returns false if file could not be parsed
+bool MainWindow::parseSignalsBatchXml( const QString &filename, const QString &appName )
+{
+    QFile file( filename );
+    if ( !file.open( QIODevice::ReadOnly ) ) {
+        qWarning() << FCFL << "cannot open" << filename << file.errorString();
+        return false;
+    }
+
+    QString errorString;
+    int typeCount = signalsCache.parseBatchXml( &file, appName, applicationsNamesMap.key( appName ), &errorString );
+    if ( typeCount < 0 ) {
+        qWarning() << FCFL << errorString << "in" << filename;
+        return false;
+    }
+    qCDebug(logTree) << FCFL << "prefetched signals of" << typeCount << "types for" << appName;
+    return true;
+}
+
+
 void MainWindow::parseApplicationsXml( QString filename )
 {
     QDomNode nodeInfo;
@@ -506,6 +536,7 @@ void MainWindow::parseApplicationsXml( QString filename )
 
     } //     if ( parseXml( filename, appDocument ) ) {
 
+    signalsCache.invalidate(applicationsNamesMap);
     updateApplicationsList();
 
     // Disable menu if it has no applications
@@ -520,8 +551,6 @@ void MainWindow::parseApplicationsXml( QString filename )
 
 bool MainWindow::parseXml( QString fileName, QDomDocument & resultDocument )
 {
-    //    qDebug() << FCFL << fileName;
-
     // temporary xml dom document
     QDomDocument tempDomDocument;
     bool result = false;
@@ -530,7 +559,7 @@ bool MainWindow::parseXml( QString fileName, QDomDocument & resultDocument )
     QFile xmlFile( fileName );
 
     if ( !xmlFile.exists() ) {
-        qDebug() << FCFL << fileName << "not found";
+        qCWarning(logTree) << FCFL << fileName << "not found";
         QMessageBox::critical(
                 this,
                 tr( "XML Error" ),
@@ -539,7 +568,7 @@ bool MainWindow::parseXml( QString fileName, QDomDocument & resultDocument )
     } else {
 
         if ( !xmlFile.open( QIODevice::ReadOnly ) ) {
-            qDebug() << fileName << "open error";
+            qCWarning(logTree) << FCFL << fileName << "open error";
             QMessageBox::critical(
                     this,
                     tr( "XML Error" ),
@@ -554,7 +583,7 @@ bool MainWindow::parseXml( QString fileName, QDomDocument & resultDocument )
 
             if ( !result )  {
 
-                qDebug() << FCFL << fileName << 'l' << errorLine << 'c' << errorColumn << ':' << errorMsg;
+                qCWarning(logTree) << FCFL << fileName << 'l' << errorLine << 'c' << errorColumn << ':' << errorMsg;
                 QMessageBox::critical(
                         this,
                         tr( "XML Error" ),
@@ -566,7 +595,7 @@ bool MainWindow::parseXml( QString fileName, QDomDocument & resultDocument )
                         );
 
             } else {
-                qDebug() << FCFL << fileName << "success";
+                qCDebug(logTree) << FCFL << fileName << "success";
                 // return parsed xml dom as result
                 resultDocument = tempDomDocument;
 
@@ -610,7 +639,6 @@ bool MainWindow::getXmlParameters( QString filename )
                         QString value = node.toElement().attribute("value");
                         tmpXmlParameters.insert(name, value);
                     }
-                    //else qDebug() << FCFL << "Skipping element node" << node.nodeName;
                 }
 
                 node = node.nextSibling();
@@ -0,0 +1,514 @@
+/***************************************************************************
+**
+** Copyright (C) 2010 Nokia Corporation and/or its subsidiary(-ies).
+** All rights reserved.
+** Contact: Nokia Corporation (testabilitydriver@nokia.com)
+**
+** This file is part of Testability Driver.
+**
+** If you have questions regarding the use of this file, please contact
+** Nokia at testabilitydriver@nokia.com .
+**
+** This library is free software; you can redistribute it and/or
+** modify it under the terms of the GNU Lesser General Public
+** License version 2.1 as published by the Free Software Foundation
+** and appearing in the file LICENSE.LGPL included in the packaging
+** of this file.
+**
+****************************************************************************/
+
+
+#include "tdriver_xml_view.h"
+
+#include <QApplication>
+#include <QClipboard>
+#include <QDir>
+#include <QFontDatabase>
+#include <QFontMetrics>
+#include <QKeyEvent>
+#include <QMouseEvent>
+#include <QPainter>
+#include <QScrollBar>
+#include <QTemporaryFile>
+#include <QtCore/QDebug>
+
+#include <limits.h>
+#include <string.h>
+
+static const int IndentColumns = 2;
+// longer lines, like base64 encoded data, are cut for painting, search still covers them
+static const int MaxLineBytes = 64 * 1024;
+
+
+static inline bool isSpace(char c)
+{
+    return c == ' ' || c == '\n' || c == '\r' || c == '\t';
+}
+
+
+static inline uchar foldAscii(uchar c)
+{
+    return (c >= 'A' && c <= 'Z') ? uchar(c + ('a' - 'A')) : c;
+}
+
+
+// multibyte utf-8 characters count as word characters
+static inline bool isWordByte(uchar c)
+{
+    return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || (c >= '0' && c <= '9') || c == '_' || c >= 0x80;
+}
+
+
+static qint64 indexOf(const char *data, qint64 size, qint64 from, const char *text)
+{
+    const size_t length = strlen(text);
+    while (from + qint64(length) <= size) {
+        const char *first = static_cast<const char *>(memchr(data + from, text[0], size - from));
+        if (!first) break;
+        from = first - data;
+        if (from + qint64(length) <= size && memcmp(first, text, length) == 0) return from;
+        ++from;
+    }
+    return -1;
+}
+
+
+TDriverXmlView::TDriverXmlView(QWidget *parent) :
+    QAbstractScrollArea(parent),
+    mappedFile(NULL),
+    data(NULL),
+    dataSize(0),
+    maxColumns(0),
+    currentLine(-1),
+    matchOffset(-1),
+    matchLength(0)
+{
+    setFont(QFontDatabase::systemFont(QFontDatabase::FixedFont));
+    setFocusPolicy(Qt::StrongFocus);
+    viewport()->setBackgroundRole(QPalette::Base);
+}
+
+
+TDriverXmlView::~TDriverXmlView()
+{
+    delete mappedFile;
+}
+
+
+bool TDriverXmlView::setFile(const QString &fileName)
+{
+    clear();
+
+    QFile source(fileName);
+    if (!source.open(QIODevice::ReadOnly)) {
+        qWarning() << "TDriverXmlView: could not open" << fileName << source.errorString();
+        return false;
+    }
+
+    QTemporaryFile *copy = new QTemporaryFile(QDir::tempPath() + "/visualizer_xml_XXXXXX.xml");
+    bool ok = copy->open();
+    while (ok && !source.atEnd()) {
+        const QByteArray chunk = source.read(1024 * 1024);
+        if (chunk.isEmpty()) break;
+        ok = (copy->write(chunk) == chunk.size());
+    }
+    ok = ok && copy->flush() && copy->size() > 0;
+
+    uchar *mapped = ok ? copy->map(0, copy->size()) : NULL;
+    if (!mapped) {
+        qWarning() << "TDriverXmlView: could not map copy of" << fileName << copy->errorString();
+        delete copy;
+        return false;
+    }
+
+    mappedFile = copy;
+    setBytes(reinterpret_cast<const char *>(mapped), copy->size());
+    return true;
+}
+
+
+void TDriverXmlView::setData(const QByteArray &xml)
+{
+    clear();
+    ownData = xml;
+    setBytes(ownData.constData(), ownData.size());
+}
+
+
+void TDriverXmlView::clear()
+{
+    lines.clear();
+    maxColumns = 0;
+    data = NULL;
+    dataSize = 0;
+    ownData.clear();
+    // deleting file also unmaps it
+    delete mappedFile;
+    mappedFile = NULL;
+
+    currentLine = -1;
+    matchOffset = -1;
+    matchLength = 0;
+
+    updateScrollBars();
+    verticalScrollBar()->setValue(0);
+    horizontalScrollBar()->setValue(0);
+    viewport()->update();
+}
+
+
+void TDriverXmlView::setBytes(const char *bytes, qint64 size)
+{
+    data = bytes;
+    dataSize = size;
+    layoutLines();
+    updateScrollBars();
+    viewport()->update();
+}
+
+
+qint64 TDriverXmlView::markupEnd(qint64 pos) const
+{
+    qint64 end = -1;
+
+    if (indexOf(data, qMin(dataSize, pos + 4), pos, "<!--") == pos) {
+        end = indexOf(data, dataSize, pos + 4, "-->");
+        if (end >= 0) end += 3;
+    }
+    else if (indexOf(data, qMin(dataSize, pos + 9), pos, "<![CDATA[") == pos) {
+        end = indexOf(data, dataSize, pos + 9, "]]>");
+        if (end >= 0) end += 3;
+    }
+    else {
+        // '>' is allowed inside attribute values
+        char quote = 0;
+        for (qint64 ii = pos + 1; ii < dataSize; ++ii) {
+            const char c = data[ii];
+            if (quote) {
+                if (c == quote) quote = 0;
+            }
+            else if (c == '"' || c == '\'') quote = c;
+            else if (c == '>') {
+                end = ii + 1;
+                break;
+            }
+        }
+    }
+
+    return (end < 0) ? dataSize : end;
+}
+
+
+void TDriverXmlView::layoutLines()
+{
+    lines.clear();
+    maxColumns = 0;
+
+    int depth = 0;
+    qint64 pos = 0;
+
+    while (pos < dataSize) {
+        while (pos < dataSize && isSpace(data[pos])) ++pos;
+        if (pos >= dataSize) break;
+
+        Line line;
+        line.offset = pos;
+        line.depth = depth;
+        qint64 end;
+
+        if (data[pos] != '<') {
+            const char *next = static_cast<const char *>(memchr(data + pos, '<', dataSize - pos));
+            end = next ? next - data : dataSize;
+        }
+        else if (pos + 1 < dataSize && data[pos + 1] == '/') {
+            end = markupEnd(pos);
+            line.depth = depth = qMax(0, depth - 1);
+        }
+        else {
+            end = markupEnd(pos);
+            const char second = (pos + 1 < dataSize) ? data[pos + 1] : 0;
+            if (second != '?' && second != '!' && !(end - pos > 2 && data[end - 2] == '/')) {
+                // element with only text content is kept on one line
+                const char *next = static_cast<const char *>(memchr(data + end, '<', dataSize - end));
+                const qint64 close = next ? next - data : dataSize;
+                if (close + 1 < dataSize && data[close + 1] == '/') end = markupEnd(close);
+                else ++depth;
+            }
+        }
+
+        qint64 last = end;
+        while (last > pos && isSpace(data[last - 1])) --last;
+        line.length = int(qMin<qint64>(last - pos, INT_MAX));
+        lines.append(line);
+
+        maxColumns = qMax(maxColumns, line.depth * IndentColumns + qMin(line.length, MaxLineBytes));
+        pos = end;
+    }
+}
+
+
+QString TDriverXmlView::lineText(int line) const
+{
+    if (line < 0 || line >= lines.size()) return QString();
+
+    const Line &info = lines.at(line);
+    QString text = QString::fromUtf8(data + info.offset, qMin(info.length, MaxLineBytes));
+
+    // newlines and tabs of text content would break fixed width columns
+    QChar *chars = text.data();
+    for (int ii = 0; ii < text.size(); ++ii) {
+        if (chars[ii].unicode() < ' ') chars[ii] = QLatin1Char(' ');
+    }
+    return text;
+}
+
+
+QString TDriverXmlView::selectedText() const
+{
+    return (matchOffset < 0) ? QString() : QString::fromUtf8(data + matchOffset, matchLength);
+}
+
+
+int TDriverXmlView::columns(qint64 offset, qint64 bytes) const
+{
+    return QString::fromUtf8(data + offset, int(qBound<qint64>(0, bytes, MaxLineBytes))).size();
+}
+
+
+int TDriverXmlView::lineAt(qint64 offset) const
+{
+    // last line starting at or before offset
+    int low = 0;
+    int high = lines.size();
+    while (low < high) {
+        const int middle = low + (high - low) / 2;
+        if (lines.at(middle).offset <= offset) low = middle + 1;
+        else high = middle;
+    }
+    return low - 1;
+}
+
+
+void TDriverXmlView::updateScrollBars()
+{
+    const QFontMetrics metrics(font());
+    const int visibleLines = qMax(1, viewport()->height() / metrics.height());
+    const int visibleColumns = qMax(1, viewport()->width() / qMax(1, metrics.width(QLatin1Char('x'))));
+
+    verticalScrollBar()->setRange(0, qMax(0, lines.size() - visibleLines));
+    verticalScrollBar()->setPageStep(visibleLines);
+    horizontalScrollBar()->setRange(0, qMax(0, maxColumns - visibleColumns + 1));
+    horizontalScrollBar()->setPageStep(visibleColumns);
+}
+
+
+void TDriverXmlView::showLine(int line)
+{
+    if (line < 0 || line >= lines.size()) return;
+
+    currentLine = line;
+
+    const int visibleLines = verticalScrollBar()->pageStep();
+    const int top = verticalScrollBar()->value();
+    if (line < top || line >= top + visibleLines) {
+        verticalScrollBar()->setValue(line - visibleLines / 3);
+    }
+
+    const Line &info = lines.at(line);
+    int column = info.depth * IndentColumns;
+    if (matchOffset >= info.offset && matchOffset < info.offset + info.length) {
+        column += columns(info.offset, matchOffset - info.offset);
+    }
+    const int visibleColumns = horizontalScrollBar()->pageStep();
+    const int left = horizontalScrollBar()->value();
+    if (column < left || column + matchLength > left + visibleColumns) {
+        horizontalScrollBar()->setValue(column - visibleColumns / 4);
+    }
+
+    viewport()->update();
+}
+
+
+qint64 TDriverXmlView::search(const char *data, qint64 dataSize, const QByteArray &pattern, qint64 from,
+                              bool caseSensitive, bool entireWords, bool backwards)
+{
+    const int length = pattern.size();
+    if (length == 0 || length > dataSize) return -1;
+
+    const uchar *text = reinterpret_cast<const uchar *>(data);
+
+    // case insensitive search folds only ascii letters, which covers names and attributes of dumps
+    uchar fold[256];
+    QByteArray foldedPattern(pattern);
+    if (!caseSensitive) {
+        for (int ii = 0; ii < length; ++ii) foldedPattern[ii] = char(foldAscii(uchar(pattern.at(ii))));
+    }
+    const uchar *folded = reinterpret_cast<const uchar *>(foldedPattern.constData());
+    for (int ii = 0; ii < 256; ++ii) fold[ii] = caseSensitive ? uchar(ii) : foldAscii(uchar(ii));
+
+    // Boyer-Moore-Horspool, shifts are mirrored for backwards search
+    int shift[256];
+    for (int ii = 0; ii < 256; ++ii) shift[ii] = length;
+    if (backwards) {
+        for (int ii = length - 1; ii > 0; --ii) shift[folded[ii]] = ii;
+    }
+    else {
+        for (int ii = 0; ii < length - 1; ++ii) shift[folded[ii]] = length - 1 - ii;
+    }
+
+    qint64 pos = backwards ? qMin(from, dataSize - length) : qMax<qint64>(0, from);
+
+    while (pos >= 0 && pos + length <= dataSize) {
+        int ii = length - 1;
+        while (ii >= 0 && fold[text[pos + ii]] == folded[ii]) --ii;
+
+        if (ii < 0 && (!entireWords
+                       || ((pos == 0 || !isWordByte(text[pos - 1]))
+                           && (pos + length == dataSize || !isWordByte(text[pos + length]))))) {
+            return pos;
+        }
+
+        if (backwards) pos -= shift[fold[text[pos]]];
+        else pos += shift[fold[text[pos + length - 1]]];
+    }
+    return -1;
+}
+
+
+bool TDriverXmlView::find(const QString &text, bool caseSensitive, bool entireWords, bool backwards, bool wrapAround)
+{
+    const QByteArray pattern = text.toUtf8();
+    if (pattern.isEmpty() || lines.isEmpty()) return false;
+
+    qint64 from;
+    if (matchOffset >= 0) {
+        from = backwards ? matchOffset - 1 : matchOffset + 1;
+    }
+    else if (currentLine >= 0) {
+        from = backwards ? lines.at(currentLine).offset - 1 : lines.at(currentLine).offset;
+    }
+    else {
+        from = backwards ? dataSize : 0;
+    }
+
+    qint64 found = search(data, dataSize, pattern, from, caseSensitive, entireWords, backwards);
+    if (found < 0 && wrapAround) {
+        found = search(data, dataSize, pattern, backwards ? dataSize : 0, caseSensitive, entireWords, backwards);
+    }
+    if (found < 0) return false;
+
+    matchOffset = found;
+    matchLength = pattern.size();
+    showLine(lineAt(found));
+    return true;
+}
+
+
+bool TDriverXmlView::showObject(const QString &id)
+{
+    if (id.isEmpty() || lines.isEmpty()) return false;
+
+    const QByteArray pattern = "id=\"" + id.toUtf8() + '"';
+
+    for (qint64 pos = search(data, dataSize, pattern, 0, true, false, false); pos > 0;
+         pos = search(data, dataSize, pattern, pos + 1, true, false, false)) {
+
+        if (!isSpace(data[pos - 1])) continue;
+
+        // id must be an attribute of obj or object start tag
+        qint64 start = pos;
+        while (start > 0 && data[start] != '<' && data[start] != '>') --start;
+        if (data[start] != '<') continue;
+
+        const char *name = data + start + 1;
+        const qint64 available = dataSize - start - 1;
+        const bool isObj = available > 3 && memcmp(name, "obj", 3) == 0 && isSpace(name[3]);
+        const bool isObject = available > 6 && memcmp(name, "object", 6) == 0 && isSpace(name[6]);
+        if (!isObj && !isObject) continue;
+
+        matchOffset = -1;
+        matchLength = 0;
+        showLine(lineAt(start));
+        return true;
+    }
+    return false;
+}
+
+
+void TDriverXmlView::paintEvent(QPaintEvent *event)
+{
+    QPainter painter(viewport());
+
+    const QFontMetrics metrics(font());
+    const int lineHeight = metrics.height();
+    const int charWidth = qMax(1, metrics.width(QLatin1Char('x')));
+    const int top = verticalScrollBar()->value();
+    const int leftColumn = horizontalScrollBar()->value();
+    const int visibleColumns = viewport()->width() / charWidth + 2;
+
+    const int first = top + event->rect().top() / lineHeight;
+    const int last = qMin(lines.size() - 1, top + event->rect().bottom() / lineHeight);
+
+    for (int line = first; line <= last; ++line) {
+        const Line &info = lines.at(line);
+        const int y = (line - top) * lineHeight;
+        const int indent = info.depth * IndentColumns;
+
+        if (line == currentLine) {
+            painter.fillRect(0, y, viewport()->width(), lineHeight, palette().alternateBase());
+        }
+
+        // only the visible part of line is drawn
+        const QString text = lineText(line);
+        const int start = qMax(0, leftColumn - indent);
+        painter.setPen(palette().color(QPalette::Text));
+        painter.drawText((indent + start - leftColumn) * charWidth, y + metrics.ascent(),
+                         text.mid(start, visibleColumns));
+
+        if (matchOffset >= info.offset && matchOffset < info.offset + info.length) {
+            const int column = indent + columns(info.offset, matchOffset - info.offset);
+            const QString match = text.mid(column - indent,
+                                                     columns(matchOffset, qMin<qint64>(matchLength, info.offset + info.length - matchOffset)));
+            const QRect rect((column - leftColumn) * charWidth, y, match.size() * charWidth, lineHeight);
+            painter.fillRect(rect, palette().highlight());
+            painter.setPen(palette().color(QPalette::HighlightedText));
+            painter.drawText(rect.left(), y + metrics.ascent(), match);
+        }
+    }
+}
+
+
+void TDriverXmlView::resizeEvent(QResizeEvent *event)
+{
+    QAbstractScrollArea::resizeEvent(event);
+    updateScrollBars();
+}
+
+
+void TDriverXmlView::mousePressEvent(QMouseEvent *event)
+{
+    const int line = verticalScrollBar()->value() + event->pos().y() / QFontMetrics(font()).height();
+    if (line < lines.size()) {
+        currentLine = line;
+        viewport()->update();
+    }
+    QAbstractScrollArea::mousePressEvent(event);
+}
+
+
+void TDriverXmlView::keyPressEvent(QKeyEvent *event)
+{
+    if (event->matches(QKeySequence::Copy)) {
+        const QString text = (matchOffset >= 0) ? selectedText() : lineText(currentLine);
+        if (!text.isEmpty()) QApplication::clipboard()->setText(text);
+    }
+    else if ((event->key() == Qt::Key_Up || event->key() == Qt::Key_Down) && !lines.isEmpty()) {
+        matchOffset = -1;
+        matchLength = 0;
+        const int step = (event->key() == Qt::Key_Up) ? -1 : 1;
+        showLine(qBound(0, currentLine + step, lines.size() - 1));
+    }
+    else {
+        QAbstractScrollArea::keyPressEvent(event);
+    }
+}
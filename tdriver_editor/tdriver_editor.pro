@@ -43,7 +43,7 @@ mac {
 INCLUDEPATH += $$EDITORLIBDIR
 #LIBS += -L$$EDITORLIBDIR -l$$EDITOR_LIB
 LIBS += -l$$EDITOR_LIB
-QT += network xml widgets
+QT += network xml widgets concurrent
 
 # For libtdriverfetureditor
 INCLUDEPATH += $$FEATUREDITORLIBDIR
@@ -52,16 +52,23 @@ LIBS += -l$$FEATUREDITOR_LIB
 # Input
 HEADERS += ../inc/tdriver_main_types.h \
     tdriver_statehistorymenu.h
+HEADERS += ../inc/tdriver_attributes_model.h
 HEADERS += ../inc/tdriver_behaviour.h
+HEADERS += ../inc/tdriver_find_index.h
+HEADERS += ../inc/tdriver_signals_cache.h
+HEADERS += ../inc/tdriver_locator.h
+HEADERS += ../inc/tdriver_locator_analyzer.h
 HEADERS += ../inc/tdriver_image_view.h
 HEADERS += ../inc/tdriver_main_window.h
 HEADERS += ../inc/tdriver_recorder.h
+HEADERS += ../inc/tdriver_xml_view.h
 
 SOURCES += ../src/tdriver_libeditor_ui.cpp \
     ../src/tdriver_libfeatureditor_ui.cpp \
     tdriver_statehistorymenu.cpp
 SOURCES += ../src/tdriver_editor.cpp
 SOURCES += ../src/tdriver_main_window.cpp
+SOURCES += ../src/tdriver_attributes_model.cpp
 SOURCES += ../src/tdriver_image_view.cpp
 SOURCES += ../src/tdriver_recorder.cpp
 SOURCES += ../src/tdriver_behaviours.cpp
@@ -69,13 +76,22 @@ SOURCES += ../src/tdriver_image_widget.cpp
 SOURCES += ../src/tdriver_keyboard_commands_widget.cpp
 SOURCES += ../src/tdriver_menu.cpp
 SOURCES += ../src/tdriver_object_tree.cpp
+SOURCES += ../src/tdriver_ui_dump_reader.cpp
 SOURCES += ../src/tdriver_properties_table.cpp
 SOURCES += ../src/tdriver_show_xml.cpp
+SOURCES += ../src/tdriver_xml_view.cpp
 SOURCES += ../src/tdriver_ui.cpp
 SOURCES += ../src/tdriver_xml.cpp
 SOURCES += ../src/tdriver_find_dialog.cpp
+SOURCES += ../src/tdriver_find_index.cpp
+SOURCES += ../src/tdriver_signals_cache.cpp
+SOURCES += ../src/tdriver_locator.cpp
+SOURCES += ../src/tdriver_locator_analyzer.cpp
 SOURCES += ../src/tdriver_startapp_dialog.cpp
 SOURCES += ../src/tdriver_savedlayouts.cpp
+SOURCES += ../src/tdriver_diagnostics.cpp
+SOURCES += ../src/tdriver_app_snapshots.cpp
+SOURCES += ../src/tdriver_api_methods.cpp
 
 FORMS += ../src/tdriver_richtextcontainer.ui
 
@@ -10,7 +10,8 @@ TDriverStateHistoryMenu::TDriverStateHistoryMenu(const QString &filePathPrefix,
     int slashPos = filePathPrefix.lastIndexOf('/');
     parentPath = filePathPrefix.left(slashPos+1);
     QString namePrefix = filePathPrefix.mid(slashPos+1);
-    dirNameFilters << namePrefix+"*";
+    // directories of other session windows have a longer prefix
+    dirNameFilters << namePrefix+"[0-9][0-9]";
     addAction(tr("N/A"))->setDisabled(true);
     connect(this, SIGNAL(triggered(QAction*)), SLOT(emitActivated(QAction*)));
 }
@@ -0,0 +1,115 @@
+/***************************************************************************
+**
+** Copyright (C) 2010 Nokia Corporation and/or its subsidiary(-ies).
+** All rights reserved.
+** Contact: Nokia Corporation (testabilitydriver@nokia.com)
+**
+** This file is part of Testability Driver.
+**
+** If you have questions regarding the use of this file, please contact
+** Nokia at testabilitydriver@nokia.com .
+**
+** This library is free software; you can redistribute it and/or
+** modify it under the terms of the GNU Lesser General Public
+** License version 2.1 as published by the Free Software Foundation
+** and appearing in the file LICENSE.LGPL included in the packaging
+** of this file.
+**
+****************************************************************************/
+
+
+// Mock replacement for tdriver_interface.rb, for running Visualizer without TDriver and SUT.
+// Select it by setting TDRIVER_VISUALIZER_LISTENER to the path of this executable.
+//
+// Configuration is read from environment variables (Visualizer starts listener without arguments),
+// command line options override them:
+//   TDRIVER_MOCKRBI_LATENCY     --latency <ms>        delay of each reply, default 0
+//   TDRIVER_MOCKRBI_IMAGE_LATENCY --image-latency <ms> delay of refresh_image reply, default same as latency
+//   TDRIVER_MOCKRBI_OBJECTS     --objects <count>     objects in synthetic ui dump, default 100
+//   TDRIVER_MOCKRBI_IMAGE_SIZE  --image-size <WxH>    size of synthetic screen capture, default 360x640
+//   TDRIVER_MOCKRBI_BEHAVIOURS  --behaviours <count>  methods per object type, default 20
+//   TDRIVER_MOCKRBI_SIGNALS     --signals <count>     signals in signal list, default 10
+//   TDRIVER_MOCKRBI_DATA_DIR    --data-dir <dir>      recorded applications.xml, ui_dump.xml, image.png,
+//                                                     behaviours.xml and signals.xml, used instead of synthetic data
+
+#include "tdriver_mockrbiserver.h"
+
+#include <QCoreApplication>
+#include <QCommandLineParser>
+#include <QStringList>
+#include <QSize>
+
+#include <cstdlib>
+
+
+static QString option(const QCommandLineParser &parser, const QString &name, const char *envVar)
+{
+    return parser.isSet(name) ? parser.value(name) : QString::fromLocal8Bit(getenv(envVar));
+}
+
+
+static QSize parseSize(const QString &str, const QSize &defaultSize)
+{
+    QStringList parts = str.split('x', Qt::SkipEmptyParts, Qt::CaseInsensitive);
+    bool wOk = false, hOk = false;
+    QSize size;
+    if (parts.size() == 2) size = QSize(parts.at(0).toInt(&wOk), parts.at(1).toInt(&hOk));
+    return (wOk && hOk && !size.isEmpty()) ? size : defaultSize;
+}
+
+
+int main(int argc, char *argv[])
+{
+    QCoreApplication app(argc, argv);
+    app.setApplicationName("tdriver_mockrbi");
+
+    qRegisterMetaType<BAList>("BAList");
+    qRegisterMetaType<BAListMap>("BAListMap");
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription("Mock TDriver Visualizer listener, replacement for tdriver_interface.rb");
+    parser.addHelpOption();
+    parser.addOption(QCommandLineOption("latency", "Delay of each reply in milliseconds.", "ms"));
+    parser.addOption(QCommandLineOption("image-latency", "Delay of screen capture reply in milliseconds.", "ms"));
+    parser.addOption(QCommandLineOption("objects", "Number of objects in ui dump.", "count"));
+    parser.addOption(QCommandLineOption("image-size", "Size of screen capture.", "WxH"));
+    parser.addOption(QCommandLineOption("behaviours", "Number of methods per object type.", "count"));
+    parser.addOption(QCommandLineOption("signals", "Number of signals.", "count"));
+    parser.addOption(QCommandLineOption("data-dir", "Directory of recorded reply files.", "dir"));
+    parser.process(app);
+
+    TDriverMockRbiServer server;
+    QString value;
+    bool ok;
+
+    value = option(parser, "latency", "TDRIVER_MOCKRBI_LATENCY");
+    int latency = value.toInt(&ok);
+    if (ok) server.setLatency(latency);
+
+    value = option(parser, "image-latency", "TDRIVER_MOCKRBI_IMAGE_LATENCY");
+    int imageLatency = value.toInt(&ok);
+    if (ok) server.setImageLatency(imageLatency);
+
+    value = option(parser, "objects", "TDRIVER_MOCKRBI_OBJECTS");
+    int objects = value.toInt(&ok);
+    if (ok) server.setObjectCount(objects);
+
+    value = option(parser, "image-size", "TDRIVER_MOCKRBI_IMAGE_SIZE");
+    if (!value.isEmpty()) server.setImageSize(parseSize(value, QSize(360, 640)));
+
+    value = option(parser, "behaviours", "TDRIVER_MOCKRBI_BEHAVIOURS");
+    int behaviours = value.toInt(&ok);
+    if (ok) server.setBehaviourCount(behaviours);
+
+    value = option(parser, "signals", "TDRIVER_MOCKRBI_SIGNALS");
+    int signalCount = value.toInt(&ok);
+    if (ok) server.setSignalCount(signalCount);
+
+    value = option(parser, "data-dir", "TDRIVER_MOCKRBI_DATA_DIR");
+    if (!value.isEmpty()) server.setDataDir(value);
+
+    if (!server.listen()) return 1;
+
+    QObject::connect(&server, SIGNAL(finished()), &app, SLOT(quit()));
+    return app.exec();
+}
@@ -0,0 +1,547 @@
+/***************************************************************************
+**
+** Copyright (C) 2010 Nokia Corporation and/or its subsidiary(-ies).
+** All rights reserved.
+** Contact: Nokia Corporation (testabilitydriver@nokia.com)
+**
+** This file is part of Testability Driver.
+**
+** If you have questions regarding the use of this file, please contact
+** Nokia at testabilitydriver@nokia.com .
+**
+** This library is free software; you can redistribute it and/or
+** modify it under the terms of the GNU Lesser General Public
+** License version 2.1 as published by the Free Software Foundation
+** and appearing in the file LICENSE.LGPL included in the packaging
+** of this file.
+**
+****************************************************************************/
+
+
+#include "tdriver_mockrbiserver.h"
+
+#include <tdriver_rubyinterface.h>
+#include <tdriver_rbidispatcher.h>
+#include <tdriver_util.h>
+#include <tdriver_debug_macros.h>
+
+#include <QTcpSocket>
+#include <QHostAddress>
+#include <QTimer>
+#include <QFile>
+#include <QDir>
+#include <QFileInfo>
+#include <QXmlStreamWriter>
+#include <QImage>
+#include <QPainter>
+#include <QRect>
+
+#include <cstdio>
+
+// must match REQUIRED_TDRIVER_INTERFACE_RB_VERSION of TDriverRubyInterface
+static const int mockInterfaceVersion = TDriverRubyInterface::REQUIRED_TDRIVER_INTERFACE_RB_VERSION;
+
+static const char mockApplicationName[] = "mockapp";
+static const char mockApplicationId[] = "1001";
+
+// number of children per object in synthetic ui dump
+static const int objectFanout = 4;
+
+
+TDriverMockRbiServer::TDriverMockRbiServer(QObject *parent) :
+    QObject(parent),
+    conn(NULL),
+    handler(NULL),
+    latency(0),
+    imageLatency(-1),
+    objectCount(100),
+    imageSize(360, 640),
+    behaviourCount(20),
+    signalCount(10),
+    outputPath(QDir::tempPath())
+{
+    connect(&server, SIGNAL(newConnection()), SLOT(acceptConnection()));
+}
+
+
+bool TDriverMockRbiServer::listen()
+{
+    if (!server.listen(QHostAddress(QHostAddress::LocalHost), 0)) {
+        qWarning() << FCFL << "listen failed:" << server.errorString();
+        return false;
+    }
+
+    // same format as puts_hello of tdriver_interface.rb
+    printf("TDriverVisualizerRubyInterface version %d port %d tdriver %s\n",
+           mockInterfaceVersion, server.serverPort(), "mock");
+    fflush(stdout);
+    return true;
+}
+
+
+void TDriverMockRbiServer::acceptConnection()
+{
+    // like tdriver_interface.rb, accept just one connection
+    conn = server.nextPendingConnection();
+    server.close();
+    if (!conn) return;
+
+    handler = new TDriverRbiProtocol(conn, &syncMutex, &helloCond, this);
+    handler->setValidThread(thread());
+    handler->connected(); // socket is already connected, reset protocol state
+
+    // requests of every name are answered, unknown ones with an error like tdriver_interface.rb does
+    TDriverRbiDispatcher::globalInstance()->subscribe(QByteArray(), this,
+                                                      SLOT(handleMessage(TDriverRbiMessage)));
+    connect(handler, SIGNAL(gotDisconnection()), SLOT(connectionClosed()));
+
+    // hello message has sequence number 0, so write it directly
+    BAListMap hello;
+    hello["tdriver"] << "mock";
+    hello["version"] << QByteArray::number(mockInterfaceVersion);
+    hello["RUBY_VERSION"] << "mock";
+
+    QByteArray helloData;
+    TDriverRbiProtocol::makeStringListMapMsg(helloData, "hello", hello, 0);
+    conn->write(helloData);
+}
+
+
+void TDriverMockRbiServer::connectionClosed()
+{
+    qCDebug(logRbi) << FCFL;
+    emit finished();
+}
+
+
+void TDriverMockRbiServer::handleMessage(TDriverRbiMessage rbiMessage)
+{
+    const quint32 seqNum = rbiMessage.seqNum();
+    const QByteArray &name = rbiMessage.name();
+    const BAListMap &message = rbiMessage.map();
+    qCDebug(logRbi) << FCFL << seqNum << name << message;
+
+    PendingReply reply;
+    reply.seqNum = seqNum;
+    reply.name = name;
+
+    if (name == TDriverUtil::visualizationId && !message.value("input").isEmpty()) {
+        const BAList &input = message["input"];
+        if (input.first() == "quit") {
+            conn->disconnectFromHost();
+            return;
+        }
+        if (input.value(1) == "cancel") {
+            // like tdriver_interface.rb, drop queued work and reply to cancel request immediately
+            const BAList cancelled = input.mid(2);
+            for (int ii = 0; ii < pendingReplies.size(); ++ii) {
+                PendingReply &pending = pendingReplies[ii];
+                if (cancelled.contains(QByteArray::number(pending.seqNum))) {
+                    pending.message.clear();
+                    pending.message["cancelled"] << QByteArray::number(pending.seqNum);
+                }
+            }
+            handler->sendStringListMapMsg(name, BAListMap(), seqNum);
+
+            // concurrent replies only simulate latency, so they are replied right away,
+            // their timers find nothing to send after this
+            foreach (const QByteArray &cancelledSeqNum, cancelled) {
+                const quint32 cancelledNum = cancelledSeqNum.toUInt();
+                if (!concurrentReplies.contains(cancelledNum)) continue;
+
+                PendingReply dropped = concurrentReplies.take(cancelledNum);
+                BAListMap cancelledMessage;
+                cancelledMessage["cancelled"] << QByteArray::number(cancelledNum);
+                handler->sendStringListMapMsg(dropped.name, cancelledMessage, cancelledNum);
+            }
+            return;
+        }
+        reply.message = visualizationReply(input);
+
+        const QByteArray cmd = input.value(1).toLower();
+        if (cmd == "refresh_ui") {
+            startConcurrentReply(reply, latency);
+            return;
+        }
+        if (cmd == "refresh_image") {
+            startConcurrentReply(reply, (imageLatency >= 0) ? imageLatency : latency);
+            return;
+        }
+    }
+    else if (name == "interact reset") {
+        // empty reply
+    }
+    else if (name == TDriverUtil::interactionId) {
+        reply.message["error_message"] << "interaction is not supported by mock server";
+    }
+    else {
+        reply.message["error_message"] << "invalid request";
+    }
+
+    // replies are sent one at a time, simulating single threaded script with given latency
+    pendingReplies.enqueue(reply);
+    if (pendingReplies.size() == 1) {
+        QTimer::singleShot(latency, this, SLOT(sendNextReply()));
+    }
+}
+
+
+void TDriverMockRbiServer::sendNextReply()
+{
+    if (pendingReplies.isEmpty() || !handler) return;
+
+    PendingReply reply = pendingReplies.dequeue();
+    handler->sendStringListMapMsg(reply.name, reply.message, reply.seqNum);
+
+    if (!pendingReplies.isEmpty()) {
+        QTimer::singleShot(latency, this, SLOT(sendNextReply()));
+    }
+}
+
+
+void TDriverMockRbiServer::startConcurrentReply(const PendingReply &reply, int delay)
+{
+    // own timer for each reply, so replies may complete in different order than requests were sent
+    concurrentReplies.insert(reply.seqNum, reply);
+
+    QTimer *timer = new QTimer(this);
+    timer->setSingleShot(true);
+    timer->setProperty("seqNum", reply.seqNum);
+    connect(timer, SIGNAL(timeout()), SLOT(sendConcurrentReply()));
+    connect(timer, SIGNAL(timeout()), timer, SLOT(deleteLater()));
+    timer->start(delay);
+}
+
+
+void TDriverMockRbiServer::sendConcurrentReply()
+{
+    QObject *timer = sender();
+    if (!timer || !handler) return;
+
+    quint32 seqNum = timer->property("seqNum").toUInt();
+    if (!concurrentReplies.contains(seqNum)) return;
+
+    PendingReply reply = concurrentReplies.take(seqNum);
+    handler->sendStringListMapMsg(reply.name, reply.message, reply.seqNum);
+}
+
+
+BAListMap TDriverMockRbiServer::visualizationReply(const BAList &input)
+{
+    BAListMap reply;
+
+    if (input.size() < 2) {
+        reply["exception"].clear();
+        reply["error"] << "Error: not enough parameters in command";
+        return reply;
+    }
+
+    const QString sutId = QString::fromLatin1(input.at(0));
+    const QByteArray cmd = input.at(1).toLower();
+
+    if (cmd == "check_version") {
+        reply["version"] << "mock";
+    }
+    else if (cmd == "set_output_path") {
+        if (input.size() > 2) outputPath = QString::fromLocal8Bit(input.at(2));
+        reply["output_path"] << QFile::encodeName(outputPath);
+    }
+    else if (cmd == "get_parameter") {
+        reply["parameter"] << input.value(2) << "nil";
+    }
+    else if (cmd == "get_all_parameters") {
+        reply["keys"] << "type" << "default_timeout";
+        reply["values"] << "\"qt\"" << "\"20\"";
+    }
+    else if (cmd == "list_apps") {
+        QString filename = recordedFile("applications.xml");
+        if (filename.isEmpty()) filename = writeOutputFile("visualizer_applications_" + sutId, "xml", applicationsXml());
+        reply["applications_filename"] << QFile::encodeName(filename);
+    }
+    else if (cmd == "refresh_ui") {
+        QString filename = recordedFile("ui_dump.xml");
+        if (filename.isEmpty()) filename = writeOutputFile("visualizer_dump_" + sutId, "xml", uiDumpXml(sutId));
+        reply["ui_filename"] << QFile::encodeName(filename);
+    }
+    else if (cmd == "refresh_subtree") {
+        // ids of synthetic objects are 10000 + index
+        bool ok = false;
+        const int index = input.value(3).toInt(&ok) - 10000;
+        if (!ok || index < 0 || index >= objectCount) {
+            reply["exception"] << "MobyBase::TestObjectNotFoundError" << "object " + input.value(3) + " not found";
+            reply["error"] << "Error: evaluating command (refresh_subtree) failed";
+        }
+        else {
+            QString filename = writeOutputFile("visualizer_subtree_" + sutId, "xml", subtreeXml(index));
+            reply["subtree_filename"] << QFile::encodeName(filename);
+        }
+    }
+    else if (cmd == "refresh_image") {
+        QString filename = recordedFile("image.png");
+        if (filename.isEmpty()) filename = imageFile(sutId);
+        reply["image_filename"] << QFile::encodeName(filename);
+    }
+    else if (cmd == "get_behaviours") {
+        QString filename = recordedFile("behaviours.xml");
+        if (filename.isEmpty()) {
+            BAList objectTypes;
+            foreach (const QByteArray &type, input.value(2).split(',')) {
+                QByteArray trimmed = type.trimmed();
+                if (trimmed.startsWith('\'') || trimmed.startsWith('"')) trimmed = trimmed.mid(1, trimmed.size() - 2);
+                if (!trimmed.isEmpty()) objectTypes << trimmed;
+            }
+            filename = writeOutputFile("visualizer_behaviours_" + sutId, "xml", behavioursXml(objectTypes));
+        }
+        reply["behaviour_filename"] << QFile::encodeName(filename);
+    }
+    else if (cmd == "list_signals") {
+        QString filename = recordedFile("signals.xml");
+        if (filename.isEmpty()) filename = writeOutputFile("visualizer_class_signals_" + sutId, "xml", signalsXml());
+        reply["signal_filename"] << QFile::encodeName(filename);
+    }
+    else if (cmd == "disconnect" || cmd == "tap" || cmd == "press_key"
+             || cmd == "set_attribute" || cmd == "start_application") {
+        // accepted without doing anything
+    }
+    else {
+        reply["exception"].clear();
+        reply["error"] << "Error: no command matched (" + cmd + ")";
+    }
+
+    return reply;
+}
+
+
+QString TDriverMockRbiServer::recordedFile(const QString &baseName) const
+{
+    if (dataDir.isEmpty()) return QString();
+
+    QFileInfo info(QDir(dataDir), baseName);
+    return info.isReadable() ? info.absoluteFilePath() : QString();
+}
+
+
+QString TDriverMockRbiServer::writeOutputFile(const QString &prefix, const QString &extension, const QByteArray &data)
+{
+    // same naming as create_output_file of tdriver_interface.rb
+    QString filename = QDir(outputPath).filePath(prefix + "_1." + extension);
+    QFile file(filename);
+    if (!file.open(QIODevice::WriteOnly) || file.write(data) != data.size()) {
+        qWarning() << FCFL << "failed to write" << filename << file.errorString();
+    }
+    return filename;
+}
+
+
+QByteArray TDriverMockRbiServer::applicationsXml() const
+{
+    QByteArray data;
+    QXmlStreamWriter xml(&data);
+    xml.setAutoFormatting(true);
+    xml.writeStartDocument();
+    xml.writeStartElement("tasMessage");
+    xml.writeAttribute("version", "1.3");
+    xml.writeStartElement("tasInfo");
+    xml.writeAttribute("id", "1");
+    xml.writeAttribute("name", "mock");
+    xml.writeAttribute("type", "qt");
+    xml.writeStartElement("obj");
+    xml.writeAttribute("env", "qt");
+    xml.writeAttribute("id", "");
+    xml.writeAttribute("name", "QApplications");
+    xml.writeAttribute("type", "applications");
+    xml.writeStartElement("obj");
+    xml.writeAttribute("env", "qt");
+    xml.writeAttribute("id", mockApplicationId);
+    xml.writeAttribute("name", mockApplicationName);
+    xml.writeAttribute("type", "application");
+    xml.writeEndElement(); // obj application
+    xml.writeEndElement(); // obj applications
+    xml.writeEndElement(); // tasInfo
+    xml.writeEndElement(); // tasMessage
+    xml.writeEndDocument();
+    return data;
+}
+
+
+static void writeAttr(QXmlStreamWriter &xml, const QString &name, const QString &type, const QString &value)
+{
+    xml.writeStartElement("attr");
+    xml.writeAttribute("name", name);
+    xml.writeAttribute("type", type);
+    xml.writeAttribute("access", "rw");
+    xml.writeCharacters(value);
+    xml.writeEndElement();
+}
+
+
+static void writeGeometryAttrs(QXmlStreamWriter &xml, const QRect &rect)
+{
+    writeAttr(xml, "x", "int", QString::number(rect.x()));
+    writeAttr(xml, "y", "int", QString::number(rect.y()));
+    writeAttr(xml, "x_absolute", "int", QString::number(rect.x()));
+    writeAttr(xml, "y_absolute", "int", QString::number(rect.y()));
+    writeAttr(xml, "width", "int", QString::number(rect.width()));
+    writeAttr(xml, "height", "int", QString::number(rect.height()));
+    writeAttr(xml, "visible", "bool", "true");
+}
+
+
+// children split their parent into horizontal strips
+static QRect mockChildRect(const QRect &rect, int child)
+{
+    const int stripHeight = qMax(1, rect.height() / objectFanout);
+    return QRect(rect.x() + 2, rect.y() + child * stripHeight + 2,
+                 qMax(1, rect.width() - 4), qMax(1, stripHeight - 4));
+}
+
+
+static QRect mockObjectRect(int index, const QRect &appRect)
+{
+    if (index == 0) return appRect;
+    return mockChildRect(mockObjectRect((index - 1) / objectFanout, appRect), (index - 1) % objectFanout);
+}
+
+
+// writes object with given index and its children, objects form a heap indexed tree
+static void writeMockObject(QXmlStreamWriter &xml, int index, int count, const QRect &rect)
+{
+    const QString name = QString("object_%1").arg(index);
+    xml.writeStartElement("obj");
+    xml.writeAttribute("env", "qt");
+    xml.writeAttribute("id", QString::number(10000 + index));
+    xml.writeAttribute("name", name);
+    xml.writeAttribute("type", (index % 3 == 0) ? "QPushButton" : "QWidget");
+
+    writeAttr(xml, "objectName", "QString", name);
+    writeAttr(xml, "text", "QString", QString("Text of %1").arg(name));
+    writeGeometryAttrs(xml, rect);
+
+    const int firstChild = index * objectFanout + 1;
+    for (int child = 0; child < objectFanout && firstChild + child < count; ++child) {
+        writeMockObject(xml, firstChild + child, count, mockChildRect(rect, child));
+    }
+
+    xml.writeEndElement(); // obj
+}
+
+
+QByteArray TDriverMockRbiServer::subtreeXml(int index) const
+{
+    // like xml_data of TDriver test object, object element is the root
+    QByteArray data;
+    QXmlStreamWriter xml(&data);
+    xml.setAutoFormatting(true);
+    xml.writeStartDocument();
+    writeMockObject(xml, index, objectCount, mockObjectRect(index, QRect(QPoint(0, 0), imageSize)));
+    xml.writeEndDocument();
+    return data;
+}
+
+
+QByteArray TDriverMockRbiServer::uiDumpXml(const QString &sutId) const
+{
+    QByteArray data;
+    QXmlStreamWriter xml(&data);
+    xml.setAutoFormatting(true);
+    xml.writeStartDocument();
+    xml.writeStartElement("tasMessage");
+    xml.writeAttribute("version", "1.3");
+    xml.writeStartElement("tasInfo");
+    xml.writeAttribute("env", "qt");
+    xml.writeAttribute("id", sutId);
+    xml.writeAttribute("name", sutId);
+    xml.writeAttribute("type", "qt");
+
+    xml.writeStartElement("obj");
+    xml.writeAttribute("env", "qt");
+    xml.writeAttribute("id", mockApplicationId);
+    xml.writeAttribute("name", mockApplicationName);
+    xml.writeAttribute("type", "application");
+    writeAttr(xml, "objectName", "QString", mockApplicationName);
+
+    QRect appRect(QPoint(0, 0), imageSize);
+    writeGeometryAttrs(xml, appRect);
+    if (objectCount > 0) writeMockObject(xml, 0, objectCount, appRect);
+
+    xml.writeEndElement(); // obj application
+    xml.writeEndElement(); // tasInfo
+    xml.writeEndElement(); // tasMessage
+    xml.writeEndDocument();
+    return data;
+}
+
+
+QByteArray TDriverMockRbiServer::behavioursXml(const BAList &objectTypes) const
+{
+    QByteArray data;
+    QXmlStreamWriter xml(&data);
+    xml.setAutoFormatting(true);
+    xml.writeStartDocument();
+    xml.writeStartElement("behaviours");
+    foreach (const QByteArray &objectType, objectTypes) {
+        xml.writeStartElement("behaviour");
+        xml.writeAttribute("object_type", QString::fromLatin1(objectType));
+        for (int ii = 0; ii < behaviourCount; ++ii) {
+            const QString method = QString("mock_method_%1").arg(ii);
+            xml.writeStartElement("object_method");
+            xml.writeAttribute("name", method);
+            xml.writeTextElement("description", QString("Mock method %1 of %2.").arg(ii).arg(QString::fromLatin1(objectType)));
+            xml.writeTextElement("example", method);
+            xml.writeEndElement(); // object_method
+        }
+        xml.writeEndElement(); // behaviour
+    }
+    xml.writeEndElement(); // behaviours
+    xml.writeEndDocument();
+    return data;
+}
+
+
+QByteArray TDriverMockRbiServer::signalsXml() const
+{
+    QByteArray data;
+    QXmlStreamWriter xml(&data);
+    xml.setAutoFormatting(true);
+    xml.writeStartDocument();
+    xml.writeStartElement("tasMessage");
+    xml.writeAttribute("version", "1.3");
+    xml.writeStartElement("tasInfo");
+    xml.writeAttribute("id", "1");
+    xml.writeAttribute("name", "QtSignals");
+    xml.writeAttribute("type", "QtSignals");
+    for (int ii = 0; ii < signalCount; ++ii) {
+        xml.writeStartElement("obj");
+        xml.writeAttribute("env", "qt");
+        xml.writeAttribute("id", QString::number(ii));
+        xml.writeAttribute("name", QString("mockSignal%1()").arg(ii));
+        xml.writeAttribute("type", "QtSignal");
+        xml.writeEndElement();
+    }
+    xml.writeEndElement(); // tasInfo
+    xml.writeEndElement(); // tasMessage
+    xml.writeEndDocument();
+    return data;
+}
+
+
+QString TDriverMockRbiServer::imageFile(const QString &sutId)
+{
+    QImage image(imageSize, QImage::Format_RGB32);
+    image.fill(Qt::lightGray);
+    {
+        // draw outlines of synthetic objects, so that highlighting can be checked visually
+        QPainter painter(&image);
+        painter.setPen(Qt::darkGray);
+        const int stripHeight = qMax(1, imageSize.height() / objectFanout);
+        for (int child = 0; child < objectFanout && child + 1 < objectCount; ++child) {
+            painter.drawRect(2, child * stripHeight + 2, imageSize.width() - 5, stripHeight - 5);
+        }
+    }
+
+    QString filename = QDir(outputPath).filePath("visualizer_dump_" + sutId + "_1.png");
+    if (!image.save(filename, "PNG")) {
+        qWarning() << FCFL << "failed to save" << filename;
+    }
+    return filename;
+}
@@ -0,0 +1,112 @@
+/***************************************************************************
+**
+** Copyright (C) 2010 Nokia Corporation and/or its subsidiary(-ies).
+** All rights reserved.
+** Contact: Nokia Corporation (testabilitydriver@nokia.com)
+**
+** This file is part of Testability Driver.
+**
+** If you have questions regarding the use of this file, please contact
+** Nokia at testabilitydriver@nokia.com .
+**
+** This library is free software; you can redistribute it and/or
+** modify it under the terms of the GNU Lesser General Public
+** License version 2.1 as published by the Free Software Foundation
+** and appearing in the file LICENSE.LGPL included in the packaging
+** of this file.
+**
+****************************************************************************/
+
+
+#ifndef TDRIVER_MOCKRBISERVER_H
+#define TDRIVER_MOCKRBISERVER_H
+
+#include <tdriver_rbiprotocol.h>
+#include <tdriver_rbimessage.h>
+
+#include <QObject>
+#include <QTcpServer>
+#include <QMutex>
+#include <QWaitCondition>
+#include <QQueue>
+#include <QMap>
+#include <QSize>
+
+class QTcpSocket;
+
+// Stand-in for tdriver_interface.rb, which speaks TDriverRbiProtocol framing
+// and answers visualization commands with synthetic or recorded data.
+// Used for running Visualizer without TDriver and SUT, for load and latency benchmarks.
+class TDriverMockRbiServer : public QObject
+{
+    Q_OBJECT
+public:
+    explicit TDriverMockRbiServer(QObject *parent = 0);
+
+    // configuration, must be set before listen()
+    void setLatency(int ms) { latency = ms; }
+    void setImageLatency(int ms) { imageLatency = ms; }
+    void setObjectCount(int count) { objectCount = count; }
+    void setImageSize(const QSize &size) { imageSize = size; }
+    void setBehaviourCount(int count) { behaviourCount = count; }
+    void setSignalCount(int count) { signalCount = count; }
+    void setDataDir(const QString &dir) { dataDir = dir; }
+    void setOutputPath(const QString &path) { outputPath = path; }
+
+    // starts listening on localhost, and prints the startup line expected by TDriverRubyInterface
+    bool listen();
+
+signals:
+    void finished();
+
+private slots:
+    void acceptConnection();
+    void handleMessage(TDriverRbiMessage rbiMessage);
+    void sendNextReply();
+    void sendConcurrentReply();
+    void connectionClosed();
+
+private:
+    struct PendingReply {
+        quint32 seqNum;
+        QByteArray name;
+        BAListMap message;
+    };
+
+    BAListMap visualizationReply(const BAList &input);
+    void startConcurrentReply(const PendingReply &reply, int delay);
+
+    QString recordedFile(const QString &baseName) const;
+    QString writeOutputFile(const QString &prefix, const QString &extension, const QByteArray &data);
+
+    QByteArray applicationsXml() const;
+    QByteArray uiDumpXml(const QString &sutId) const;
+    QByteArray subtreeXml(int index) const;
+    QByteArray behavioursXml(const BAList &objectTypes) const;
+    QByteArray signalsXml() const;
+    QString imageFile(const QString &sutId);
+
+private:
+    QTcpServer server;
+    QTcpSocket *conn;
+    TDriverRbiProtocol *handler;
+
+    // required by TDriverRbiProtocol, not used for waiting in this single threaded server
+    QMutex syncMutex;
+    QWaitCondition helloCond;
+
+    QQueue<PendingReply> pendingReplies;
+    // replies of refresh_ui and refresh_image, which tdriver_interface.rb executes concurrently
+    QMap<quint32, PendingReply> concurrentReplies;
+
+    int latency;
+    int imageLatency;
+    int objectCount;
+    QSize imageSize;
+    int behaviourCount;
+    int signalCount;
+    QString dataDir;
+    QString outputPath;
+};
+
+#endif // TDRIVER_MOCKRBISERVER_H
@@ -0,0 +1,42 @@
+############################################################################
+##
+## Copyright (C) 2010 Nokia Corporation and/or its subsidiary(-ies).
+## All rights reserved.
+## Contact: Nokia Corporation (testabilitydriver@nokia.com)
+##
+## This file is part of Testability Driver.
+##
+## If you have questions regarding the use of this file, please contact
+## Nokia at testabilitydriver@nokia.com .
+##
+## This library is free software; you can redistribute it and/or
+## modify it under the terms of the GNU Lesser General Public
+## License version 2.1 as published by the Free Software Foundation
+## and appearing in the file LICENSE.LGPL included in the packaging
+## of this file.
+##
+############################################################################
+
+
+# This file assumes it's being included by test/auto/<test>/<test>.pro
+
+UTILLIBDIR = ../../../libtdriverutil
+UTIL_LIB = tdriverutil
+
+VISUALIZER_SRC = ../../../src
+VISUALIZER_INC = ../../../inc
+
+DESTDIR = ../../../bin
+QMAKE_LIBDIR = $$DESTDIR $$QMAKE_LIBDIR
+
+TEMPLATE = app
+CONFIG += testcase console link_prl
+CONFIG -= app_bundle
+
+QT += testlib
+
+INCLUDEPATH += $$UTILLIBDIR $$VISUALIZER_INC
+LIBS += -l$$UTIL_LIB
+
+# tests are run from the build tree, where libtdriverutil is not installed
+unix: QMAKE_RPATHDIR += $$OUT_PWD/$$DESTDIR
@@ -0,0 +1,291 @@
+/***************************************************************************
+**
+** Copyright (C) 2010 Nokia Corporation and/or its subsidiary(-ies).
+** All rights reserved.
+** Contact: Nokia Corporation (testabilitydriver@nokia.com)
+**
+** This file is part of Testability Driver.
+**
+** If you have questions regarding the use of this file, please contact
+** Nokia at testabilitydriver@nokia.com .
+**
+** This library is free software; you can redistribute it and/or
+** modify it under the terms of the GNU Lesser General Public
+** License version 2.1 as published by the Free Software Foundation
+** and appearing in the file LICENSE.LGPL included in the packaging
+** of this file.
+**
+****************************************************************************/
+
+
+#include <QtTest>
+#include <QBuffer>
+
+#include <tdriver_behaviour.h>
+
+
+class TestTDriverBehaviours : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void parseSortsMethods();
+    void parseNestedText();
+    void parseError();
+    void sharedTables();
+    void mergeIntoKnownType();
+    void clear();
+    void cacheRoundTrip();
+    void cacheOtherKey();
+    void cacheUnknownFormat();
+    void cacheTruncated();
+    void cacheKeepsKnownTypes();
+};
+
+
+static const char behavioursXml[] =
+        "<?xml version=\"1.0\"?>\n"
+        "<behaviours>\n"
+        "<behaviour object_type=\"QPushButton\">\n"
+        "  <object_method name=\"tap\"><description>Taps object.</description><example>tap</example></object_method>\n"
+        "  <object_method name=\"drag\"><description>Drags object.</description><example>drag(1, 2)</example></object_method>\n"
+        "</behaviour>\n"
+        "<behaviour object_type=\"QToolButton\">\n"
+        "  <object_method name=\"drag\"><description>Drags object.</description><example>drag(1, 2)</example></object_method>\n"
+        "  <object_method name=\"tap\"><description>Taps object.</description><example>tap</example></object_method>\n"
+        "</behaviour>\n"
+        "<behaviour object_type=\"sut\">\n"
+        "  <object_method name=\"list_apps\"><description>Lists applications.</description><example>list_apps</example></object_method>\n"
+        "</behaviour>\n"
+        "</behaviours>\n";
+
+
+static bool parseBehaviours(BehaviourRegistry &registry, const QByteArray &xml)
+{
+    QBuffer buffer;
+    buffer.setData(xml);
+    buffer.open(QIODevice::ReadOnly);
+    return registry.parseXml(&buffer);
+}
+
+
+static QByteArray cacheData(const BehaviourRegistry &registry, const QString &key)
+{
+    QBuffer buffer;
+    buffer.open(QIODevice::WriteOnly);
+    registry.writeCache(&buffer, key);
+    return buffer.data();
+}
+
+
+static bool readCache(BehaviourRegistry &registry, const QByteArray &data, const QString &key)
+{
+    QBuffer buffer;
+    buffer.setData(data);
+    buffer.open(QIODevice::ReadOnly);
+    return registry.readCache(&buffer, key);
+}
+
+
+static QStringList methodNames(const BehaviourRegistry &registry, const QString &objectType)
+{
+    QStringList names;
+    const BehaviourMethodTable *table = registry.methods(objectType);
+    if (table) {
+        foreach (const BehaviourMethod *method, *table) names << method->name;
+    }
+    return names;
+}
+
+
+void TestTDriverBehaviours::parseSortsMethods()
+{
+    BehaviourRegistry registry;
+    QVERIFY(parseBehaviours(registry, behavioursXml));
+
+    QVERIFY(registry.contains("QPushButton"));
+    QVERIFY(!registry.contains("QLabel"));
+    QVERIFY(!registry.methods("QLabel"));
+
+    QCOMPARE(methodNames(registry, "QPushButton"), QStringList() << "drag" << "tap");
+    QCOMPARE(methodNames(registry, "sut"), QStringList() << "list_apps");
+    QCOMPARE(registry.methods("sut")->at(0)->description, QString("Lists applications."));
+    QCOMPARE(registry.methods("sut")->at(0)->example, QString("list_apps"));
+}
+
+
+void TestTDriverBehaviours::parseNestedText()
+{
+    BehaviourRegistry registry;
+    QVERIFY(parseBehaviours(registry,
+                            "<behaviours><behaviour object_type=\"QLabel\">"
+                            "<object_method name=\"text\">"
+                            "<arguments><argument name=\"x\"/></arguments>"
+                            "<description>Returns <b>text</b> of label.</description>"
+                            "<example>label.text</example>"
+                            "</object_method>"
+                            "</behaviour></behaviours>"));
+
+    // text of nested elements is included, unknown elements are skipped
+    const BehaviourMethodTable *table = registry.methods("QLabel");
+    QVERIFY(table);
+    QCOMPARE(table->size(), 1);
+    QCOMPARE(table->at(0)->description, QString("Returns text of label."));
+    QCOMPARE(table->at(0)->example, QString("label.text"));
+}
+
+
+void TestTDriverBehaviours::parseError()
+{
+    BehaviourRegistry registry;
+    QBuffer buffer;
+    buffer.setData("<behaviours><behaviour object_type=\"QLabel\"><object_method name=\"text\">");
+    buffer.open(QIODevice::ReadOnly);
+
+    QString errorString;
+    QVERIFY(!registry.parseXml(&buffer, &errorString));
+    QVERIFY(!errorString.isEmpty());
+}
+
+
+void TestTDriverBehaviours::sharedTables()
+{
+    BehaviourRegistry registry;
+    QVERIFY(parseBehaviours(registry, behavioursXml));
+
+    // each distinct method and each distinct sorted table is stored once
+    QCOMPARE(registry.methodCount(), 3);
+    QCOMPARE(registry.tableCount(), 2);
+    QCOMPARE(registry.methods("QPushButton"), registry.methods("QToolButton"));
+
+    // another reply with the same methods adds nothing
+    QVERIFY(parseBehaviours(registry,
+                            "<behaviours><behaviour object_type=\"QCheckBox\">"
+                            "<object_method name=\"tap\"><description>Taps object.</description><example>tap</example></object_method>"
+                            "<object_method name=\"drag\"><description>Drags object.</description><example>drag(1, 2)</example></object_method>"
+                            "</behaviour></behaviours>"));
+    QCOMPARE(registry.methodCount(), 3);
+    QCOMPARE(registry.tableCount(), 2);
+    QCOMPARE(registry.methods("QCheckBox"), registry.methods("QPushButton"));
+}
+
+
+void TestTDriverBehaviours::mergeIntoKnownType()
+{
+    BehaviourRegistry registry;
+    QVERIFY(parseBehaviours(registry, behavioursXml));
+    const BehaviourMethodTable *before = registry.methods("QToolButton");
+
+    // methods are added to known type, method with a known name is not replaced
+    QVERIFY(parseBehaviours(registry,
+                            "<behaviours><behaviour object_type=\"QToolButton\">"
+                            "<object_method name=\"tap\"><description>Other.</description></object_method>"
+                            "<object_method name=\"press\"><description>Presses object.</description></object_method>"
+                            "</behaviour></behaviours>"));
+
+    QCOMPARE(methodNames(registry, "QToolButton"), QStringList() << "drag" << "press" << "tap");
+    QCOMPARE(registry.methods("QToolButton")->at(2)->description, QString("Taps object."));
+
+    // other types using the same table are not affected
+    QCOMPARE(registry.methods("QPushButton"), before);
+    QCOMPARE(methodNames(registry, "QPushButton"), QStringList() << "drag" << "tap");
+}
+
+
+void TestTDriverBehaviours::clear()
+{
+    BehaviourRegistry registry;
+    QVERIFY(parseBehaviours(registry, behavioursXml));
+
+    registry.clear();
+    QVERIFY(registry.objectTypes().isEmpty());
+    QCOMPARE(registry.methodCount(), 0);
+    QCOMPARE(registry.tableCount(), 0);
+}
+
+
+void TestTDriverBehaviours::cacheRoundTrip()
+{
+    BehaviourRegistry source;
+    QVERIFY(parseBehaviours(source, behavioursXml));
+
+    BehaviourRegistry loaded;
+    QVERIFY(readCache(loaded, cacheData(source, "1.0|qt"), "1.0|qt"));
+
+    QStringList types = loaded.objectTypes();
+    types.sort();
+    QCOMPARE(types, QStringList() << "QPushButton" << "QToolButton" << "sut");
+    QCOMPARE(methodNames(loaded, "QPushButton"), QStringList() << "drag" << "tap");
+    QCOMPARE(loaded.methods("QPushButton")->at(0)->example, QString("drag(1, 2)"));
+    QCOMPARE(loaded.methods("QPushButton")->at(1)->description, QString("Taps object."));
+
+    // sharing of methods and tables survives the cache
+    QCOMPARE(loaded.methodCount(), source.methodCount());
+    QCOMPARE(loaded.tableCount(), source.tableCount());
+    QCOMPARE(loaded.methods("QPushButton"), loaded.methods("QToolButton"));
+}
+
+
+void TestTDriverBehaviours::cacheOtherKey()
+{
+    BehaviourRegistry source;
+    QVERIFY(parseBehaviours(source, behavioursXml));
+
+    // behaviours of another cuTeDriver version or sut type are not used
+    BehaviourRegistry loaded;
+    QVERIFY(!readCache(loaded, cacheData(source, "1.0|qt"), "1.1|qt"));
+    QVERIFY(loaded.objectTypes().isEmpty());
+}
+
+
+void TestTDriverBehaviours::cacheUnknownFormat()
+{
+    BehaviourRegistry loaded;
+    QVERIFY(!readCache(loaded, QByteArray(), "1.0|qt"));
+    QVERIFY(!readCache(loaded, QByteArray("<behaviours/>"), "1.0|qt"));
+
+    // same magic number with another format version
+    QByteArray data;
+    {
+        QDataStream out(&data, QIODevice::WriteOnly);
+        out << quint32(0x54444243) << qint32(1) << QString("1.0|qt");
+    }
+    QVERIFY(!readCache(loaded, data, "1.0|qt"));
+    QVERIFY(loaded.objectTypes().isEmpty());
+}
+
+
+void TestTDriverBehaviours::cacheTruncated()
+{
+    BehaviourRegistry source;
+    QVERIFY(parseBehaviours(source, behavioursXml));
+    QByteArray data = cacheData(source, "1.0|qt");
+
+    BehaviourRegistry loaded;
+    QVERIFY(!readCache(loaded, data.left(data.size() - 3), "1.0|qt"));
+}
+
+
+void TestTDriverBehaviours::cacheKeepsKnownTypes()
+{
+    BehaviourRegistry source;
+    QVERIFY(parseBehaviours(source, behavioursXml));
+    const QByteArray data = cacheData(source, "1.0|qt");
+
+    // behaviours received before cache was loaded are kept
+    BehaviourRegistry loaded;
+    QVERIFY(parseBehaviours(loaded,
+                            "<behaviours><behaviour object_type=\"QPushButton\">"
+                            "<object_method name=\"press\"/>"
+                            "</behaviour></behaviours>"));
+    QVERIFY(readCache(loaded, data, "1.0|qt"));
+
+    QCOMPARE(methodNames(loaded, "QPushButton"), QStringList() << "press");
+    QCOMPARE(methodNames(loaded, "QToolButton"), QStringList() << "drag" << "tap");
+    QVERIFY(loaded.contains("sut"));
+}
+
+
+QTEST_APPLESS_MAIN(TestTDriverBehaviours)
+
+#include "tst_tdriver_behaviours.moc"
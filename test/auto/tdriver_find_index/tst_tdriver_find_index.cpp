@@ -0,0 +1,276 @@
+/***************************************************************************
+**
+** Copyright (C) 2010 Nokia Corporation and/or its subsidiary(-ies).
+** All rights reserved.
+** Contact: Nokia Corporation (testabilitydriver@nokia.com)
+**
+** This file is part of Testability Driver.
+**
+** If you have questions regarding the use of this file, please contact
+** Nokia at testabilitydriver@nokia.com .
+**
+** This library is free software; you can redistribute it and/or
+** modify it under the terms of the GNU Lesser General Public
+** License version 2.1 as published by the Free Software Foundation
+** and appearing in the file LICENSE.LGPL included in the packaging
+** of this file.
+**
+****************************************************************************/
+
+
+#include <QtTest>
+
+#include <tdriver_find_index.h>
+
+
+class TestTDriverFindIndex : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void init();
+    void tree();
+    void find_data();
+    void find();
+    void candidatesIncludeMatches_data();
+    void candidatesIncludeMatches();
+    void lastQuery();
+    void step_data();
+    void step();
+    void valueNodes();
+    void clear();
+
+private:
+    int addNode(const QString &type, const QString &name, const QString &id, int parent,
+                const QString &text = QString());
+    TDriverFindIndex index;
+};
+
+
+static TestObjectKey testKey(int number)
+{
+    return reinterpret_cast<TestObjectKey>(quintptr(number + 1) * 16);
+}
+
+
+int TestTDriverFindIndex::addNode(const QString &type, const QString &name, const QString &id, int parent,
+                                  const QString &text)
+{
+    TreeItemInfo info;
+    info.type = type;
+    info.name = name;
+    info.id = id;
+    info.env = "qt";
+
+    QMap<QString, AttributeInfo> attributes;
+    if (!text.isNull()) {
+        AttributeInfo attribute;
+        attribute.name = "Text";
+        attribute.value = text;
+        attributes.insert("text", attribute);
+    }
+    return index.addNode(testKey(index.size()), info, attributes, parent);
+}
+
+
+// 0 sut
+//   1 QMainWindow
+//     2 QPushButton okButton "OK"
+//     3 QPushButton cancelButton "Cancel"
+//     4 QLabel statusLabel "Ready to calculate"
+//   5 QDialog aboutDialog
+void TestTDriverFindIndex::init()
+{
+    index.clear();
+    addNode("sut", "sut_qt", "1", -1);
+    addNode("QMainWindow", "MainWindow", "10", 0);
+    addNode("QPushButton", "okButton", "11", 1, "OK");
+    addNode("QPushButton", "cancelButton", "12", 1, "Cancel");
+    addNode("QLabel", "statusLabel", "13", 1, "Ready to calculate");
+    index.setSubtreeEnd(1, 5);
+    addNode("QDialog", "aboutDialog", "14", 0);
+    index.setSubtreeEnd(0, 6);
+}
+
+
+void TestTDriverFindIndex::tree()
+{
+    QCOMPARE(index.size(), 6);
+    QVERIFY(!index.isEmpty());
+
+    QCOMPARE(index.node(testKey(3)), 3);
+    QCOMPARE(index.node(testKey(42)), -1);
+    QCOMPARE(index.key(4), testKey(4));
+
+    QCOMPARE(index.parent(0), -1);
+    QCOMPARE(index.parent(3), 1);
+    QCOMPARE(index.parent(5), 0);
+    QCOMPARE(index.subtreeEnd(0), 6);
+    QCOMPARE(index.subtreeEnd(1), 5);
+    QCOMPARE(index.subtreeEnd(2), 3);
+}
+
+
+static TDriverFindIndex::Query makeQuery(const QString &text, bool caseSensitive, bool entireWords, bool attributes)
+{
+    TDriverFindIndex::Query query;
+    query.text = text;
+    query.caseSensitive = caseSensitive;
+    query.entireWords = entireWords;
+    query.attributes = attributes;
+    return query;
+}
+
+
+static void addQueryRows()
+{
+    QTest::addColumn<QString>("text");
+    QTest::addColumn<bool>("caseSensitive");
+    QTest::addColumn<bool>("entireWords");
+    QTest::addColumn<bool>("attributes");
+    QTest::addColumn<QVector<int> >("expected");
+
+    QTest::newRow("substring") << "button" << false << false << false << (QVector<int>() << 2 << 3);
+    QTest::newRow("substring case") << "Button" << true << false << false << (QVector<int>() << 2 << 3);
+    QTest::newRow("substring case miss") << "BUTTON" << true << false << false << QVector<int>();
+    QTest::newRow("short") << "ok" << false << false << false << (QVector<int>() << 2);
+    QTest::newRow("short case") << "OK" << true << false << false << QVector<int>();
+    QTest::newRow("short attributes") << "OK" << true << false << true << (QVector<int>() << 2);
+    QTest::newRow("id") << "13" << false << false << false << (QVector<int>() << 4);
+    QTest::newRow("word") << "okbutton" << false << true << false << (QVector<int>() << 2);
+    QTest::newRow("word case") << "okbutton" << true << true << false << QVector<int>();
+    QTest::newRow("word type") << "QPushButton" << false << true << false << (QVector<int>() << 2 << 3);
+    QTest::newRow("word part") << "Push" << false << true << false << QVector<int>();
+    QTest::newRow("attribute") << "calculate" << false << false << true << (QVector<int>() << 4);
+    QTest::newRow("attribute off") << "calculate" << false << false << false << QVector<int>();
+    QTest::newRow("attribute word") << "cancel" << false << true << true << (QVector<int>() << 3);
+    QTest::newRow("attribute word part") << "Ready" << false << true << true << QVector<int>();
+    QTest::newRow("missing gram") << "xyzzy" << false << false << true << QVector<int>();
+}
+
+
+void TestTDriverFindIndex::find_data()
+{
+    addQueryRows();
+}
+
+
+void TestTDriverFindIndex::find()
+{
+    QFETCH(QString, text);
+    QFETCH(bool, caseSensitive);
+    QFETCH(bool, entireWords);
+    QFETCH(bool, attributes);
+    QFETCH(QVector<int>, expected);
+
+    QCOMPARE(index.find(makeQuery(text, caseSensitive, entireWords, attributes)), expected);
+}
+
+
+void TestTDriverFindIndex::candidatesIncludeMatches_data()
+{
+    addQueryRows();
+}
+
+
+void TestTDriverFindIndex::candidatesIncludeMatches()
+{
+    QFETCH(QString, text);
+    QFETCH(bool, caseSensitive);
+    QFETCH(bool, entireWords);
+    QFETCH(bool, attributes);
+
+    // index only selects candidates, so it must not lose any node that a full scan matches
+    const TDriverFindIndex::Query query = makeQuery(text, caseSensitive, entireWords, attributes);
+    const QVector<int> candidates = index.candidates(query);
+    for (int node = 0; node < index.size(); ++node) {
+        if (index.matches(node, query)) QVERIFY2(candidates.contains(node), qPrintable(QString::number(node)));
+    }
+}
+
+
+void TestTDriverFindIndex::lastQuery()
+{
+    const TDriverFindIndex::Query query = makeQuery("button", false, false, false);
+    const QVector<int> *first = &index.find(query);
+    QCOMPARE(&index.find(query), first);
+    QCOMPARE(first->size(), 2);
+
+    // added node invalidates kept result
+    addNode("QPushButton", "helpButton", "15", 5);
+    QCOMPARE(index.find(query), QVector<int>() << 2 << 3 << 6);
+}
+
+
+void TestTDriverFindIndex::step_data()
+{
+    QTest::addColumn<int>("current");
+    QTest::addColumn<int>("first");
+    QTest::addColumn<int>("end");
+    QTest::addColumn<bool>("backwards");
+    QTest::addColumn<bool>("wrap");
+    QTest::addColumn<int>("expected");
+
+    // matches are 2, 3 and 5
+    QTest::newRow("next") << 2 << 0 << 6 << false << false << 3;
+    QTest::newRow("next from root") << 0 << 0 << 6 << false << false << 2;
+    QTest::newRow("next from non-match") << 4 << 0 << 6 << false << false << 5;
+    QTest::newRow("next at end") << 5 << 0 << 6 << false << false << -1;
+    QTest::newRow("next wraps") << 5 << 0 << 6 << false << true << 2;
+    QTest::newRow("previous") << 3 << 0 << 6 << true << false << 2;
+    QTest::newRow("previous from non-match") << 4 << 0 << 6 << true << false << 3;
+    QTest::newRow("previous at start") << 2 << 0 << 6 << true << false << -1;
+    QTest::newRow("previous wraps") << 2 << 0 << 6 << true << true << 5;
+    QTest::newRow("previous from root wraps") << 0 << 0 << 6 << true << true << 5;
+    QTest::newRow("subtree next") << 3 << 1 << 5 << false << false << -1;
+    QTest::newRow("subtree next wraps") << 3 << 1 << 5 << false << true << 2;
+    QTest::newRow("subtree previous wraps") << 1 << 1 << 5 << true << true << 3;
+    QTest::newRow("subtree without matches") << 4 << 4 << 5 << false << true << -1;
+}
+
+
+void TestTDriverFindIndex::step()
+{
+    QFETCH(int, current);
+    QFETCH(int, first);
+    QFETCH(int, end);
+    QFETCH(bool, backwards);
+    QFETCH(bool, wrap);
+    QFETCH(int, expected);
+
+    const QVector<int> matches = QVector<int>() << 2 << 3 << 5;
+    QCOMPARE(TDriverFindIndex::step(matches, current, first, end, backwards, wrap), expected);
+}
+
+
+void TestTDriverFindIndex::valueNodes()
+{
+    QCOMPARE(index.valueNodes("type", "QPushButton"), QVector<int>() << 2 << 3);
+    QCOMPARE(index.valueNodes("name", "aboutDialog"), QVector<int>() << 5);
+    QCOMPARE(index.valueNodes("text", "OK"), QVector<int>() << 2);
+    QVERIFY(index.valueNodes("text", "ok").isEmpty());
+    QVERIFY(index.valueNodes("checked", "true").isEmpty());
+
+    QCOMPARE(index.fieldValue(3, "text"), QString("Cancel"));
+    QVERIFY(index.fieldValue(1, "text").isNull());
+    QCOMPARE(index.fieldName(3, "text"), QString("Text"));
+    QCOMPARE(index.fieldName(3, "type"), QString("type"));
+
+    // field indexes are rebuilt after nodes are added
+    addNode("QPushButton", "helpButton", "15", 5, "OK");
+    QCOMPARE(index.valueNodes("text", "OK"), QVector<int>() << 2 << 6);
+}
+
+
+void TestTDriverFindIndex::clear()
+{
+    index.clear();
+    QVERIFY(index.isEmpty());
+    QCOMPARE(index.node(testKey(0)), -1);
+    QVERIFY(index.find(makeQuery("button", false, false, false)).isEmpty());
+}
+
+
+QTEST_APPLESS_MAIN(TestTDriverFindIndex)
+
+#include "tst_tdriver_find_index.moc"
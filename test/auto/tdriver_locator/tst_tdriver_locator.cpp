@@ -0,0 +1,181 @@
+/***************************************************************************
+**
+** Copyright (C) 2010 Nokia Corporation and/or its subsidiary(-ies).
+** All rights reserved.
+** Contact: Nokia Corporation (testabilitydriver@nokia.com)
+**
+** This file is part of Testability Driver.
+**
+** If you have questions regarding the use of this file, please contact
+** Nokia at testabilitydriver@nokia.com .
+**
+** This library is free software; you can redistribute it and/or
+** modify it under the terms of the GNU Lesser General Public
+** License version 2.1 as published by the Free Software Foundation
+** and appearing in the file LICENSE.LGPL included in the packaging
+** of this file.
+**
+****************************************************************************/
+
+
+#include <QtTest>
+
+#include <tdriver_locator.h>
+#include <tdriver_find_index.h>
+
+
+class TestTDriverLocator : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void initTestCase();
+    void compileError_data();
+    void compileError();
+    void evaluate_data();
+    void evaluate();
+    void invalidEvaluatesEmpty();
+
+private:
+    void addNode(const QString &type, const QString &name, int parent, const QString &text = QString());
+    TDriverFindIndex index;
+};
+
+
+void TestTDriverLocator::addNode(const QString &type, const QString &name, int parent, const QString &text)
+{
+    TreeItemInfo info;
+    info.type = type;
+    info.name = name;
+    info.id = QString::number(100 + index.size());
+    info.env = "qt";
+
+    QMap<QString, AttributeInfo> attributes;
+    if (!text.isNull()) {
+        AttributeInfo attribute;
+        attribute.name = "text";
+        attribute.value = text;
+        attributes.insert("text", attribute);
+    }
+    index.addNode(reinterpret_cast<TestObjectKey>(quintptr(index.size() + 1) * 16), info, attributes, parent);
+}
+
+
+// 0 sut
+//   1 application calculator
+//     2 QMainWindow
+//       3 QPushButton okButton "OK"
+//       4 QPushButton cancelButton "Cancel"
+//       5 QWidget panel
+//         6 QPushButton helpButton "Help"
+//     7 QDialog aboutDialog
+//       8 QPushButton closeButton "OK"
+void TestTDriverLocator::initTestCase()
+{
+    addNode("sut", "sut_qt", -1);
+    addNode("application", "calculator", 0);
+    addNode("QMainWindow", "MainWindow", 1);
+    addNode("QPushButton", "okButton", 2, "OK");
+    addNode("QPushButton", "cancelButton", 2, "Cancel");
+    addNode("QWidget", "panel", 2);
+    addNode("QPushButton", "helpButton", 5, "Help");
+    index.setSubtreeEnd(5, 7);
+    index.setSubtreeEnd(2, 7);
+    addNode("QDialog", "aboutDialog", 1);
+    addNode("QPushButton", "closeButton", 7, "OK");
+    index.setSubtreeEnd(7, 9);
+    index.setSubtreeEnd(1, 9);
+    index.setSubtreeEnd(0, 9);
+}
+
+
+void TestTDriverLocator::compileError_data()
+{
+    QTest::addColumn<QString>("text");
+    QTest::addColumn<QString>("error");
+
+    QTest::newRow("empty") << "" << "Object type expected";
+    QTest::newRow("sut only") << "sut" << "Object type expected";
+    QTest::newRow("trailing dot") << "QPushButton." << "Object type expected";
+    QTest::newRow("open argument list") << "QPushButton(" << "Attribute name expected";
+    QTest::newRow("missing arrow") << "QPushButton(:text 'OK')" << "=> expected";
+    QTest::newRow("missing colon") << "QPushButton(text 'OK')" << ": expected";
+    QTest::newRow("missing value") << "QPushButton(:text => )" << "Value expected";
+    QTest::newRow("missing paren") << "QPushButton(:text => 'OK'" << ") expected";
+    QTest::newRow("unterminated string") << "QPushButton(:text => 'OK)" << "Unterminated string";
+    QTest::newRow("unterminated regexp") << "QPushButton(:text => /OK)" << "Unterminated regular expression";
+    QTest::newRow("regexp option") << "QPushButton(:text => /OK/q)" << "Unknown regular expression option";
+    QTest::newRow("invalid regexp") << "QPushButton(:text => /O(K/)" << "Invalid regular expression";
+    QTest::newRow("negative index") << "QPushButton(:__index => -1)" << "Invalid :__index";
+    QTest::newRow("text index") << "QPushButton(:__index => 'first')" << "Invalid :__index";
+    QTest::newRow("unexpected text") << "QPushButton extra" << "Unexpected text at position 13";
+}
+
+
+void TestTDriverLocator::compileError()
+{
+    QFETCH(QString, text);
+    QFETCH(QString, error);
+
+    QString compileError;
+    TDriverLocator locator = TDriverLocator::compile(text, &compileError);
+    QVERIFY(!locator.isValid());
+    QVERIFY2(compileError.startsWith(error), qPrintable(compileError));
+}
+
+
+void TestTDriverLocator::evaluate_data()
+{
+    QTest::addColumn<QString>("text");
+    QTest::addColumn<QVector<int> >("expected");
+
+    QTest::newRow("type") << "QPushButton" << (QVector<int>() << 3 << 4 << 6 << 8);
+    QTest::newRow("sut prefix") << "sut.application.QPushButton" << (QVector<int>() << 3 << 4 << 6 << 8);
+    QTest::newRow("tdriver prefix") << "TDriver.sut(:Id => 'sut_qt').QDialog" << (QVector<int>() << 7);
+    QTest::newRow("attribute") << "@sut.application( :name => 'calculator' ).QPushButton( :text => 'OK' )" << (QVector<int>() << 3 << 8);
+    QTest::newRow("attribute name case") << "QPushButton(:Text => 'OK')" << (QVector<int>() << 3 << 8);
+    QTest::newRow("descendant") << "QMainWindow.QPushButton(:text => 'OK')" << (QVector<int>() << 3);
+    QTest::newRow("nested descendant") << "QMainWindow.QWidget.QPushButton" << (QVector<int>() << 6);
+    QTest::newRow("other subtree") << "QDialog.QPushButton" << (QVector<int>() << 8);
+    QTest::newRow("not descendant") << "QDialog.QWidget" << QVector<int>();
+    QTest::newRow("regexp") << "QPushButton(:name => /^(ok|close)Button$/)" << (QVector<int>() << 3 << 8);
+    QTest::newRow("regexp option") << "QPushButton(:name => /HELP/i)" << (QVector<int>() << 6);
+    QTest::newRow("index") << "QPushButton(:name => /button/i, :__index => 1)" << (QVector<int>() << 4);
+    QTest::newRow("index after descendant") << "QDialog.QPushButton(:__index => 0)" << (QVector<int>() << 8);
+    QTest::newRow("index out of range") << "QPushButton(:__index => 9)" << QVector<int>();
+    QTest::newRow("child") << "child(:name => 'panel')" << (QVector<int>() << 5);
+    QTest::newRow("children type") << "children(:type => 'QPushButton', :text => 'OK')" << (QVector<int>() << 3 << 8);
+    QTest::newRow("new hash syntax") << "QPushButton(text: 'Help')" << (QVector<int>() << 6);
+    QTest::newRow("string key") << "QPushButton('text' => \"Cancel\")" << (QVector<int>() << 4);
+    QTest::newRow("escaped quote") << "QPushButton(:text => 'O\\K')" << (QVector<int>() << 3 << 8);
+    QTest::newRow("option ignored") << "QPushButton(:text => 'OK', :__timeout => 5)" << (QVector<int>() << 3 << 8);
+    QTest::newRow("number literal") << "QPushButton(:id => 104)" << (QVector<int>() << 4);
+    QTest::newRow("nil") << "QPushButton(:text => nil)" << QVector<int>();
+    QTest::newRow("missing attribute") << "QPushButton(:checked => 'true')" << QVector<int>();
+    QTest::newRow("unknown type") << "QLabel" << QVector<int>();
+}
+
+
+void TestTDriverLocator::evaluate()
+{
+    QFETCH(QString, text);
+    QFETCH(QVector<int>, expected);
+
+    QString error;
+    TDriverLocator locator = TDriverLocator::compile(text, &error);
+    QVERIFY2(locator.isValid(), qPrintable(error));
+    QVERIFY(error.isEmpty());
+    QCOMPARE(locator.evaluate(index), expected);
+}
+
+
+void TestTDriverLocator::invalidEvaluatesEmpty()
+{
+    QVERIFY(TDriverLocator().evaluate(index).isEmpty());
+    QVERIFY(TDriverLocator::compile("QPushButton(").evaluate(index).isEmpty());
+}
+
+
+QTEST_APPLESS_MAIN(TestTDriverLocator)
+
+#include "tst_tdriver_locator.moc"
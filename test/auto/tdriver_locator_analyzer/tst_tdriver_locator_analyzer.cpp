@@ -0,0 +1,155 @@
+/***************************************************************************
+**
+** Copyright (C) 2010 Nokia Corporation and/or its subsidiary(-ies).
+** All rights reserved.
+** Contact: Nokia Corporation (testabilitydriver@nokia.com)
+**
+** This file is part of Testability Driver.
+**
+** If you have questions regarding the use of this file, please contact
+** Nokia at testabilitydriver@nokia.com .
+**
+** This library is free software; you can redistribute it and/or
+** modify it under the terms of the GNU Lesser General Public
+** License version 2.1 as published by the Free Software Foundation
+** and appearing in the file LICENSE.LGPL included in the packaging
+** of this file.
+**
+****************************************************************************/
+
+
+#include <QtTest>
+
+#include <tdriver_locator_analyzer.h>
+#include <tdriver_locator.h>
+#include <tdriver_find_index.h>
+
+
+class TestTDriverLocatorAnalyzer : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void initTestCase();
+    void uniqueLocator_data();
+    void uniqueLocator();
+    void allLocatorsUnique();
+    void keptUntilCleared();
+
+private:
+    void addNode(const QString &type, const QString &name, int parent,
+                 const QString &field = QString(), const QString &value = QString());
+    TDriverFindIndex index;
+};
+
+
+void TestTDriverLocatorAnalyzer::addNode(const QString &type, const QString &name, int parent,
+                                         const QString &field, const QString &value)
+{
+    TreeItemInfo info;
+    info.type = type;
+    info.name = name;
+    info.id = QString::number(100 + index.size());
+    info.env = "qt";
+
+    // attributes are keyed by lower case name, like in MainWindow::attributesMap
+    QMap<QString, AttributeInfo> attributes;
+    if (!field.isEmpty()) {
+        AttributeInfo attribute;
+        attribute.name = field;
+        attribute.value = value;
+        attributes.insert(field.toLower(), attribute);
+    }
+    index.addNode(reinterpret_cast<TestObjectKey>(quintptr(index.size() + 1) * 16), info, attributes, parent);
+}
+
+
+void TestTDriverLocatorAnalyzer::initTestCase()
+{
+    addNode("sut", "sut_qt", -1);                                       // 0
+    addNode("application", "calculator", 0);                            // 1
+    addNode("QMainWindow", "MainWindow", 1);                            // 2
+    addNode("QPushButton", "okButton", 2, "text", "OK");                // 3
+    addNode("QPushButton", "digit", 2, "text", "1");                    // 4
+    addNode("QPushButton", "digit", 2, "text", "2");                    // 5
+    addNode("QPushButton", "op", 2, "text", "1");                       // 6
+    addNode("QWidget", "leftPanel", 2);                                 // 7
+    addNode("QPushButton", "NoName", 7, "text", "Clear");               // 8
+    index.setSubtreeEnd(7, 9);
+    addNode("QWidget", "rightPanel", 2);                                // 9
+    addNode("QPushButton", "NoName", 9, "text", "Clear");               // 10
+    index.setSubtreeEnd(9, 11);
+    addNode("QToolBar", "NoName", 2);                                   // 11
+    addNode("QToolButton", "NoName", 11);                               // 12
+    addNode("QToolButton", "NoName", 11);                               // 13
+    addNode("QCheckBox", "NoName", 11, "text", "Bold");                 // 14
+    addNode("QCheckBox", "NoName", 11, "text", "Bold");                 // 15
+    index.setSubtreeEnd(11, 16);
+    index.setSubtreeEnd(2, 16);
+    addNode("QDialog", "NoName", 1, "windowTitle", "About");            // 16
+    addNode("QDialog", "NoName", 1, "windowTitle", "Settings");         // 17
+    addNode("QLabel", "NoName", 17, "text", "It's");                    // 18
+    addNode("QLabel", "NoName", 17, "text", "Ready");                   // 19
+    addNode("QCheckBox", "NoName", 17, "text", "Italic");               // 20
+    index.setSubtreeEnd(17, 21);
+    index.setSubtreeEnd(1, 21);
+    index.setSubtreeEnd(0, 21);
+}
+
+
+void TestTDriverLocatorAnalyzer::uniqueLocator_data()
+{
+    QTest::addColumn<int>("node");
+    QTest::addColumn<QString>("expected");
+
+    QTest::newRow("sut") << 0 << "";
+    QTest::newRow("application") << 1 << "";
+    QTest::newRow("only of type") << 2 << "QMainWindow()";
+    QTest::newRow("unique name") << 3 << "QPushButton( :name => 'okButton' )";
+    QTest::newRow("two attributes") << 4 << "QPushButton( :name => 'digit', :text => '1' )";
+    QTest::newRow("rarest attribute") << 5 << "QPushButton( :text => '2' )";
+    QTest::newRow("parent") << 8 << "QWidget( :name => 'leftPanel' ).QPushButton( :text => 'Clear' )";
+    QTest::newRow("other parent") << 10 << "QWidget( :name => 'rightPanel' ).QPushButton( :text => 'Clear' )";
+    QTest::newRow("index without attributes") << 13 << "QToolButton( :__index => 1 )";
+    QTest::newRow("index with attributes") << 15 << "QCheckBox( :text => 'Bold', :__index => 1 )";
+    QTest::newRow("attribute name case") << 16 << "QDialog( :windowTitle => 'About' )";
+    QTest::newRow("quoted value") << 18 << "QLabel( :text => 'It\\'s' )";
+}
+
+
+void TestTDriverLocatorAnalyzer::uniqueLocator()
+{
+    QFETCH(int, node);
+    QFETCH(QString, expected);
+
+    TDriverLocatorAnalyzer analyzer;
+    QCOMPARE(analyzer.uniqueLocator(index, node), expected);
+}
+
+
+void TestTDriverLocatorAnalyzer::allLocatorsUnique()
+{
+    // every given locator selects exactly its own object with the locator engine
+    TDriverLocatorAnalyzer analyzer;
+    for (int node = 2; node < index.size(); ++node) {
+        const QString locator = analyzer.uniqueLocator(index, node);
+        QVERIFY2(!locator.isEmpty(), qPrintable(QString::number(node)));
+        QCOMPARE(TDriverLocator::compile(locator).evaluate(index), QVector<int>() << node);
+    }
+}
+
+
+void TestTDriverLocatorAnalyzer::keptUntilCleared()
+{
+    TDriverLocatorAnalyzer analyzer;
+    const QString locator = analyzer.uniqueLocator(index, 8);
+    QCOMPARE(analyzer.uniqueLocator(index, 8), locator);
+
+    analyzer.clear();
+    QCOMPARE(analyzer.uniqueLocator(index, 8), locator);
+}
+
+
+QTEST_APPLESS_MAIN(TestTDriverLocatorAnalyzer)
+
+#include "tst_tdriver_locator_analyzer.moc"
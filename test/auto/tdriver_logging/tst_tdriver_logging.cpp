@@ -0,0 +1,98 @@
+/***************************************************************************
+**
+** Copyright (C) 2010 Nokia Corporation and/or its subsidiary(-ies).
+** All rights reserved.
+** Contact: Nokia Corporation (testabilitydriver@nokia.com)
+**
+** This file is part of Testability Driver.
+**
+** If you have questions regarding the use of this file, please contact
+** Nokia at testabilitydriver@nokia.com .
+**
+** This library is free software; you can redistribute it and/or
+** modify it under the terms of the GNU Lesser General Public
+** License version 2.1 as published by the Free Software Foundation
+** and appearing in the file LICENSE.LGPL included in the packaging
+** of this file.
+**
+****************************************************************************/
+
+
+#include <QtTest>
+
+#include <tdriver_logging.h>
+#include <tdriver_debug_macros.h>
+
+// Compares debug output of a disabled category with unconditional qDebug, which
+// formatted every sent and received RBI message before categories were used.
+// Run with "tst_tdriver_logging -tickcounter" or "-callgrind" for stable numbers.
+class TestTDriverLogging : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void initTestCase();
+    void cleanupTestCase();
+    void defaultLevels();
+    void disabledCategory();
+    void unconditionalDebug();
+
+private:
+    BAListMap message;
+    QtMessageHandler previousHandler;
+};
+
+
+static void discardMessage(QtMsgType, const QMessageLogContext &, const QString &)
+{
+}
+
+
+void TestTDriverLogging::initTestCase()
+{
+    // typical refresh_ui request with its reply file name
+    message["command"] << "sut_qt" << "refresh_ui" << "calculator" << "30";
+    message["file"] << "/tmp/visualizer_dump_sut_qt.xml";
+
+    // benchmarks measure formatting, not writing to terminal
+    previousHandler = qInstallMessageHandler(discardMessage);
+}
+
+
+void TestTDriverLogging::cleanupTestCase()
+{
+    qInstallMessageHandler(previousHandler);
+}
+
+
+void TestTDriverLogging::defaultLevels()
+{
+    QVERIFY(!logRbi().isDebugEnabled());
+    QVERIFY(!logUi().isDebugEnabled());
+    QVERIFY(!logTree().isDebugEnabled());
+    QVERIFY(logRbi().isWarningEnabled());
+    QVERIFY(logTree().isWarningEnabled());
+}
+
+
+void TestTDriverLogging::disabledCategory()
+{
+    quint32 seqNum = 0;
+    QBENCHMARK {
+        qCDebug(logRbi) << FCFL << "SENDING" << ++seqNum << "visualization" << message;
+    }
+}
+
+
+void TestTDriverLogging::unconditionalDebug()
+{
+    quint32 seqNum = 0;
+    QBENCHMARK {
+        qDebug() << FCFL << "SENDING" << ++seqNum << "visualization" << message;
+    }
+}
+
+
+QTEST_APPLESS_MAIN(TestTDriverLogging)
+
+#include "tst_tdriver_logging.moc"
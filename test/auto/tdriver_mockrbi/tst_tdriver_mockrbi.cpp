@@ -0,0 +1,188 @@
+/***************************************************************************
+**
+** Copyright (C) 2010 Nokia Corporation and/or its subsidiary(-ies).
+** All rights reserved.
+** Contact: Nokia Corporation (testabilitydriver@nokia.com)
+**
+** This file is part of Testability Driver.
+**
+** If you have questions regarding the use of this file, please contact
+** Nokia at testabilitydriver@nokia.com .
+**
+** This library is free software; you can redistribute it and/or
+** modify it under the terms of the GNU Lesser General Public
+** License version 2.1 as published by the Free Software Foundation
+** and appearing in the file LICENSE.LGPL included in the packaging
+** of this file.
+**
+****************************************************************************/
+
+
+#include <QtTest>
+
+#include <tdriver_rubyinterface.h>
+#include <tdriver_rbidispatcher.h>
+#include <tdriver_util.h>
+
+// Drives TDriverRubyInterface and TDriverRbiDispatcher against tdriver_mockrbi,
+// which replaces tdriver_interface.rb, so no Ruby, TDriver or SUT is needed.
+class TestTDriverMockRbi : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void initTestCase();
+    void cleanupTestCase();
+    void goOnline();
+    void checkVersion();
+    void invalidCommand();
+    void concurrentReplyOrder();
+    void cancelConcurrent();
+    void cancelUnknown();
+
+public slots:
+    void receiveRbiMessage(TDriverRbiMessage message);
+
+private:
+    quint32 sendVisualization(const BAList &input);
+    BAListMap reply(quint32 seqNum) const { return replies.value(seqNum).map(); }
+
+    QHash<quint32, TDriverRbiMessage> replies;
+    QList<quint32> replyOrder;
+};
+
+
+// refresh_ui and refresh_image are executed concurrently by the listener,
+// so with these latencies the image reply arrives first
+static const char uiLatency[] = "500";
+static const char imageLatency[] = "0";
+static const int replyTimeout = 10000;
+
+
+void TestTDriverMockRbi::initTestCase()
+{
+    qRegisterMetaType<BAList>("BAList");
+    qRegisterMetaType<BAListMap>("BAListMap");
+
+    const QString listener = QDir(QCoreApplication::applicationDirPath()).filePath("tdriver_mockrbi");
+    if (!QFileInfo(listener).isExecutable()) {
+        QSKIP("tdriver_mockrbi not built next to the test");
+    }
+
+    // listener inherits environment of TDriverRubyInterface
+    qputenv("TDRIVER_VISUALIZER_LISTENER", QFile::encodeName(listener));
+    qputenv("TDRIVER_MOCKRBI_LATENCY", uiLatency);
+    qputenv("TDRIVER_MOCKRBI_IMAGE_LATENCY", imageLatency);
+    qputenv("TDRIVER_MOCKRBI_OBJECTS", "20");
+    qputenv("TDRIVER_MOCKRBI_IMAGE_SIZE", "40x80");
+
+    TDriverRbiDispatcher::globalInstance()->subscribe(TDriverUtil::visualizationId, this,
+                                                      SLOT(receiveRbiMessage(TDriverRbiMessage)));
+    TDriverRubyInterface::startGlobalInstance();
+}
+
+
+void TestTDriverMockRbi::cleanupTestCase()
+{
+    TDriverRubyInterface *rbi = TDriverRubyInterface::globalInstance();
+    if (!rbi) return;
+
+    rbi->requestClose();
+    rbi->quit();
+    QVERIFY(rbi->wait(replyTimeout));
+}
+
+
+void TestTDriverMockRbi::receiveRbiMessage(TDriverRbiMessage message)
+{
+    replies.insert(message.seqNum(), message);
+    replyOrder << message.seqNum();
+}
+
+
+quint32 TestTDriverMockRbi::sendVisualization(const BAList &input)
+{
+    BAListMap msg;
+    msg["input"] = input;
+    return TDriverRubyInterface::globalInstance()->sendCmd(TDriverUtil::visualizationId, msg);
+}
+
+
+void TestTDriverMockRbi::goOnline()
+{
+    TDriverRubyInterface *rbi = TDriverRubyInterface::globalInstance();
+    QCOMPARE(rbi->goOnline(), QString());
+    QVERIFY(rbi->isOnline());
+    QCOMPARE(rbi->getRbiVersion(), int(TDriverRubyInterface::REQUIRED_TDRIVER_INTERFACE_RB_VERSION));
+    QCOMPARE(rbi->getTDriverVersion(), QString("mock"));
+    QVERIFY(rbi->getPort() > 0);
+}
+
+
+void TestTDriverMockRbi::checkVersion()
+{
+    quint32 seqNum = sendVisualization(BAList() << "sut_qt" << "check_version");
+    QVERIFY(seqNum > 0);
+    QTRY_VERIFY_WITH_TIMEOUT(replies.contains(seqNum), replyTimeout);
+
+    QCOMPARE(replies.value(seqNum).name(), QByteArray(TDriverUtil::visualizationId));
+    QCOMPARE(reply(seqNum).value("version"), BAList() << "mock");
+    QVERIFY(!reply(seqNum).contains("error"));
+}
+
+
+void TestTDriverMockRbi::invalidCommand()
+{
+    quint32 seqNum = sendVisualization(BAList() << "sut_qt" << "no_such_command");
+    QVERIFY(seqNum > 0);
+    QTRY_VERIFY_WITH_TIMEOUT(replies.contains(seqNum), replyTimeout);
+
+    QVERIFY(reply(seqNum).contains("exception"));
+    QVERIFY(reply(seqNum).value("error").value(0).contains("no_such_command"));
+}
+
+
+void TestTDriverMockRbi::concurrentReplyOrder()
+{
+    quint32 uiSeqNum = sendVisualization(BAList() << "sut_qt" << "refresh_ui");
+    quint32 imageSeqNum = sendVisualization(BAList() << "sut_qt" << "refresh_image");
+    QVERIFY(uiSeqNum > 0 && imageSeqNum > uiSeqNum);
+    QTRY_VERIFY_WITH_TIMEOUT(replies.contains(uiSeqNum) && replies.contains(imageSeqNum), replyTimeout);
+
+    QVERIFY(replyOrder.indexOf(imageSeqNum) < replyOrder.indexOf(uiSeqNum));
+    QVERIFY(QFileInfo(QFile::decodeName(reply(uiSeqNum).value("ui_filename").value(0))).isReadable());
+    QVERIFY(QFileInfo(QFile::decodeName(reply(imageSeqNum).value("image_filename").value(0))).isReadable());
+}
+
+
+void TestTDriverMockRbi::cancelConcurrent()
+{
+    quint32 uiSeqNum = sendVisualization(BAList() << "sut_qt" << "refresh_ui");
+    quint32 cancelSeqNum = sendVisualization(BAList() << "sut_qt" << "cancel" << QByteArray::number(uiSeqNum));
+    QVERIFY(uiSeqNum > 0 && cancelSeqNum > uiSeqNum);
+    QTRY_VERIFY_WITH_TIMEOUT(replies.contains(uiSeqNum) && replies.contains(cancelSeqNum), replyTimeout);
+
+    // cancelled request gets its reply right away instead of after latency, with no data
+    QVERIFY(reply(cancelSeqNum).isEmpty());
+    QCOMPARE(reply(uiSeqNum).value("cancelled"), BAList() << QByteArray::number(uiSeqNum));
+    QVERIFY(!reply(uiSeqNum).contains("ui_filename"));
+
+    // and nothing else arrives for it when latency has passed
+    QTest::qWait(QByteArray(uiLatency).toInt() * 2);
+    QCOMPARE(replyOrder.count(uiSeqNum), 1);
+}
+
+
+void TestTDriverMockRbi::cancelUnknown()
+{
+    quint32 cancelSeqNum = sendVisualization(BAList() << "sut_qt" << "cancel" << "999999");
+    QVERIFY(cancelSeqNum > 0);
+    QTRY_VERIFY_WITH_TIMEOUT(replies.contains(cancelSeqNum), replyTimeout);
+    QVERIFY(reply(cancelSeqNum).isEmpty());
+    QVERIFY(!replies.contains(999999));
+}
+
+
+QTEST_GUILESS_MAIN(TestTDriverMockRbi)
+
+#include "tst_tdriver_mockrbi.moc"
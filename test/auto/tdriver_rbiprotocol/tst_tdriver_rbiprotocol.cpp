@@ -0,0 +1,152 @@
+/***************************************************************************
+**
+** Copyright (C) 2010 Nokia Corporation and/or its subsidiary(-ies).
+** All rights reserved.
+** Contact: Nokia Corporation (testabilitydriver@nokia.com)
+**
+** This file is part of Testability Driver.
+**
+** If you have questions regarding the use of this file, please contact
+** Nokia at testabilitydriver@nokia.com .
+**
+** This library is free software; you can redistribute it and/or
+** modify it under the terms of the GNU Lesser General Public
+** License version 2.1 as published by the Free Software Foundation
+** and appearing in the file LICENSE.LGPL included in the packaging
+** of this file.
+**
+****************************************************************************/
+
+
+#include <QtTest>
+#include <QDataStream>
+
+#include <tdriver_rbiprotocol.h>
+
+
+class TestTDriverRbiProtocol : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void makeMessage_data();
+    void makeMessage();
+    void appendsToTarget();
+    void parseListMap_data();
+    void parseListMap();
+};
+
+
+// message as written by the nested QDataStream buffers of earlier versions,
+// which tdriver_interface.rb has been written against
+static QByteArray dataStreamMessage(const QByteArray &name, const BAListMap &msg, quint32 seqNum)
+{
+    QByteArray target;
+    QDataStream msgStream(&target, QIODevice::Append | QIODevice::WriteOnly);
+    msgStream << seqNum;
+    msgStream << name;
+
+    QByteArray mapBuf;
+    {
+        QDataStream mapStream(&mapBuf, QIODevice::WriteOnly | QIODevice::Append);
+        BAListMap::const_iterator mapIter;
+        for (mapIter = msg.constBegin(); mapIter != msg.constEnd(); ++mapIter) {
+            mapStream << mapIter.key();
+            QByteArray listBuf;
+            {
+                QDataStream listStream(&listBuf, QIODevice::WriteOnly | QIODevice::Append);
+                foreach (const QByteArray &listItem, mapIter.value()) {
+                    listStream << listItem;
+                }
+            }
+            mapStream << listBuf;
+        }
+    }
+    msgStream << mapBuf;
+    return target;
+}
+
+
+static void addMessageRows()
+{
+    QTest::addColumn<QByteArray>("name");
+    QTest::addColumn<BAListMap>("msg");
+
+    BAListMap command;
+    command["command"] << "sut_qt" << "refresh_ui" << "calculator";
+    command["timeout"] << "30";
+
+    BAListMap emptyList;
+    emptyList["command"] << "ping";
+    emptyList["args"] = BAList();
+
+    BAListMap emptyItems;
+    emptyItems["items"] << QByteArray() << QByteArray("") << "x";
+
+    BAListMap binary;
+    binary["data"] << QByteArray("\0\xff\n\r\x01", 5) << QByteArray(70000, 'a');
+
+    QTest::newRow("empty map") << QByteArray("hello") << BAListMap();
+    QTest::newRow("null name") << QByteArray() << command;
+    QTest::newRow("command") << QByteArray("visualization") << command;
+    QTest::newRow("empty list") << QByteArray("visualization") << emptyList;
+    QTest::newRow("null and empty items") << QByteArray("interaction") << emptyItems;
+    QTest::newRow("binary and large items") << QByteArray("interaction") << binary;
+}
+
+
+void TestTDriverRbiProtocol::makeMessage_data()
+{
+    addMessageRows();
+}
+
+
+void TestTDriverRbiProtocol::makeMessage()
+{
+    QFETCH(QByteArray, name);
+    QFETCH(BAListMap, msg);
+
+    QByteArray message;
+    TDriverRbiProtocol::makeStringListMapMsg(message, name, msg, 0x01020304);
+
+    QCOMPARE(message.size(), TDriverRbiProtocol::stringListMapMsgSize(name, msg));
+    QCOMPARE(message, dataStreamMessage(name, msg, 0x01020304));
+}
+
+
+void TestTDriverRbiProtocol::appendsToTarget()
+{
+    BAListMap msg;
+    msg["command"] << "ping";
+
+    QByteArray message("previous");
+    TDriverRbiProtocol::makeStringListMapMsg(message, "name", msg, 7);
+
+    QVERIFY(message.startsWith("previous"));
+    QCOMPARE(message.mid(8), dataStreamMessage("name", msg, 7));
+}
+
+
+void TestTDriverRbiProtocol::parseListMap_data()
+{
+    addMessageRows();
+}
+
+
+void TestTDriverRbiProtocol::parseListMap()
+{
+    QFETCH(QByteArray, name);
+    QFETCH(BAListMap, msg);
+
+    QByteArray message;
+    TDriverRbiProtocol::makeStringListMapMsg(message, name, msg, 1);
+
+    // map data follows seqNum, name and map data length
+    const QByteArray mapData = message.mid(3 * sizeof(quint32) + name.size());
+    QCOMPARE(TDriverRbiProtocol::parseListMap(mapData), msg);
+}
+
+
+QTEST_APPLESS_MAIN(TestTDriverRbiProtocol)
+
+#include "tst_tdriver_rbiprotocol.moc"
@@ -0,0 +1,193 @@
+/***************************************************************************
+**
+** Copyright (C) 2010 Nokia Corporation and/or its subsidiary(-ies).
+** All rights reserved.
+** Contact: Nokia Corporation (testabilitydriver@nokia.com)
+**
+** This file is part of Testability Driver.
+**
+** If you have questions regarding the use of this file, please contact
+** Nokia at testabilitydriver@nokia.com .
+**
+** This library is free software; you can redistribute it and/or
+** modify it under the terms of the GNU Lesser General Public
+** License version 2.1 as published by the Free Software Foundation
+** and appearing in the file LICENSE.LGPL included in the packaging
+** of this file.
+**
+****************************************************************************/
+
+
+#include <QtTest>
+#include <QBuffer>
+
+#include <tdriver_signals_cache.h>
+
+
+class TestTDriverSignalsCache : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void insertAndLookup();
+    void parseBatch();
+    void parseBatchFailedType();
+    void parseBatchError();
+    void failedReplacedByList();
+    void invalidateRestarted();
+    void appIdChange();
+    void clear();
+};
+
+
+// list_signals_batch reply as written by get_signals_batch_xml in tdriver_interface.rb
+static const char batchXml[] =
+        "<signalsBatch>\n"
+        "<type name=\"QPushButton\" env=\"qt\">\n"
+        "<tasMessage version=\"1.3\"><tasInfo id=\"1\" name=\"QtSignals\" type=\"QtSignals\">\n"
+        "  <obj env=\"qt\" id=\"27\" name=\"pressed()\" type=\"QtSignal\" />\n"
+        "  <obj env=\"qt\" id=\"30\" name=\"clicked()\" type=\"QtSignal\" />\n"
+        "</tasInfo></tasMessage>\n"
+        "</type>\n"
+        "<type name=\"QLabel\" env=\"qt\">\n"
+        "<tasMessage version=\"1.3\"><tasInfo id=\"1\" name=\"QtSignals\" type=\"QtSignals\">\n"
+        "  <object id=\"0\" name=\"linkActivated(QString)\" type=\"QtSignal\"></object>\n"
+        "</tasInfo></tasMessage>\n"
+        "</type>\n"
+        "<type name=\"My&lt;Widget&gt;\" env=\"qt\" error=\"RuntimeError: no &quot;signal&quot; fixture\"/>\n"
+        "</signalsBatch>\n";
+
+
+static int parseBatch(TDriverSignalsCache &cache, const QByteArray &xml, const QString &appName, const QString &appId)
+{
+    QBuffer buffer;
+    buffer.setData(xml);
+    buffer.open(QIODevice::ReadOnly);
+    return cache.parseBatchXml(&buffer, appName, appId);
+}
+
+
+void TestTDriverSignalsCache::insertAndLookup()
+{
+    TDriverSignalsCache cache;
+    const QString key = TDriverSignalsCache::typeKey("QPushButton", "qt");
+    QCOMPARE(key, QString("QPushButton/qt"));
+
+    cache.insert("calculator", "100", key, QStringList() << "clicked()");
+    QVERIFY(cache.contains("calculator", key));
+    QCOMPARE(cache.value("calculator", key), QStringList() << "clicked()");
+
+    // lists are per application and per env
+    QVERIFY(!cache.contains("notes", key));
+    QVERIFY(!cache.contains("calculator", TDriverSignalsCache::typeKey("QPushButton", "qt,web")));
+
+    // empty list is a valid cached list
+    cache.insert("calculator", "100", "QFrame/qt", QStringList());
+    QVERIFY(cache.contains("calculator", "QFrame/qt"));
+
+    // foreground application has no name and is not cached
+    cache.insert(QString(), "0", key, QStringList() << "clicked()");
+    QVERIFY(!cache.contains(QString(), key));
+}
+
+
+void TestTDriverSignalsCache::parseBatch()
+{
+    TDriverSignalsCache cache;
+    QCOMPARE(parseBatch(cache, batchXml, "calculator", "100"), 2);
+
+    QCOMPARE(cache.value("calculator", "QPushButton/qt"), QStringList() << "pressed()" << "clicked()");
+    QCOMPARE(cache.value("calculator", "QLabel/qt"), QStringList() << "linkActivated(QString)");
+}
+
+
+void TestTDriverSignalsCache::parseBatchFailedType()
+{
+    TDriverSignalsCache cache;
+    QCOMPARE(parseBatch(cache, batchXml, "calculator", "100"), 2);
+
+    // failed type is not cached, only remembered so that prefetch skips it
+    QVERIFY(!cache.contains("calculator", "My<Widget>/qt"));
+    QVERIFY(cache.isFailed("calculator", "My<Widget>/qt"));
+    QVERIFY(!cache.isFailed("calculator", "QPushButton/qt"));
+}
+
+
+void TestTDriverSignalsCache::parseBatchError()
+{
+    TDriverSignalsCache cache;
+    QString errorString;
+    QBuffer buffer;
+    buffer.setData("<signalsBatch><type name=\"QLabel\" env=\"qt\"><obj name=\"x()\"/>");
+    buffer.open(QIODevice::ReadOnly);
+
+    QCOMPARE(cache.parseBatchXml(&buffer, "calculator", "100", &errorString), -1);
+    QVERIFY(!errorString.isEmpty());
+    QVERIFY(!cache.contains("calculator", "QLabel/qt"));
+}
+
+
+void TestTDriverSignalsCache::failedReplacedByList()
+{
+    TDriverSignalsCache cache;
+    cache.insertFailed("calculator", "100", "QLabel/qt");
+    QVERIFY(cache.isFailed("calculator", "QLabel/qt"));
+
+    // list received later, for example from list_signals of a selected object
+    cache.insert("calculator", "100", "QLabel/qt", QStringList() << "linkActivated(QString)");
+    QVERIFY(!cache.isFailed("calculator", "QLabel/qt"));
+    QVERIFY(cache.contains("calculator", "QLabel/qt"));
+}
+
+
+void TestTDriverSignalsCache::invalidateRestarted()
+{
+    TDriverSignalsCache cache;
+    cache.insert("calculator", "100", "QPushButton/qt", QStringList() << "clicked()");
+    cache.insertFailed("calculator", "100", "QLabel/qt");
+    cache.insert("notes", "200", "QTextEdit/qt", QStringList() << "textChanged()");
+
+    // application list maps process id to name
+    QMap<QString, QString> applications;
+    applications.insert("100", "calculator");
+    applications.insert("200", "notes");
+    cache.invalidate(applications);
+    QVERIFY(cache.contains("calculator", "QPushButton/qt"));
+    QVERIFY(cache.contains("notes", "QTextEdit/qt"));
+
+    // calculator restarted with a new id, notes closed
+    applications.clear();
+    applications.insert("101", "calculator");
+    cache.invalidate(applications);
+    QVERIFY(!cache.contains("calculator", "QPushButton/qt"));
+    QVERIFY(!cache.isFailed("calculator", "QLabel/qt"));
+    QVERIFY(!cache.contains("notes", "QTextEdit/qt"));
+}
+
+
+void TestTDriverSignalsCache::appIdChange()
+{
+    TDriverSignalsCache cache;
+    cache.insert("calculator", "100", "QPushButton/qt", QStringList() << "clicked()");
+
+    // list of restarted application replaces lists of the previous process
+    cache.insert("calculator", "101", "QLabel/qt", QStringList() << "linkActivated(QString)");
+    QVERIFY(!cache.contains("calculator", "QPushButton/qt"));
+    QVERIFY(cache.contains("calculator", "QLabel/qt"));
+}
+
+
+void TestTDriverSignalsCache::clear()
+{
+    TDriverSignalsCache cache;
+    QCOMPARE(parseBatch(cache, batchXml, "calculator", "100"), 2);
+
+    cache.clear();
+    QVERIFY(!cache.contains("calculator", "QPushButton/qt"));
+    QVERIFY(!cache.isFailed("calculator", "My<Widget>/qt"));
+}
+
+
+QTEST_APPLESS_MAIN(TestTDriverSignalsCache)
+
+#include "tst_tdriver_signals_cache.moc"
@@ -0,0 +1,112 @@
+/***************************************************************************
+**
+** Copyright (C) 2010 Nokia Corporation and/or its subsidiary(-ies).
+** All rights reserved.
+** Contact: Nokia Corporation (testabilitydriver@nokia.com)
+**
+** This file is part of Testability Driver.
+**
+** If you have questions regarding the use of this file, please contact
+** Nokia at testabilitydriver@nokia.com .
+**
+** This library is free software; you can redistribute it and/or
+** modify it under the terms of the GNU Lesser General Public
+** License version 2.1 as published by the Free Software Foundation
+** and appearing in the file LICENSE.LGPL included in the packaging
+** of this file.
+**
+****************************************************************************/
+
+
+#include <QtTest>
+
+#include <tdriver_xml_view.h>
+
+
+class TestTDriverXmlView : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void search_data();
+    void search();
+    void searchWithoutData();
+};
+
+
+// Button 0, okButton 7, BUTTON 16, button_1 23, button 32
+static const char words[] = "Button okButton BUTTON button_1 button";
+
+
+void TestTDriverXmlView::search_data()
+{
+    QTest::addColumn<QByteArray>("data");
+    QTest::addColumn<QString>("pattern");
+    QTest::addColumn<int>("from");
+    QTest::addColumn<bool>("caseSensitive");
+    QTest::addColumn<bool>("entireWords");
+    QTest::addColumn<bool>("backwards");
+    QTest::addColumn<int>("expected");
+
+    const QByteArray data(words);
+    const int size = data.size();
+
+    QTest::newRow("forward at from") << data << "Button" << 0 << true << false << false << 0;
+    QTest::newRow("forward after from") << data << "Button" << 1 << true << false << false << 9;
+    QTest::newRow("forward case sensitive") << data << "button" << 0 << true << false << false << 23;
+    QTest::newRow("forward ignoring case") << data << "button" << 1 << false << false << false << 9;
+    QTest::newRow("forward entire words") << data << "button" << 0 << true << true << false << 32;
+    QTest::newRow("forward entire words ignoring case") << data << "button" << 1 << false << true << false << 16;
+    QTest::newRow("forward past last") << data << "button" << 33 << false << false << false << -1;
+    QTest::newRow("forward not found") << data << "Label" << 0 << false << false << false << -1;
+
+    QTest::newRow("backwards from end") << data << "Button" << size << true << false << true << 9;
+    QTest::newRow("backwards ignoring case") << data << "button" << size << false << false << true << 32;
+    QTest::newRow("backwards before from") << data << "button" << 31 << false << false << true << 23;
+    QTest::newRow("backwards entire words") << data << "button" << 31 << false << true << true << 16;
+    QTest::newRow("backwards at from") << data << "Button" << 0 << true << false << true << 0;
+    QTest::newRow("backwards before start") << data << "Button" << -1 << true << false << true << -1;
+    QTest::newRow("backwards not found") << data << "Label" << size << false << false << true << -1;
+
+    // bytes of multibyte utf-8 characters are word characters: "ä" 0, "abc" 2 and 6
+    const QByteArray utf8("\xc3\xa4" "abc abc");
+    QTest::newRow("utf-8 word forward") << utf8 << "abc" << 0 << true << true << false << 6;
+    QTest::newRow("utf-8 word backwards") << utf8 << "abc" << utf8.size() << true << true << true << 6;
+    QTest::newRow("utf-8 pattern") << utf8 << QString::fromUtf8("\xc3\xa4" "a") << 0 << true << false << false << 0;
+
+    // only ascii letters are folded
+    QTest::newRow("non-ascii case") << utf8 << QString::fromUtf8("\xc3\x84" "a") << 0 << false << false << false << -1;
+
+    QTest::newRow("tag") << QByteArray("<obj name=\"a\"><obj name=\"b\"/></obj>")
+                         << "<obj" << 1 << true << false << false << 14;
+    QTest::newRow("longer than data") << QByteArray("abc") << "abcd" << 0 << true << false << false << -1;
+    QTest::newRow("empty pattern") << data << "" << 0 << true << false << false << -1;
+}
+
+
+void TestTDriverXmlView::search()
+{
+    QFETCH(QByteArray, data);
+    QFETCH(QString, pattern);
+    QFETCH(int, from);
+    QFETCH(bool, caseSensitive);
+    QFETCH(bool, entireWords);
+    QFETCH(bool, backwards);
+    QFETCH(int, expected);
+
+    QCOMPARE(TDriverXmlView::search(data.constData(), data.size(), pattern.toUtf8(), from,
+                                    caseSensitive, entireWords, backwards),
+             qint64(expected));
+}
+
+
+void TestTDriverXmlView::searchWithoutData()
+{
+    QCOMPARE(TDriverXmlView::search(NULL, 0, "a", 0, true, false, false), qint64(-1));
+    QCOMPARE(TDriverXmlView::search(NULL, 0, "a", 0, true, false, true), qint64(-1));
+}
+
+
+QTEST_APPLESS_MAIN(TestTDriverXmlView)
+
+#include "tst_tdriver_xml_view.moc"
@@ -36,3 +36,9 @@ QMAKE_LIBDIR = $$DESTDIR $$QMAKE_LIBDIR
 CONFIG(no_sql) {
     DEFINES *= TDRIVER_NO_SQL
 }
+
+# debug output (qDebug and qCDebug) is compiled out from release builds,
+# use CONFIG+=keep_debug_output to keep it
+CONFIG(release, debug|release):!CONFIG(keep_debug_output) {
+    DEFINES *= QT_NO_DEBUG_OUTPUT
+}
@@ -26,6 +26,9 @@ SUBDIRS += common
 # library of independent utility classes, such as localization string database access
 SUBDIRS += libtdriverutil
 
+# mock replacement for tdriver_interface.rb, for testing and benchmarking without TDriver and SUT
+SUBDIRS += tdriver_mockrbi
+
 # library which implements code editor and ruby debugger widgets
 SUBDIRS += libtdrivereditor
 
@@ -41,4 +44,7 @@ SUBDIRS += tdriver_editor
 # Testability Driver fixture for tdriver_editor, for running feature tests
 SUBDIRS += fixtures
 
+# unit tests, run with "make check"
+SUBDIRS += test/auto
+
 CONFIG += ordered